@@ -0,0 +1,432 @@
+#include "Cache.h"
+
+#pragma warning(push, 0)
+
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/Chrono.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+
+#pragma warning(pop)
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "IO.h"
+
+namespace Cache
+{
+    // The cache is made of two kinds of files:
+    // - '<location hash>.slloc' maps the command line and cursor position to the type key found there.
+    // - '<type hash>.slentry' holds the .slbin produced.
+    // Both start with their write time and the files read by the parse with their stamps and content hashes, an edit can
+    // move the cursor onto another record so the location mapping is validated on its own and not only through the entry
+    // it points to.
+    // Files are written to a temporary and renamed in place so concurrent invocations never read partial entries.
+
+    using THash = unsigned long long;
+
+    enum { ENTRY_MAGIC = 0x41434C53, ENTRY_VERSION = 5 }; // 'SLCA', bumped with the embedded .slbin format
+
+    enum { STALE_TEMP_SECONDS = 600 }; // temporaries older than this belong to writers that died before the rename
+    enum { RACY_STAMP_SECONDS = 2 };   // coarsest file system stamp resolution (FAT), closer edits can share a stamp
+
+    struct Dependency
+    {
+        Dependency()
+            : size(0u)
+            , stamp(0u)
+            , hash(0u)
+        {}
+
+        std::string        path;
+        unsigned long long size;
+        unsigned long long stamp;     // nanoseconds
+        THash              hash;
+    };
+
+    struct GlobalParams
+    {
+        GlobalParams()
+            : maxBytes(0u)
+        {}
+
+        std::string        directory;
+        unsigned long long maxBytes;
+    };
+
+    GlobalParams g_params;
+
+    namespace Utils
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        THash Hash(llvm::StringRef data)
+        {
+            return llvm::xxHash64(data);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string GetEntryPath(const THash hash, const char* extension)
+        {
+            char filename[32];
+            snprintf(filename, sizeof(filename), "%016llx%s", hash, extension);
+
+            llvm::SmallString<256> path(g_params.directory);
+            llvm::sys::path::append(path, filename);
+            return path.str().str();
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        template<typename T> void Write(std::string& buffer, const T value)
+        {
+            buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void WriteString(std::string& buffer, llvm::StringRef str)
+        {
+            Write(buffer, static_cast<unsigned int>(str.size()));
+            buffer.append(str.data(), str.size());
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        template<typename T> bool Read(llvm::StringRef& buffer, T& value)
+        {
+            if (buffer.size() < sizeof(T)) return false;
+            memcpy(&value, buffer.data(), sizeof(T));
+            buffer = buffer.drop_front(sizeof(T));
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ReadString(llvm::StringRef& buffer, llvm::StringRef& str)
+        {
+            unsigned int size = 0u;
+            if (!Read(buffer, size) || buffer.size() < size) return false;
+            str = buffer.take_front(size);
+            buffer = buffer.drop_front(size);
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ReadFileData(std::unique_ptr<llvm::MemoryBuffer>& output, const std::string& path)
+        {
+            llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> file = llvm::MemoryBuffer::getFile(path, /*IsText*/ false, /*RequiresNullTerminator*/ false);
+            if (!file)
+            {
+                return false;
+            }
+            output = std::move(file.get());
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        unsigned long long GetNanoseconds(const llvm::sys::TimePoint<>& time)
+        {
+            return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count());
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool FillDependency(Dependency& dependency, bool computeHash)
+        {
+            llvm::sys::fs::file_status status;
+            if (llvm::sys::fs::status(dependency.path, status))
+            {
+                return false;
+            }
+
+            dependency.size  = status.getSize();
+            dependency.stamp = GetNanoseconds(status.getLastModificationTime());
+
+            if (computeHash)
+            {
+                std::unique_ptr<llvm::MemoryBuffer> data;
+                if (!ReadFileData(data, dependency.path))
+                {
+                    return false;
+                }
+                dependency.hash = Hash(data->getBuffer());
+            }
+
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsDependencyValid(const Dependency& stored, const unsigned long long writeTime)
+        {
+            Dependency current;
+            current.path = stored.path;
+
+            //same size and timestamp means same file, otherwise the content decides ( touched but unchanged files still hit )
+            if (!FillDependency(current, false) || current.size != stored.size)
+            {
+                return false;
+            }
+
+            //a file modified right before the entry was written can be edited again within the same stamp resolution
+            const unsigned long long racyWindow = static_cast<unsigned long long>(RACY_STAMP_SECONDS) * 1000000000ull;
+            const bool isStampReliable = stored.stamp + racyWindow <= writeTime;
+            return (isStampReliable && current.stamp == stored.stamp) || (FillDependency(current, true) && current.hash == stored.hash);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool WriteHeader(std::string& buffer, const TDependencies& dependencies)
+        {
+            Write(buffer, static_cast<unsigned int>(ENTRY_MAGIC));
+            Write(buffer, static_cast<unsigned int>(ENTRY_VERSION));
+            Write(buffer, GetNanoseconds(std::chrono::system_clock::now()));
+            Write(buffer, static_cast<unsigned int>(dependencies.size()));
+
+            for (const std::string& path : dependencies)
+            {
+                Dependency dependency;
+                dependency.path = path;
+                if (!FillDependency(dependency, true))
+                {
+                    //something we can't validate later on, do not cache
+                    return false;
+                }
+
+                WriteString(buffer, dependency.path);
+                Write(buffer, dependency.size);
+                Write(buffer, dependency.stamp);
+                Write(buffer, dependency.hash);
+            }
+
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ReadHeader(llvm::StringRef& buffer)
+        {
+            unsigned int magic = 0u;
+            unsigned int version = 0u;
+            unsigned long long writeTime = 0u;
+            unsigned int numDependencies = 0u;
+            if (!Read(buffer, magic) || magic != ENTRY_MAGIC || !Read(buffer, version) || version != ENTRY_VERSION || !Read(buffer, writeTime) || !Read(buffer, numDependencies))
+            {
+                return false;
+            }
+
+            for (unsigned int i = 0u; i < numDependencies; ++i)
+            {
+                Dependency dependency;
+                llvm::StringRef path;
+                if (!ReadString(buffer, path) || !Read(buffer, dependency.size) || !Read(buffer, dependency.stamp) || !Read(buffer, dependency.hash))
+                {
+                    return false;
+                }
+
+                dependency.path = path.str();
+                if (!IsDependencyValid(dependency, writeTime))
+                {
+                    LOG_INFO("Cache miss: %s changed.", dependency.path.c_str());
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool WriteAtomically(const std::string& path, llvm::StringRef data)
+        {
+            llvm::SmallString<256> tempPath;
+            int fd = -1;
+            if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%%%.tmp", fd, tempPath))
+            {
+                return false;
+            }
+
+            {
+                llvm::raw_fd_ostream stream(fd, /*shouldClose*/ true);
+                stream << data;
+                if (stream.has_error())
+                {
+                    stream.clear_error();
+                    llvm::sys::fs::remove(tempPath);
+                    return false;
+                }
+            }
+
+            if (llvm::sys::fs::rename(tempPath, path))
+            {
+                llvm::sys::fs::remove(tempPath);
+                return false;
+            }
+
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void Touch(const std::string& path)
+        {
+            int fd = -1;
+            if (!llvm::sys::fs::openFileForReadWrite(path, fd, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_None))
+            {
+                llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+                llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void Evict()
+        {
+            struct CacheFile
+            {
+                std::string                           path;
+                unsigned long long                    size;
+                llvm::sys::TimePoint<>                time;
+            };
+
+            std::vector<CacheFile> files;
+            unsigned long long totalSize = 0u;
+
+            const llvm::sys::TimePoint<> staleTime = std::chrono::system_clock::now() - std::chrono::seconds(STALE_TEMP_SECONDS);
+
+            std::error_code error;
+            for (llvm::sys::fs::directory_iterator it(g_params.directory, error), end; it != end && !error; it.increment(error))
+            {
+                const llvm::StringRef extension = llvm::sys::path::extension(it->path());
+                llvm::sys::fs::file_status status;
+                if ((extension == ".slentry" || extension == ".slloc" || extension == ".tmp") && !llvm::sys::fs::status(it->path(), status))
+                {
+                    //leftovers from crashed writers are removed, recent temporaries might still be renamed and only count
+                    if (extension == ".tmp" && status.getLastModificationTime() < staleTime && !llvm::sys::fs::remove(it->path()))
+                    {
+                        continue;
+                    }
+
+                    files.push_back(CacheFile{ it->path(), status.getSize(), status.getLastModificationTime() });
+                    totalSize += status.getSize();
+                }
+            }
+
+            if (totalSize <= g_params.maxBytes)
+            {
+                return;
+            }
+
+            //least recently used first, shrink a bit further than the limit to avoid evicting on every store
+            std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.time < b.time; });
+
+            const unsigned long long target = g_params.maxBytes - (g_params.maxBytes / 10u);
+            for (const CacheFile& file : files)
+            {
+                if (totalSize <= target) break;
+                if (llvm::sys::path::extension(file.path) == ".tmp") continue;
+
+                //another process might be using or removing it, just skip it on failure
+                if (!llvm::sys::fs::remove(file.path))
+                {
+                    totalSize -= file.size;
+                }
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void SetDirectory(const std::string& directory, const unsigned long long maxBytes)
+    {
+        g_params.directory = directory;
+        g_params.maxBytes  = maxBytes;
+
+        if (!directory.empty() && llvm::sys::fs::create_directories(directory))
+        {
+            LOG_WARNING("Unable to create the cache directory %s, caching disabled.", directory.c_str());
+            g_params.directory.clear();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool IsEnabled()
+    {
+        return !g_params.directory.empty();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Fetch(const std::string& locationKey, const char* outputFilename)
+    {
+        if (!IsEnabled())
+        {
+            return false;
+        }
+
+        const std::string locationPath = Utils::GetEntryPath(Utils::Hash(locationKey), ".slloc");
+
+        //the type found at the cursor is only trusted while the files it was parsed from are unchanged
+        std::unique_ptr<llvm::MemoryBuffer> locationData;
+        THash typeHash = 0u;
+        llvm::StringRef locationBuffer;
+        if (!Utils::ReadFileData(locationData, locationPath) || !Utils::ReadHeader(locationBuffer = locationData->getBuffer()) || !Utils::Read(locationBuffer, typeHash))
+        {
+            return false;
+        }
+
+        const std::string entryPath = Utils::GetEntryPath(typeHash, ".slentry");
+
+        //another location might have stored the entry since, with its own dependencies
+        std::unique_ptr<llvm::MemoryBuffer> entryData;
+        llvm::StringRef buffer;
+        if (!Utils::ReadFileData(entryData, entryPath) || !Utils::ReadHeader(buffer = entryData->getBuffer()))
+        {
+            return false;
+        }
+
+        //everything this result was built from is unchanged, the rest of the entry is the .slbin payload
+        if (!Utils::WriteAtomically(outputFilename, buffer))
+        {
+            return false;
+        }
+
+        Utils::Touch(locationPath);
+        Utils::Touch(entryPath);
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void Store(const std::string& locationKey, const std::string& typeName, const TDependencies& dependencies, const char* outputFilename)
+    {
+        if (!IsEnabled())
+        {
+            return;
+        }
+
+        std::unique_ptr<llvm::MemoryBuffer> payload;
+        if (!Utils::ReadFileData(payload, outputFilename))
+        {
+            return;
+        }
+
+        std::string header;
+        if (!Utils::WriteHeader(header, dependencies))
+        {
+            return;
+        }
+
+        std::string entry = header;
+        entry.append(payload->getBufferStart(), payload->getBufferSize());
+
+        //the type key is independent from the cursor, different locations resolving to the same type share the entry
+        //the location key is 'command line \n cursor [\n instantiation arguments]', the instantiations change the payload
+        const size_t commandEnd = locationKey.find('\n');
+        const size_t cursorEnd = commandEnd == std::string::npos ? std::string::npos : locationKey.find('\n', commandEnd + 1);
+        const std::string instantiations = cursorEnd == std::string::npos ? std::string() : locationKey.substr(cursorEnd);
+        const THash typeHash = Utils::Hash(locationKey.substr(0, commandEnd) + '\n' + typeName + instantiations);
+
+        std::string location = header;
+        Utils::Write(location, typeHash);
+
+        if (Utils::WriteAtomically(Utils::GetEntryPath(typeHash, ".slentry"), entry) &&
+            Utils::WriteAtomically(Utils::GetEntryPath(Utils::Hash(locationKey), ".slloc"), location))
+        {
+            Utils::Evict();
+        }
+    }
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Cache
+{
+	using TDependencies = std::vector<std::string>;
+
+	void SetDirectory(const std::string& directory, const unsigned long long maxBytes);
+	bool IsEnabled();
+
+	bool Fetch(const std::string& locationKey, const char* outputFilename);
+	void Store(const std::string& locationKey, const std::string& typeName, const TDependencies& dependencies, const char* outputFilename);
+}
@@ -7,17 +7,41 @@
 #include <clang/AST/ASTContext.h>
 #include <clang/AST/RecursiveASTVisitor.h>
 #include <clang/AST/RecordLayout.h>
+#include <clang/Frontend/ASTUnit.h>
 #include <clang/Frontend/CompilerInstance.h>
 #include <clang/Frontend/FrontendActions.h>
+#include <clang/Frontend/Utils.h>
+#include <clang/Index/USRGeneration.h>
+#include <clang/Lex/Lexer.h>
+#include <clang/Lex/Pragma.h>
+#include <clang/Lex/Preprocessor.h>
+#include <clang/Tooling/ArgumentsAdjusters.h>
 #include <clang/Tooling/CommonOptionsParser.h>
+#include <clang/Tooling/CompilationDatabase.h>
 #include <clang/Tooling/Tooling.h>
+#include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/PointerIntPair.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Regex.h>
+#include <llvm/Support/StringSaver.h>
+#include <llvm/Support/ThreadPool.h>
 
 #pragma warning(pop)    
 
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "Cache.h"
 #include "LayoutDefinitions.h"
+#include "LayoutPostProcess.h"
 #include "IO.h"
+#include "Trace.h"
 
 namespace ClangParser 
 {
@@ -27,46 +51,197 @@ namespace ClangParser
         unsigned int col;
     };
 
+    struct Timings
+    {
+        Timings()
+            : lookup(0)
+            , compute(0)
+        {}
+
+        // microseconds, summing per record milliseconds would round most of them down to zero
+        long long lookup;
+        long long compute;
+    };
+
+    struct RecordFilter
+    {
+        RecordFilter()
+            : enabled(false)
+        {}
+
+        bool        enabled;
+        std::string filePattern;
+        std::string namePattern;
+    };
+
     using TFilenameLookup = std::unordered_map<unsigned int,size_t>; 
-    TFilenameLookup        g_filenameLookup;
+    using TRecordSet      = std::unordered_set<std::string>;
+    using TRecordKey      = llvm::PointerIntPair<const clang::CXXRecordDecl*,1,bool>; 
+    using TRecordMemo     = llvm::DenseMap<TRecordKey,Layout::TIndex>;
+
+    // per thread as the scanner parses several translation units concurrently
+    thread_local TFilenameLookup g_filenameLookup;
+    thread_local Layout::Store   g_store;      // flat storage, records reused through the memo share their children range
+    thread_local TRecordMemo     g_recordMemo; // computed records for the current translation unit
+
+    thread_local Timings         g_timings;
 
-    Layout::Result         g_result;
     LocationFilter         g_locationFilter;
+    RecordFilter           g_recordFilter;
+    bool                   g_skipFunctionBodies = false;
+
+    // template arguments of the -instantiate requests, entered at the end of the main file by INSTANTIATE_PRAGMA
+    std::vector<std::string> g_instantiations;
+    constexpr const char*    INSTANTIATE_PRAGMA = "struct_layout_instantiate";
+
+    // files read by the last translation unit, only collected when the result cache is enabled
+    thread_local Cache::TDependencies g_dependencies;
+
+    // USRs of the records already exported by any translation unit
+    TRecordSet             g_exportedRecords;
+    std::mutex             g_exportedRecordsMutex;
 
     namespace Helpers
     {
-        void DestroyTree(Layout::Node* node)
+        long GetElapsedMiliseconds(const std::chrono::steady_clock::time_point& start)
+        { 
+            return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        long long GetElapsedMicroseconds(const std::chrono::steady_clock::time_point& start)
+        { 
+            return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        bool IsBeforeFilter(const clang::PresumedLoc& location)
+        { 
+            return location.getLine() < g_locationFilter.row || (location.getLine() == g_locationFilter.row && location.getColumn() < g_locationFilter.col);
+        }
+
+        bool IsAfterFilter(const clang::PresumedLoc& location)
         { 
-            if (node)
+            return location.getLine() > g_locationFilter.row || (location.getLine() == g_locationFilter.row && location.getColumn() > g_locationFilter.col);
+        }
+
+        bool CanContainFilter(const clang::SourceManager& sourceManager, const clang::SourceRange& range)
+        { 
+            const clang::SourceLocation begin = sourceManager.getExpansionLoc(range.getBegin());
+            if (!begin.isValid() || sourceManager.getFileID(begin) != sourceManager.getMainFileID())
             { 
-                for(Layout::Node* child : node->children) 
-                { 
-                    DestroyTree(child);
-                } 
+                return false;
+            }
+
+            const clang::PresumedLoc startLocation = sourceManager.getPresumedLoc(begin);
+            const clang::PresumedLoc endLocation = sourceManager.getPresumedLoc(range.getEnd());
+            return startLocation.isValid() && endLocation.isValid() && !IsAfterFilter(startLocation) && !IsBeforeFilter(endLocation);
+        }
+
+        bool CanSkipFunctionBody(const clang::Decl* declaration)
+        { 
+            if (g_recordFilter.enabled)
+            { 
+                //no location to look for
+                return true;
+            }
+
+            const clang::ASTContext& context = declaration->getASTContext();
+            const clang::SourceManager& sourceManager = context.getSourceManager();
+
+            //bodies outside the main file or starting after the location can't contain it
+            const clang::SourceLocation declarationEnd = sourceManager.getExpansionLoc(declaration->getEndLoc());
+            if (!declarationEnd.isValid() || sourceManager.getFileID(declarationEnd) != sourceManager.getMainFileID())
+            { 
+                return true;
+            }
+
+            const clang::PresumedLoc startLocation = sourceManager.getPresumedLoc(sourceManager.getExpansionLoc(declaration->getBeginLoc()));
+            if (startLocation.isInvalid() || !IsBeforeFilter(startLocation))
+            { 
+                return true;
+            }
+
+            //The body has not been parsed yet, raw lex from the declarator end to find its closing brace. 
+            //Braces found inside the parameters or directly after a member name in constructor initializers are not the body.
+            const std::pair<clang::FileID,unsigned> decomposed = sourceManager.getDecomposedLoc(declarationEnd);
+            const llvm::StringRef buffer = sourceManager.getBufferData(decomposed.first);
+            clang::Lexer lexer(sourceManager.getLocForStartOfFile(decomposed.first), context.getLangOpts(), buffer.begin(), buffer.begin() + decomposed.second, buffer.end());
+
+            clang::Token token;
+            lexer.LexFromRawLexer(token);
+
+            bool         initializers = false;
+            unsigned int nesting      = 0u;
+            unsigned int bodyDepth    = 0u;
+
+            while (token.isNot(clang::tok::eof))
+            { 
+                const clang::tok::TokenKind previous = token.getKind();
+                lexer.LexFromRawLexer(token);
 
-                delete node;
+                switch (token.getKind())
+                { 
+                case clang::tok::l_brace:
+                    if (bodyDepth > 0u) ++bodyDepth;
+                    else if (nesting == 0u && !(initializers && (previous == clang::tok::raw_identifier || previous == clang::tok::greater || previous == clang::tok::greatergreater))) bodyDepth = 1u;
+                    else ++nesting;
+                    break;
+                case clang::tok::r_brace:
+                    if (bodyDepth > 0u)
+                    { 
+                        if (--bodyDepth == 0u) return IsBeforeFilter(sourceManager.getPresumedLoc(token.getLocation()));
+                    }
+                    else if (nesting > 0u) --nesting;
+                    break;
+                case clang::tok::l_paren:
+                case clang::tok::l_square:
+                    if (bodyDepth == 0u) ++nesting;
+                    break;
+                case clang::tok::r_paren:
+                case clang::tok::r_square:
+                    if (bodyDepth == 0u && nesting > 0u) --nesting;
+                    break;
+                case clang::tok::colon:
+                    if (bodyDepth == 0u && nesting == 0u) initializers = true;
+                    break;
+                default: 
+                    break;
+                }
             }
+
+            return false;
         }
 
         void ClearResult()
         { 
             g_filenameLookup.clear();
-            Helpers::DestroyTree(ClangParser::g_result.node);
-            g_result.node = nullptr;
-            g_result.files.clear();
+            g_recordMemo.clear();
+            g_store.Clear();
         }
 
         size_t AddFileToDictionary(const clang::FileID fileId, const char* filename)
         {
-            const size_t nextIndex = g_result.files.size();
+            const size_t nextIndex = g_store.files.size();
             std::pair<TFilenameLookup::iterator,bool> const& result = g_filenameLookup.insert(TFilenameLookup::value_type(fileId.getHashValue(),nextIndex));
             if (result.second) 
             { 
-                g_result.files.emplace_back(filename);
+                g_store.files.emplace_back(filename);
             } 
             return result.first->second;
         }
 
+        bool ClaimRecord(const clang::CXXRecordDecl* declaration)
+        { 
+            llvm::SmallString<128> usr;
+            if (clang::index::generateUSRForDecl(declaration, usr))
+            { 
+                //no usr available, always export it
+                return true;
+            }
+
+            std::lock_guard<std::mutex> lock(g_exportedRecordsMutex);
+            return g_exportedRecords.insert(usr.str().str()).second;
+        }
+
         void RetrieveLocation(Layout::Location& output, const clang::ASTContext& context, const clang::SourceLocation& location)
         { 
             const clang::SourceManager& sourceManager = context.getSourceManager();
@@ -83,19 +258,73 @@ namespace ClangParser
             output.column    = startLocation.getColumn();
         }
 
-        Layout::Node* ComputeStruct(const clang::ASTContext& context, const clang::CXXRecordDecl* declaration, const bool includeVirtualBases = true)
+        std::string GetRecordName(const clang::ASTContext& context, const clang::CXXRecordDecl* declaration)
+        { 
+            if (!llvm::isa<clang::ClassTemplateSpecializationDecl>(declaration))
+            { 
+                return declaration->getQualifiedNameAsString();
+            }
+
+            //the qualified name alone would collapse every instantiation of a template into the same name
+            clang::PrintingPolicy policy = context.getPrintingPolicy();
+            policy.SuppressTagKeyword = true;
+            policy.FullyQualifiedName = true;
+            return clang::QualType(declaration->getTypeForDecl(), 0).getAsString(policy);
+        }
+
+        const clang::ClassTemplateDecl* GetDescribedTemplate(const clang::CXXRecordDecl* declaration)
+        { 
+            if (const clang::ClassTemplatePartialSpecializationDecl* partial = llvm::dyn_cast<clang::ClassTemplatePartialSpecializationDecl>(declaration))
+            { 
+                return partial->getSpecializedTemplate();
+            }
+            return declaration->getDescribedClassTemplate();
+        }
+
+        bool IsInstantiationOf(const clang::ClassTemplateSpecializationDecl* specialization, const clang::CXXRecordDecl* pattern)
+        { 
+            //explicit specializations have their own definition and location, they are found like any other record
+            const clang::TemplateSpecializationKind kind = specialization->getSpecializationKind();
+            if (kind == clang::TSK_Undeclared || kind == clang::TSK_ExplicitSpecialization || 
+                !specialization->isCompleteDefinition() || specialization->isDependentType() || specialization->isInvalidDecl())
+            { 
+                return false;
+            }
+
+            const llvm::PointerUnion<clang::ClassTemplateDecl*,clang::ClassTemplatePartialSpecializationDecl*> source = specialization->getSpecializedTemplateOrPartial();
+            if (const clang::ClassTemplatePartialSpecializationDecl* partial = source.dyn_cast<clang::ClassTemplatePartialSpecializationDecl*>())
+            { 
+                return partial->getCanonicalDecl() == pattern->getCanonicalDecl();
+            }
+            return !llvm::isa<clang::ClassTemplatePartialSpecializationDecl>(pattern);
+        }
+
+        Layout::TIndex ComputeStruct(const clang::ASTContext& context, const clang::CXXRecordDecl* declaration, const bool includeVirtualBases = true);
+
+        Layout::TIndex AddVTablePtr(const clang::ASTContext& context, const Layout::Category nature, const Layout::TAmount offset)
+        { 
+            Layout::FlatNode vPtrNode; 
+            vPtrNode.nature = nature; 
+            vPtrNode.offset = offset; 
+            vPtrNode.size   = context.toCharUnitsFromBits(context.getTargetInfo().getPointerWidth(clang::LangAS::Default)).getQuantity();
+            vPtrNode.align  = context.toCharUnitsFromBits(context.getTargetInfo().getPointerAlign(clang::LangAS::Default)).getQuantity();
+            return g_store.AddNode(vPtrNode);
+        }
+
+        Layout::TIndex ComputeStructPrototype(const clang::ASTContext& context, const clang::CXXRecordDecl* declaration, const bool includeVirtualBases)
         {
-            Layout::Node* node = new Layout::Node();
+            Layout::FlatNode node;
+            llvm::SmallVector<Layout::TIndex,16> children;
 
-            RetrieveLocation(node->typeLocation,context,declaration->getLocation());
+            RetrieveLocation(node.typeLocation,context,declaration->getLocation());
 
             const clang::ASTRecordLayout& layout = context.getASTRecordLayout(declaration);
 
             //basic data
-            node->isValid = !declaration->isInvalidDecl() && declaration->isCompleteDefinition();
-            node->type    = declaration->getQualifiedNameAsString();
-            node->size    = includeVirtualBases? layout.getSize().getQuantity() : layout.getNonVirtualSize().getQuantity();
-            node->align   = layout.getAlignment().getQuantity();
+            node.isValid = !declaration->isInvalidDecl() && declaration->isCompleteDefinition();
+            node.type    = g_store.strings.Intern(GetRecordName(context, declaration));
+            node.size    = includeVirtualBases? layout.getSize().getQuantity() : layout.getNonVirtualSize().getQuantity();
+            node.align   = layout.getAlignment().getQuantity();
 
             //Check for bases 
 
@@ -104,22 +333,12 @@ namespace ClangParser
             if(declaration->isDynamicClass() && !primaryBase && !context.getTargetInfo().getCXXABI().isMicrosoft())
             {
                 //vtable pointer
-                Layout::Node* vPtrNode = new Layout::Node(); 
-                vPtrNode->nature = Layout::Category::VTablePtr; 
-                vPtrNode->offset = 0u; 
-                vPtrNode->size   = context.toCharUnitsFromBits(context.getTargetInfo().getPointerWidth(clang::LangAS::Default)).getQuantity();
-                vPtrNode->align  = context.toCharUnitsFromBits(context.getTargetInfo().getPointerAlign(clang::LangAS::Default)).getQuantity();
-                node->children.push_back(vPtrNode);
+                children.push_back(AddVTablePtr(context, Layout::Category::VTablePtr, 0u));
             }
             else if(layout.hasOwnVFPtr())
             {
                 //vftable pointer
-                Layout::Node* vPtrNode = new Layout::Node();
-                vPtrNode->nature = Layout::Category::VFTablePtr;
-                vPtrNode->offset = 0u;
-                vPtrNode->size   = context.toCharUnitsFromBits(context.getTargetInfo().getPointerWidth(clang::LangAS::Default)).getQuantity();
-                vPtrNode->align  = context.toCharUnitsFromBits(context.getTargetInfo().getPointerAlign(clang::LangAS::Default)).getQuantity();
-                node->children.push_back(vPtrNode);
+                children.push_back(AddVTablePtr(context, Layout::Category::VFTablePtr, 0u));
             }
 
             //Collect nvbases
@@ -140,23 +359,19 @@ namespace ClangParser
             // compute nvbases
             for(const clang::CXXRecordDecl* base : bases)
             {
-                Layout::Node* baseNode = ComputeStruct(context,base,false); 
-                baseNode->offset = layout.getBaseClassOffset(base).getQuantity();
-                baseNode->nature = base == primaryBase? Layout::Category::NVPrimaryBase : Layout::Category::NVBase;
-                node->children.push_back(baseNode);
-                node->isValid = node->isValid && baseNode->isValid;
+                const Layout::TIndex baseIndex = ComputeStruct(context,base,false); 
+                Layout::FlatNode& baseNode = g_store.nodes[baseIndex];
+                baseNode.offset = layout.getBaseClassOffset(base).getQuantity();
+                baseNode.nature = base == primaryBase? Layout::Category::NVPrimaryBase : Layout::Category::NVBase;
+                children.push_back(baseIndex);
+                node.isValid = node.isValid && baseNode.isValid;
             }
 
             // vbptr (for Microsoft C++ ABI)
             if(layout.hasOwnVBPtr())
             {                
                 //vbtable pointer
-                Layout::Node* vPtrNode = new Layout::Node();
-                vPtrNode->nature = Layout::Category::VBTablePtr;
-                vPtrNode->offset = layout.getVBPtrOffset().getQuantity();
-                vPtrNode->size   = context.toCharUnitsFromBits(context.getTargetInfo().getPointerWidth(clang::LangAS::Default)).getQuantity();
-                vPtrNode->align  = context.toCharUnitsFromBits(context.getTargetInfo().getPointerAlign(clang::LangAS::Default)).getQuantity();
-                node->children.push_back(vPtrNode);
+                children.push_back(AddVTablePtr(context, Layout::Category::VBTablePtr, layout.getVBPtrOffset().getQuantity()));
             }
 
             //Check for fields 
@@ -170,16 +385,19 @@ namespace ClangParser
                 // Recursively visit fields of record type.
                 if (const clang::CXXRecordDecl* fieldDeclarationCXX = field.getType()->getAsCXXRecordDecl())
                 {
-                    Layout::Node* fieldNode = ComputeStruct(context,fieldDeclarationCXX,true);
-                    fieldNode->name   = field.getNameAsString();
-                    fieldNode->type   = field.getType().getAsString(); //check if this or qualified types form function is better
-                    fieldNode->offset = fieldOffset.getQuantity();
-                    fieldNode->nature = Layout::Category::ComplexField;
-
-                    RetrieveLocation(fieldNode->fieldLocation,context,field.getLocation());
-
-                    node->children.push_back(fieldNode);
-                    node->isValid = node->isValid && fieldNode->isValid;
+                    Layout::Location fieldLocation;
+                    RetrieveLocation(fieldLocation,context,field.getLocation());
+
+                    const Layout::TIndex fieldIndex = ComputeStruct(context,fieldDeclarationCXX,true);
+                    Layout::FlatNode& fieldNode = g_store.nodes[fieldIndex];
+                    fieldNode.name   = g_store.strings.Intern(field.getNameAsString());
+                    fieldNode.type   = g_store.strings.Intern(field.getType().getAsString()); //check if this or qualified types form function is better
+                    fieldNode.offset = fieldOffset.getQuantity();
+                    fieldNode.nature = Layout::Category::ComplexField;
+                    fieldNode.fieldLocation = fieldLocation;
+
+                    children.push_back(fieldIndex);
+                    node.isValid = node.isValid && fieldNode.isValid;
                 }
                 else
                 {
@@ -188,43 +406,46 @@ namespace ClangParser
                         const clang::TypeInfo fieldInfo = context.getTypeInfo(field.getType());
 
                         //bitfield
-                        Layout::Node* fieldNode = new Layout::Node();
-                        fieldNode->name    = field.getNameAsString(); 
-                        fieldNode->type    = field.getType().getAsString();
-                        fieldNode->isValid = !field.isInvalidDecl();
-
-                        fieldNode->nature = Layout::Category::Bitfield;
-                        fieldNode->offset = fieldOffset.getQuantity();
-                        fieldNode->size   = context.toCharUnitsFromBits(fieldInfo.Width).getQuantity();
-                        fieldNode->align  = context.toCharUnitsFromBits(fieldInfo.Align).getQuantity();
-
-                        Layout::Node* extraData = new Layout::Node();
-                        extraData->offset  = localFieldOffsetInBits - context.toBits(fieldOffset); 
-                        extraData->size    = field.getBitWidthValue(context);
-                        fieldNode->children.push_back(extraData);
-
-                        node->children.push_back(fieldNode);
-                        node->isValid = node->isValid && fieldNode->isValid;
+                        Layout::FlatNode fieldNode;
+                        fieldNode.name    = g_store.strings.Intern(field.getNameAsString()); 
+                        fieldNode.type    = g_store.strings.Intern(field.getType().getAsString());
+                        fieldNode.isValid = !field.isInvalidDecl();
+
+                        fieldNode.nature = Layout::Category::Bitfield;
+                        fieldNode.offset = fieldOffset.getQuantity();
+                        fieldNode.size   = context.toCharUnitsFromBits(fieldInfo.Width).getQuantity();
+                        fieldNode.align  = context.toCharUnitsFromBits(fieldInfo.Align).getQuantity();
+
+                        Layout::FlatNode extraData;
+                        extraData.offset  = localFieldOffsetInBits - context.toBits(fieldOffset); 
+                        extraData.size    = field.getBitWidthValue(context);
+                        const Layout::TIndex extraIndex = g_store.AddNode(extraData);
+
+                        const Layout::TIndex fieldIndex = g_store.AddNode(fieldNode);
+                        g_store.SetChildren(fieldIndex, &extraIndex, 1u);
+
+                        children.push_back(fieldIndex);
+                        node.isValid = node.isValid && fieldNode.isValid;
                     }
                     else
                     {
                         const clang::TypeInfo fieldInfo = context.getTypeInfo(field.getType());
 
                         //simple field
-                        Layout::Node* fieldNode = new Layout::Node();
-                        fieldNode->name    = field.getNameAsString(); 
-                        fieldNode->type    = field.getType().getAsString();
-                        fieldNode->isValid = !field.isInvalidDecl();
+                        Layout::FlatNode fieldNode;
+                        fieldNode.name    = g_store.strings.Intern(field.getNameAsString()); 
+                        fieldNode.type    = g_store.strings.Intern(field.getType().getAsString());
+                        fieldNode.isValid = !field.isInvalidDecl();
 
-                        fieldNode->nature = Layout::Category::SimpleField;
-                        fieldNode->offset = fieldOffset.getQuantity();
-                        fieldNode->size   = context.toCharUnitsFromBits(fieldInfo.Width).getQuantity();
-                        fieldNode->align  = context.toCharUnitsFromBits(fieldInfo.Align).getQuantity();
+                        fieldNode.nature = Layout::Category::SimpleField;
+                        fieldNode.offset = fieldOffset.getQuantity();
+                        fieldNode.size   = context.toCharUnitsFromBits(fieldInfo.Width).getQuantity();
+                        fieldNode.align  = context.toCharUnitsFromBits(fieldInfo.Align).getQuantity();
 
-                        RetrieveLocation(fieldNode->fieldLocation,context,field.getLocation());
+                        RetrieveLocation(fieldNode.fieldLocation,context,field.getLocation());
 
-                        node->children.push_back(fieldNode);
-                        node->isValid = node->isValid && fieldNode->isValid;
+                        children.push_back(g_store.AddNode(fieldNode));
+                        node.isValid = node.isValid && fieldNode.isValid;
                     }
                 }
             }
@@ -244,23 +465,48 @@ namespace ClangParser
                     {
                         clang::CharUnits size = clang::CharUnits::fromQuantity(4);
 
-                        Layout::Node* vtorDispNode = new Layout::Node();
-                        vtorDispNode->nature = Layout::Category::VtorDisp;
-                        vtorDispNode->offset = (vBaseOffset - size).getQuantity();
-                        vtorDispNode->size   = size.getQuantity();
-                        vtorDispNode->align  = size.getQuantity();
-                        node->children.push_back(vtorDispNode);
+                        Layout::FlatNode vtorDispNode;
+                        vtorDispNode.nature = Layout::Category::VtorDisp;
+                        vtorDispNode.offset = (vBaseOffset - size).getQuantity();
+                        vtorDispNode.size   = size.getQuantity();
+                        vtorDispNode.align  = size.getQuantity();
+                        children.push_back(g_store.AddNode(vtorDispNode));
                     }
 
-                    Layout::Node* vBaseNode = ComputeStruct(context,vBase,false);
-                    vBaseNode->offset = vBaseOffset.getQuantity();
-                    vBaseNode->nature = vBase == primaryBase? Layout::Category::VPrimaryBase : Layout::Category::VBase;
-                    node->children.push_back(vBaseNode);
-                    node->isValid = node->isValid && vBaseNode->isValid;
+                    const Layout::TIndex vBaseIndex = ComputeStruct(context,vBase,false);
+                    Layout::FlatNode& vBaseNode = g_store.nodes[vBaseIndex];
+                    vBaseNode.offset = vBaseOffset.getQuantity();
+                    vBaseNode.nature = vBase == primaryBase? Layout::Category::VPrimaryBase : Layout::Category::VBase;
+                    children.push_back(vBaseIndex);
+                    node.isValid = node.isValid && vBaseNode.isValid;
                 }
             }
 
-            return node;
+            const Layout::TIndex nodeIndex = g_store.AddNode(node);
+            g_store.SetChildren(nodeIndex, children.data(), static_cast<Layout::TIndex>(children.size()));
+            return nodeIndex;
+        }
+
+        Layout::TIndex ComputeStruct(const clang::ASTContext& context, const clang::CXXRecordDecl* declaration, const bool includeVirtualBases)
+        {
+            // Each record is only computed once per translation unit, every use gets a copy of the memoized node 
+            // holding its own name, offset and nature while sharing the children range with the rest of copies.
+            const TRecordKey key(declaration, includeVirtualBases);
+            TRecordMemo::const_iterator found = g_recordMemo.find(key);
+
+            Layout::TIndex prototype;
+            if (found == g_recordMemo.end())
+            { 
+                prototype = ComputeStructPrototype(context, declaration, includeVirtualBases);
+                g_recordMemo[key] = prototype;
+            }
+            else
+            { 
+                prototype = found->second;
+            }
+
+            const Layout::FlatNode copy = g_store.nodes[prototype];
+            return g_store.AddNode(copy);
         }
     }
 
@@ -274,10 +520,12 @@ namespace ClangParser
             , m_mainFileId(sourceManager.getMainFileID())
             , m_bestStartLine(0u)
             , m_bestStartCol(0u)
+            , m_numVisited(0u)
         {}
 
         bool VisitCXXRecordDecl(clang::CXXRecordDecl* declaration) 
         {
+            ++m_numVisited;
             if (m_sourceManager.getFileID(declaration->getLocation()) == m_mainFileId)
             { 
                 TryRecord(declaration,declaration->getSourceRange());
@@ -313,6 +561,7 @@ namespace ClangParser
         }
 
         const clang::CXXRecordDecl* GetBest() const { return m_best; }
+        unsigned int GetNumVisited() const { return m_numVisited; }
 
     private: 
 
@@ -334,7 +583,8 @@ namespace ClangParser
 
         void TryRecord(const clang::CXXRecordDecl* declaration, const clang::SourceRange& sourceRange)
         { 
-            if (declaration && !declaration->isDependentType() && declaration->getDefinition() /* && !declaration->isInvalidDecl() && declaration->isCompleteDefinition() */)
+            //dependent records are only laid out through their instantiations, which requires a class template to find them
+            if (declaration && (!declaration->isDependentType() || Helpers::GetDescribedTemplate(declaration)) && declaration->getDefinition() /* && !declaration->isInvalidDecl() && declaration->isCompleteDefinition() */)
             { 
                 //Check range
                 const clang::PresumedLoc startLocation = m_sourceManager.getPresumedLoc(sourceRange.getBegin());
@@ -363,26 +613,255 @@ namespace ClangParser
 
         unsigned int m_bestStartLine;
         unsigned int m_bestStartCol; 
+        unsigned int m_numVisited;
     };
 
-    class Consumer : public clang::ASTConsumer 
+    /////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    class CollectRecordsVisitor : public clang::RecursiveASTVisitor<CollectRecordsVisitor> 
     {
     public:
-        virtual void HandleTranslationUnit(clang::ASTContext& context) override
+        CollectRecordsVisitor(const clang::SourceManager& sourceManager, const RecordFilter& filter)
+            : m_sourceManager(sourceManager)
+            , m_fileRegex(filter.filePattern)
+            , m_nameRegex(filter.namePattern)
+            , m_filterFiles(!filter.filePattern.empty())
+            , m_filterNames(!filter.namePattern.empty())
+            , m_numVisited(0u)
+        {}
+
+        bool VisitCXXRecordDecl(clang::CXXRecordDecl* declaration) 
         {
-            const clang::SourceManager& sourceManager = context.getSourceManager();
-            auto Decls = context.getTranslationUnitDecl()->decls();
+            ++m_numVisited;
+            if (declaration->isThisDeclarationADefinition() && 
+                !declaration->isImplicit()                  && 
+                !declaration->isDependentType()             && 
+                !declaration->isInvalidDecl()               && 
+                !declaration->isLambda()                    && 
+                !declaration->isAnonymousStructOrUnion()    && 
+                PassesFilters(declaration))
+            { 
+                m_records.push_back(declaration);
+            }
+            return true;
+        }
+
+        const std::vector<const clang::CXXRecordDecl*>& GetRecords() const { return m_records; }
+        unsigned int GetNumVisited() const { return m_numVisited; }
+
+    private: 
+
+        bool PassesFilters(const clang::CXXRecordDecl* declaration) const
+        { 
+            if (m_filterNames && !m_nameRegex.match(declaration->getQualifiedNameAsString()))
+            { 
+                return false;
+            }
+
+            if (m_filterFiles)
+            { 
+                const clang::PresumedLoc location = m_sourceManager.getPresumedLoc(declaration->getLocation());
+                if (location.isInvalid() || !m_fileRegex.match(location.getFilename()))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+    private:
+        const clang::SourceManager& m_sourceManager;
+        llvm::Regex                 m_fileRegex;
+        llvm::Regex                 m_nameRegex;
+        bool                        m_filterFiles;
+        bool                        m_filterNames;
+        unsigned int                m_numVisited;
+
+        std::vector<const clang::CXXRecordDecl*> m_records;
+    };
+
+    void ProcessTemplate(clang::ASTContext& context, const clang::CXXRecordDecl* pattern)
+    {
+        const clang::ClassTemplateDecl* classTemplate = Helpers::GetDescribedTemplate(pattern);
 
-            FindStructAtLocationVisitor visitor(sourceManager);
+        const std::string qualifiedName = classTemplate->getQualifiedNameAsString();
+
+        unsigned int found = 0u;
+        for (const clang::ClassTemplateSpecializationDecl* specialization : classTemplate->specializations())
+        { 
+            if (Helpers::IsInstantiationOf(specialization, pattern))
+            { 
+                TRACE_SCOPE("ComputeStruct");
+                g_store.roots.push_back(Helpers::ComputeStruct(context, specialization));
+                ++found;
+            }
+        }
+
+        LOG_INFO("Found %u instantiations of %s.", found, qualifiedName.c_str());
+    }
+
+    const clang::CXXRecordDecl* FindRecordAtLocation(clang::ASTContext& context, unsigned int& numVisited)
+    {
+        const clang::SourceManager& sourceManager = context.getSourceManager();
+        auto Decls = context.getTranslationUnitDecl()->decls();
+
+        FindStructAtLocationVisitor visitor(sourceManager);
+        { 
+            TRACE_SCOPE("FindStructAtLocationVisitor");
             for (auto& Decl : Decls) 
             {
-                visitor.TraverseDecl(Decl);
+                //only the top level declarations whose range includes the location can hold the type we are looking for
+                if (Helpers::CanContainFilter(sourceManager, Decl->getSourceRange()))
+                { 
+                    visitor.TraverseDecl(Decl);
+                }
             }
+        }
 
-            if (const clang::CXXRecordDecl* best = visitor.GetBest())
-            {
-                g_result.node    = Helpers::ComputeStruct(context, best);
+        numVisited = visitor.GetNumVisited();
+        return visitor.GetBest();
+    }
+
+    void ProcessLocation(clang::ASTContext& context)
+    {
+        const std::chrono::steady_clock::time_point lookupStart = std::chrono::steady_clock::now();
+
+        unsigned int numVisited = 0u;
+        const clang::CXXRecordDecl* best = FindRecordAtLocation(context, numVisited);
+
+        g_timings.lookup += Helpers::GetElapsedMicroseconds(lookupStart);
+        Trace::AddCounter("recordsVisited", numVisited);
+
+        if (best)
+        {
+            const std::chrono::steady_clock::time_point computeStart = std::chrono::steady_clock::now();
+            if (best->isDependentType())
+            { 
+                //a class template: every instantiation found in the translation unit
+                ProcessTemplate(context, best);
+            }
+            else
+            { 
+                TRACE_SCOPE("ComputeStruct");
+                g_store.roots.push_back(Helpers::ComputeStruct(context, best));
+            }
+            g_timings.compute += Helpers::GetElapsedMicroseconds(computeStart);
+        }
+    }
+
+    void ProcessAllRecords(clang::ASTContext& context)
+    {
+        const std::chrono::steady_clock::time_point lookupStart = std::chrono::steady_clock::now();
+
+        CollectRecordsVisitor visitor(context.getSourceManager(), g_recordFilter);
+        { 
+            TRACE_SCOPE("CollectRecordsVisitor");
+            visitor.TraverseDecl(context.getTranslationUnitDecl());
+        }
+
+        g_timings.lookup += Helpers::GetElapsedMicroseconds(lookupStart);
+        Trace::AddCounter("recordsVisited", visitor.GetNumVisited());
+        const std::chrono::steady_clock::time_point computeStart = std::chrono::steady_clock::now();
+
+        unsigned int exported = 0u;
+        for (const clang::CXXRecordDecl* record : visitor.GetRecords())
+        { 
+            //records coming from shared headers are only computed by the first translation unit claiming them
+            if (Helpers::ClaimRecord(record))
+            { 
+                TRACE_SCOPE("ComputeStruct");
+                g_store.roots.push_back(Helpers::ComputeStruct(context, record));
+                ++exported;
+            }
+        }
+
+        g_timings.compute += Helpers::GetElapsedMicroseconds(computeStart);
+
+        LOG_INFO("Exported %u records out of %u found.", exported, static_cast<unsigned int>(visitor.GetRecords().size()));
+    }
+
+    void ProcessTranslationUnit(clang::ASTContext& context)
+    {
+        TRACE_SCOPE("ProcessTranslationUnit");
+
+        //file ids and declarations are only unique within a translation unit
+        g_filenameLookup.clear();
+        g_recordMemo.clear();
+
+        const size_t numNodes = g_store.nodes.size();
+
+        if (g_recordFilter.enabled)
+        {
+            ProcessAllRecords(context);
+        }
+        else
+        { 
+            ProcessLocation(context);
+        }
+
+        if (Trace::IsEnabled())
+        { 
+            Trace::AddCounter("nodesCreated", static_cast<long long>(g_store.nodes.size() - numNodes));
+            Trace::AddCounter("lookupTableFiles", static_cast<long long>(g_filenameLookup.size()));
+            Trace::MaxCounter("astMemoryBytes", static_cast<long long>(context.getASTAllocatedMemory() + context.getSideTableAllocatedMemory()));
+        }
+    }
+
+    class InstantiatePragmaHandler : public clang::PragmaHandler
+    {
+    public:
+        //The template is only known once the main file has been parsed: the pragma appended to it runs after its last 
+        //declaration and enters the requested instantiations as a buffer of their own, still within the same parse.
+        InstantiatePragmaHandler(clang::CompilerInstance& compilerInstance)
+            : clang::PragmaHandler(INSTANTIATE_PRAGMA)
+            , m_compilerInstance(compilerInstance)
+        {}
+
+        void HandlePragma(clang::Preprocessor& preprocessor, clang::PragmaIntroducer introducer, clang::Token&) override
+        { 
+            preprocessor.DiscardUntilEndOfDirective();
+
+            //the AST context is created after the action begins, only query it once the pragma is reached
+            unsigned int numVisited = 0u;
+            const clang::CXXRecordDecl* pattern = FindRecordAtLocation(m_compilerInstance.getASTContext(), numVisited);
+            const clang::ClassTemplateDecl* classTemplate = pattern && pattern->isDependentType() ? Helpers::GetDescribedTemplate(pattern) : nullptr;
+
+            //unnamed scopes can't be spelled, instantiations can only come from the translation unit itself
+            const std::string qualifiedName = classTemplate ? classTemplate->getQualifiedNameAsString() : std::string();
+            if (qualifiedName.empty() || qualifiedName.find("(anonymous") != std::string::npos)
+            { 
+                LOG_WARNING("No class template found at the given location, ignoring -instantiate.");
+                return;
+            }
+
+            std::string content;
+            for (const std::string& arguments : g_instantiations)
+            { 
+                //sizeof only instantiates the class definition, member functions not valid for these arguments are left alone
+                content += "static_assert(sizeof(::" + qualifiedName + "< " + arguments + " >) != 0u, \"\");\n";
             }
+
+            clang::SourceManager& sourceManager = preprocessor.getSourceManager();
+            const clang::FileID fileId = sourceManager.createFileID(llvm::MemoryBuffer::getMemBufferCopy(content, "<instantiations>"), clang::SrcMgr::C_User, 0, 0, introducer.Loc);
+            preprocessor.EnterSourceFile(fileId, nullptr, introducer.Loc);
+        }
+
+    private:
+        clang::CompilerInstance& m_compilerInstance;
+    };
+
+    class Consumer : public clang::ASTConsumer 
+    {
+    public:
+        virtual void HandleTranslationUnit(clang::ASTContext& context) override
+        {
+            ProcessTranslationUnit(context);
+        }
+
+        virtual bool shouldSkipFunctionBody(clang::Decl* declaration) override
+        { 
+            //only queried by Sema when the action enabled SkipFunctionBodies
+            return Helpers::CanSkipFunctionBody(declaration);
         }
     };
 
@@ -391,6 +870,48 @@ namespace ClangParser
     public:
         using ASTConsumerPointer = std::unique_ptr<clang::ASTConsumer>;
         ASTConsumerPointer CreateASTConsumer(clang::CompilerInstance&, llvm::StringRef) override { return std::make_unique<Consumer>(); }
+
+        bool BeginSourceFileAction(clang::CompilerInstance& compilerInstance) override
+        { 
+            compilerInstance.getFrontendOpts().SkipFunctionBodies = g_skipFunctionBodies;
+
+            if (Cache::IsEnabled())
+            { 
+                //the preprocessor already exists at this point, attach directly instead of through addDependencyCollector
+                m_dependencyCollector = std::make_shared<DependencyCollector>();
+                m_dependencyCollector->attachToPreprocessor(compilerInstance.getPreprocessor());
+            }
+
+            if (!g_instantiations.empty())
+            { 
+                //owned by the preprocessor, only the main file remapped by Parser::AppendInstantiatePragma uses it
+                compilerInstance.getPreprocessor().AddPragmaHandler(new InstantiatePragmaHandler(compilerInstance));
+            }
+
+            return clang::SyntaxOnlyAction::BeginSourceFileAction(compilerInstance);
+        }
+
+        void EndSourceFileAction() override
+        { 
+            if (m_dependencyCollector)
+            { 
+                const llvm::ArrayRef<std::string> dependencies = m_dependencyCollector->getDependencies();
+                g_dependencies.assign(dependencies.begin(), dependencies.end());
+                m_dependencyCollector.reset();
+            }
+
+            clang::SyntaxOnlyAction::EndSourceFileAction();
+        }
+
+    private:
+        class DependencyCollector : public clang::DependencyCollector
+        {
+        public:
+            //system headers can change with the toolchain, the cache must see them too
+            bool needSystemDependencies() override { return true; }
+        };
+
+        std::shared_ptr<DependencyCollector> m_dependencyCollector;
     };
 }
 
@@ -403,11 +924,26 @@ namespace CommandLine
     llvm::cl::opt<std::string>  g_outputFilename("output", llvm::cl::desc("Specify output filename"), llvm::cl::value_desc("filename"), llvm::cl::cat(g_commandLineCategory));
     llvm::cl::opt<unsigned int> g_locationRow("locationRow", llvm::cl::desc("Specify input filename row to inspect"), llvm::cl::value_desc("number"), llvm::cl::cat(g_commandLineCategory));
     llvm::cl::opt<unsigned int> g_locationCol("locationCol", llvm::cl::desc("Specify input filename column to inspect"), llvm::cl::value_desc("number"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<bool>         g_exportAll("all", llvm::cl::desc("Export every complete record defined in the translation unit instead of the one at the given location"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<std::string>  g_fileFilter("fileFilter", llvm::cl::desc("Only export records defined in files matching this regex (used with -all)"), llvm::cl::value_desc("regex"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<std::string>  g_nameFilter("nameFilter", llvm::cl::desc("Only export records whose qualified name matches this regex, e.g. '^Engine::' (used with -all)"), llvm::cl::value_desc("regex"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<std::string>  g_databaseDir("database", llvm::cl::desc("Scan every file found in the compile_commands.json of the given directory (used with -all)"), llvm::cl::value_desc("directory"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<unsigned int> g_jobs("jobs", llvm::cl::desc("Number of translation units parsed concurrently with -all (0 uses all the available cores)"), llvm::cl::value_desc("number"), llvm::cl::init(0u), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<bool>         g_fast("fast", llvm::cl::desc("Skip parsing the function bodies that can't contain the requested location"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<std::string>  g_cacheDir("cache", llvm::cl::desc("Reuse the results stored in the given directory while none of the files they were built from changed"), llvm::cl::value_desc("directory"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<unsigned int> g_cacheSize("cacheSize", llvm::cl::desc("Maximum size of the cache directory in MB, least recently used results are evicted first"), llvm::cl::value_desc("MB"), llvm::cl::init(512u), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::list<std::string> g_instantiations("instantiate", llvm::cl::desc("Also lay out the class template at the given location with these template arguments, e.g. -instantiate=\"int, 4\" (repeatable)"), llvm::cl::value_desc("arguments"), llvm::cl::ZeroOrMore, llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::list<std::string> g_targets("targets", llvm::cl::desc("Parse the location once per target triple, e.g. -targets=x86_64-pc-linux-gnu,aarch64-linux-gnu,x86_64-pc-windows-msvc"), llvm::cl::value_desc("triples"), llvm::cl::CommaSeparated, llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::list<std::string> g_defineSets("defineSet", llvm::cl::desc("Parse the location once per set of comma separated defines, combined with every -targets entry, e.g. -defineSet= -defineSet=TARGET_DEBUG (repeatable)"), llvm::cl::value_desc("defines"), llvm::cl::ZeroOrMore, llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<std::string>  g_timingsFilename("timings", llvm::cl::desc("Append the duration of each parsing phase in microseconds as one JSON line to the given file"), llvm::cl::value_desc("filename"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<std::string>  g_traceFilename("trace", llvm::cl::desc("Write a Chrome trace event file of the parsing phases and print the time per phase along with the node, record, file and memory counters"), llvm::cl::value_desc("filename"), llvm::cl::cat(g_commandLineCategory));
+    llvm::cl::opt<bool>         g_server("server", llvm::cl::desc("Stay alive answering layout requests read from stdin, reusing the parsed headers between requests"), llvm::cl::cat(g_commandLineCategory));
 
     //aliases
     llvm::cl::alias g_shortOutputFilenameOption("o", llvm::cl::desc("Alias for -output"), llvm::cl::aliasopt(g_outputFilename));
     llvm::cl::alias g_shortLocationRowOption("r", llvm::cl::desc("Alias for -locationRow"), llvm::cl::aliasopt(g_locationRow));
     llvm::cl::alias g_shortLocationColOption("c", llvm::cl::desc("Alias for -locationCol"), llvm::cl::aliasopt(g_locationCol));    
+    llvm::cl::alias g_shortJobsOption("j", llvm::cl::desc("Alias for -jobs"), llvm::cl::aliasopt(g_jobs));
 }
 
 namespace Parser
@@ -417,23 +953,937 @@ namespace Parser
         ClangParser::g_locationFilter = filter;
     }
 
-    bool Parse(int argc, const char* argv[])
+    bool SetRecordFilter(const ClangParser::RecordFilter& filter)
     { 
-        llvm::Expected<clang::tooling::CommonOptionsParser> optionsParser = clang::tooling::CommonOptionsParser::create(argc, argv, CommandLine::g_commandLineCategory);
-        if (!optionsParser)
-        {
-            llvm::errs() << "Failed to create options parser: " << llvm::toString(optionsParser.takeError()) << "\n";
+        std::string error;
+        if (!llvm::Regex(filter.filePattern).isValid(error) || !llvm::Regex(filter.namePattern).isValid(error))
+        { 
+            LOG_ERROR("Invalid record filter: %s", error.c_str());
             return false;
         }
 
-        clang::tooling::ClangTool tool(optionsParser->getCompilations(), optionsParser->getSourcePathList());
+        ClangParser::g_recordFilter = filter;
+        return true;
+    }
+}
 
-        SetFilter(ClangParser::LocationFilter{ CommandLine::g_locationRow, CommandLine::g_locationCol });
+namespace Server
+{
+    // Each request is a single stdin line with the same arguments as a one-shot invocation: 
+    //   -r=<row> -c=<col> -o=<output> [-p <compile commands dir>] <file>
+    // The options also accept their value as the next argument ('-r 10'), any other option fails the request.
+    // Each answer is a single stdout line: 'OK <ms>', 'NOTFOUND <ms>' or 'ERROR <ms>'.
+    // Translation units are kept alive with a precompiled preamble so consecutive requests only reparse the main file, 
+    // up to MAX_UNITS of them, the least recently used one being released first. 
+    // Compilation databases are loaded once per build path (or source directory) and kept for the whole session.
 
-        tool.run(clang::tooling::newFrontendActionFactory<ClangParser::Action>().get());
+    enum { MAX_UNITS = 8 };
 
-        const char* outputFileName = CommandLine::g_outputFilename.size() == 0 ? "output.slbin" : CommandLine::g_outputFilename.c_str();
-        bool ret = IO::ToFile(ClangParser::g_result, outputFileName);
+    struct Request
+    {
+        Request()
+            : row(0u)
+            , col(0u)
+        {}
+
+        std::string  file;
+        std::string  output;
+        std::string  buildPath;
+        unsigned int row;
+        unsigned int col;
+    };
+
+    struct Unit
+    {
+        Unit()
+            : lastUse(0u)
+        {}
+
+        std::vector<std::string>        commandLine;
+        std::unique_ptr<clang::ASTUnit> ast;
+        unsigned long long              lastUse;
+    };
+
+    using TUnits     = std::unordered_map<std::string,Unit>;
+    using TDatabases = std::unordered_map<std::string,std::unique_ptr<clang::tooling::CompilationDatabase>>;
+
+    TUnits             g_units;
+    TDatabases         g_databases;
+    unsigned long long g_useCounter = 0u;
+    std::string        g_resourceDir;
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ParseUInt(unsigned int& output, llvm::StringRef str)
+    {
+        return !str.getAsInteger(10,output);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ConsumeOption(llvm::StringRef& value, const llvm::SmallVectorImpl<const char*>& tokens, size_t& index, llvm::StringRef shortName, llvm::StringRef longName)
+    {
+        //accepts both '-name=value' and '-name value'
+        llvm::StringRef token = tokens[index];
+        for (llvm::StringRef name : { shortName, longName })
+        {
+            if (name.empty() || !token.consume_front(name)) continue;
+
+            if (token.consume_front("="))
+            {
+                value = token;
+                return true;
+            }
+
+            if (token.empty() && (index+1) < tokens.size())
+            {
+                value = tokens[++index];
+                return true;
+            }
+
+            token = tokens[index];
+        }
+        return false;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ParseRequest(Request& request, const std::string& line)
+    {
+        llvm::BumpPtrAllocator allocator;
+        llvm::StringSaver saver(allocator);
+        llvm::SmallVector<const char*,16> tokens;
+        llvm::cl::TokenizeWindowsCommandLine(line,saver,tokens);
+
+        for (size_t i = 0; i < tokens.size(); ++i)
+        {
+            llvm::StringRef value;
+
+            if      (ConsumeOption(value, tokens, i, "-r", "-locationRow")) { if (!ParseUInt(request.row,value)) return false; }
+            else if (ConsumeOption(value, tokens, i, "-c", "-locationCol")) { if (!ParseUInt(request.col,value)) return false; }
+            else if (ConsumeOption(value, tokens, i, "-o", "-output"))      { request.output = value.str(); }
+            else if (ConsumeOption(value, tokens, i, "-p", ""))             { request.buildPath = value.str(); }
+            else if (llvm::StringRef(tokens[i]).startswith("-"))            { LOG_ERROR("Unknown request argument %s", tokens[i]); return false; }
+            else                                                            { request.file = tokens[i]; }
+        }
+
+        return !request.file.empty();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    clang::tooling::CompilationDatabase* AcquireDatabase(const Request& request)
+    {
+        //without an explicit build path the database is searched from the source directory up
+        const std::string key = request.buildPath.empty() ? llvm::sys::path::parent_path(request.file).str() : request.buildPath;
+
+        std::unique_ptr<clang::tooling::CompilationDatabase>& database = g_databases[key];
+        if (!database)
+        {
+            std::string error;
+            database = request.buildPath.empty() ?
+                clang::tooling::CompilationDatabase::autoDetectFromSource(request.file, error) :
+                clang::tooling::CompilationDatabase::autoDetectFromDirectory(request.buildPath, error);
+
+            if (!database)
+            {
+                //not cached, the database can still be generated before the next request
+                LOG_ERROR("Unable to load the compilation database: %s", error.c_str());
+                g_databases.erase(key);
+                return nullptr;
+            }
+        }
+
+        return database.get();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool GetCommandLine(std::vector<std::string>& output, const Request& request)
+    {
+        clang::tooling::CompilationDatabase* database = AcquireDatabase(request);
+        if (!database)
+        {
+            return false;
+        }
+
+        std::vector<clang::tooling::CompileCommand> commands = database->getCompileCommands(request.file);
+        if (commands.empty())
+        {
+            LOG_ERROR("No compile command found for %s", request.file.c_str());
+            return false;
+        }
+
+        clang::tooling::ArgumentsAdjuster adjuster = clang::tooling::combineAdjusters(clang::tooling::getClangStripOutputAdjuster(), clang::tooling::getClangSyntaxOnlyAdjuster());
+        output = adjuster(commands.front().CommandLine, commands.front().Filename);
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::unique_ptr<clang::ASTUnit> CreateUnit(const std::vector<std::string>& commandLine)
+    {
+        std::vector<const char*> args;
+        args.reserve(commandLine.size());
+        for (const std::string& arg : commandLine)
+        {
+            args.push_back(arg.c_str());
+        }
+
+        llvm::IntrusiveRefCntPtr<clang::DiagnosticsEngine> diagnostics = clang::CompilerInstance::createDiagnostics(new clang::DiagnosticOptions());
+
+        //in fast mode the headers in the preamble don't keep their function bodies
+        return std::unique_ptr<clang::ASTUnit>(clang::ASTUnit::LoadFromCommandLine(args.data(), args.data() + args.size(), 
+            std::make_shared<clang::PCHContainerOperations>(), diagnostics, g_resourceDir,
+            /*StorePreamblesInMemory*/ true, /*PreambleStoragePath*/ "", /*OnlyLocalDecls*/ false, 
+            clang::CaptureDiagsKind::None, /*RemappedFiles*/ {}, /*RemappedFilesKeepOriginalName*/ true, 
+            /*PrecompilePreambleAfterNParses*/ 1, clang::TU_Complete, /*CacheCodeCompletionResults*/ false, 
+            /*IncludeBriefCommentsInCodeCompletion*/ false, /*AllowPCHWithCompilerErrors*/ false,
+            ClangParser::g_skipFunctionBodies ? clang::SkipFunctionBodiesScope::Preamble : clang::SkipFunctionBodiesScope::None));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void ReleaseLeastRecentUnit()
+    {
+        TUnits::iterator oldest = g_units.begin();
+        for (TUnits::iterator it = g_units.begin(), itEnd = g_units.end(); it != itEnd; ++it)
+        {
+            if (it->second.lastUse < oldest->second.lastUse)
+            {
+                oldest = it;
+            }
+        }
+
+        if (oldest != g_units.end())
+        {
+            LOG_INFO("Releasing the translation unit of %s", oldest->first.c_str());
+            g_units.erase(oldest);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    clang::ASTUnit* AcquireUnit(const Request& request)
+    {
+        std::vector<std::string> commandLine;
+        if (!GetCommandLine(commandLine, request))
+        {
+            return nullptr;
+        }
+
+        if (g_units.find(request.file) == g_units.end() && g_units.size() >= MAX_UNITS)
+        {
+            ReleaseLeastRecentUnit();
+        }
+
+        Unit& unit = g_units[request.file];
+        unit.lastUse = ++g_useCounter;
+
+        if (unit.ast && unit.commandLine == commandLine)
+        {
+            //Only the main file gets parsed again, the preamble is reused unless any of its headers changed
+            if (unit.ast->Reparse(std::make_shared<clang::PCHContainerOperations>()))
+            {
+                LOG_ERROR("Failed to reparse %s", request.file.c_str());
+                unit.ast.reset();
+            }
+        }
+        else
+        {
+            unit.commandLine = commandLine;
+            unit.ast = CreateUnit(commandLine);
+            if (!unit.ast)
+            {
+                LOG_ERROR("Failed to parse %s", request.file.c_str());
+            }
+        }
+
+        return unit.ast.get();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    const char* ProcessRequest(const std::string& line)
+    {
+        TRACE_SCOPE("Server::Request");
+
+        Request request;
+        if (!ParseRequest(request, line))
+        {
+            LOG_ERROR("Invalid request: %s", line.c_str());
+            return "ERROR";
+        }
+
+        clang::ASTUnit* unit = AcquireUnit(request);
+        if (!unit)
+        {
+            return "ERROR";
+        }
+
+        Parser::SetFilter(ClangParser::LocationFilter{ request.row, request.col });
+        ClangParser::ProcessTranslationUnit(unit->getASTContext());
+
+        const bool found = !ClangParser::g_store.roots.empty();
+        const char* outputFileName = request.output.empty() ? "output.slbin" : request.output.c_str();
+        Layout::PostProcess(ClangParser::g_store);
+        const bool written = IO::ToFile(ClangParser::g_store, outputFileName);
+
+        ClangParser::Helpers::ClearResult();
+
+        return !written ? "ERROR" : found ? "OK" : "NOTFOUND";
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Run(const char* argv0)
+    {
+        static int s_staticSymbol;
+        g_resourceDir = clang::CompilerInvocation::GetResourcesPath(argv0, &s_staticSymbol);
+
+        LOG_PROGRESS("Layout server ready.");
+
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            if (line.empty()) continue;
+            if (line == "quit") break;
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const char* status = ProcessRequest(line);
+            const long miliseconds = ClangParser::Helpers::GetElapsedMiliseconds(start);
+
+            IO::LogTime(IO::Verbosity::Info, "Request completed in ", miliseconds);
+            IO::Log(IO::Verbosity::Info, "\n");
+
+            fprintf(stdout, "%s %ld\n", status, miliseconds);
+            fflush(stdout);
+        }
+
+        g_units.clear();
+        g_databases.clear();
+        return true;
+    }
+}
+
+namespace Scanner
+{
+    // Parses a list of translation units concurrently, each worker owns its thread local store which gets merged 
+    // into the shared one once its translation unit is done. Records are deduplicated by USR across all workers.
+
+    using TFileIndices = std::unordered_map<std::string,int>;
+
+    Layout::Store  g_mergedStore;
+    TFileIndices   g_mergedFiles;
+    std::mutex     g_mergeMutex;
+
+    // -----------------------------------------------------------------------------------------------------------
+    void RemapLocation(Layout::Location& location, const std::vector<int>& fileRemap)
+    { 
+        if (location.fileIndex != Layout::INVALID_FILE_INDEX)
+        { 
+            location.fileIndex = fileRemap[location.fileIndex];
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void MergeThreadResult()
+    { 
+        TRACE_SCOPE("Scanner::Merge");
+
+        Layout::Store& local = ClangParser::g_store;
+
+        std::lock_guard<std::mutex> lock(g_mergeMutex);
+
+        std::vector<int> fileRemap;
+        fileRemap.reserve(local.files.size());
+        for (const std::string& file : local.files)
+        { 
+            const std::pair<TFileIndices::iterator,bool> result = g_mergedFiles.insert(TFileIndices::value_type(file,static_cast<int>(g_mergedStore.files.size())));
+            if (result.second)
+            { 
+                g_mergedStore.files.push_back(file);
+            }
+            fileRemap.push_back(result.first->second);
+        }
+
+        Layout::TIndices stringRemap;
+        stringRemap.reserve(local.strings.Size());
+        for (Layout::TIndex i = 0u, sz = local.strings.Size(); i < sz; ++i)
+        { 
+            stringRemap.push_back(g_mergedStore.strings.Intern(local.strings.Get(i)));
+        }
+
+        const Layout::TIndex nodeOffset     = static_cast<Layout::TIndex>(g_mergedStore.nodes.size());
+        const Layout::TIndex childrenOffset = static_cast<Layout::TIndex>(g_mergedStore.children.size());
+
+        g_mergedStore.nodes.reserve(g_mergedStore.nodes.size() + local.nodes.size());
+        for (Layout::FlatNode node : local.nodes)
+        { 
+            node.name        = stringRemap[node.name];
+            node.type        = stringRemap[node.type];
+            node.firstChild += childrenOffset;
+            RemapLocation(node.typeLocation, fileRemap);
+            RemapLocation(node.fieldLocation, fileRemap);
+            g_mergedStore.nodes.push_back(node);
+        }
+
+        g_mergedStore.children.reserve(g_mergedStore.children.size() + local.children.size());
+        for (const Layout::TIndex child : local.children)
+        { 
+            g_mergedStore.children.push_back(child + nodeOffset);
+        }
+
+        for (const Layout::TIndex root : local.roots)
+        { 
+            g_mergedStore.roots.push_back(root + nodeOffset);
+        }
+
+        ClangParser::Helpers::ClearResult();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::Store& Run(const clang::tooling::CompilationDatabase& database, const std::vector<std::string>& files, const unsigned int jobs)
+    { 
+        llvm::ThreadPool pool(llvm::hardware_concurrency(jobs));
+        LOG_PROGRESS("Scanning %u translation units using %u threads...", static_cast<unsigned int>(files.size()), pool.getThreadCount());
+
+        for (const std::string& file : files)
+        { 
+            pool.async([&database, &file]()
+            {
+                //physical file system keeps the working directory per tool instead of changing the process one
+                clang::tooling::ClangTool tool(database, llvm::ArrayRef<std::string>(file), std::make_shared<clang::PCHContainerOperations>(), llvm::vfs::createPhysicalFileSystem());
+                { 
+                    TRACE_SCOPE("ClangTool::run");
+                    tool.run(clang::tooling::newFrontendActionFactory<ClangParser::Action>().get());
+                }
+                MergeThreadResult();
+            });
+        }
+
+        pool.wait();
+
+        return g_mergedStore;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void Clear()
+    { 
+        g_mergedStore.Clear();
+        g_mergedFiles.clear();
+    }
+}
+
+namespace Matrix
+{
+    // Parses the same location once per variant ( target triple x define set ) concurrently through the scanner workers.
+    // The roots of each variant are tagged with the variant name and their members are matched by path across variants.
+
+    struct Variant
+    {
+        std::string              name;
+        std::vector<std::string> arguments;
+    };
+
+    struct Member
+    {
+        Layout::TAmount offset;    // negative when the variant doesn't have the member
+        Layout::TAmount size;
+        Layout::TAmount bitOffset; // negative when the member is not a bitfield
+        Layout::TAmount bitSize;
+    };
+
+    struct Row
+    {
+        std::string         path;
+        std::vector<Member> variants;
+    };
+
+    struct Table
+    {
+        std::vector<Row>                       rows;   // first seen order
+        std::unordered_map<std::string,size_t> lookup; // by path
+    };
+
+    using TVariants = std::vector<Variant>;
+
+    constexpr Layout::TIndex MISSING_ROOT = 0xFFFFFFFF;
+
+    // -----------------------------------------------------------------------------------------------------------
+    void BuildVariants(TVariants& output, const std::vector<std::string>& targets, const std::vector<std::string>& defineSets)
+    { 
+        const std::vector<std::string> noTargets(1u);
+        const std::vector<std::string> noDefines(1u);
+
+        for (const std::string& target : targets.empty() ? noTargets : targets)
+        { 
+            for (const std::string& defines : defineSets.empty() ? noDefines : defineSets)
+            { 
+                Variant variant;
+                if (!target.empty())
+                { 
+                    variant.name = target;
+                    variant.arguments.push_back("--target=" + target);
+                }
+
+                llvm::SmallVector<llvm::StringRef,8> names;
+                llvm::StringRef(defines).split(names, ',', -1, false);
+                for (const llvm::StringRef define : names)
+                { 
+                    variant.name += variant.name.empty() ? "" : " ";
+                    variant.name += define.trim().str();
+                    variant.arguments.push_back("-D" + define.trim().str());
+                }
+
+                variant.name = variant.name.empty() ? "default" : variant.name;
+                output.push_back(variant);
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::string GetLabel(const Layout::Store& store, const Layout::FlatNode& node)
+    { 
+        switch (node.nature)
+        { 
+        case Layout::Category::VTablePtr:     return "<vtable ptr>";
+        case Layout::Category::VFTablePtr:    return "<vftable ptr>";
+        case Layout::Category::VBTablePtr:    return "<vbtable ptr>";
+        case Layout::Category::VtorDisp:      return "<vtordisp>";
+        case Layout::Category::NVPrimaryBase:
+        case Layout::Category::NVBase:        return "<base " + std::string(store.strings.Get(node.type)) + ">";
+        case Layout::Category::VPrimaryBase:
+        case Layout::Category::VBase:         return "<virtual base " + std::string(store.strings.Get(node.type)) + ">";
+        default:                              return node.name ? std::string(store.strings.Get(node.name)) : "<unnamed>";
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void CollectMembers(Table& table, const Layout::Store& store, const Layout::FlatNode& node, const std::string& prefix, const Layout::TAmount offset, const size_t variant, const size_t numVariants)
+    { 
+        std::unordered_map<std::string,unsigned int> occurrences;
+        for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+        { 
+            const Layout::FlatNode& childNode = store.nodes[*child];
+            const Layout::TAmount childOffset = offset + childNode.offset;
+
+            //repeated labels ( unnamed unions ) are told apart by their occurrence
+            std::string key = GetLabel(store, childNode);
+            const unsigned int occurrence = occurrences[key]++;
+            key += occurrence > 0u ? '#' + std::to_string(occurrence) : std::string();
+            const std::string path = prefix.empty() ? key : prefix + '.' + key;
+
+            const std::pair<std::unordered_map<std::string,size_t>::iterator,bool> inserted = table.lookup.emplace(path, table.rows.size());
+            if (inserted.second)
+            { 
+                table.rows.push_back(Row{ path, std::vector<Member>(numVariants, Member{ -1, 0, -1, 0 }) });
+            }
+
+            Member& member = table.rows[inserted.first->second].variants[variant];
+            member.offset = childOffset;
+            member.size   = childNode.size;
+
+            if (childNode.nature == Layout::Category::Bitfield && childNode.numChildren == 1u)
+            { 
+                //the single extra child holds the bit offset and width
+                const Layout::FlatNode& extra = store.nodes[*store.ChildrenBegin(childNode)];
+                member.bitOffset = extra.offset;
+                member.bitSize   = extra.size;
+            }
+            else if (childNode.numChildren > 0u)
+            { 
+                CollectMembers(table, store, childNode, path, childOffset, variant, numVariants);
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::string ToString(const Member& member)
+    { 
+        if (member.offset < 0) return "-";
+        if (member.bitOffset >= 0) return std::to_string(member.offset) + "." + std::to_string(member.bitOffset) + " (" + std::to_string(member.bitSize) + "b)";
+        return std::to_string(member.offset) + " (" + std::to_string(member.size) + ")";
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool IsDivergent(const Row& row)
+    { 
+        for (const Member& member : row.variants)
+        { 
+            const Member& first = row.variants.front();
+            if (member.offset != first.offset || member.size != first.size || member.bitOffset != first.bitOffset || member.bitSize != first.bitSize)
+            { 
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void ReportType(FILE* output, const Layout::Store& store, const std::string& typeName, const Layout::TIndices& roots)
+    { 
+        Table table;
+
+        fprintf(output, "%s\n", typeName.c_str());
+        fprintf(output, "  %-8s %8s %6s %8s\n", "Variant", "Size", "Align", "Padding");
+        for (size_t i = 0u; i < roots.size(); ++i)
+        { 
+            const std::string variant = "[" + std::to_string(i) + "]";
+            if (roots[i] == MISSING_ROOT)
+            { 
+                fprintf(output, "  %-8s %8s\n", variant.c_str(), "-");
+                continue;
+            }
+
+            const Layout::FlatNode& root = store.nodes[roots[i]];
+            CollectMembers(table, store, root, std::string(), 0, i, roots.size());
+            fprintf(output, "  %-8s %8lld %6lld %8lld\n", variant.c_str(), root.size, root.align, root.size - root.realSize);
+        }
+
+        //rows are created the first time a variant has them, earlier variants already left them missing
+        size_t pathWidth = 6u;
+        for (const Row& row : table.rows)
+        { 
+            pathWidth = std::min<size_t>(std::max(pathWidth, row.path.size()), 64u);
+        }
+
+        fprintf(output, "\n    %-*s", static_cast<int>(pathWidth), "Member");
+        for (size_t i = 0u; i < roots.size(); ++i)
+        { 
+            fprintf(output, " %14s", ("[" + std::to_string(i) + "]").c_str());
+        }
+        fprintf(output, "\n");
+
+        unsigned int numDivergent = 0u;
+        for (const Row& row : table.rows)
+        { 
+            const bool divergent = IsDivergent(row);
+            numDivergent += divergent ? 1u : 0u;
+
+            fprintf(output, "  %c %-*s", divergent ? '*' : ' ', static_cast<int>(pathWidth), row.path.c_str());
+            for (const Member& member : row.variants)
+            { 
+                fprintf(output, " %14s", ToString(member).c_str());
+            }
+            fprintf(output, "\n");
+        }
+
+        fprintf(output, "  %u of %u members diverge\n\n", numDivergent, static_cast<unsigned int>(table.rows.size()));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void Report(FILE* output, const Layout::Store& store, const TVariants& variants)
+    { 
+        fprintf(output, "Variants:\n");
+        for (size_t i = 0u; i < variants.size(); ++i)
+        { 
+            fprintf(output, "  [%u] %s\n", static_cast<unsigned int>(i), variants[i].name.c_str());
+        }
+        fprintf(output, "\n");
+
+        //roots are already sorted by variant, group them by type
+        std::unordered_map<std::string_view,size_t> variantByName;
+        for (size_t i = 0u; i < variants.size(); ++i)
+        { 
+            variantByName.emplace(variants[i].name, i);
+        }
+
+        std::vector<std::pair<std::string,Layout::TIndices>> types;
+        std::unordered_map<std::string,size_t> typeLookup;
+        for (const Layout::TIndex root : store.roots)
+        { 
+            const Layout::FlatNode& node = store.nodes[root];
+            const std::string typeName(store.strings.Get(node.type));
+            const std::pair<std::unordered_map<std::string,size_t>::iterator,bool> inserted = typeLookup.emplace(typeName, types.size());
+            if (inserted.second)
+            { 
+                types.emplace_back(typeName, Layout::TIndices(variants.size(), MISSING_ROOT));
+            }
+            types[inserted.first->second].second[variantByName[store.strings.Get(node.name)]] = root;
+        }
+
+        for (const std::pair<std::string,Layout::TIndices>& type : types)
+        { 
+            ReportType(output, store, type.first, type.second);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::Store& Run(const clang::tooling::CompilationDatabase& database, const std::string& file, const TVariants& variants, const unsigned int jobs)
+    { 
+        llvm::ThreadPool pool(llvm::hardware_concurrency(jobs));
+        LOG_PROGRESS("Parsing %u variants using %u threads...", static_cast<unsigned int>(variants.size()), pool.getThreadCount());
+
+        for (const Variant& variant : variants)
+        { 
+            pool.async([&database, &file, &variant]()
+            {
+                //appended so they win over the target and defines of the compile command
+                clang::tooling::ClangTool tool(database, llvm::ArrayRef<std::string>(file), std::make_shared<clang::PCHContainerOperations>(), llvm::vfs::createPhysicalFileSystem());
+                tool.appendArgumentsAdjuster(clang::tooling::getInsertArgumentAdjuster(variant.arguments, clang::tooling::ArgumentInsertPosition::END));
+                { 
+                    TRACE_SCOPE("ClangTool::run");
+                    tool.run(clang::tooling::newFrontendActionFactory<ClangParser::Action>().get());
+                }
+
+                Layout::Store& local = ClangParser::g_store;
+                const Layout::TIndex name = local.strings.Intern(variant.name);
+                for (const Layout::TIndex root : local.roots)
+                { 
+                    local.nodes[root].name = name;
+                }
+
+                Scanner::MergeThreadResult();
+            });
+        }
+
+        pool.wait();
+
+        //variants finish in any order, put their roots back in the requested one
+        Layout::Store& store = Scanner::g_mergedStore;
+        std::unordered_map<Layout::TIndex,size_t> variantByName;
+        for (size_t i = 0u; i < variants.size(); ++i)
+        { 
+            variantByName.emplace(store.strings.Intern(variants[i].name), i);
+        }
+        std::stable_sort(store.roots.begin(), store.roots.end(), [&](const Layout::TIndex a, const Layout::TIndex b){ return variantByName[store.nodes[a].name] < variantByName[store.nodes[b].name]; });
+
+        return store;
+    }
+}
+
+namespace Parser
+{ 
+    // -----------------------------------------------------------------------------------------------------------
+    bool ScanAll(const clang::tooling::CompilationDatabase& database, const std::vector<std::string>& files)
+    { 
+        Layout::Store& store = Scanner::Run(database, files, CommandLine::g_jobs);
+        Layout::PostProcess(store);
+
+        const char* outputFileName = CommandLine::g_outputFilename.size() == 0 ? "output.slbin" : CommandLine::g_outputFilename.c_str();
+        bool ret = IO::ToFile(store, outputFileName);
+
+        Scanner::Clear();
+
+        return ret;
+    }
+
+    bool ParseMatrix(const clang::tooling::CompilationDatabase& database, const std::string& file)
+    { 
+        Matrix::TVariants variants;
+        Matrix::BuildVariants(variants, CommandLine::g_targets, CommandLine::g_defineSets);
+
+        Layout::Store& store = Matrix::Run(database, file, variants, CommandLine::g_jobs);
+        Layout::PostProcess(store);
+
+        const char* outputFileName = CommandLine::g_outputFilename.size() == 0 ? "output.slbin" : CommandLine::g_outputFilename.c_str();
+        bool ret = IO::ToFile(store, outputFileName);
+
+        Matrix::Report(stdout, store, variants);
+
+        Scanner::Clear();
+
+        return ret;
+    }
+
+    std::string GetCacheKey(const clang::tooling::CompilationDatabase& database, const std::string& file)
+    { 
+        //the adjusted command line identifies the translation unit, the location is appended after a line break
+        std::string key;
+        for (const clang::tooling::CompileCommand& command : database.getCompileCommands(file))
+        { 
+            key += command.Directory;
+            for (const std::string& argument : clang::tooling::getClangStripOutputAdjuster()(command.CommandLine, command.Filename))
+            { 
+                key += '\0';
+                key += argument;
+            }
+        }
+
+        key += '\n';
+        key += file + ':' + std::to_string(CommandLine::g_locationRow) + ':' + std::to_string(CommandLine::g_locationCol);
+        for (const std::string& arguments : CommandLine::g_instantiations)
+        { 
+            key += '\n';
+            key += arguments;
+        }
+        return key;
+    }
+
+    bool AppendInstantiatePragma(const std::string& file, std::string& absolutePath, std::string& content)
+    { 
+        //The template is only known once the file has been parsed, the pragma appended to an in memory copy of the 
+        //main file enters the requested instantiations at the end of the same parse. Appending keeps every existing location.
+        llvm::SmallString<256> path(file);
+        llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer>> buffer = llvm::MemoryBuffer::getFile(file);
+        if (llvm::sys::fs::make_absolute(path) || !buffer)
+        { 
+            LOG_ERROR("Unable to read %s.", file.c_str());
+            return false;
+        }
+
+        absolutePath = path.str().str();
+        content = (*buffer)->getBuffer().str();
+        content += "\n#pragma ";
+        content += ClangParser::INSTANTIATE_PRAGMA;
+        content += '\n';
+        return true;
+    }
+
+    void WriteTimings(const char* filename, const char* input, const long long parse, const long long postProcess, const long long write)
+    { 
+        //one line per run, the benchmark harness aggregates the file after several runs
+        FILE* stream = nullptr;
+        if (fopen_s(&stream, filename, "a") != 0 || stream == nullptr)
+        { 
+            LOG_ERROR("Unable to open %s for writing.", filename);
+            return;
+        }
+
+        const ClangParser::Timings& timings = ClangParser::g_timings;
+        const Layout::Store& store = ClangParser::g_store;
+
+        std::string escapedInput;
+        for (const char* c = input; *c; ++c)
+        { 
+            if (*c == '"' || *c == '\\') escapedInput += '\\';
+            escapedInput += *c;
+        }
+
+        fprintf(stream, "{\"input\":\"%s\",\"parse\":%lld,\"lookup\":%lld,\"compute\":%lld,\"postprocess\":%lld,\"write\":%lld,\"roots\":%u,\"nodes\":%u}\n",
+            escapedInput.c_str(), parse, timings.lookup, timings.compute, postProcess, write, static_cast<unsigned int>(store.roots.size()), static_cast<unsigned int>(store.nodes.size()));
+        fclose(stream);
+    }
+
+    bool Parse(int argc, const char* argv[])
+    { 
+        llvm::Expected<clang::tooling::CommonOptionsParser> optionsParser = clang::tooling::CommonOptionsParser::create(argc, argv, CommandLine::g_commandLineCategory, llvm::cl::ZeroOrMore);
+        if (!optionsParser)
+        {
+            llvm::errs() << "Failed to create options parser: " << llvm::toString(optionsParser.takeError()) << "\n";
+            return false;
+        }
+
+        //every phase below reports to the trace until Parse returns
+        Trace::Session traceSession(CommandLine::g_traceFilename.empty() ? nullptr : CommandLine::g_traceFilename.c_str());
+        TRACE_SCOPE("Parser::Parse");
+
+        ClangParser::g_skipFunctionBodies = CommandLine::g_fast;
+        ClangParser::g_instantiations.assign(CommandLine::g_instantiations.begin(), CommandLine::g_instantiations.end());
+
+        Cache::SetDirectory(CommandLine::g_cacheDir, static_cast<unsigned long long>(CommandLine::g_cacheSize) * 1024u * 1024u);
+
+        if (CommandLine::g_server)
+        {
+            return Server::Run(argv[0]);
+        }
+
+        if (optionsParser->getSourcePathList().empty() && CommandLine::g_databaseDir.empty())
+        {
+            LOG_ERROR("No input files provided.");
+            return false;
+        }
+
+        SetFilter(ClangParser::LocationFilter{ CommandLine::g_locationRow, CommandLine::g_locationCol });
+
+        ClangParser::RecordFilter recordFilter;
+        recordFilter.enabled     = CommandLine::g_exportAll;
+        recordFilter.filePattern = CommandLine::g_fileFilter;
+        recordFilter.namePattern = CommandLine::g_nameFilter;
+        if (!SetRecordFilter(recordFilter))
+        { 
+            return false;
+        }
+
+        if (!CommandLine::g_databaseDir.empty())
+        { 
+            if (!CommandLine::g_exportAll)
+            { 
+                LOG_ERROR("Scanning a compilation database requires -all.");
+                return false;
+            }
+
+            std::string error;
+            std::unique_ptr<clang::tooling::CompilationDatabase> database = clang::tooling::CompilationDatabase::autoDetectFromDirectory(CommandLine::g_databaseDir, error);
+            if (!database)
+            { 
+                LOG_ERROR("Unable to load the compilation database: %s", error.c_str());
+                return false;
+            }
+
+            return ScanAll(*database, database->getAllFiles());
+        }
+
+        if (CommandLine::g_exportAll && optionsParser->getSourcePathList().size() > 1)
+        { 
+            return ScanAll(optionsParser->getCompilations(), optionsParser->getSourcePathList());
+        }
+
+        if (!CommandLine::g_targets.empty() || !CommandLine::g_defineSets.empty())
+        { 
+            if (CommandLine::g_exportAll || optionsParser->getSourcePathList().size() != 1)
+            { 
+                LOG_ERROR("Variant matrices require a single input file and location.");
+                return false;
+            }
+
+            return ParseMatrix(optionsParser->getCompilations(), optionsParser->getSourcePathList().front());
+        }
+
+        const char* outputFileName = CommandLine::g_outputFilename.size() == 0 ? "output.slbin" : CommandLine::g_outputFilename.c_str();
+
+        //only single location queries are cached, the -all results depend on too many records to validate cheaply
+        const bool useCache = Cache::IsEnabled() && !CommandLine::g_exportAll && optionsParser->getSourcePathList().size() == 1;
+        const std::string cacheKey = useCache ? GetCacheKey(optionsParser->getCompilations(), optionsParser->getSourcePathList().front()) : std::string();
+        if (useCache && Cache::Fetch(cacheKey, outputFileName))
+        { 
+            LOG_INFO("Result found in cache.");
+            return true;
+        }
+
+        const std::chrono::steady_clock::time_point parseStart = std::chrono::steady_clock::now();
+
+        clang::tooling::ClangTool tool(optionsParser->getCompilations(), optionsParser->getSourcePathList());
+
+        //the tool only references the mapped path and content, both must outlive the run
+        std::string mappedPath;
+        std::string mappedContent;
+        if (!CommandLine::g_instantiations.empty() && !CommandLine::g_exportAll && optionsParser->getSourcePathList().size() == 1 
+            && AppendInstantiatePragma(optionsParser->getSourcePathList().front(), mappedPath, mappedContent))
+        { 
+            tool.mapVirtualFile(mappedPath, mappedContent);
+        }
+
+        { 
+            TRACE_SCOPE("ClangTool::run");
+            tool.run(clang::tooling::newFrontendActionFactory<ClangParser::Action>().get());
+        }
+
+        const long long runTime = ClangParser::Helpers::GetElapsedMicroseconds(parseStart);
+        const std::chrono::steady_clock::time_point postProcessStart = std::chrono::steady_clock::now();
+
+        Layout::PostProcess(ClangParser::g_store);
+
+        const long long postProcessTime = ClangParser::Helpers::GetElapsedMicroseconds(postProcessStart);
+        const std::chrono::steady_clock::time_point writeStart = std::chrono::steady_clock::now();
+
+        bool ret = IO::ToFile(ClangParser::g_store, outputFileName);
+        const long long writeTime = ClangParser::Helpers::GetElapsedMicroseconds(writeStart);
+
+        if (ret && useCache && !ClangParser::g_store.roots.empty() && !ClangParser::g_dependencies.empty())
+        { 
+            const Layout::FlatNode& root = ClangParser::g_store.nodes[ClangParser::g_store.roots.front()];
+            Cache::Store(cacheKey, std::string(ClangParser::g_store.strings.Get(root.type)), ClangParser::g_dependencies, outputFileName);
+        }
+        ClangParser::g_dependencies.clear();
+
+        const ClangParser::Timings& timings = ClangParser::g_timings;
+        const long long parseTime = std::max(runTime - timings.lookup - timings.compute, 0ll);
+
+        //the default output stays as it was, the breakdown is only printed when asked for or when measuring -fast
+        const IO::Verbosity timingsVerbosity = CommandLine::g_fast || !CommandLine::g_timingsFilename.empty() ? IO::Verbosity::Progress : IO::Verbosity::Info;
+        IO::LogTime(timingsVerbosity, "Timings - parse: ", static_cast<long>(parseTime / 1000));
+        IO::LogTime(timingsVerbosity, " | lookup: ", static_cast<long>(timings.lookup / 1000));
+        IO::LogTime(timingsVerbosity, " | compute: ", static_cast<long>(timings.compute / 1000));
+        IO::LogTime(timingsVerbosity, " | postprocess: ", static_cast<long>(postProcessTime / 1000));
+        IO::LogTime(timingsVerbosity, " | write: ", static_cast<long>(writeTime / 1000));
+        IO::Log(timingsVerbosity, "\n");
+
+        if (!CommandLine::g_timingsFilename.empty())
+        { 
+            WriteTimings(CommandLine::g_timingsFilename.c_str(), optionsParser->getSourcePathList().front().c_str(), parseTime, postProcessTime, writeTime);
+        }
 
         ClangParser::Helpers::ClearResult();
 
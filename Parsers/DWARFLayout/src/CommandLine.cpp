@@ -0,0 +1,166 @@
+#include "CommandLine.h"
+
+#include "IO.h"
+
+ExportParams::ExportParams()
+    : input(nullptr)
+    , output("tempResult.slbin")
+    , locationFile(nullptr)
+    , fileFilter(nullptr)
+    , trace(nullptr)
+    , locationLine(0)
+    , jobs(0)
+    , exportAll(false)
+{}
+
+namespace CommandLine
+{ 
+    constexpr int FAILURE = -1;
+    constexpr int SUCCESS = 0;
+
+    namespace Utils
+    { 
+        // -----------------------------------------------------------------------------------------------------------
+        int StringCompare(const char* s1, const char* s2)
+        {
+            for(;*s1 && (*s1 == *s2);++s1,++s2){}
+            return *(const unsigned char*)s1 - *(const unsigned char*)s2;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool StringToUInt(unsigned int& output, const char* str)
+        { 
+            unsigned int ret = 0; 
+            while (char c = *str)
+            { 
+                if (c < '0' || c > '9') 
+                { 
+                    return false;
+                }
+
+                ret=ret*10+(c-'0'); 
+                ++str;
+            }
+
+            output = ret;
+            return true;
+        } 
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // -----------------------------------------------------------------------------------------------------------
+    void DisplayHelp()
+    {
+        ExportParams defaultParams;
+        LOG_ALWAYS("Struct Layout DWARF Data Extractor"); 
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Reads the DWARF debug information of an ELF binary, object file or split DWARF object and extracts the type layout."); 
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Command Legend:"); 
+        
+        LOG_ALWAYS("-input          (-i)  : The path to the binary with debug information"); 
+        LOG_ALWAYS("-output         (-o)  : The output file path for the results ('%s' by default)",defaultParams.output); 
+        LOG_ALWAYS("-locationFile   (-lf) : The source file path where the symbol is located.");
+        LOG_ALWAYS("-locationRow    (-lr) : The source file line within the given 'locationFile' where the symbol is located.");
+        LOG_ALWAYS("-all                  : Exports every record of the binary instead of the one at the given location");
+        LOG_ALWAYS("-fileFilter           : Only exports the records declared in files containing this text in their path - requires '-all'");
+        LOG_ALWAYS("-jobs           (-j)  : Number of worker threads (the hardware concurrency by default)");
+        LOG_ALWAYS("-trace          (-t)  : Writes a Chrome trace event file of the export phases and prints the time per phase and the counters");
+        LOG_ALWAYS("-verbosity      (-v)  : Sets the verbosity level - example: '-v 1'"); 
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    int Parse(ExportParams& params, int argc, char* argv[])
+    { 
+        //No args
+        if (argc <= 1) 
+        {
+            LOG_ERROR("No arguments found. Type '?' for help.");
+            return FAILURE;
+        }
+
+        //Check for Help
+        for (int i=1;i<argc;++i)
+        { 
+            if (Utils::StringCompare(argv[i],"?") == 0)
+            { 
+                DisplayHelp();
+                return FAILURE;
+            }
+        }
+
+        //Parse arguments
+        for(int i=1;i < argc;++i)
+        { 
+            char* argValue = argv[i];
+            if (argValue[0] == '-')
+            { 
+                if ((Utils::StringCompare(argValue,"-i")==0 || Utils::StringCompare(argValue,"-input")==0) && (i+1) < argc)
+                { 
+                    ++i;
+                    params.input = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-o")==0 || Utils::StringCompare(argValue,"-output")==0) && (i+1) < argc)
+                { 
+                    ++i;
+                    params.output = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue, "-lf") == 0 || Utils::StringCompare(argValue, "-locationFile") == 0) && (i + 1) < argc)
+                {
+                    ++i;
+                    params.locationFile = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue, "-lr") == 0 || Utils::StringCompare(argValue, "-locationRow") == 0) && (i + 1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]))
+                    {
+                        params.locationLine = value;
+                    }
+                }
+                else if (Utils::StringCompare(argValue, "-all") == 0)
+                {
+                    params.exportAll = true;
+                }
+                else if (Utils::StringCompare(argValue, "-fileFilter") == 0 && (i + 1) < argc)
+                {
+                    ++i;
+                    params.fileFilter = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue, "-j") == 0 || Utils::StringCompare(argValue, "-jobs") == 0) && (i + 1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]))
+                    {
+                        params.jobs = value;
+                    }
+                }
+                else if ((Utils::StringCompare(argValue, "-t") == 0 || Utils::StringCompare(argValue, "-trace") == 0) && (i + 1) < argc)
+                {
+                    ++i;
+                    params.trace = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-v")==0 || Utils::StringCompare(argValue,"-verbosity")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value,argv[i]) && value < static_cast<unsigned int>(IO::Verbosity::Invalid))
+                    { 
+                        IO::SetVerbosityLevel(IO::Verbosity(value));
+                    }
+                } 
+                
+            }
+            else if (params.input == nullptr)
+            { 
+                //We assume that the first free argument is the actual input file
+                params.input = argValue;
+            }
+        }
+
+        return 0;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+struct ExportParams 
+{ 
+    ExportParams();
+
+    const char*  input; 
+    const char*  output;
+    const char*  locationFile;
+    const char*  fileFilter;
+    const char*  trace;
+    unsigned int locationLine; 
+    unsigned int jobs;
+    bool         exportAll;
+};
+
+namespace CommandLine
+{ 
+    int Parse(ExportParams& args, int argc, char* argv[]);
+}
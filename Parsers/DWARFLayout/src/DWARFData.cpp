@@ -0,0 +1,1630 @@
+#include "DWARFData.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+#include "IO.h"
+
+namespace DWARF
+{
+    namespace Form
+    {
+        enum : uint16_t
+        {
+            Addr          = 0x01,
+            Block2        = 0x03,
+            Block4        = 0x04,
+            Data2         = 0x05,
+            Data4         = 0x06,
+            Data8         = 0x07,
+            String        = 0x08,
+            Block         = 0x09,
+            Block1        = 0x0a,
+            Data1         = 0x0b,
+            Flag          = 0x0c,
+            Sdata         = 0x0d,
+            Strp          = 0x0e,
+            Udata         = 0x0f,
+            RefAddr       = 0x10,
+            Ref1          = 0x11,
+            Ref2          = 0x12,
+            Ref4          = 0x13,
+            Ref8          = 0x14,
+            RefUdata      = 0x15,
+            Indirect      = 0x16,
+            SecOffset     = 0x17,
+            Exprloc       = 0x18,
+            FlagPresent   = 0x19,
+            Strx          = 0x1a,
+            Addrx         = 0x1b,
+            RefSup4       = 0x1c,
+            StrpSup       = 0x1d,
+            Data16        = 0x1e,
+            LineStrp      = 0x1f,
+            RefSig8       = 0x20,
+            ImplicitConst = 0x21,
+            Loclistx      = 0x22,
+            Rnglistx      = 0x23,
+            RefSup8       = 0x24,
+            Strx1         = 0x25,
+            Strx2         = 0x26,
+            Strx3         = 0x27,
+            Strx4         = 0x28,
+            Addrx1        = 0x29,
+            Addrx2        = 0x2a,
+            Addrx3        = 0x2b,
+            Addrx4        = 0x2c,
+            GNUAddrIndex  = 0x1f01,
+            GNUStrIndex   = 0x1f02,
+            GNURefAlt     = 0x1f20,
+            GNUStrpAlt    = 0x1f21,
+        };
+    }
+
+    namespace Attribute
+    {
+        enum : uint16_t
+        {
+            Sibling            = 0x01,
+            Name               = 0x03,
+            ByteSize           = 0x0b,
+            BitOffset          = 0x0c,
+            BitSize            = 0x0d,
+            StmtList           = 0x10,
+            CompDir            = 0x1b,
+            ContainingType     = 0x1d,
+            UpperBound         = 0x2f,
+            AbstractOrigin     = 0x31,
+            Accessibility      = 0x32,
+            Artificial         = 0x34,
+            Count              = 0x37,
+            DataMemberLocation = 0x38,
+            DeclColumn         = 0x39,
+            DeclFile           = 0x3a,
+            DeclLine           = 0x3b,
+            Declaration        = 0x3c,
+            External           = 0x3f,
+            Specification      = 0x47,
+            Type               = 0x49,
+            Virtuality         = 0x4c,
+            Signature          = 0x69,
+            DataBitOffset      = 0x6b,
+            StrOffsetsBase     = 0x72,
+            DwoName            = 0x76,
+            Alignment          = 0x88,
+            GNUDwoName         = 0x2130,
+            GNUDwoId           = 0x2131,
+        };
+    }
+
+    namespace Op
+    {
+        enum : uint8_t
+        {
+            Constu     = 0x10,
+            Plus       = 0x22,
+            PlusUconst = 0x23,
+            Lit0       = 0x30,
+            Lit31      = 0x4f,
+        };
+    }
+
+    namespace LineContent
+    {
+        enum : uint64_t
+        {
+            Path           = 0x1,
+            DirectoryIndex = 0x2,
+        };
+    }
+
+    // package index columns, version 2 (GNU extension for DWARF 4) and version 5 only differ in the TYPES column
+    namespace PackageColumn
+    {
+        enum : uint32_t
+        {
+            Info       = 1,
+            Types      = 2,
+            Abbrev     = 3,
+            Line       = 4,
+            StrOffsets = 6,
+        };
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct Context::Contribution
+    {
+        Contribution()
+            : abbrev(0u)
+            , line(0u)
+            , strOffsets(0u)
+        {}
+
+        uint64_t abbrev;
+        uint64_t line;
+        uint64_t strOffsets;
+    };
+
+    namespace Helpers
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        // Bounds checked sequential reads over a section, any read past the end invalidates the cursor and yields 0
+        class Cursor
+        {
+        public:
+            Cursor(const Section& section, const uint64_t offset)
+                : m_data(section.data)
+                , m_size(section.size)
+                , m_offset(offset)
+                , m_valid(section.data != nullptr && offset <= section.size)
+            {}
+
+            bool     IsValid() const   { return m_valid; }
+            uint64_t GetOffset() const { return m_offset; }
+
+            bool Skip(const uint64_t bytes)
+            {
+                if (Check(bytes))
+                {
+                    m_offset += bytes;
+                }
+                return m_valid;
+            }
+
+            template<typename T> T Fixed()
+            {
+                T value = 0;
+                if (Check(sizeof(T)))
+                {
+                    memcpy(&value, m_data + m_offset, sizeof(T));
+                    m_offset += sizeof(T);
+                }
+                return value;
+            }
+
+            uint64_t Unsigned(const unsigned int size)
+            {
+                switch (size)
+                {
+                case 1u: return Fixed<uint8_t>();
+                case 2u: return Fixed<uint16_t>();
+                case 4u: return Fixed<uint32_t>();
+                case 8u: return Fixed<uint64_t>();
+                case 3u:
+                {
+                    const uint64_t low = Fixed<uint16_t>();
+                    return low | (static_cast<uint64_t>(Fixed<uint8_t>()) << 16);
+                }
+                default:
+                    m_valid = false;
+                    return 0u;
+                }
+            }
+
+            uint64_t ULEB()
+            {
+                uint64_t value = 0u;
+                unsigned int shift = 0u;
+                while (Check(1u))
+                {
+                    const uint8_t byte = m_data[m_offset++];
+                    if (shift < 64u)
+                    {
+                        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                    }
+                    shift += 7u;
+                    if ((byte & 0x80) == 0)
+                    {
+                        break;
+                    }
+                }
+                return value;
+            }
+
+            int64_t SLEB()
+            {
+                int64_t value = 0;
+                unsigned int shift = 0u;
+                uint8_t byte = 0u;
+                while (Check(1u))
+                {
+                    byte = m_data[m_offset++];
+                    if (shift < 64u)
+                    {
+                        value |= static_cast<int64_t>(byte & 0x7f) << shift;
+                    }
+                    shift += 7u;
+                    if ((byte & 0x80) == 0)
+                    {
+                        break;
+                    }
+                }
+
+                if (shift < 64u && (byte & 0x40))
+                {
+                    value |= -(static_cast<int64_t>(1) << shift);
+                }
+                return value;
+            }
+
+            const char* CString()
+            {
+                if (!Check(1u))
+                {
+                    return nullptr;
+                }
+
+                const char* str = reinterpret_cast<const char*>(m_data + m_offset);
+                const void* terminator = memchr(str, 0, static_cast<size_t>(m_size - m_offset));
+                if (terminator == nullptr)
+                {
+                    m_valid = false;
+                    return nullptr;
+                }
+
+                m_offset += static_cast<const char*>(terminator) - str + 1;
+                return str;
+            }
+
+            const uint8_t* Pointer() const { return m_data + m_offset; }
+
+        private:
+            bool Check(const uint64_t bytes)
+            {
+                m_valid = m_valid && m_size - m_offset >= bytes;
+                return m_valid;
+            }
+
+        private:
+            const uint8_t* m_data;
+            uint64_t       m_size;
+            uint64_t       m_offset;
+            bool           m_valid;
+        };
+
+        // ----------------------------------------------------------------------------------------------------------
+        // The unit properties needed to decode attribute forms, line tables use it with their own header sizes
+        struct FormContext
+        {
+            const ElfFile* file;
+            uint64_t       unitOffset;
+            uint64_t       strOffsetsBase;
+            uint16_t       version;
+            uint8_t        addressSize;
+            uint8_t        offsetSize;
+        };
+
+        // ----------------------------------------------------------------------------------------------------------
+        struct Value
+        {
+            enum class Class : unsigned char
+            {
+                Constant,
+                Signed,
+                String,
+                Block,
+                Reference,
+                Flag,
+                Other,
+            };
+
+            Value()
+                : cls(Class::Other)
+                , u(0u)
+                , str(nullptr)
+                , block(nullptr)
+                , blockSize(0u)
+            {}
+
+            Class          cls;
+            uint64_t       u;
+            const char*    str;
+            const uint8_t* block;
+            uint64_t       blockSize;
+            Reference      ref;
+        };
+
+        // ----------------------------------------------------------------------------------------------------------
+        FormContext MakeFormContext(const Unit& unit)
+        {
+            return FormContext{ unit.file, unit.offset, unit.strOffsetsBase, unit.version, unit.addressSize, unit.offsetSize };
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        const char* ReadString(const Section& section, const uint64_t offset)
+        {
+            if (section.data == nullptr || offset >= section.size)
+            {
+                return nullptr;
+            }
+
+            const char* str = reinterpret_cast<const char*>(section.data + offset);
+            return memchr(str, 0, static_cast<size_t>(section.size - offset)) ? str : nullptr;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        const char* ReadIndexedString(const FormContext& context, const uint64_t index)
+        {
+            const Section& offsets = context.file->GetSection(SectionId::StrOffsets);
+            Cursor cursor(offsets, context.strOffsetsBase + index * context.offsetSize);
+            const uint64_t offset = cursor.Unsigned(context.offsetSize);
+            return cursor.IsValid() ? ReadString(context.file->GetSection(SectionId::Str), offset) : nullptr;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void SetBlock(Value& value, Cursor& cursor, const uint64_t size)
+        {
+            value.cls       = Value::Class::Block;
+            value.block     = cursor.Pointer();
+            value.blockSize = size;
+            cursor.Skip(size);
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void SetReference(Value& value, const Reference::Kind kind, const uint64_t offset)
+        {
+            value.cls       = Value::Class::Reference;
+            value.ref.kind  = kind;
+            value.ref.value = offset;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        bool ReadValue(Cursor& cursor, const FormContext& context, const uint16_t form, const int64_t implicitConst, Value& value)
+        {
+            switch (form)
+            {
+            case Form::Addr:          cursor.Unsigned(context.addressSize); break;
+            case Form::Data1:         value.cls = Value::Class::Constant; value.u = cursor.Fixed<uint8_t>();  break;
+            case Form::Data2:         value.cls = Value::Class::Constant; value.u = cursor.Fixed<uint16_t>(); break;
+            case Form::Data4:         value.cls = Value::Class::Constant; value.u = cursor.Fixed<uint32_t>(); break;
+            case Form::Data8:         value.cls = Value::Class::Constant; value.u = cursor.Fixed<uint64_t>(); break;
+            case Form::Udata:         value.cls = Value::Class::Constant; value.u = cursor.ULEB();            break;
+            case Form::Sdata:         value.cls = Value::Class::Signed;   value.u = static_cast<uint64_t>(cursor.SLEB()); break;
+            case Form::ImplicitConst: value.cls = Value::Class::Signed;   value.u = static_cast<uint64_t>(implicitConst); break;
+            case Form::SecOffset:     value.cls = Value::Class::Constant; value.u = cursor.Unsigned(context.offsetSize); break;
+            case Form::Data16:        cursor.Skip(16u); break;
+
+            case Form::Flag:          value.cls = Value::Class::Flag; value.u = cursor.Fixed<uint8_t>(); break;
+            case Form::FlagPresent:   value.cls = Value::Class::Flag; value.u = 1u; break;
+
+            case Form::Block1:        SetBlock(value, cursor, cursor.Fixed<uint8_t>());  break;
+            case Form::Block2:        SetBlock(value, cursor, cursor.Fixed<uint16_t>()); break;
+            case Form::Block4:        SetBlock(value, cursor, cursor.Fixed<uint32_t>()); break;
+            case Form::Block:
+            case Form::Exprloc:       SetBlock(value, cursor, cursor.ULEB()); break;
+
+            case Form::String:        value.cls = Value::Class::String; value.str = cursor.CString(); break;
+            case Form::Strp:          value.cls = Value::Class::String; value.str = ReadString(context.file->GetSection(SectionId::Str), cursor.Unsigned(context.offsetSize)); break;
+            case Form::LineStrp:      value.cls = Value::Class::String; value.str = ReadString(context.file->GetSection(SectionId::LineStr), cursor.Unsigned(context.offsetSize)); break;
+            case Form::Strx:
+            case Form::GNUStrIndex:   value.cls = Value::Class::String; value.str = ReadIndexedString(context, cursor.ULEB()); break;
+            case Form::Strx1:         value.cls = Value::Class::String; value.str = ReadIndexedString(context, cursor.Unsigned(1u)); break;
+            case Form::Strx2:         value.cls = Value::Class::String; value.str = ReadIndexedString(context, cursor.Unsigned(2u)); break;
+            case Form::Strx3:         value.cls = Value::Class::String; value.str = ReadIndexedString(context, cursor.Unsigned(3u)); break;
+            case Form::Strx4:         value.cls = Value::Class::String; value.str = ReadIndexedString(context, cursor.Unsigned(4u)); break;
+
+            //supplementary object files (dwz) are not loaded, their strings and references stay unresolved
+            case Form::StrpSup:
+            case Form::GNUStrpAlt:
+            case Form::GNURefAlt:     cursor.Unsigned(context.offsetSize); break;
+            case Form::RefSup4:       cursor.Skip(4u); break;
+            case Form::RefSup8:       cursor.Skip(8u); break;
+
+            case Form::Ref1:          SetReference(value, Reference::Kind::Offset, context.unitOffset + cursor.Fixed<uint8_t>());  break;
+            case Form::Ref2:          SetReference(value, Reference::Kind::Offset, context.unitOffset + cursor.Fixed<uint16_t>()); break;
+            case Form::Ref4:          SetReference(value, Reference::Kind::Offset, context.unitOffset + cursor.Fixed<uint32_t>()); break;
+            case Form::Ref8:          SetReference(value, Reference::Kind::Offset, context.unitOffset + cursor.Fixed<uint64_t>()); break;
+            case Form::RefUdata:      SetReference(value, Reference::Kind::Offset, context.unitOffset + cursor.ULEB()); break;
+            case Form::RefAddr:       SetReference(value, Reference::Kind::Info, cursor.Unsigned(context.version <= 2 ? context.addressSize : context.offsetSize)); break;
+            case Form::RefSig8:       SetReference(value, Reference::Kind::Signature, cursor.Fixed<uint64_t>()); break;
+
+            case Form::Addrx:
+            case Form::Loclistx:
+            case Form::Rnglistx:
+            case Form::GNUAddrIndex:  cursor.ULEB(); break;
+            case Form::Addrx1:        cursor.Skip(1u); break;
+            case Form::Addrx2:        cursor.Skip(2u); break;
+            case Form::Addrx3:        cursor.Skip(3u); break;
+            case Form::Addrx4:        cursor.Skip(4u); break;
+
+            case Form::Indirect:
+            {
+                const uint64_t actualForm = cursor.ULEB();
+                return actualForm != Form::Indirect && actualForm != Form::ImplicitConst && ReadValue(cursor, context, static_cast<uint16_t>(actualForm), 0, value);
+            }
+
+            default:
+                //the size of an unknown form is unknown, the rest of the unit can't be decoded
+                return false;
+            }
+
+            return cursor.IsValid();
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Member offsets expressed as location expressions, anything else than a constant push is a runtime lookup
+        bool EvaluateMemberLocation(int64_t& output, const uint8_t* block, const uint64_t size)
+        {
+            Section section;
+            section.data = block;
+            section.size = size;
+
+            Cursor cursor(section, 0u);
+            const uint8_t op = cursor.Fixed<uint8_t>();
+
+            uint64_t value = 0u;
+            if (op == Op::PlusUconst)
+            {
+                value = cursor.ULEB();
+            }
+            else if (op == Op::Constu || (op >= Op::Lit0 && op <= Op::Lit31))
+            {
+                value = op == Op::Constu ? cursor.ULEB() : static_cast<uint64_t>(op - Op::Lit0);
+                if (cursor.GetOffset() < size && cursor.Fixed<uint8_t>() != Op::Plus)
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                return false;
+            }
+
+            output = static_cast<int64_t>(value);
+            return cursor.IsValid() && cursor.GetOffset() == size;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        bool IsConstant(const Value& value)
+        {
+            return value.cls == Value::Class::Constant || value.cls == Value::Class::Signed;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void SetFlag(Die& die, const Die::Flags flag, const bool enabled)
+        {
+            die.flags = enabled ? (die.flags | flag) : (die.flags & ~static_cast<uint32_t>(flag));
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void AssignAttribute(Die& die, const uint16_t name, const Value& value)
+        {
+            switch (name)
+            {
+            case Attribute::Sibling:
+                if (value.cls == Value::Class::Reference && value.ref.kind == Reference::Kind::Offset) die.sibling = value.ref.value;
+                break;
+            case Attribute::Name:
+                if (value.cls == Value::Class::String) die.name = value.str;
+                break;
+            case Attribute::CompDir:
+                if (value.cls == Value::Class::String) die.compDir = value.str;
+                break;
+            case Attribute::DwoName:
+            case Attribute::GNUDwoName:
+                if (value.cls == Value::Class::String) die.dwoName = value.str;
+                break;
+            case Attribute::ByteSize:
+                if (IsConstant(value)) { die.byteSize = value.u; SetFlag(die, Die::HasByteSize, true); }
+                break;
+            case Attribute::BitOffset:
+                if (IsConstant(value)) { die.bitOffset = static_cast<int64_t>(value.u); SetFlag(die, Die::HasBitOffset, true); }
+                break;
+            case Attribute::BitSize:
+                if (IsConstant(value)) { die.bitSize = value.u; SetFlag(die, Die::HasBitSize, true); }
+                break;
+            case Attribute::DataBitOffset:
+                if (IsConstant(value)) { die.dataBitOffset = static_cast<int64_t>(value.u); SetFlag(die, Die::HasDataBitOffset, true); }
+                break;
+            case Attribute::DataMemberLocation:
+                if (IsConstant(value))
+                {
+                    die.memberLocation = static_cast<int64_t>(value.u);
+                    SetFlag(die, Die::HasMemberLocation, true);
+                }
+                else if (value.cls == Value::Class::Block)
+                {
+                    SetFlag(die, Die::HasMemberLocation, true);
+                    SetFlag(die, Die::MemberLocationIsExpr, !EvaluateMemberLocation(die.memberLocation, value.block, value.blockSize));
+                }
+                break;
+            case Attribute::UpperBound:
+                //a negative bound is the unknown size of a flexible array
+                if (IsConstant(value) && !(value.cls == Value::Class::Signed && static_cast<int64_t>(value.u) < 0)) { die.upperBound = value.u; SetFlag(die, Die::HasUpperBound, true); }
+                break;
+            case Attribute::Count:
+                if (IsConstant(value)) { die.count = value.u; SetFlag(die, Die::HasCount, true); }
+                break;
+            case Attribute::Alignment:
+                if (IsConstant(value)) { die.alignment = value.u; SetFlag(die, Die::HasAlignment, true); }
+                break;
+            case Attribute::DeclFile:
+                if (IsConstant(value)) die.declFile = value.u;
+                break;
+            case Attribute::DeclLine:
+                if (IsConstant(value)) die.declLine = static_cast<unsigned int>(value.u);
+                break;
+            case Attribute::DeclColumn:
+                if (IsConstant(value)) die.declColumn = static_cast<unsigned int>(value.u);
+                break;
+            case Attribute::StmtList:
+                if (IsConstant(value)) { die.stmtList = value.u; SetFlag(die, Die::HasStmtList, true); }
+                break;
+            case Attribute::StrOffsetsBase:
+                if (IsConstant(value)) { die.strOffsetsBase = value.u; SetFlag(die, Die::HasStrOffsetsBase, true); }
+                break;
+            case Attribute::GNUDwoId:
+                if (IsConstant(value)) { die.dwoId = value.u; SetFlag(die, Die::HasDwoId, true); }
+                break;
+            case Attribute::Declaration:
+                SetFlag(die, Die::IsDeclaration, value.u != 0u);
+                break;
+            case Attribute::Artificial:
+                SetFlag(die, Die::IsArtificial, value.u != 0u);
+                break;
+            case Attribute::External:
+                SetFlag(die, Die::IsExternal, value.u != 0u);
+                break;
+            case Attribute::Virtuality:
+                SetFlag(die, Die::IsVirtual, value.u != 0u);
+                break;
+            case Attribute::Accessibility:
+                if (IsConstant(value)) die.accessibility = static_cast<uint8_t>(value.u);
+                break;
+            case Attribute::Type:
+                if (value.cls == Value::Class::Reference) die.type = value.ref;
+                break;
+            case Attribute::Specification:
+            case Attribute::AbstractOrigin:
+                if (value.cls == Value::Class::Reference) die.specification = value.ref;
+                break;
+            case Attribute::Signature:
+                if (value.cls == Value::Class::Reference) die.signature = value.ref;
+                break;
+            case Attribute::ContainingType:
+                if (value.cls == Value::Class::Reference) die.containingType = value.ref;
+                break;
+            default:
+                break;
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        bool IsAbsolutePath(const std::string& path)
+        {
+            return (!path.empty() && (path[0] == '/' || path[0] == '\\')) || (path.size() > 1u && path[1] == ':');
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Lexical normalization with forward slashes, the paths come from other machines so the file system is not queried
+        std::string NormalizePath(const std::string& path)
+        {
+            std::string root;
+            size_t start = 0u;
+            if (path.size() > 1u && path[1] == ':')
+            {
+                root  = path.substr(0u, 2u);
+                start = 2u;
+            }
+            if (start < path.size() && (path[start] == '/' || path[start] == '\\'))
+            {
+                root += '/';
+                ++start;
+            }
+
+            std::vector<std::string> parts;
+            while (start <= path.size())
+            {
+                size_t end = path.find_first_of("/\\", start);
+                end = end == std::string::npos ? path.size() : end;
+
+                const std::string part = path.substr(start, end - start);
+                if (part == "..")
+                {
+                    if (!parts.empty() && parts.back() != "..")
+                    {
+                        parts.pop_back();
+                    }
+                    else if (root.empty())
+                    {
+                        parts.push_back(part);
+                    }
+                }
+                else if (!part.empty() && part != ".")
+                {
+                    parts.push_back(part);
+                }
+                start = end + 1u;
+            }
+
+            std::string ret = root;
+            for (size_t i = 0u; i < parts.size(); ++i)
+            {
+                ret += i == 0u ? "" : "/";
+                ret += parts[i];
+            }
+            return ret;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        std::string JoinPath(const std::string& compDir, const std::string& directory, const std::string& name)
+        {
+            if (IsAbsolutePath(name))
+            {
+                return NormalizePath(name);
+            }
+
+            std::string base = directory;
+            if (!IsAbsolutePath(base) && !compDir.empty())
+            {
+                base = base.empty() ? compDir : compDir + '/' + base;
+            }
+            return NormalizePath(base.empty() ? name : base + '/' + name);
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void ReadLineFiles(const Unit& unit, std::vector<std::string>& files)
+        {
+            const Section& section = unit.file->GetSection(SectionId::Line);
+            Cursor cursor(section, unit.lineOffset);
+
+            uint64_t length = cursor.Fixed<uint32_t>();
+            uint8_t offsetSize = 4u;
+            if (length == 0xffffffffu)
+            {
+                length = cursor.Fixed<uint64_t>();
+                offsetSize = 8u;
+            }
+
+            const uint16_t version = cursor.Fixed<uint16_t>();
+            if (!cursor.IsValid() || version < 2u || version > 5u)
+            {
+                LOG_WARNING("Unsupported line table at offset %llu of %s.", static_cast<unsigned long long>(unit.lineOffset), unit.file->GetFilename().c_str());
+                return;
+            }
+
+            uint8_t addressSize = unit.addressSize;
+            if (version >= 5u)
+            {
+                addressSize = cursor.Fixed<uint8_t>();
+                cursor.Skip(1u); //segment selector size
+            }
+
+            cursor.Unsigned(offsetSize); //header length
+            cursor.Skip(version >= 4u ? 5u : 4u); //minimum instruction length, max ops per instruction, default is stmt, line base, line range
+            const uint8_t opcodeBase = cursor.Fixed<uint8_t>();
+            cursor.Skip(opcodeBase > 0u ? opcodeBase - 1u : 0u);
+
+            std::vector<std::string> directories;
+            if (version >= 5u)
+            {
+                const FormContext context{ unit.file, 0u, unit.strOffsetsBase, version, addressSize, offsetSize };
+                for (int table = 0; table < 2 && cursor.IsValid(); ++table)
+                {
+                    std::vector<std::pair<uint64_t, uint64_t>> formats(cursor.Fixed<uint8_t>());
+                    for (std::pair<uint64_t, uint64_t>& format : formats)
+                    {
+                        format.first  = cursor.ULEB();
+                        format.second = cursor.ULEB();
+                    }
+
+                    const uint64_t count = cursor.ULEB();
+                    for (uint64_t i = 0u; i < count && cursor.IsValid(); ++i)
+                    {
+                        const char* path = nullptr;
+                        uint64_t directory = 0u;
+                        for (const std::pair<uint64_t, uint64_t>& format : formats)
+                        {
+                            Value value;
+                            if (!ReadValue(cursor, context, static_cast<uint16_t>(format.second), 0, value))
+                            {
+                                return;
+                            }
+
+                            if (format.first == LineContent::Path && value.cls == Value::Class::String)  path = value.str;
+                            if (format.first == LineContent::DirectoryIndex && IsConstant(value))        directory = value.u;
+                        }
+
+                        if (table == 0)
+                        {
+                            directories.emplace_back(path ? path : "");
+                        }
+                        else
+                        {
+                            files.push_back(JoinPath(unit.compDir, directory < directories.size() ? directories[directory] : "", path ? path : ""));
+                        }
+                    }
+                }
+            }
+            else
+            {
+                //the directory 0 is the compilation directory and the file 0 means no file before DWARF 5
+                directories.push_back(unit.compDir);
+                while (const char* directory = cursor.CString())
+                {
+                    if (*directory == '\0') break;
+                    directories.emplace_back(directory);
+                }
+
+                files.emplace_back();
+                while (const char* name = cursor.CString())
+                {
+                    if (*name == '\0') break;
+                    const uint64_t directory = cursor.ULEB();
+                    cursor.ULEB(); //modification time
+                    cursor.ULEB(); //length
+                    files.push_back(JoinPath(unit.compDir, directory < directories.size() ? directories[directory] : "", name));
+                }
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        const char* GetAnonymousName(const uint16_t tag)
+        {
+            switch (tag)
+            {
+            case Tag::ClassType:       return "(anonymous class)";
+            case Tag::UnionType:       return "(anonymous union)";
+            case Tag::EnumerationType: return "(anonymous enum)";
+            case Tag::Namespace:       return "(anonymous namespace)";
+            default:                   return "(anonymous struct)";
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        bool IsRecord(const uint16_t tag)
+        {
+            return tag == Tag::StructureType || tag == Tag::ClassType || tag == Tag::UnionType;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool AbbreviationTable::Read(const Section& section, const uint64_t offset)
+    {
+        Helpers::Cursor cursor(section, offset);
+        while (cursor.IsValid())
+        {
+            const uint64_t code = cursor.ULEB();
+            if (code == 0u)
+            {
+                break;
+            }
+
+            Abbreviation abbreviation;
+            abbreviation.tag         = static_cast<uint16_t>(cursor.ULEB());
+            abbreviation.hasChildren = cursor.Fixed<uint8_t>() != 0u;
+            abbreviation.firstSpec   = static_cast<uint32_t>(m_specs.size());
+
+            while (cursor.IsValid())
+            {
+                AttributeSpec spec;
+                spec.name          = static_cast<uint16_t>(cursor.ULEB());
+                spec.form          = static_cast<uint16_t>(cursor.ULEB());
+                spec.implicitConst = spec.form == Form::ImplicitConst ? cursor.SLEB() : 0;
+                if (spec.name == 0u && spec.form == 0u)
+                {
+                    break;
+                }
+                m_specs.push_back(spec);
+            }
+
+            abbreviation.numSpecs = static_cast<uint32_t>(m_specs.size()) - abbreviation.firstSpec;
+
+            if (code < 0x10000u)
+            {
+                if (code >= m_entries.size())
+                {
+                    m_entries.resize(static_cast<size_t>(code) + 1u);
+                    m_used.resize(static_cast<size_t>(code) + 1u, false);
+                }
+                m_entries[static_cast<size_t>(code)] = abbreviation;
+                m_used[static_cast<size_t>(code)]    = true;
+            }
+            else
+            {
+                m_sparse[code] = abbreviation;
+            }
+        }
+
+        return cursor.IsValid();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const Abbreviation* AbbreviationTable::Find(const uint64_t code) const
+    {
+        if (code < m_entries.size())
+        {
+            return m_used[static_cast<size_t>(code)] ? &m_entries[static_cast<size_t>(code)] : nullptr;
+        }
+
+        std::unordered_map<uint64_t, Abbreviation>::const_iterator found = m_sparse.find(code);
+        return found == m_sparse.end() ? nullptr : &found->second;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    Unit::Unit()
+        : file(nullptr)
+        , section(SectionId::Info)
+        , offset(0u)
+        , dieOffset(0u)
+        , end(0u)
+        , signature(0u)
+        , typeOffset(0u)
+        , strOffsetsBase(0u)
+        , lineOffset(INVALID_OFFSET)
+        , version(0u)
+        , unitType(UnitType::Compile)
+        , addressSize(8u)
+        , offsetSize(4u)
+        , isSplit(false)
+        , skeleton(nullptr)
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    Die::Die()
+        : unit(nullptr)
+        , offset(0u)
+        , next(0u)
+        , sibling(0u)
+        , tag(Tag::Null)
+        , hasChildren(false)
+        , flags(0u)
+        , name(nullptr)
+        , compDir(nullptr)
+        , dwoName(nullptr)
+        , byteSize(0u)
+        , memberLocation(0)
+        , dataBitOffset(0)
+        , bitOffset(0)
+        , bitSize(0u)
+        , upperBound(0u)
+        , count(0u)
+        , alignment(0u)
+        , declFile(0u)
+        , declLine(0u)
+        , declColumn(0u)
+        , stmtList(0u)
+        , strOffsetsBase(0u)
+        , dwoId(0u)
+        , accessibility(0u)
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    Context::Context()
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    Context::~Context()
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Context::Open(const char* filename)
+    {
+        const ElfFile* binary = LoadFile(filename);
+        if (binary == nullptr)
+        {
+            return false;
+        }
+
+        if (binary->GetSection(SectionId::Info).data == nullptr || binary->GetSection(SectionId::Abbrev).data == nullptr)
+        {
+            LOG_ERROR("%s has no DWARF debug information. For stripped binaries pass the separate debug file instead.", filename);
+            return false;
+        }
+
+        std::vector<std::unique_ptr<Unit>> units;
+        ReadUnits(*binary, SectionId::Info, binary->IsSplit(), units);
+        ReadUnits(*binary, SectionId::Types, binary->IsSplit(), units);
+
+        LoadSplitUnits(filename, units);
+
+        //type units have no compilation directory, their relative line table paths use the one of their object
+        std::unordered_map<const ElfFile*, std::string> compDirs;
+        for (const std::unique_ptr<Unit>& unit : m_allUnits)
+        {
+            if (!unit->compDir.empty())
+            {
+                compDirs.emplace(unit->file, unit->compDir);
+            }
+        }
+
+        for (const std::unique_ptr<Unit>& unit : m_allUnits)
+        {
+            m_sortedUnits.push_back(unit.get());
+
+            const bool isTypeUnit = unit->unitType == UnitType::Type || unit->unitType == UnitType::SplitType;
+            if (isTypeUnit)
+            {
+                m_typeUnits.emplace(unit->signature, unit.get());
+
+                std::unordered_map<const ElfFile*, std::string>::const_iterator compDir = compDirs.find(unit->file);
+                if (unit->compDir.empty() && compDir != compDirs.end())
+                {
+                    unit->compDir = compDir->second;
+                }
+            }
+        }
+
+        std::sort(m_sortedUnits.begin(), m_sortedUnits.end(), [](const Unit* a, const Unit* b)
+        {
+            return a->file != b->file ? a->file < b->file : a->section != b->section ? a->section < b->section : a->offset < b->offset;
+        });
+
+        if (m_units.empty())
+        {
+            LOG_ERROR("No compilation units found in %s.", filename);
+            return false;
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    unsigned char Context::GetAddressSize() const
+    {
+        return m_units.empty() ? 8u : m_units.front()->addressSize;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const ElfFile* Context::LoadFile(const std::string& filename)
+    {
+        std::unique_ptr<ElfFile> file(new ElfFile());
+        if (!file->Open(filename.c_str()))
+        {
+            return nullptr;
+        }
+
+        m_files.push_back(std::move(file));
+        return m_files.back().get();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Context::ReadUnits(const ElfFile& file, const SectionId section, const bool isSplit, std::vector<std::unique_ptr<Unit>>& output)
+    {
+        const Section& data = file.GetSection(section);
+        if (data.data == nullptr)
+        {
+            return true;
+        }
+
+        //packages locate the abbreviations, strings and line tables of each unit through their indexes
+        std::unordered_map<uint64_t, Contribution> contributions;
+        if (file.IsPackage())
+        {
+            for (const SectionId indexSection : { SectionId::CuIndex, SectionId::TuIndex })
+            {
+                Helpers::Cursor cursor(file.GetSection(indexSection), 0u);
+                const uint32_t version    = cursor.Fixed<uint32_t>() & 0xffffu;
+                const uint32_t numColumns = cursor.Fixed<uint32_t>();
+                const uint32_t numUnits   = cursor.Fixed<uint32_t>();
+                const uint32_t numSlots   = cursor.Fixed<uint32_t>();
+                cursor.Skip(static_cast<uint64_t>(numSlots) * 12u); //signatures and row indices
+
+                std::vector<uint32_t> columns(cursor.IsValid() ? numColumns : 0u);
+                for (uint32_t& column : columns)
+                {
+                    column = cursor.Fixed<uint32_t>();
+                }
+
+                const uint32_t unitColumn = section == SectionId::Types ? PackageColumn::Types : PackageColumn::Info;
+                for (uint32_t row = 0u; row < numUnits && cursor.IsValid(); ++row)
+                {
+                    Contribution contribution;
+                    uint64_t unitOffset = INVALID_OFFSET;
+                    for (const uint32_t column : columns)
+                    {
+                        const uint32_t value = cursor.Fixed<uint32_t>();
+                        if (column == unitColumn && (version == 2u || column == PackageColumn::Info)) unitOffset = value;
+                        else if (column == PackageColumn::Abbrev)                                     contribution.abbrev = value;
+                        else if (column == PackageColumn::Line)                                       contribution.line = value;
+                        else if (column == PackageColumn::StrOffsets)                                 contribution.strOffsets = value;
+                    }
+
+                    if (unitOffset != INVALID_OFFSET)
+                    {
+                        contributions.emplace(unitOffset, contribution);
+                    }
+                }
+            }
+        }
+
+        uint64_t offset = 0u;
+        while (offset < data.size)
+        {
+            std::unique_ptr<Unit> unit(new Unit());
+            unit->file    = &file;
+            unit->section = section;
+            unit->offset  = offset;
+            unit->isSplit = isSplit;
+
+            std::unordered_map<uint64_t, Contribution>::const_iterator found = contributions.find(offset);
+            const Contribution* contribution = found == contributions.end() ? nullptr : &found->second;
+
+            if (!ReadUnitHeader(*unit, contribution))
+            {
+                LOG_WARNING("Corrupt unit header at offset %llu of %s, ignoring the rest of the section.", static_cast<unsigned long long>(offset), file.GetFilename().c_str());
+                return false;
+            }
+
+            offset = unit->end;
+
+            if (unit->version < 2u || unit->version > 5u)
+            {
+                LOG_WARNING("Skipping a unit with unsupported DWARF version %u in %s.", static_cast<unsigned int>(unit->version), file.GetFilename().c_str());
+                continue;
+            }
+
+            if (unit->abbreviations)
+            {
+                ReadRootEntry(*unit, contribution);
+                output.push_back(std::move(unit));
+            }
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Context::ReadUnitHeader(Unit& unit, const Contribution* contribution)
+    {
+        const Section& section = unit.file->GetSection(unit.section);
+        Helpers::Cursor cursor(section, unit.offset);
+
+        uint64_t length = cursor.Fixed<uint32_t>();
+        unit.offsetSize = 4u;
+        if (length == 0xffffffffu)
+        {
+            length = cursor.Fixed<uint64_t>();
+            unit.offsetSize = 8u;
+        }
+        else if (length >= 0xfffffff0u)
+        {
+            return false;
+        }
+
+        unit.end = cursor.GetOffset() + length;
+        if (!cursor.IsValid() || length > section.size || unit.end > section.size)
+        {
+            return false;
+        }
+
+        unit.version = cursor.Fixed<uint16_t>();
+        if (unit.version < 2u || unit.version > 5u)
+        {
+            return cursor.IsValid();
+        }
+
+        uint64_t abbreviationOffset = 0u;
+        if (unit.version >= 5u)
+        {
+            unit.unitType      = cursor.Fixed<uint8_t>();
+            unit.addressSize   = cursor.Fixed<uint8_t>();
+            abbreviationOffset = cursor.Unsigned(unit.offsetSize);
+
+            if (unit.unitType == UnitType::Skeleton || unit.unitType == UnitType::SplitCompile)
+            {
+                unit.signature = cursor.Fixed<uint64_t>();
+            }
+            else if (unit.unitType == UnitType::Type || unit.unitType == UnitType::SplitType)
+            {
+                unit.signature  = cursor.Fixed<uint64_t>();
+                unit.typeOffset = unit.offset + cursor.Unsigned(unit.offsetSize);
+            }
+        }
+        else
+        {
+            abbreviationOffset = cursor.Unsigned(unit.offsetSize);
+            unit.addressSize   = cursor.Fixed<uint8_t>();
+            unit.unitType      = UnitType::Compile;
+
+            if (unit.section == SectionId::Types)
+            {
+                unit.unitType   = unit.isSplit ? UnitType::SplitType : UnitType::Type;
+                unit.signature  = cursor.Fixed<uint64_t>();
+                unit.typeOffset = unit.offset + cursor.Unsigned(unit.offsetSize);
+            }
+        }
+
+        unit.dieOffset = cursor.GetOffset();
+        if (!cursor.IsValid() || unit.dieOffset > unit.end)
+        {
+            return false;
+        }
+
+        //units of the same object usually share one abbreviation table
+        abbreviationOffset += contribution ? contribution->abbrev : 0u;
+        const std::string key = unit.file->GetFilename() + '@' + std::to_string(abbreviationOffset);
+        std::unordered_map<std::string, std::shared_ptr<const AbbreviationTable>>::const_iterator found = m_abbreviations.find(key);
+        if (found != m_abbreviations.end())
+        {
+            unit.abbreviations = found->second;
+        }
+        else
+        {
+            std::shared_ptr<AbbreviationTable> table = std::make_shared<AbbreviationTable>();
+            if (table->Read(unit.file->GetSection(SectionId::Abbrev), abbreviationOffset))
+            {
+                unit.abbreviations = table;
+                m_abbreviations.emplace(key, table);
+            }
+            else
+            {
+                LOG_WARNING("Unable to read the abbreviation table at offset %llu of %s.", static_cast<unsigned long long>(abbreviationOffset), unit.file->GetFilename().c_str());
+            }
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Context::ReadRootEntry(Unit& unit, const Contribution* contribution)
+    {
+        //split units index their strings from the start of their contribution, skipping the DWARF 5 header
+        const uint64_t strOffsetsHeader = unit.version >= 5u ? (unit.offsetSize == 8u ? 16u : 8u) : 0u;
+        unit.strOffsetsBase = (contribution ? contribution->strOffsets : 0u) + (unit.isSplit ? strOffsetsHeader : 0u);
+
+        Die root;
+        if (!ReadDie(unit, unit.dieOffset, root) || root.tag == Tag::Null)
+        {
+            return;
+        }
+
+        if (root.Has(Die::HasStrOffsetsBase))
+        {
+            //the base is needed to decode the indexed strings of the root entry itself
+            unit.strOffsetsBase = root.strOffsetsBase;
+            ReadDie(unit, unit.dieOffset, root);
+        }
+
+        unit.name    = root.name    ? root.name    : "";
+        unit.compDir = root.compDir ? root.compDir : "";
+        unit.dwoName = root.dwoName && !unit.isSplit ? root.dwoName : "";
+
+        if (root.Has(Die::HasDwoId) && unit.signature == 0u)
+        {
+            unit.signature = root.dwoId;
+        }
+
+        if (root.Has(Die::HasStmtList))
+        {
+            unit.lineOffset = root.stmtList + (contribution ? contribution->line : 0u);
+        }
+        else if (unit.isSplit && contribution)
+        {
+            unit.lineOffset = contribution->line;
+        }
+        else if (unit.isSplit && unit.file->GetSection(SectionId::Line).data)
+        {
+            unit.lineOffset = 0u;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Context::LoadSplitUnits(const std::string& binary, std::vector<std::unique_ptr<Unit>>& units)
+    {
+        const std::filesystem::path binaryDirectory = std::filesystem::path(binary).parent_path();
+
+        std::vector<std::unique_ptr<Unit>> packageUnits;
+        bool packageLoaded = false;
+
+        for (std::unique_ptr<Unit>& unit : units)
+        {
+            const bool isSkeleton = !unit->isSplit && (unit->unitType == UnitType::Skeleton || !unit->dwoName.empty());
+            if (!isSkeleton)
+            {
+                m_units.push_back(unit.get());
+                m_allUnits.push_back(std::move(unit));
+                continue;
+            }
+
+            const Unit* skeleton = unit.get();
+            m_allUnits.push_back(std::move(unit));
+
+            //the split object is next to the compilation directory, or moved next to the binary
+            std::vector<std::filesystem::path> candidates;
+            const std::filesystem::path dwoName(skeleton->dwoName);
+            if (dwoName.is_absolute())
+            {
+                candidates.push_back(dwoName);
+            }
+            else
+            {
+                if (!skeleton->compDir.empty()) candidates.push_back(std::filesystem::path(skeleton->compDir) / dwoName);
+                candidates.push_back(binaryDirectory / dwoName);
+            }
+            candidates.push_back(binaryDirectory / dwoName.filename());
+
+            std::vector<std::unique_ptr<Unit>> splitUnits;
+            for (const std::filesystem::path& candidate : candidates)
+            {
+                std::error_code error;
+                if (std::filesystem::is_regular_file(candidate, error))
+                {
+                    if (const ElfFile* file = LoadFile(candidate.string()))
+                    {
+                        ReadUnits(*file, SectionId::Info, true, splitUnits);
+                        ReadUnits(*file, SectionId::Types, true, splitUnits);
+                        break;
+                    }
+                }
+            }
+
+            if (splitUnits.empty())
+            {
+                //fall back to the package built with dwp next to the binary
+                if (!packageLoaded)
+                {
+                    packageLoaded = true;
+                    const std::string packageName = binary + ".dwp";
+                    std::error_code error;
+                    if (std::filesystem::is_regular_file(packageName, error))
+                    {
+                        if (const ElfFile* package = LoadFile(packageName))
+                        {
+                            ReadUnits(*package, SectionId::Info, true, packageUnits);
+                            ReadUnits(*package, SectionId::Types, true, packageUnits);
+                        }
+                    }
+                }
+
+                for (std::unique_ptr<Unit>& packageUnit : packageUnits)
+                {
+                    if (packageUnit && packageUnit->signature == skeleton->signature && packageUnit->unitType != UnitType::Type && packageUnit->unitType != UnitType::SplitType)
+                    {
+                        splitUnits.push_back(std::move(packageUnit));
+                        break;
+                    }
+                }
+            }
+
+            if (splitUnits.empty())
+            {
+                LOG_WARNING("Split DWARF object %s not found, its types are skipped.", skeleton->dwoName.c_str());
+                continue;
+            }
+
+            for (std::unique_ptr<Unit>& splitUnit : splitUnits)
+            {
+                const bool isTypeUnit = splitUnit->unitType == UnitType::Type || splitUnit->unitType == UnitType::SplitType;
+                if (!isTypeUnit)
+                {
+                    splitUnit->skeleton = skeleton;
+                    if (splitUnit->compDir.empty())
+                    {
+                        splitUnit->compDir = skeleton->compDir;
+                    }
+                }
+                m_units.push_back(splitUnit.get());
+                m_allUnits.push_back(std::move(splitUnit));
+            }
+        }
+
+        //the package type units are shared by all its compile units
+        for (std::unique_ptr<Unit>& packageUnit : packageUnits)
+        {
+            if (packageUnit && (packageUnit->unitType == UnitType::Type || packageUnit->unitType == UnitType::SplitType))
+            {
+                m_units.push_back(packageUnit.get());
+                m_allUnits.push_back(std::move(packageUnit));
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Context::ReadDie(const Unit& unit, const uint64_t offset, Die& die) const
+    {
+        die        = Die();
+        die.unit   = &unit;
+        die.offset = offset;
+
+        if (offset >= unit.end || !unit.abbreviations)
+        {
+            return false;
+        }
+
+        Helpers::Cursor cursor(unit.file->GetSection(unit.section), offset);
+        const uint64_t code = cursor.ULEB();
+        if (code == 0u)
+        {
+            die.next = cursor.GetOffset();
+            return cursor.IsValid();
+        }
+
+        const Abbreviation* abbreviation = unit.abbreviations->Find(code);
+        if (abbreviation == nullptr)
+        {
+            return false;
+        }
+
+        die.tag         = abbreviation->tag;
+        die.hasChildren = abbreviation->hasChildren;
+
+        const Helpers::FormContext context = Helpers::MakeFormContext(unit);
+        const AttributeSpec* specs = unit.abbreviations->GetSpecs(*abbreviation);
+        for (uint32_t i = 0u; i < abbreviation->numSpecs; ++i)
+        {
+            Helpers::Value value;
+            if (!Helpers::ReadValue(cursor, context, specs[i].form, specs[i].implicitConst, value))
+            {
+                return false;
+            }
+            Helpers::AssignAttribute(die, specs[i].name, value);
+        }
+
+        die.next = cursor.GetOffset();
+        return die.next <= unit.end;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    uint64_t Context::SkipChildren(const Die& die) const
+    {
+        if (!die.hasChildren)
+        {
+            return die.next;
+        }
+
+        if (die.sibling > die.offset && die.sibling <= die.unit->end)
+        {
+            return die.sibling;
+        }
+
+        unsigned int depth = 1u;
+        uint64_t offset = die.next;
+        Die child;
+        while (depth > 0u)
+        {
+            if (!ReadDie(*die.unit, offset, child))
+            {
+                return die.unit->end;
+            }
+
+            if (child.tag == Tag::Null)
+            {
+                --depth;
+                offset = child.next;
+            }
+            else if (child.hasChildren && child.sibling > child.offset && child.sibling <= die.unit->end)
+            {
+                offset = child.sibling;
+            }
+            else
+            {
+                depth += child.hasChildren ? 1u : 0u;
+                offset = child.next;
+            }
+        }
+        return offset;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const Unit* Context::FindUnit(const ElfFile* file, const SectionId section, const uint64_t offset) const
+    {
+        //last unit starting at or before the offset
+        std::vector<const Unit*>::const_iterator found = std::upper_bound(m_sortedUnits.begin(), m_sortedUnits.end(), offset, [file, section](const uint64_t value, const Unit* unit)
+        {
+            return file != unit->file ? file < unit->file : section != unit->section ? section < unit->section : value < unit->offset;
+        });
+
+        if (found == m_sortedUnits.begin())
+        {
+            return nullptr;
+        }
+
+        const Unit* unit = *(--found);
+        return unit->file == file && unit->section == section && offset >= unit->dieOffset && offset < unit->end ? unit : nullptr;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Context::Resolve(const Unit& from, const Reference& reference, const Unit*& unit, uint64_t& offset) const
+    {
+        switch (reference.kind)
+        {
+        case Reference::Kind::Offset:
+            unit   = reference.value >= from.dieOffset && reference.value < from.end ? &from : FindUnit(from.file, from.section, reference.value);
+            offset = reference.value;
+            return unit != nullptr;
+
+        case Reference::Kind::Info:
+            unit   = FindUnit(from.file, SectionId::Info, reference.value);
+            offset = reference.value;
+            return unit != nullptr;
+
+        case Reference::Kind::Signature:
+        {
+            std::unordered_map<uint64_t, const Unit*>::const_iterator found = m_typeUnits.find(reference.value);
+            if (found == m_typeUnits.end())
+            {
+                return false;
+            }
+            unit   = found->second;
+            offset = found->second->typeOffset;
+            return true;
+        }
+
+        default:
+            return false;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const std::vector<std::string>& Context::GetFiles(const Unit& unit) const
+    {
+        std::call_once(unit.filesOnce, [this, &unit]() { BuildFiles(unit); });
+        return unit.files;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Context::BuildFiles(const Unit& unit) const
+    {
+        //split compile units use the line table of their skeleton
+        const Unit* lineUnit = unit.skeleton && unit.skeleton->lineOffset != INVALID_OFFSET ? unit.skeleton : &unit;
+        if (lineUnit->lineOffset != INVALID_OFFSET)
+        {
+            Helpers::ReadLineFiles(*lineUnit, unit.files);
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const UnitIndex& Context::GetIndex(const Unit& unit) const
+    {
+        std::call_once(unit.indexOnce, [this, &unit]() { BuildIndex(unit); });
+        return unit.index;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Context::BuildIndex(const Unit& unit) const
+    {
+        UnitIndex& index = unit.index;
+        index.scopes.emplace_back();
+
+        Die die;
+        if (!ReadDie(unit, unit.dieOffset, die) || !die.hasChildren)
+        {
+            return;
+        }
+
+        //scope of the children of every open entry
+        std::vector<uint32_t> stack(1u, 0u);
+        uint64_t offset = die.next;
+
+        while (!stack.empty() && offset < unit.end)
+        {
+            if (!ReadDie(unit, offset, die))
+            {
+                LOG_WARNING("Corrupt entry at offset %llu of %s, the rest of the unit is skipped.", static_cast<unsigned long long>(offset), unit.file->GetFilename().c_str());
+                break;
+            }
+
+            offset = die.next;
+
+            if (die.tag == Tag::Null)
+            {
+                stack.pop_back();
+                continue;
+            }
+
+            const uint32_t parentScope = stack.back();
+            uint32_t childScope = parentScope;
+            bool visitChildren = false;
+
+            switch (die.tag)
+            {
+            case Tag::StructureType:
+            case Tag::ClassType:
+            case Tag::UnionType:
+            case Tag::EnumerationType:
+            case Tag::Typedef:
+            {
+                //out of line definitions of nested types take the scope of their declaration
+                uint32_t scope = parentScope;
+                const char* name = die.name;
+                const Unit* specUnit = nullptr;
+                uint64_t specOffset = 0u;
+                if (die.specification && Resolve(unit, die.specification, specUnit, specOffset) && specUnit == &unit)
+                {
+                    std::unordered_map<uint64_t, uint32_t>::const_iterator found = index.scopeOf.find(specOffset);
+                    scope = found != index.scopeOf.end() ? found->second : scope;
+
+                    Die specification;
+                    if (name == nullptr && ReadDie(unit, specOffset, specification))
+                    {
+                        name = specification.name;
+                    }
+                }
+
+                index.scopeOf[die.offset] = scope;
+
+                if (Helpers::IsRecord(die.tag))
+                {
+                    const std::string qualifiedName = index.scopes[scope] + (name ? name : Helpers::GetAnonymousName(die.tag));
+                    if (!die.Has(Die::IsDeclaration) && die.Has(Die::HasByteSize))
+                    {
+                        index.records.push_back(RecordEntry{ qualifiedName, die.offset, die.declFile, die.declLine });
+                    }
+
+                    if (die.hasChildren)
+                    {
+                        childScope = static_cast<uint32_t>(index.scopes.size());
+                        index.scopes.push_back(qualifiedName + "::");
+                        visitChildren = true;
+                    }
+                }
+            }
+            break;
+
+            case Tag::Namespace:
+                childScope = static_cast<uint32_t>(index.scopes.size());
+                index.scopes.push_back(index.scopes[parentScope] + (die.name ? die.name : Helpers::GetAnonymousName(die.tag)) + "::");
+                visitChildren = true;
+                break;
+
+            case Tag::Subprogram:
+            case Tag::LexicalBlock:
+                //local types keep the enclosing scope
+                visitChildren = true;
+                break;
+
+            default:
+                break;
+            }
+
+            if (die.hasChildren)
+            {
+                if (visitChildren)
+                {
+                    stack.push_back(childScope);
+                }
+                else
+                {
+                    offset = SkipChildren(die);
+                }
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    std::string Context::GetQualifiedName(const Die& die) const
+    {
+        const UnitIndex& index = GetIndex(*die.unit);
+        std::unordered_map<uint64_t, uint32_t>::const_iterator found = index.scopeOf.find(die.offset);
+        const std::string& scope = found == index.scopeOf.end() ? index.scopes.front() : index.scopes[found->second];
+
+        const char* name = die.name;
+        const Unit* specUnit = nullptr;
+        uint64_t specOffset = 0u;
+        Die specification;
+        if (name == nullptr && die.specification && Resolve(*die.unit, die.specification, specUnit, specOffset) && ReadDie(*specUnit, specOffset, specification))
+        {
+            name = specification.name;
+        }
+
+        return scope + (name ? name : Helpers::GetAnonymousName(die.tag));
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Context::FindDefinition(const std::string& name, const Unit*& unit, uint64_t& offset) const
+    {
+        std::call_once(m_definitionsOnce, [this]()
+        {
+            LOG_INFO("Indexing the record definitions of all the units...");
+            for (const Unit* candidate : m_units)
+            {
+                for (const RecordEntry& record : GetIndex(*candidate).records)
+                {
+                    m_definitions.emplace(record.name, std::make_pair(candidate, record.offset));
+                }
+            }
+        });
+
+        std::unordered_map<std::string, std::pair<const Unit*, uint64_t>>::const_iterator found = m_definitions.find(name);
+        if (found == m_definitions.end())
+        {
+            return false;
+        }
+
+        unit   = found->second.first;
+        offset = found->second.second;
+        return true;
+    }
+}
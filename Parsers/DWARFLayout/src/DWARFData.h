@@ -0,0 +1,283 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ElfFile.h"
+
+namespace DWARF
+{
+    // ----------------------------------------------------------------------------------------------------------
+    // The subset of the DWARF 2 to 5 constants needed to find records and compute their layout
+
+    namespace Tag
+    {
+        enum : uint16_t
+        {
+            Null                  = 0x00,
+            ArrayType             = 0x01,
+            ClassType             = 0x02,
+            EnumerationType       = 0x04,
+            FormalParameter       = 0x05,
+            LexicalBlock          = 0x0b,
+            Member                = 0x0d,
+            PointerType           = 0x0f,
+            ReferenceType         = 0x10,
+            CompileUnit           = 0x11,
+            StructureType         = 0x13,
+            SubroutineType        = 0x15,
+            Typedef               = 0x16,
+            UnionType             = 0x17,
+            UnspecifiedParameters = 0x18,
+            Inheritance           = 0x1c,
+            PtrToMemberType       = 0x1f,
+            SubrangeType          = 0x21,
+            BaseType              = 0x24,
+            ConstType             = 0x26,
+            Subprogram            = 0x2e,
+            VolatileType          = 0x35,
+            RestrictType          = 0x37,
+            Namespace             = 0x39,
+            UnspecifiedType       = 0x3b,
+            PartialUnit           = 0x3c,
+            TypeUnit              = 0x41,
+            RvalueReferenceType   = 0x42,
+            AtomicType            = 0x47,
+            SkeletonUnit          = 0x4a,
+        };
+    }
+
+    namespace UnitType
+    {
+        enum : uint8_t
+        {
+            Compile      = 0x01,
+            Type         = 0x02,
+            Partial      = 0x03,
+            Skeleton     = 0x04,
+            SplitCompile = 0x05,
+            SplitType    = 0x06,
+        };
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct Reference
+    {
+        enum class Kind : unsigned char
+        {
+            None,
+            Offset,    // offset in the section holding the referencing unit
+            Info,      // offset in the .debug_info section of the same file
+            Signature, // type unit signature
+        };
+
+        Reference()
+            : kind(Kind::None)
+            , value(0u)
+        {}
+
+        explicit operator bool() const { return kind != Kind::None; }
+
+        Kind     kind;
+        uint64_t value;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct AttributeSpec
+    {
+        uint16_t name;
+        uint16_t form;
+        int64_t  implicitConst;
+    };
+
+    struct Abbreviation
+    {
+        uint16_t tag;
+        bool     hasChildren;
+        uint32_t firstSpec;
+        uint32_t numSpecs;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    class AbbreviationTable
+    {
+    public:
+        bool Read(const Section& section, const uint64_t offset);
+
+        const Abbreviation*  Find(const uint64_t code) const;
+        const AttributeSpec* GetSpecs(const Abbreviation& abbreviation) const { return m_specs.data() + abbreviation.firstSpec; }
+
+    private:
+        std::vector<Abbreviation>                  m_entries; // indexed by code, producers emit them sequentially
+        std::vector<bool>                          m_used;
+        std::unordered_map<uint64_t, Abbreviation> m_sparse;  // codes too big for the direct table
+        std::vector<AttributeSpec>                 m_specs;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct RecordEntry
+    {
+        std::string  name;     // qualified
+        uint64_t     offset;
+        uint64_t     declFile;
+        unsigned int declLine;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Built once per unit with a single walk over its entries
+    struct UnitIndex
+    {
+        std::vector<std::string>               scopes;  // qualified prefixes ending in "::", 0 is the global scope
+        std::unordered_map<uint64_t, uint32_t> scopeOf; // named type entry offset -> scope index
+        std::vector<RecordEntry>               records; // record definitions in entry order
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct Unit
+    {
+        Unit();
+
+        const ElfFile*                           file;
+        SectionId                                section;      // Info or Types
+        uint64_t                                 offset;       // unit header
+        uint64_t                                 dieOffset;    // root entry
+        uint64_t                                 end;
+        uint64_t                                 signature;    // type signature or dwo id
+        uint64_t                                 typeOffset;   // section offset of the type entry in type units
+        uint64_t                                 strOffsetsBase;
+        uint64_t                                 lineOffset;   // line table offset in the file .debug_line, INVALID_OFFSET when missing
+        uint16_t                                 version;
+        uint8_t                                  unitType;
+        uint8_t                                  addressSize;
+        uint8_t                                  offsetSize;
+        bool                                     isSplit;      // read from a .dwo or .dwp
+        std::shared_ptr<const AbbreviationTable> abbreviations;
+        std::string                              compDir;
+        std::string                              name;
+        std::string                              dwoName;      // skeletons only
+        const Unit*                              skeleton;     // split compile units, holder of the line table
+
+        //built lazily and thread safe, the units are shared by all the workers
+        mutable std::once_flag                   filesOnce;
+        mutable std::vector<std::string>         files;
+        mutable std::once_flag                   indexOnce;
+        mutable UnitIndex                        index;
+    };
+
+    constexpr uint64_t INVALID_OFFSET = ~0ull;
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Decoded debug information entry, only the attributes used to locate and lay out records are kept
+    struct Die
+    {
+        enum Flags : uint32_t
+        {
+            HasByteSize          = 1u << 0,
+            HasMemberLocation    = 1u << 1,
+            MemberLocationIsExpr = 1u << 2,  // not a constant offset, the virtual base expressions
+            HasDataBitOffset     = 1u << 3,
+            HasBitOffset         = 1u << 4,
+            HasBitSize           = 1u << 5,
+            HasUpperBound        = 1u << 6,
+            HasCount             = 1u << 7,
+            HasStmtList          = 1u << 8,
+            HasStrOffsetsBase    = 1u << 9,
+            HasDwoId             = 1u << 10,
+            HasAlignment         = 1u << 11,
+            IsDeclaration        = 1u << 12,
+            IsArtificial         = 1u << 13,
+            IsExternal           = 1u << 14,
+            IsVirtual            = 1u << 15,
+        };
+
+        Die();
+
+        bool Has(const Flags flag) const { return (flags & flag) != 0u; }
+
+        const Unit*  unit;
+        uint64_t     offset;
+        uint64_t     next;          // first child when it has children, next sibling otherwise
+        uint64_t     sibling;       // DW_AT_sibling section offset, 0 when missing
+        uint16_t     tag;           // Tag::Null for the entries closing a children list
+        bool         hasChildren;
+        uint32_t     flags;
+        const char*  name;
+        const char*  compDir;
+        const char*  dwoName;
+        Reference    type;
+        Reference    specification;
+        Reference    signature;     // DW_AT_signature, declarations completed by a type unit
+        Reference    containingType;
+        uint64_t     byteSize;
+        int64_t      memberLocation;
+        int64_t      dataBitOffset;
+        int64_t      bitOffset;
+        uint64_t     bitSize;
+        uint64_t     upperBound;
+        uint64_t     count;
+        uint64_t     alignment;
+        uint64_t     declFile;
+        unsigned int declLine;
+        unsigned int declColumn;
+        uint64_t     stmtList;
+        uint64_t     strOffsetsBase;
+        uint64_t     dwoId;
+        uint8_t      accessibility; // DW_ACCESS_public 1, protected 2, private 3, 0 when missing
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // All the debug information reachable from a binary: its own units, the split DWARF objects or package the
+    // skeleton units point to and the type units. Opening only reads the unit headers and root entries, the entries
+    // are decoded on demand straight from the mapped sections so a query only touches the units it needs.
+    // Everything is read only once opened, the lazily built parts are guarded, so workers can share the context.
+    class Context
+    {
+    public:
+        Context();
+        ~Context();
+
+        Context(const Context&) = delete;
+        Context& operator=(const Context&) = delete;
+
+        bool Open(const char* filename);
+
+        const std::vector<const Unit*>& GetUnits() const { return m_units; } // units holding entries, skeletons excluded
+        unsigned char                   GetAddressSize() const;
+
+        bool     ReadDie(const Unit& unit, const uint64_t offset, Die& die) const;
+        uint64_t SkipChildren(const Die& die) const;                          // offset after the whole subtree of die
+        bool     Resolve(const Unit& from, const Reference& reference, const Unit*& unit, uint64_t& offset) const;
+
+        const std::vector<std::string>& GetFiles(const Unit& unit) const;      // indexed by DW_AT_decl_file
+        const UnitIndex&                GetIndex(const Unit& unit) const;
+        std::string                     GetQualifiedName(const Die& die) const;
+        bool                            FindDefinition(const std::string& name, const Unit*& unit, uint64_t& offset) const;
+
+    private:
+        struct Contribution;
+
+        bool  ReadUnits(const ElfFile& file, const SectionId section, const bool isSplit, std::vector<std::unique_ptr<Unit>>& output);
+        bool  ReadUnitHeader(Unit& unit, const Contribution* contribution);
+        void  ReadRootEntry(Unit& unit, const Contribution* contribution);
+        const ElfFile* LoadFile(const std::string& filename);
+        void  LoadSplitUnits(const std::string& binary, std::vector<std::unique_ptr<Unit>>& skeletons);
+        const Unit* FindUnit(const ElfFile* file, const SectionId section, const uint64_t offset) const;
+        void  BuildIndex(const Unit& unit) const;
+        void  BuildFiles(const Unit& unit) const;
+
+    private:
+        std::vector<std::unique_ptr<ElfFile>>                           m_files;
+        std::vector<std::unique_ptr<Unit>>                              m_allUnits;
+        std::vector<const Unit*>                                        m_units;
+        std::vector<const Unit*>                                        m_sortedUnits; // by file, section and offset
+        std::unordered_map<uint64_t, const Unit*>                       m_typeUnits; // by signature
+        std::unordered_map<std::string, std::shared_ptr<const AbbreviationTable>> m_abbreviations;
+
+        mutable std::once_flag                                          m_definitionsOnce;
+        mutable std::unordered_map<std::string, std::pair<const Unit*, uint64_t>> m_definitions;
+    };
+}
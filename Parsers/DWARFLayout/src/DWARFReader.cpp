@@ -0,0 +1,1374 @@
+#include "DWARFReader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "IO.h"
+#include "LayoutDefinitions.h"
+#include "LayoutPostProcess.h"
+#include "Trace.h"
+
+#include "DWARFData.h"
+
+namespace DWARFReader
+{
+    // records without a layout, the exports skip them
+    constexpr Layout::TIndex NO_NODE = 0xFFFFFFFF;
+
+    namespace Access
+    {
+        enum : uint8_t
+        {
+            Public    = 1,
+            Protected = 2,
+            Private   = 3,
+        };
+    }
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        template<typename T> T Min(T a, T b) { return a > b ? b : a; }
+        template<typename T> T Max(T a, T b) { return a > b ? a : b; }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TAmount AlignOffsetTo(const Layout::TAmount offset, const Layout::TAmount alignment)
+        {
+            return alignment > 1 ? ((offset + alignment - 1) / alignment) * alignment : offset;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Same lexical normalization as the paths read from the line tables
+        std::string NormalizePath(const char* path)
+        {
+            std::string root;
+            std::string input = path ? path : "";
+            std::replace(input.begin(), input.end(), '\\', '/');
+
+            size_t start = 0u;
+            if (input.size() > 1u && input[1] == ':')
+            {
+                root  = input.substr(0u, 2u);
+                start = 2u;
+            }
+            if (start < input.size() && input[start] == '/')
+            {
+                root += '/';
+                ++start;
+            }
+
+            std::vector<std::string> parts;
+            while (start <= input.size())
+            {
+                size_t end = input.find('/', start);
+                end = end == std::string::npos ? input.size() : end;
+
+                const std::string part = input.substr(start, end - start);
+                if (part == ".." && !parts.empty() && parts.back() != "..")
+                {
+                    parts.pop_back();
+                }
+                else if (!part.empty() && part != "." && (part != ".." || root.empty()))
+                {
+                    parts.push_back(part);
+                }
+                start = end + 1u;
+            }
+
+            std::string ret = root;
+            for (size_t i = 0u; i < parts.size(); ++i)
+            {
+                ret += i == 0u ? "" : "/";
+                ret += parts[i];
+            }
+            return ret;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Relative queries match any file ending with them, the compilation directory is rarely known by the caller
+        bool SameFilename(const std::string& file, const std::string& query, const bool queryIsRelative)
+        {
+            if (file.size() < query.size())
+            {
+                return false;
+            }
+
+            if (file.size() == query.size())
+            {
+                return file == query;
+            }
+
+            return queryIsRelative && file[file.size() - query.size() - 1u] == '/' && file.compare(file.size() - query.size(), query.size(), query) == 0;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Runs task(index, worker) for every index in [0,count) on up to jobs threads, picking the indices in order
+        template<typename TTask>
+        void ParallelFor(const size_t count, const unsigned int jobs, const TTask& task)
+        {
+            const unsigned int numWorkers = static_cast<unsigned int>(Min<size_t>(Max(jobs, 1u), Max<size_t>(count, 1u)));
+            if (numWorkers <= 1u)
+            {
+                for (size_t i = 0u; i < count; ++i)
+                {
+                    task(i, 0u);
+                }
+                return;
+            }
+
+            std::atomic<size_t> next(0u);
+            std::vector<std::thread> workers;
+            workers.reserve(numWorkers);
+            for (unsigned int worker = 0u; worker < numWorkers; ++worker)
+            {
+                workers.emplace_back([&next, &task, count, worker]()
+                {
+                    for (size_t i = next++; i < count; i = next++)
+                    {
+                        task(i, worker);
+                    }
+                });
+            }
+
+            for (std::thread& thread : workers)
+            {
+                thread.join();
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        unsigned int GetNumJobs(const unsigned int jobs)
+        {
+            if (jobs > 0u)
+            {
+                return jobs;
+            }
+            const unsigned int hardware = std::thread::hardware_concurrency();
+            return hardware > 0u ? hardware : 1u;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Files referenced by the nodes, shared by all the workers. The indices depend on the worker timing, they are
+    // renumbered in the order of the final result before exporting
+    struct FileTable
+    {
+        int Add(const std::string& path)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::unordered_map<std::string, int>::const_iterator found = indices.find(path);
+            if (found != indices.end())
+            {
+                return found->second;
+            }
+
+            const int index = static_cast<int>(files.size());
+            files.push_back(path);
+            indices.emplace(path, index);
+            return index;
+        }
+
+        std::mutex                           mutex;
+        std::unordered_map<std::string, int> indices;
+        Layout::TFiles                       files;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    struct RecordInfo;
+
+    struct BaseInfo
+    {
+        const RecordInfo* record;
+        Layout::TAmount   offset; // only meaningful for non virtual bases
+        bool              isVirtual;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Everything the derived classes need to know about a record to place it, computed once per record and thread
+    struct RecordInfo
+    {
+        RecordInfo()
+            : complete(NO_NODE)
+            , asBase(NO_NODE)
+            , size(0)
+            , dataSize(0)
+            , align(1)
+            , nvAlign(1)
+            , primaryBase(nullptr)
+            , primaryIsVirtual(false)
+            , isDynamic(false)
+            , isPOD(true)
+        {}
+
+        Layout::TIndex        complete;         // prototype of the complete object, with its virtual bases
+        Layout::TIndex        asBase;           // prototype of the base class subobject, without virtual bases
+        Layout::TAmount       size;
+        Layout::TAmount       dataSize;         // Itanium dsize of the non virtual part, the tail padding derived classes reuse starts there
+        Layout::TAmount       align;
+        Layout::TAmount       nvAlign;
+        const RecordInfo*     primaryBase;
+        bool                  primaryIsVirtual;
+        bool                  isDynamic;
+        bool                  isPOD;            // POD for the purpose of layout, its tail padding is never reused
+        std::vector<BaseInfo> bases;            // direct bases in declaration order
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    struct TypeInfo
+    {
+        TypeInfo()
+            : size(0)
+            , align(1)
+            , record(nullptr)
+            , isPOD(true)
+        {}
+
+        Layout::TAmount   size;
+        Layout::TAmount   align;
+        const RecordInfo* record; // records only, arrays of records are simple fields
+        bool              isPOD;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Builds the layout nodes of records in a store of its own, one instance per worker thread so the caches need no
+    // locking. Records are computed once as prototypes and every use gets a copy sharing the prototype children
+    class LayoutBuilder
+    {
+    public:
+        LayoutBuilder(const DWARF::Context& context, FileTable& files)
+            : m_context(context)
+            , m_files(files)
+            , m_pointerSize(context.GetAddressSize())
+        {}
+
+        Layout::TIndex ComputeRoot(const DWARF::Unit& unit, const uint64_t offset)
+        {
+            DWARF::Die die;
+            if (!m_context.ReadDie(unit, offset, die))
+            {
+                return NO_NODE;
+            }
+
+            const RecordInfo* info = GetRecord(die);
+            return info ? CopyNode(info->complete) : NO_NODE;
+        }
+
+        const Layout::Store& GetStore() const { return m_store; }
+
+    private:
+        struct Key
+        {
+            bool operator==(const Key& other) const { return unit == other.unit && offset == other.offset; }
+
+            const DWARF::Unit* unit;
+            uint64_t           offset;
+        };
+
+        struct KeyHasher
+        {
+            size_t operator()(const Key& key) const { return std::hash<const void*>()(key.unit) ^ std::hash<uint64_t>()(key.offset * 0x9E3779B97F4A7C15ull); }
+        };
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ReadReference(const DWARF::Die& from, const DWARF::Reference& reference, DWARF::Die& output) const
+        {
+            const DWARF::Unit* unit = nullptr;
+            uint64_t offset = 0u;
+            return reference && m_context.Resolve(*from.unit, reference, unit, offset) && m_context.ReadDie(*unit, offset, output) && output.tag != DWARF::Tag::Null;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        static bool IsRecordTag(const uint16_t tag)
+        {
+            return tag == DWARF::Tag::StructureType || tag == DWARF::Tag::ClassType || tag == DWARF::Tag::UnionType;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Declarations are completed by their type unit or by the first definition with the same qualified name,
+        // the type unit stubs only have the signature
+        bool CompleteDeclaration(DWARF::Die& die) const
+        {
+            if (!die.Has(DWARF::Die::IsDeclaration) && !die.signature)
+            {
+                return true;
+            }
+
+            DWARF::Die definition;
+            if (die.signature && ReadReference(die, die.signature, definition) && !definition.Has(DWARF::Die::IsDeclaration))
+            {
+                die = definition;
+                return true;
+            }
+
+            const DWARF::Unit* unit = nullptr;
+            uint64_t offset = 0u;
+            if (m_context.FindDefinition(m_context.GetQualifiedName(die), unit, offset) && m_context.ReadDie(*unit, offset, definition))
+            {
+                die = definition;
+                return true;
+            }
+
+            return false;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Follows typedefs and qualifiers, returns false for void and unresolved types
+        bool StripType(DWARF::Die& die, Layout::TAmount& alignment) const
+        {
+            for (unsigned int depth = 0u; depth < 64u; ++depth)
+            {
+                if (alignment == 0 && die.Has(DWARF::Die::HasAlignment))
+                {
+                    alignment = static_cast<Layout::TAmount>(die.alignment);
+                }
+
+                switch (die.tag)
+                {
+                case DWARF::Tag::Typedef:
+                case DWARF::Tag::ConstType:
+                case DWARF::Tag::VolatileType:
+                case DWARF::Tag::RestrictType:
+                case DWARF::Tag::AtomicType:
+                {
+                    DWARF::Die inner;
+                    if (!ReadReference(die, die.type, inner))
+                    {
+                        return false;
+                    }
+                    die = inner;
+                }
+                break;
+
+                case DWARF::Tag::StructureType:
+                case DWARF::Tag::ClassType:
+                case DWARF::Tag::UnionType:
+                case DWARF::Tag::EnumerationType:
+                    return CompleteDeclaration(die);
+
+                default:
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        TypeInfo GetTypeInfo(const DWARF::Die& type)
+        {
+            TypeInfo info;
+
+            Layout::TAmount alignment = 0;
+            DWARF::Die die = type;
+            if (!StripType(die, alignment))
+            {
+                return info;
+            }
+
+            switch (die.tag)
+            {
+            case DWARF::Tag::StructureType:
+            case DWARF::Tag::ClassType:
+            case DWARF::Tag::UnionType:
+                if (const RecordInfo* record = GetRecord(die))
+                {
+                    info.size   = record->size;
+                    info.align  = record->align;
+                    info.record = record;
+                    info.isPOD  = record->isPOD;
+                }
+                break;
+
+            case DWARF::Tag::ArrayType:
+            {
+                DWARF::Die element;
+                if (ReadReference(die, die.type, element))
+                {
+                    info = GetTypeInfo(element);
+                }
+                info.record = nullptr;
+
+                Layout::TAmount count = 1;
+                if (die.hasChildren)
+                {
+                    DWARF::Die child;
+                    for (uint64_t offset = die.next; m_context.ReadDie(*die.unit, offset, child) && child.tag != DWARF::Tag::Null; offset = m_context.SkipChildren(child))
+                    {
+                        if (child.tag == DWARF::Tag::SubrangeType)
+                        {
+                            //C and C++ arrays start at 0, flexible arrays have no bounds
+                            count *= child.Has(DWARF::Die::HasCount) ? static_cast<Layout::TAmount>(child.count) : child.Has(DWARF::Die::HasUpperBound) ? static_cast<Layout::TAmount>(child.upperBound) + 1 : 0;
+                        }
+                    }
+                }
+                info.size = die.Has(DWARF::Die::HasByteSize) ? static_cast<Layout::TAmount>(die.byteSize) : info.size * count;
+            }
+            break;
+
+            case DWARF::Tag::ReferenceType:
+            case DWARF::Tag::RvalueReferenceType:
+                info.isPOD = false;
+                info.size  = die.Has(DWARF::Die::HasByteSize) ? static_cast<Layout::TAmount>(die.byteSize) : m_pointerSize;
+                info.align = m_pointerSize;
+                break;
+
+            case DWARF::Tag::PtrToMemberType:
+            {
+                //pointers to member functions hold the function and the this adjustment
+                DWARF::Die member;
+                const bool isFunction = ReadReference(die, die.type, member) && member.tag == DWARF::Tag::SubroutineType;
+                info.size  = die.Has(DWARF::Die::HasByteSize) ? static_cast<Layout::TAmount>(die.byteSize) : isFunction ? 2 * m_pointerSize : m_pointerSize;
+                info.align = m_pointerSize;
+            }
+            break;
+
+            case DWARF::Tag::PointerType:
+            case DWARF::Tag::UnspecifiedType:
+                info.size  = die.Has(DWARF::Die::HasByteSize) ? static_cast<Layout::TAmount>(die.byteSize) : m_pointerSize;
+                info.align = info.size;
+                break;
+
+            case DWARF::Tag::EnumerationType:
+            case DWARF::Tag::BaseType:
+                info.size  = die.Has(DWARF::Die::HasByteSize) ? static_cast<Layout::TAmount>(die.byteSize) : 4;
+                info.align = die.Has(DWARF::Die::HasAlignment) ? static_cast<Layout::TAmount>(die.alignment) : Helpers::Max<Layout::TAmount>(info.size, 1);
+                break;
+
+            default:
+                break;
+            }
+
+            if (alignment > 0)
+            {
+                info.align = alignment;
+            }
+            return info;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        const std::string& GetTypeName(const DWARF::Die& die)
+        {
+            const Key key{ die.unit, die.offset };
+            std::unordered_map<Key, std::string, KeyHasher>::const_iterator found = m_typeNames.find(key);
+            if (found != m_typeNames.end())
+            {
+                return found->second;
+            }
+
+            std::string name = GetDeclarator(die, "", 0u);
+            return m_typeNames.emplace(key, std::move(name)).first->second;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Prints the type the way clang does: the declarator is built from the outermost type inwards
+        std::string GetDeclarator(const DWARF::Die& die, const std::string& inner, const unsigned int depth)
+        {
+            const auto Join = [](const std::string& base, const std::string& declarator)
+            {
+                return declarator.empty() ? base : declarator[0] == '[' ? base + declarator : base + ' ' + declarator;
+            };
+
+            const auto Next = [this, &die, depth](const std::string& declarator)
+            {
+                DWARF::Die type;
+                return depth < 64u && ReadReference(die, die.type, type) ? GetDeclarator(type, declarator, depth + 1u) : (declarator.empty() ? std::string("void") : "void " + declarator);
+            };
+
+            const auto NeedsParentheses = [this, &die]()
+            {
+                DWARF::Die type;
+                return ReadReference(die, die.type, type) && (type.tag == DWARF::Tag::ArrayType || type.tag == DWARF::Tag::SubroutineType);
+            };
+
+            switch (die.tag)
+            {
+            case DWARF::Tag::PointerType:
+            case DWARF::Tag::ReferenceType:
+            case DWARF::Tag::RvalueReferenceType:
+            {
+                const char* symbol = die.tag == DWARF::Tag::PointerType ? "*" : die.tag == DWARF::Tag::ReferenceType ? "&" : "&&";
+                const std::string declarator = symbol + inner;
+                return Next(NeedsParentheses() ? '(' + declarator + ')' : declarator);
+            }
+
+            case DWARF::Tag::PtrToMemberType:
+            {
+                DWARF::Die container;
+                const std::string scope = ReadReference(die, die.containingType, container) ? GetDeclarator(container, "", depth + 1u) : std::string("?");
+                const std::string declarator = scope + "::*" + inner;
+                return Next(NeedsParentheses() ? '(' + declarator + ')' : declarator);
+            }
+
+            case DWARF::Tag::ConstType:
+            case DWARF::Tag::VolatileType:
+            case DWARF::Tag::RestrictType:
+            case DWARF::Tag::AtomicType:
+            {
+                const char* qualifier = die.tag == DWARF::Tag::ConstType ? "const" : die.tag == DWARF::Tag::VolatileType ? "volatile" : die.tag == DWARF::Tag::RestrictType ? "__restrict" : "_Atomic";
+
+                //qualified pointers put the qualifier after the star, everything else before the type
+                DWARF::Die type;
+                const bool hasType = ReadReference(die, die.type, type);
+                if (hasType && (type.tag == DWARF::Tag::PointerType || type.tag == DWARF::Tag::ReferenceType || type.tag == DWARF::Tag::RvalueReferenceType || type.tag == DWARF::Tag::PtrToMemberType))
+                {
+                    return GetDeclarator(type, inner.empty() ? std::string(qualifier) : std::string(qualifier) + ' ' + inner, depth + 1u);
+                }
+                return std::string(qualifier) + ' ' + (hasType && depth < 64u ? GetDeclarator(type, inner, depth + 1u) : Join("void", inner));
+            }
+
+            case DWARF::Tag::ArrayType:
+            {
+                std::string dimensions;
+                DWARF::Die child;
+                for (uint64_t offset = die.hasChildren ? die.next : die.unit->end; m_context.ReadDie(*die.unit, offset, child) && child.tag != DWARF::Tag::Null; offset = m_context.SkipChildren(child))
+                {
+                    if (child.tag == DWARF::Tag::SubrangeType)
+                    {
+                        const bool hasBound = child.Has(DWARF::Die::HasCount) || child.Has(DWARF::Die::HasUpperBound);
+                        dimensions += hasBound ? '[' + std::to_string(child.Has(DWARF::Die::HasCount) ? child.count : child.upperBound + 1u) + ']' : std::string("[]");
+                    }
+                }
+                return Next(inner + dimensions);
+            }
+
+            case DWARF::Tag::SubroutineType:
+            {
+                std::string parameters;
+                DWARF::Die child;
+                for (uint64_t offset = die.hasChildren ? die.next : die.unit->end; m_context.ReadDie(*die.unit, offset, child) && child.tag != DWARF::Tag::Null; offset = m_context.SkipChildren(child))
+                {
+                    //the this parameter of member function types is artificial
+                    if (child.tag == DWARF::Tag::FormalParameter && !child.Has(DWARF::Die::IsArtificial))
+                    {
+                        DWARF::Die type;
+                        parameters += parameters.empty() ? "" : ", ";
+                        parameters += depth < 64u && ReadReference(child, child.type, type) ? GetDeclarator(type, "", depth + 1u) : std::string("void");
+                    }
+                    else if (child.tag == DWARF::Tag::UnspecifiedParameters)
+                    {
+                        parameters += parameters.empty() ? "..." : ", ...";
+                    }
+                }
+                return Next(inner + '(' + parameters + ')');
+            }
+
+            case DWARF::Tag::StructureType:
+            case DWARF::Tag::ClassType:
+            case DWARF::Tag::UnionType:
+            case DWARF::Tag::EnumerationType:
+            case DWARF::Tag::Typedef:
+                return Join(m_context.GetQualifiedName(die), inner);
+
+            default:
+                return Join(die.name ? die.name : "?", inner);
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void SetLocation(Layout::Location& location, const DWARF::Die& die)
+        {
+            location.fileIndex = GetFileIndex(*die.unit, die.declFile);
+            location.line      = die.declLine;
+            location.column    = die.declColumn;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        int GetFileIndex(const DWARF::Unit& unit, const uint64_t declFile)
+        {
+            std::vector<int>& cache = m_unitFiles[&unit];
+            if (cache.empty())
+            {
+                cache.resize(m_context.GetFiles(unit).size() + 1u, Layout::INVALID_FILE_INDEX - 1);
+            }
+
+            if (declFile + 1u >= cache.size())
+            {
+                return Layout::INVALID_FILE_INDEX;
+            }
+
+            int& index = cache[static_cast<size_t>(declFile)];
+            if (index == Layout::INVALID_FILE_INDEX - 1)
+            {
+                const std::string& path = m_context.GetFiles(unit)[static_cast<size_t>(declFile)];
+                index = path.empty() ? static_cast<int>(Layout::INVALID_FILE_INDEX) : m_files.Add(path);
+            }
+            return index;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TIndex CopyNode(const Layout::TIndex node)
+        {
+            const Layout::FlatNode copy = m_store.nodes[node];
+            return m_store.AddNode(copy);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TIndex CreatePointerNode(const Layout::Category nature, const Layout::TAmount offset)
+        {
+            Layout::FlatNode node;
+            node.nature = nature;
+            node.offset = offset;
+            node.size   = m_pointerSize;
+            node.align  = m_pointerSize;
+            return m_store.AddNode(node);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TIndex CreateBaseNode(const RecordInfo& base, const Layout::Category nature, const Layout::TAmount offset)
+        {
+            const Layout::TIndex index = CopyNode(base.asBase);
+            Layout::FlatNode& node = m_store.nodes[index];
+            node.nature = nature;
+            node.offset = offset;
+            return index;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        static bool IsNearlyEmpty(const RecordInfo& record, const Layout::TAmount pointerSize)
+        {
+            return record.isDynamic && record.dataSize == pointerSize;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Virtual bases that are the primary base of some class of the hierarchy share its address
+        static void CollectIndirectPrimaryBases(const RecordInfo& record, std::unordered_set<const RecordInfo*>& output)
+        {
+            for (const BaseInfo& base : record.bases)
+            {
+                if (base.record->primaryBase && base.record->primaryIsVirtual)
+                {
+                    output.insert(base.record->primaryBase);
+                }
+                CollectIndirectPrimaryBases(*base.record, output);
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Inheritance graph order: depth first, left to right, each class before its bases
+        static void CollectVirtualBases(const RecordInfo& record, std::vector<const RecordInfo*>& output, std::unordered_set<const RecordInfo*>& visited)
+        {
+            for (const BaseInfo& base : record.bases)
+            {
+                if (base.isVirtual && visited.insert(base.record).second)
+                {
+                    output.push_back(base.record);
+                }
+                CollectVirtualBases(*base.record, output, visited);
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Gives an offset to the indirect primary virtual bases through the subobjects already placed
+        static bool PlacePrimaryBases(const RecordInfo& record, const Layout::TAmount offset, std::unordered_map<const RecordInfo*, Layout::TAmount>& offsets, std::unordered_set<const RecordInfo*>& visited)
+        {
+            bool changed = false;
+            if (record.primaryBase && record.primaryIsVirtual && offsets.emplace(record.primaryBase, offset).second)
+            {
+                changed = true;
+            }
+
+            for (const BaseInfo& base : record.bases)
+            {
+                if (!base.isVirtual)
+                {
+                    changed = PlacePrimaryBases(*base.record, offset + base.offset, offsets, visited) || changed;
+                }
+                else if (offsets.find(base.record) != offsets.end() && visited.insert(base.record).second)
+                {
+                    changed = PlacePrimaryBases(*base.record, offsets[base.record], offsets, visited) || changed;
+                }
+            }
+            return changed;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsConstructorLike(const DWARF::Die& record, const DWARF::Die& function) const
+        {
+            if (function.Has(DWARF::Die::IsArtificial) || function.name == nullptr)
+            {
+                return false;
+            }
+
+            if (function.name[0] == '~' || strcmp(function.name, "operator=") == 0)
+            {
+                return true;
+            }
+
+            //constructors of template instances are named without the template arguments
+            if (record.name)
+            {
+                const char* arguments = strchr(record.name, '<');
+                const size_t length = arguments ? static_cast<size_t>(arguments - record.name) : strlen(record.name);
+                return strlen(function.name) == length && strncmp(function.name, record.name, length) == 0;
+            }
+            return false;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        const RecordInfo* GetRecord(const DWARF::Die& die)
+        {
+            const Key key{ die.unit, die.offset };
+            std::unordered_map<Key, std::unique_ptr<RecordInfo>, KeyHasher>::iterator found = m_records.find(key);
+            if (found != m_records.end())
+            {
+                //null while being computed, a record can't contain itself
+                return found->second.get();
+            }
+
+            m_records.emplace(key, nullptr);
+            std::unique_ptr<RecordInfo> info = ComputeRecord(die);
+            const RecordInfo* ret = info.get();
+            m_records[key] = std::move(info);
+            return ret;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::unique_ptr<RecordInfo> ComputeRecord(const DWARF::Die& record)
+        {
+            std::unique_ptr<RecordInfo> info(new RecordInfo());
+
+            const std::string typeName = m_context.GetQualifiedName(record);
+
+            Layout::FlatNode node;
+            node.type    = m_store.strings.Intern(typeName);
+            node.size    = static_cast<Layout::TAmount>(record.byteSize);
+            node.isValid = !record.Has(DWARF::Die::IsDeclaration) && record.Has(DWARF::Die::HasByteSize);
+            SetLocation(node.typeLocation, record);
+
+            info->size = node.size;
+
+            Layout::TIndex vtablePtr = NO_NODE;
+            std::vector<std::pair<Layout::TIndex, const RecordInfo*>> baseNodes;
+            Layout::TIndices fields;
+            Layout::TAmount dataEnd = 0;
+            Layout::TAmount align = 1;
+            bool hasUserFunctions = false;
+
+            //class members are private by default
+            const uint8_t defaultAccess = record.tag == DWARF::Tag::ClassType ? Access::Private : Access::Public;
+
+            DWARF::Die child;
+            for (uint64_t offset = record.hasChildren ? record.next : record.unit->end; m_context.ReadDie(*record.unit, offset, child) && child.tag != DWARF::Tag::Null; offset = m_context.SkipChildren(child))
+            {
+                if (child.tag == DWARF::Tag::Inheritance)
+                {
+                    DWARF::Die baseType;
+                    Layout::TAmount alignment = 0;
+                    const RecordInfo* base = ReadReference(child, child.type, baseType) && StripType(baseType, alignment) && IsRecordTag(baseType.tag) ? GetRecord(baseType) : nullptr;
+                    if (base == nullptr)
+                    {
+                        node.isValid = false;
+                        continue;
+                    }
+
+                    //virtual bases are located at runtime through the vtable, their location is an expression
+                    const bool isVirtual = child.Has(DWARF::Die::IsVirtual) || child.Has(DWARF::Die::MemberLocationIsExpr);
+                    info->bases.push_back(BaseInfo{ base, isVirtual ? 0 : child.memberLocation, isVirtual });
+                    info->isDynamic = info->isDynamic || isVirtual || base->isDynamic;
+                    info->isPOD = false;
+
+                    if (!isVirtual)
+                    {
+                        baseNodes.emplace_back(CreateBaseNode(*base, Layout::Category::NVBase, child.memberLocation), base);
+                        dataEnd = Helpers::Max(dataEnd, child.memberLocation + base->dataSize);
+                        align   = Helpers::Max(align, base->nvAlign);
+                        node.isValid = node.isValid && m_store.nodes[base->asBase].isValid;
+                    }
+                }
+                else if (child.tag == DWARF::Tag::Member)
+                {
+                    //static data members are declarations
+                    if (child.Has(DWARF::Die::IsDeclaration) || child.Has(DWARF::Die::IsExternal))
+                    {
+                        continue;
+                    }
+
+                    const Layout::TAmount memberOffset = child.Has(DWARF::Die::HasMemberLocation) ? child.memberLocation : 0;
+
+                    if (child.Has(DWARF::Die::IsArtificial) && child.name && strncmp(child.name, "_vptr", 5) == 0)
+                    {
+                        vtablePtr = CreatePointerNode(Layout::Category::VTablePtr, memberOffset);
+                        dataEnd = Helpers::Max(dataEnd, memberOffset + m_pointerSize);
+                        align   = Helpers::Max(align, m_pointerSize);
+                        info->isDynamic = true;
+                        continue;
+                    }
+
+                    if ((child.accessibility == 0u ? defaultAccess : child.accessibility) != Access::Public)
+                    {
+                        info->isPOD = false;
+                    }
+
+                    const Layout::TIndex field = ComputeField(child, memberOffset, info->isPOD);
+                    const Layout::FlatNode& fieldNode = m_store.nodes[field];
+                    if (fieldNode.nature == Layout::Category::Bitfield)
+                    {
+                        const Layout::FlatNode& bits = m_store.nodes[*m_store.ChildrenBegin(fieldNode)];
+                        dataEnd = Helpers::Max(dataEnd, fieldNode.offset + (bits.offset + bits.size + 7) / 8);
+                    }
+                    else
+                    {
+                        dataEnd = Helpers::Max(dataEnd, fieldNode.offset + fieldNode.size);
+                    }
+                    align = Helpers::Max(align, fieldNode.align);
+                    node.isValid = node.isValid && fieldNode.isValid;
+                    fields.push_back(field);
+                }
+                else if (child.tag == DWARF::Tag::Subprogram)
+                {
+                    hasUserFunctions = hasUserFunctions || IsConstructorLike(record, child);
+                }
+            }
+
+            info->isPOD = info->isPOD && !info->isDynamic && !hasUserFunctions;
+
+            //Itanium primary base: the first dynamic non virtual base, otherwise the first nearly empty virtual base
+            for (const BaseInfo& base : info->bases)
+            {
+                if (!base.isVirtual && base.record->isDynamic)
+                {
+                    info->primaryBase = base.record;
+                    break;
+                }
+            }
+
+            std::vector<const RecordInfo*> virtualBases;
+            std::unordered_set<const RecordInfo*> visited;
+            CollectVirtualBases(*info, virtualBases, visited);
+
+            std::unordered_set<const RecordInfo*> indirectPrimaryBases;
+            CollectIndirectPrimaryBases(*info, indirectPrimaryBases);
+
+            if (info->primaryBase == nullptr && vtablePtr == NO_NODE)
+            {
+                const RecordInfo* fallback = nullptr;
+                for (const RecordInfo* base : virtualBases)
+                {
+                    if (IsNearlyEmpty(*base, m_pointerSize))
+                    {
+                        if (indirectPrimaryBases.find(base) == indirectPrimaryBases.end())
+                        {
+                            info->primaryBase = base;
+                            break;
+                        }
+                        fallback = fallback ? fallback : base;
+                    }
+                }
+
+                info->primaryBase      = info->primaryBase ? info->primaryBase : fallback;
+                info->primaryIsVirtual = info->primaryBase != nullptr;
+            }
+
+            if (info->primaryIsVirtual)
+            {
+                indirectPrimaryBases.insert(info->primaryBase);
+                dataEnd = Helpers::Max(dataEnd, info->primaryBase->dataSize);
+            }
+
+            //the non virtual part
+            Layout::TIndices children;
+            if (vtablePtr != NO_NODE)
+            {
+                children.push_back(vtablePtr);
+            }
+
+            std::stable_sort(baseNodes.begin(), baseNodes.end(), [this](const std::pair<Layout::TIndex, const RecordInfo*>& a, const std::pair<Layout::TIndex, const RecordInfo*>& b) { return m_store.nodes[a.first].offset < m_store.nodes[b.first].offset; });
+            for (const std::pair<Layout::TIndex, const RecordInfo*>& baseNode : baseNodes)
+            {
+                if (baseNode.second == info->primaryBase && !info->primaryIsVirtual)
+                {
+                    m_store.nodes[baseNode.first].nature = Layout::Category::NVPrimaryBase;
+                }
+                children.push_back(baseNode.first);
+            }
+            children.insert(children.end(), fields.begin(), fields.end());
+
+            info->dataSize = info->isPOD ? info->size : dataEnd;
+            info->nvAlign  = Helpers::Max<Layout::TAmount>(align, info->primaryIsVirtual ? info->primaryBase->nvAlign : 1);
+
+            //the virtual bases go after the non virtual data, except the primary ones sharing the address of their class
+            std::unordered_map<const RecordInfo*, Layout::TAmount> offsets;
+            Layout::TAmount vbaseAlign = info->nvAlign;
+            for (const RecordInfo* base : virtualBases)
+            {
+                vbaseAlign = Helpers::Max(vbaseAlign, base->nvAlign);
+                if (indirectPrimaryBases.find(base) == indirectPrimaryBases.end())
+                {
+                    const Layout::TAmount baseOffset = Helpers::AlignOffsetTo(dataEnd, base->nvAlign);
+                    offsets.emplace(base, baseOffset);
+                    dataEnd = baseOffset + base->dataSize;
+                }
+            }
+
+            if (!virtualBases.empty())
+            {
+                for (size_t pass = 0u; pass <= virtualBases.size(); ++pass)
+                {
+                    std::unordered_set<const RecordInfo*> placed;
+                    if (!PlacePrimaryBases(*info, 0, offsets, placed))
+                    {
+                        break;
+                    }
+                }
+            }
+
+            Layout::TIndices virtualBaseNodes;
+            for (const RecordInfo* base : virtualBases)
+            {
+                std::unordered_map<const RecordInfo*, Layout::TAmount>::const_iterator placement = offsets.find(base);
+                if (placement == offsets.end())
+                {
+                    placement = offsets.emplace(base, Helpers::AlignOffsetTo(dataEnd, base->nvAlign)).first;
+                    dataEnd = placement->second + base->dataSize;
+                }
+
+                const Layout::Category nature = base == info->primaryBase ? Layout::Category::VPrimaryBase : Layout::Category::VBase;
+                virtualBaseNodes.push_back(CreateBaseNode(*base, nature, placement->second));
+                node.isValid = node.isValid && m_store.nodes[base->asBase].isValid;
+            }
+
+            //alignment: explicit or the strictest member one that still divides the size
+            info->align = record.Has(DWARF::Die::HasAlignment) ? static_cast<Layout::TAmount>(record.alignment) : vbaseAlign;
+            if (!record.Has(DWARF::Die::HasAlignment))
+            {
+                while (info->align > 1 && info->size % info->align != 0)
+                {
+                    info->align /= 2;
+                }
+                while (info->nvAlign > 1 && info->size % info->nvAlign != 0)
+                {
+                    info->nvAlign /= 2;
+                }
+            }
+            node.align = info->nvAlign;
+
+            if (!virtualBases.empty())
+            {
+                const Layout::TAmount expectedSize = Helpers::AlignOffsetTo(dataEnd, info->align);
+                if (expectedSize != info->size)
+                {
+                    LOG_WARNING("Found different struct sizes placing the virtual bases of %s: got %lld and expected %lld from the debug information. The layout might have mistakes!", typeName.c_str(), expectedSize, info->size);
+                }
+            }
+
+            //the base subobject stops at the data end, derived classes can reuse its tail padding
+            node.size = info->dataSize;
+            info->asBase = m_store.AddNode(node);
+            m_store.SetChildren(info->asBase, children.data(), static_cast<Layout::TIndex>(children.size()));
+
+            //the complete object shares the base subobject children unless it has virtual bases to append
+            info->complete = CopyNode(info->asBase);
+            m_store.nodes[info->complete].size  = info->size;
+            m_store.nodes[info->complete].align = info->align;
+            if (!virtualBaseNodes.empty())
+            {
+                children.insert(children.end(), virtualBaseNodes.begin(), virtualBaseNodes.end());
+                m_store.SetChildren(info->complete, children.data(), static_cast<Layout::TIndex>(children.size()));
+            }
+
+            return info;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TIndex ComputeField(const DWARF::Die& member, const Layout::TAmount memberOffset, bool& isPOD)
+        {
+            DWARF::Die type;
+            const bool hasType = ReadReference(member, member.type, type);
+            const TypeInfo typeInfo = hasType ? GetTypeInfo(type) : TypeInfo();
+            isPOD = isPOD && typeInfo.isPOD;
+
+            Layout::FlatNode field;
+            if (typeInfo.record && !member.Has(DWARF::Die::HasBitSize))
+            {
+                field = m_store.nodes[typeInfo.record->complete];
+                field.nature = Layout::Category::ComplexField;
+            }
+            else
+            {
+                field.nature  = Layout::Category::SimpleField;
+                field.size    = typeInfo.size;
+                field.align   = typeInfo.align;
+                field.isValid = hasType && typeInfo.size > 0;
+            }
+
+            field.name   = m_store.strings.Intern(member.name ? member.name : "");
+            field.type   = m_store.strings.Intern(hasType ? GetTypeName(type) : std::string("?"));
+            field.offset = memberOffset;
+            SetLocation(field.fieldLocation, member);
+
+            if (member.Has(DWARF::Die::HasBitSize))
+            {
+                //DWARF 4 counts the bit offset from the most significant bit of the storage unit, little endian only
+                Layout::TAmount bitOffset = memberOffset * 8;
+                if (member.Has(DWARF::Die::HasDataBitOffset))
+                {
+                    bitOffset = member.dataBitOffset;
+                }
+                else if (member.Has(DWARF::Die::HasBitOffset))
+                {
+                    const Layout::TAmount storageSize = member.Has(DWARF::Die::HasByteSize) ? static_cast<Layout::TAmount>(member.byteSize) : typeInfo.size;
+                    bitOffset = memberOffset * 8 + storageSize * 8 - member.bitOffset - static_cast<Layout::TAmount>(member.bitSize);
+                }
+
+                field.nature  = Layout::Category::Bitfield;
+                field.offset  = bitOffset / 8;
+                field.isValid = hasType;
+
+                Layout::FlatNode extraData;
+                extraData.offset = bitOffset - field.offset * 8;
+                extraData.size   = static_cast<Layout::TAmount>(member.bitSize);
+
+                const Layout::TIndex extraIndex = m_store.AddNode(extraData);
+                const Layout::TIndex fieldIndex = m_store.AddNode(field);
+                m_store.SetChildren(fieldIndex, &extraIndex, 1u);
+                return fieldIndex;
+            }
+
+            return m_store.AddNode(field);
+        }
+
+    private:
+        const DWARF::Context&                                               m_context;
+        FileTable&                                                          m_files;
+        Layout::TAmount                                                     m_pointerSize;
+        std::unordered_map<Key, std::unique_ptr<RecordInfo>, KeyHasher>     m_records;
+        std::unordered_map<Key, std::string, KeyHasher>                     m_typeNames;
+        std::unordered_map<const DWARF::Unit*, std::vector<int>>            m_unitFiles;
+        Layout::Store                                                       m_store;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    struct Candidate
+    {
+        const DWARF::Unit*       unit;
+        const DWARF::RecordEntry* record;
+        std::string              key;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool OpenContext(DWARF::Context& context, const char* binary)
+    {
+        TRACE_SCOPE("OpenDebugInfo");
+        return context.Open(binary);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::string GetRecordKey(const DWARF::Context& context, const DWARF::Unit& unit, const DWARF::RecordEntry& record)
+    {
+        //the same header seen by several units defines the same records
+        const std::vector<std::string>& files = context.GetFiles(unit);
+        const std::string& path = record.declFile < files.size() ? files[static_cast<size_t>(record.declFile)] : std::string();
+        return record.name + '\n' + path + ':' + std::to_string(record.declLine);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Appends the store of a worker, its file indices already point to the shared file table
+    void MergeStore(Layout::Store& output, const Layout::Store& input)
+    {
+        Layout::TIndices stringRemap;
+        stringRemap.reserve(input.strings.Size());
+        for (Layout::TIndex i = 0u, sz = input.strings.Size(); i < sz; ++i)
+        {
+            stringRemap.push_back(output.strings.Intern(input.strings.Get(i)));
+        }
+
+        const Layout::TIndex nodeOffset     = static_cast<Layout::TIndex>(output.nodes.size());
+        const Layout::TIndex childrenOffset = static_cast<Layout::TIndex>(output.children.size());
+
+        output.nodes.reserve(output.nodes.size() + input.nodes.size());
+        for (Layout::FlatNode node : input.nodes)
+        {
+            node.name        = stringRemap[node.name];
+            node.type        = stringRemap[node.type];
+            node.firstChild += childrenOffset;
+            output.nodes.push_back(node);
+        }
+
+        output.children.reserve(output.children.size() + input.children.size());
+        for (const Layout::TIndex child : input.children)
+        {
+            output.children.push_back(child + nodeOffset);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void ComputeRecords(Layout::Store& store, const DWARF::Context& context, FileTable& files, const std::vector<Candidate>& candidates, const unsigned int jobs)
+    {
+        TRACE_SCOPE("ComputeRecords");
+
+        const unsigned int numWorkers = Helpers::Min<unsigned int>(jobs, static_cast<unsigned int>(Helpers::Max<size_t>(candidates.size(), 1u)));
+        std::vector<std::unique_ptr<LayoutBuilder>> builders;
+        for (unsigned int i = 0u; i < numWorkers; ++i)
+        {
+            builders.emplace_back(new LayoutBuilder(context, files));
+        }
+
+        //the root of each candidate in the store of the worker computing it
+        std::vector<std::pair<unsigned int, Layout::TIndex>> roots(candidates.size(), std::make_pair(0u, NO_NODE));
+        Helpers::ParallelFor(candidates.size(), numWorkers, [&](const size_t index, const unsigned int worker)
+        {
+            roots[index] = std::make_pair(worker, builders[worker]->ComputeRoot(*candidates[index].unit, candidates[index].record->offset));
+        });
+
+        std::vector<Layout::TIndex> nodeOffsets;
+        for (std::unique_ptr<LayoutBuilder>& builder : builders)
+        {
+            nodeOffsets.push_back(static_cast<Layout::TIndex>(store.nodes.size()));
+            MergeStore(store, builder->GetStore());
+            builder.reset();
+        }
+
+        for (const std::pair<unsigned int, Layout::TIndex>& root : roots)
+        {
+            if (root.second != NO_NODE)
+            {
+                store.roots.push_back(nodeOffsets[root.first] + root.second);
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Renumbers the files in the order the result references them, so the output doesn't depend on the threads
+    void RemapFiles(Layout::Store& store, const FileTable& files)
+    {
+        std::vector<int> remap(files.files.size(), Layout::INVALID_FILE_INDEX);
+        const auto Remap = [&](Layout::Location& location)
+        {
+            if (location.fileIndex >= 0 && static_cast<size_t>(location.fileIndex) < remap.size())
+            {
+                int& index = remap[location.fileIndex];
+                if (index == Layout::INVALID_FILE_INDEX)
+                {
+                    index = static_cast<int>(store.files.size());
+                    store.files.push_back(files.files[location.fileIndex]);
+                }
+                location.fileIndex = index;
+            }
+        };
+
+        std::vector<bool> visited(store.nodes.size(), false);
+        Layout::TIndices stack(store.roots.rbegin(), store.roots.rend());
+        while (!stack.empty())
+        {
+            const Layout::TIndex index = stack.back();
+            stack.pop_back();
+            if (!visited[index])
+            {
+                visited[index] = true;
+
+                Layout::FlatNode& node = store.nodes[index];
+                Remap(node.typeLocation);
+                Remap(node.fieldLocation);
+                for (const Layout::TIndex* child = store.ChildrenEnd(node), *begin = store.ChildrenBegin(node); child != begin; )
+                {
+                    stack.push_back(*--child);
+                }
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportResult(Layout::Store& store, const FileTable& files, const char* outputPath)
+    {
+        TRACE_SCOPE("ExportResult");
+
+        RemapFiles(store, files);
+
+        if (Trace::IsEnabled())
+        {
+            Trace::AddCounter("nodesCreated", static_cast<long long>(store.nodes.size()));
+            Trace::AddCounter("lookupTableFiles", static_cast<long long>(store.files.size()));
+        }
+
+        Layout::PostProcess(store);
+        return IO::ToFile(store, outputPath);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::vector<Candidate> FindRecordsAtLocation(const DWARF::Context& context, const char* filename, const unsigned int line, const unsigned int jobs)
+    {
+        TRACE_SCOPE("FindRecordsAtLocation");
+
+        const std::string query = Helpers::NormalizePath(filename);
+        const bool queryIsRelative = !query.empty() && query[0] != '/' && !(query.size() > 1u && query[1] == ':');
+
+        const std::vector<const DWARF::Unit*>& units = context.GetUnits();
+        std::vector<std::vector<Candidate>> perUnit(units.size());
+        std::atomic<long long> recordsVisited(0);
+
+        Helpers::ParallelFor(units.size(), jobs, [&](const size_t index, const unsigned int)
+        {
+            //units not including the file don't need to be indexed
+            const DWARF::Unit& unit = *units[index];
+            const std::vector<std::string>& files = context.GetFiles(unit);
+            std::vector<bool> matches(files.size(), false);
+            bool anyMatch = false;
+            for (size_t i = 0u; i < files.size(); ++i)
+            {
+                matches[i] = !files[i].empty() && Helpers::SameFilename(files[i], query, queryIsRelative);
+                anyMatch = anyMatch || matches[i];
+            }
+
+            if (!anyMatch)
+            {
+                return;
+            }
+
+            const DWARF::UnitIndex& unitIndex = context.GetIndex(unit);
+            recordsVisited += static_cast<long long>(unitIndex.records.size());
+            for (const DWARF::RecordEntry& record : unitIndex.records)
+            {
+                if (record.declLine == line && record.declFile < matches.size() && matches[static_cast<size_t>(record.declFile)])
+                {
+                    perUnit[index].push_back(Candidate{ &unit, &record, GetRecordKey(context, unit, record) });
+                }
+            }
+        });
+
+        Trace::AddCounter("recordsVisited", recordsVisited);
+
+        //first unit defining each record, several template instances can share the location
+        std::vector<Candidate> candidates;
+        std::unordered_set<std::string> claimed;
+        for (std::vector<Candidate>& unitCandidates : perUnit)
+        {
+            for (Candidate& candidate : unitCandidates)
+            {
+                if (claimed.insert(candidate.key).second)
+                {
+                    candidates.push_back(std::move(candidate));
+                }
+            }
+        }
+
+        return candidates;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::vector<Candidate> FindAllRecords(const DWARF::Context& context, const char* fileFilter, const unsigned int jobs)
+    {
+        TRACE_SCOPE("FindAllRecords");
+
+        const std::vector<const DWARF::Unit*>& units = context.GetUnits();
+        {
+            TRACE_SCOPE("IndexUnits");
+            Helpers::ParallelFor(units.size(), jobs, [&](const size_t index, const unsigned int)
+            {
+                context.GetFiles(*units[index]);
+                context.GetIndex(*units[index]);
+            });
+        }
+
+        //claimed sequentially in unit order, the output is the same whatever the number of jobs
+        const std::string filter = fileFilter ? Helpers::NormalizePath(fileFilter) : std::string();
+        long long recordsVisited = 0;
+        std::vector<Candidate> candidates;
+        std::unordered_set<std::string> claimed;
+        for (const DWARF::Unit* unit : units)
+        {
+            const std::vector<std::string>& files = context.GetFiles(*unit);
+            const DWARF::UnitIndex& unitIndex = context.GetIndex(*unit);
+            recordsVisited += static_cast<long long>(unitIndex.records.size());
+
+            for (const DWARF::RecordEntry& record : unitIndex.records)
+            {
+                const std::string& path = record.declFile < files.size() ? files[static_cast<size_t>(record.declFile)] : std::string();
+                if (!filter.empty() && path.find(filter) == std::string::npos)
+                {
+                    continue;
+                }
+
+                std::string key = GetRecordKey(context, *unit, record);
+                if (claimed.insert(key).second)
+                {
+                    candidates.push_back(Candidate{ unit, &record, std::move(key) });
+                }
+            }
+        }
+
+        Trace::AddCounter("recordsVisited", recordsVisited);
+        return candidates;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportAtLocation(const char* binary, const char* filename, const unsigned int line, const char* output, const unsigned int jobs)
+    {
+        if (!binary)
+        {
+            LOG_ERROR("No binary file path provided.");
+            return false;
+        }
+
+        if (!output)
+        {
+            LOG_ERROR("No output file path provided.");
+            return false;
+        }
+
+        if (!filename)
+        {
+            LOG_ERROR("No location file path provided.");
+            return false;
+        }
+
+        TRACE_SCOPE("DWARFReader::ExportAtLocation");
+
+        DWARF::Context context;
+        if (!OpenContext(context, binary))
+        {
+            return false;
+        }
+
+        const unsigned int numJobs = Helpers::GetNumJobs(jobs);
+        const std::vector<Candidate> candidates = FindRecordsAtLocation(context, filename, line, numJobs);
+        if (candidates.empty())
+        {
+            LOG_WARNING("No record definition found at %s:%u.", filename, line);
+        }
+
+        FileTable files;
+        Layout::Store store;
+        ComputeRecords(store, context, files, candidates, numJobs);
+        return ExportResult(store, files, output);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportAll(const char* binary, const char* fileFilter, const char* output, const unsigned int jobs)
+    {
+        if (!binary)
+        {
+            LOG_ERROR("No binary file path provided.");
+            return false;
+        }
+
+        if (!output)
+        {
+            LOG_ERROR("No output file path provided.");
+            return false;
+        }
+
+        TRACE_SCOPE("DWARFReader::ExportAll");
+
+        DWARF::Context context;
+        if (!OpenContext(context, binary))
+        {
+            return false;
+        }
+
+        const unsigned int numJobs = Helpers::GetNumJobs(jobs);
+        const std::vector<Candidate> candidates = FindAllRecords(context, fileFilter, numJobs);
+        LOG_PROGRESS("Computing %zu records from %zu units with %u jobs...", candidates.size(), context.GetUnits().size(), numJobs);
+
+        FileTable files;
+        Layout::Store store;
+        ComputeRecords(store, context, files, candidates, numJobs);
+        return ExportResult(store, files, output);
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+namespace DWARFReader
+{
+    bool ExportAtLocation(const char* binary, const char* filename, const unsigned int line, const char* output, const unsigned int jobs);
+    bool ExportAll(const char* binary, const char* fileFilter, const char* output, const unsigned int jobs);
+}
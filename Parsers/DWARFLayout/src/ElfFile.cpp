@@ -0,0 +1,447 @@
+#include "ElfFile.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "IO.h"
+
+namespace DWARF
+{
+    // The ELF structures are read field by field at their specification offsets, which keeps the reader independent
+    // from the system elf.h and working on Windows hosts inspecting Linux binaries. Only little endian images are read.
+
+    namespace Elf
+    {
+        constexpr uint8_t  CLASS_32       = 1;
+        constexpr uint8_t  CLASS_64       = 2;
+        constexpr uint8_t  DATA_LSB       = 1;
+        constexpr uint16_t TYPE_REL       = 1;
+
+        constexpr uint32_t SHT_SYMTAB     = 2;
+        constexpr uint32_t SHT_RELA       = 4;
+        constexpr uint32_t SHT_NOBITS     = 8;
+        constexpr uint32_t SHT_REL        = 9;
+        constexpr uint64_t SHF_COMPRESSED = 0x800;
+        constexpr uint16_t SHN_XINDEX     = 0xffff;
+
+        constexpr uint16_t EM_386         = 3;
+        constexpr uint16_t EM_ARM         = 40;
+        constexpr uint16_t EM_X86_64      = 62;
+        constexpr uint16_t EM_AARCH64     = 183;
+        constexpr uint16_t EM_RISCV       = 243;
+
+        // ----------------------------------------------------------------------------------------------------------
+        struct SectionHeader
+        {
+            uint32_t name;
+            uint32_t type;
+            uint64_t flags;
+            uint64_t offset;
+            uint64_t size;
+            uint32_t link;
+            uint32_t info;
+            uint64_t entrySize;
+        };
+    }
+
+    namespace Helpers
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        template<typename T> T Read(const uint8_t* data)
+        {
+            T value;
+            memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        Elf::SectionHeader ReadSectionHeader(const uint8_t* data, const bool is64)
+        {
+            Elf::SectionHeader header;
+            header.name      = Read<uint32_t>(data);
+            header.type      = Read<uint32_t>(data + 4);
+            header.flags     = is64 ? Read<uint64_t>(data + 8)  : Read<uint32_t>(data + 8);
+            header.offset    = is64 ? Read<uint64_t>(data + 24) : Read<uint32_t>(data + 16);
+            header.size      = is64 ? Read<uint64_t>(data + 32) : Read<uint32_t>(data + 20);
+            header.link      = is64 ? Read<uint32_t>(data + 40) : Read<uint32_t>(data + 24);
+            header.info      = is64 ? Read<uint32_t>(data + 44) : Read<uint32_t>(data + 28);
+            header.entrySize = is64 ? Read<uint64_t>(data + 56) : Read<uint32_t>(data + 36);
+            return header;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        bool FindSectionId(SectionId& output, const char* name)
+        {
+            static const char* const s_names[static_cast<int>(SectionId::Count)] =
+            {
+                ".debug_info", ".debug_abbrev", ".debug_str", ".debug_line_str", ".debug_str_offsets", ".debug_line", ".debug_types", ".debug_cu_index", ".debug_tu_index"
+            };
+
+            for (int i = 0; i < static_cast<int>(SectionId::Count); ++i)
+            {
+                const size_t length = strlen(s_names[i]);
+                if (strncmp(name, s_names[i], length) == 0 && (name[length] == '\0' || strcmp(name + length, ".dwo") == 0))
+                {
+                    output = static_cast<SectionId>(i);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Size in bytes of the absolute relocations found in debug sections, 0 for anything else
+        unsigned int GetRelocationSize(const uint16_t machine, const uint32_t type)
+        {
+            switch (machine)
+            {
+            case Elf::EM_X86_64:  return type == 1u ? 8u : (type == 10u || type == 11u) ? 4u : 0u; // R_X86_64_64, R_X86_64_32(S)
+            case Elf::EM_AARCH64: return type == 257u ? 8u : type == 258u ? 4u : 0u;                 // R_AARCH64_ABS64, R_AARCH64_ABS32
+            case Elf::EM_RISCV:   return type == 2u ? 8u : type == 1u ? 4u : 0u;                     // R_RISCV_64, R_RISCV_32
+            case Elf::EM_386:     return type == 1u ? 4u : 0u;                                       // R_386_32
+            case Elf::EM_ARM:     return type == 2u ? 4u : 0u;                                       // R_ARM_ABS32
+            default:              return 0u;
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    ElfFile::ElfFile()
+        : m_data(nullptr)
+        , m_size(0u)
+        , m_addressSize(8u)
+        , m_is64(true)
+        , m_isSplit(false)
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    ElfFile::~ElfFile()
+    {
+        Close();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool ElfFile::Open(const char* filename)
+    {
+        Close();
+
+        if (!Map(filename))
+        {
+            LOG_ERROR("Unable to open %s.", filename);
+            return false;
+        }
+
+        m_filename = filename;
+
+        if (!ReadSections())
+        {
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void ElfFile::Close()
+    {
+        Unmap();
+        m_filename.clear();
+        m_relocatedCopies.clear();
+        m_isSplit = false;
+        for (Section& section : m_sections)
+        {
+            section = Section();
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool ElfFile::ReadSections()
+    {
+        const uint8_t* header = m_data;
+        if (m_size < 52u || memcmp(header, "\x7f" "ELF", 4) != 0)
+        {
+            LOG_ERROR("%s is not an ELF file.", m_filename.c_str());
+            return false;
+        }
+
+        if (header[5] != Elf::DATA_LSB || (header[4] != Elf::CLASS_32 && header[4] != Elf::CLASS_64))
+        {
+            LOG_ERROR("%s is not a little endian ELF file, only those are supported.", m_filename.c_str());
+            return false;
+        }
+
+        m_is64        = header[4] == Elf::CLASS_64;
+        m_addressSize = m_is64 ? 8u : 4u;
+
+        const uint16_t type           = Helpers::Read<uint16_t>(header + 16);
+        const uint16_t machine        = Helpers::Read<uint16_t>(header + 18);
+        const uint64_t sectionsOffset = m_is64 ? Helpers::Read<uint64_t>(header + 40) : Helpers::Read<uint32_t>(header + 32);
+        const uint16_t entrySize      = Helpers::Read<uint16_t>(header + (m_is64 ? 58 : 46));
+        uint64_t       numSections    = Helpers::Read<uint16_t>(header + (m_is64 ? 60 : 48));
+        uint32_t       namesIndex     = Helpers::Read<uint16_t>(header + (m_is64 ? 62 : 50));
+
+        if (sectionsOffset == 0u || entrySize < (m_is64 ? 64u : 40u) || sectionsOffset + entrySize > m_size)
+        {
+            LOG_ERROR("%s has no section headers.", m_filename.c_str());
+            return false;
+        }
+
+        //big section tables keep their real count and names index in the first entry
+        const Elf::SectionHeader first = Helpers::ReadSectionHeader(m_data + sectionsOffset, m_is64);
+        numSections = numSections == 0u ? first.size : numSections;
+        namesIndex  = namesIndex == Elf::SHN_XINDEX ? first.link : namesIndex;
+
+        if (sectionsOffset + numSections * entrySize > m_size || namesIndex >= numSections)
+        {
+            LOG_ERROR("%s has a corrupt section header table.", m_filename.c_str());
+            return false;
+        }
+
+        std::vector<const uint8_t*> sectionHeaders;
+        sectionHeaders.reserve(static_cast<size_t>(numSections));
+        for (uint64_t i = 0u; i < numSections; ++i)
+        {
+            sectionHeaders.push_back(m_data + sectionsOffset + i * entrySize);
+        }
+
+        const Elf::SectionHeader names = Helpers::ReadSectionHeader(sectionHeaders[namesIndex], m_is64);
+        if (names.offset + names.size > m_size)
+        {
+            LOG_ERROR("%s has a corrupt section name table.", m_filename.c_str());
+            return false;
+        }
+
+        bool compressed = false;
+        for (const uint8_t* entry : sectionHeaders)
+        {
+            const Elf::SectionHeader section = Helpers::ReadSectionHeader(entry, m_is64);
+            if (section.name >= names.size)
+            {
+                continue;
+            }
+
+            const char* name = reinterpret_cast<const char*>(m_data + names.offset + section.name);
+            if (strncmp(name, ".zdebug", 7) == 0)
+            {
+                compressed = true;
+                continue;
+            }
+
+            SectionId id;
+            if (section.type == Elf::SHT_NOBITS || !Helpers::FindSectionId(id, name))
+            {
+                continue;
+            }
+
+            if (section.flags & Elf::SHF_COMPRESSED)
+            {
+                compressed = true;
+                continue;
+            }
+
+            if (section.offset + section.size > m_size)
+            {
+                LOG_WARNING("Section %s of %s is out of the file bounds, ignoring it.", name, m_filename.c_str());
+                continue;
+            }
+
+            m_sections[static_cast<int>(id)].data = m_data + section.offset;
+            m_sections[static_cast<int>(id)].size = section.size;
+            m_isSplit = m_isSplit || strstr(name, ".dwo") != nullptr;
+        }
+
+        if (compressed)
+        {
+            LOG_WARNING("%s has compressed debug sections, they are skipped. Link with -gz=none or decompress them with 'objcopy --decompress-debug-sections'.", m_filename.c_str());
+        }
+
+        if (type == Elf::TYPE_REL)
+        {
+            ApplyRelocations(machine, sectionHeaders);
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void ElfFile::ApplyRelocations(const uint16_t machine, const std::vector<const uint8_t*>& sectionHeaders)
+    {
+        //object files reference other debug sections through relocations against section symbols
+        for (const uint8_t* entry : sectionHeaders)
+        {
+            const Elf::SectionHeader relocations = Helpers::ReadSectionHeader(entry, m_is64);
+            if ((relocations.type != Elf::SHT_RELA && relocations.type != Elf::SHT_REL) || relocations.info >= sectionHeaders.size() || relocations.link >= sectionHeaders.size() || relocations.entrySize == 0u)
+            {
+                continue;
+            }
+
+            const Elf::SectionHeader target  = Helpers::ReadSectionHeader(sectionHeaders[relocations.info], m_is64);
+            const Elf::SectionHeader symbols = Helpers::ReadSectionHeader(sectionHeaders[relocations.link], m_is64);
+            const size_t symbolSize = m_is64 ? 24u : 16u;
+            if (symbols.type != Elf::SHT_SYMTAB || relocations.offset + relocations.size > m_size || symbols.offset + symbols.size > m_size)
+            {
+                continue;
+            }
+
+            //find which of the read sections is the target
+            Section* section = nullptr;
+            for (Section& candidate : m_sections)
+            {
+                if (candidate.data == m_data + target.offset && candidate.size == target.size && target.size > 0u)
+                {
+                    section = &candidate;
+                }
+            }
+
+            if (section == nullptr)
+            {
+                continue;
+            }
+
+            //the mapping is read only, relocate a private copy
+            uint8_t* copy = nullptr;
+            for (const std::unique_ptr<uint8_t[]>& relocated : m_relocatedCopies)
+            {
+                if (relocated.get() == section->data)
+                {
+                    copy = relocated.get();
+                }
+            }
+
+            if (copy == nullptr)
+            {
+                m_relocatedCopies.emplace_back(new uint8_t[static_cast<size_t>(section->size)]);
+                copy = m_relocatedCopies.back().get();
+                memcpy(copy, section->data, static_cast<size_t>(section->size));
+                section->data = copy;
+            }
+
+            const bool hasAddend = relocations.type == Elf::SHT_RELA;
+            for (uint64_t offset = 0u; offset + relocations.entrySize <= relocations.size; offset += relocations.entrySize)
+            {
+                const uint8_t* relocation = m_data + relocations.offset + offset;
+                const uint64_t where  = m_is64 ? Helpers::Read<uint64_t>(relocation) : Helpers::Read<uint32_t>(relocation);
+                const uint64_t info   = m_is64 ? Helpers::Read<uint64_t>(relocation + 8) : Helpers::Read<uint32_t>(relocation + 4);
+                const uint64_t symbol = m_is64 ? (info >> 32) : (info >> 8);
+                const uint32_t type   = static_cast<uint32_t>(m_is64 ? (info & 0xffffffffu) : (info & 0xffu));
+
+                const unsigned int size = Helpers::GetRelocationSize(machine, type);
+                if (size == 0u || where + size > section->size || (symbol + 1u) * symbolSize > symbols.size)
+                {
+                    continue;
+                }
+
+                const uint8_t* symbolEntry = m_data + symbols.offset + symbol * symbolSize;
+                const uint64_t symbolValue = m_is64 ? Helpers::Read<uint64_t>(symbolEntry + 8) : Helpers::Read<uint32_t>(symbolEntry + 4);
+
+                int64_t addend = 0;
+                if (hasAddend)
+                {
+                    addend = m_is64 ? Helpers::Read<int64_t>(relocation + 16) : Helpers::Read<int32_t>(relocation + 8);
+                }
+                else
+                {
+                    addend = size == 8u ? Helpers::Read<int64_t>(copy + where) : Helpers::Read<int32_t>(copy + where);
+                }
+
+                const uint64_t value = symbolValue + static_cast<uint64_t>(addend);
+                if (size == 8u)
+                {
+                    memcpy(copy + where, &value, 8u);
+                }
+                else
+                {
+                    const uint32_t value32 = static_cast<uint32_t>(value);
+                    memcpy(copy + where, &value32, 4u);
+                }
+            }
+        }
+    }
+
+#ifdef _WIN32
+    // ----------------------------------------------------------------------------------------------------------
+    bool ElfFile::Map(const char* filename)
+    {
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+        //the view keeps the mapping alive
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+
+        if (view == nullptr)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<size_t>(size.QuadPart);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void ElfFile::Unmap()
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#else
+    // ----------------------------------------------------------------------------------------------------------
+    bool ElfFile::Map(const char* filename)
+    {
+        const int file = open(filename, O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        void* view = fstat(file, &info) == 0 && info.st_size > 0 ? mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+
+        //the mapping keeps the file alive
+        close(file);
+
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<size_t>(info.st_size);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void ElfFile::Unmap()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#endif
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DWARF
+{
+    // ----------------------------------------------------------------------------------------------------------
+    enum class SectionId : unsigned char
+    {
+        Info,
+        Abbrev,
+        Str,
+        LineStr,
+        StrOffsets,
+        Line,
+        Types,
+        CuIndex,
+        TuIndex,
+
+        Count
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct Section
+    {
+        Section()
+            : data(nullptr)
+            , size(0u)
+        {}
+
+        const uint8_t* data;
+        uint64_t       size;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Memory mapped ELF image exposing its debug sections. The .dwo section names are accepted as well, so the same
+    // class opens linked binaries, split DWARF objects and packages. Relocatable objects get their debug relocations
+    // applied to private copies of the affected sections, everything else is read straight from the mapping.
+    class ElfFile
+    {
+    public:
+        ElfFile();
+        ~ElfFile();
+
+        ElfFile(const ElfFile&) = delete;
+        ElfFile& operator=(const ElfFile&) = delete;
+
+        bool Open(const char* filename);
+        void Close();
+        bool IsOpen() const { return m_data != nullptr; }
+
+        const std::string& GetFilename() const                 { return m_filename; }
+        const Section&     GetSection(const SectionId id) const { return m_sections[static_cast<int>(id)]; }
+        unsigned char      GetAddressSize() const               { return m_addressSize; }
+        bool               IsSplit() const                      { return m_isSplit; } // sections named .dwo
+        bool               IsPackage() const                    { return GetSection(SectionId::CuIndex).data != nullptr || GetSection(SectionId::TuIndex).data != nullptr; }
+
+    private:
+        bool Map(const char* filename);
+        void Unmap();
+        bool ReadSections();
+        void ApplyRelocations(const uint16_t machine, const std::vector<const uint8_t*>& sectionHeaders);
+
+    private:
+        const uint8_t*                          m_data;
+        size_t                                  m_size;
+        std::string                             m_filename;
+        Section                                 m_sections[static_cast<int>(SectionId::Count)];
+        std::vector<std::unique_ptr<uint8_t[]>> m_relocatedCopies;
+        unsigned char                           m_addressSize;
+        bool                                    m_is64;
+        bool                                    m_isSplit;
+    };
+}
@@ -0,0 +1,30 @@
+#include "DWARFReader.h"
+
+#include "IO.h"
+#include "Trace.h"
+
+#include "CommandLine.h"
+
+constexpr int FAILURE = -1;
+constexpr int SUCCESS = 0;
+
+// -----------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    //Parse Command Line arguments
+    ExportParams params;
+    if (CommandLine::Parse(params, argc, argv) != 0)
+    {
+        return FAILURE;
+    }
+
+    Trace::Session traceSession(params.trace);
+
+    //Execute exporter
+    if (params.exportAll)
+    { 
+        return DWARFReader::ExportAll(params.input, params.fileFilter, params.output, params.jobs) ? SUCCESS : FAILURE;
+    }
+
+    return DWARFReader::ExportAtLocation(params.input, params.locationFile, params.locationLine, params.output, params.jobs) ? SUCCESS : FAILURE;
+}
@@ -0,0 +1,91 @@
+#include "Analysis.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace Analysis
+{
+    // -----------------------------------------------------------------------------------------------------------
+    bool IsLeaf(const Layout::FlatNode& node)
+    {
+        //the bitfield children only hold the bit ranges of its fields
+        return node.numChildren == 0u || node.nature == Layout::Category::Bitfield;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void GetByteRange(Layout::TAmount& start, Layout::TAmount& end, const Layout::Store& store, const Layout::FlatNode& node, const Layout::TAmount offset)
+    {
+        //bitfields only cover the bytes holding the bits of their fields
+        if (node.nature == Layout::Category::Bitfield && node.numChildren > 0u)
+        {
+            Layout::TAmount startBit = -1;
+            Layout::TAmount endBit   = 0;
+            for (const Layout::TIndex* child = store.ChildrenBegin(node), *last = store.ChildrenEnd(node); child != last; ++child)
+            {
+                const Layout::FlatNode& bits = store.nodes[*child];
+                startBit = startBit < 0 ? bits.offset : std::min(startBit, bits.offset);
+                endBit   = std::max(endBit, bits.offset + bits.size);
+            }
+            start = (offset * 8 + startBit) / 8;
+            end   = (offset * 8 + endBit + 7) / 8;
+            return;
+        }
+
+        start = offset;
+        end   = offset + node.size;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TAmount GetPadding(const Layout::FlatNode& node)
+    {
+        //the real size exported by the parsers is the only padding definition, every command agrees with it
+        return node.size - node.realSize;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::string GetTypeName(const Layout::Store& store, const Layout::FlatNode& node)
+    {
+        return std::string(store.strings.Get(node.type));
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::string GetMemberLabel(const Layout::Store& store, const Layout::FlatNode& node)
+    {
+        switch (node.nature)
+        {
+        case Layout::Category::VTablePtr:     return "<vtable ptr>";
+        case Layout::Category::VFTablePtr:    return "<vftable ptr>";
+        case Layout::Category::VBTablePtr:    return "<vbtable ptr>";
+        case Layout::Category::VtorDisp:      return "<vtordisp>";
+        case Layout::Category::Shared:        return "<shared memory>";
+        case Layout::Category::NVPrimaryBase:
+        case Layout::Category::NVBase:        return "base " + GetTypeName(store, node);
+        case Layout::Category::VPrimaryBase:
+        case Layout::Category::VBase:         return "virtual base " + GetTypeName(store, node);
+        default:                              return GetTypeName(store, node) + " " + std::string(store.strings.Get(node.name));
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool FindRoot(Layout::TIndex& output, const Layout::Store& store, const char* typeName)
+    {
+        //without a name only single record exports have an obvious candidate
+        if (typeName == nullptr)
+        {
+            output = store.roots.size() == 1u ? store.roots.front() : 0u;
+            return store.roots.size() == 1u;
+        }
+
+        for (const Layout::TIndex root : store.roots)
+        {
+            if (store.strings.Get(store.nodes[root].type) == typeName)
+            {
+                output = root;
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+#include "LayoutDefinitions.h"
+
+namespace Analysis
+{
+    // Helpers shared by the analyzer commands
+
+    bool        IsLeaf(const Layout::FlatNode& node);
+    void        GetByteRange(Layout::TAmount& start, Layout::TAmount& end, const Layout::Store& store, const Layout::FlatNode& node, const Layout::TAmount offset);
+
+    Layout::TAmount GetPadding(const Layout::FlatNode& node);
+
+    std::string GetTypeName(const Layout::Store& store, const Layout::FlatNode& node);
+    std::string GetMemberLabel(const Layout::Store& store, const Layout::FlatNode& node);
+
+    bool FindRoot(Layout::TIndex& output, const Layout::Store& store, const char* typeName);
+}
\ No newline at end of file
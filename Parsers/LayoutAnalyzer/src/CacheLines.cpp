@@ -0,0 +1,247 @@
+#include "CacheLines.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+#include "Analysis.h"
+#include "Heat.h"
+#include "IO.h"
+#include "LayoutPostProcess.h"
+
+namespace CacheLines
+{
+    // Offsets are relative to the record start, assuming the record itself starts at a cache line boundary.
+
+    using TInterval  = std::pair<Layout::TAmount,Layout::TAmount>;
+    using TIntervals = std::vector<TInterval>;
+
+    struct FlaggedEntry
+    {
+        Layout::TIndex  record;
+        Occupancy       occupancy;
+    };
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        TInterval GetBytes(const Layout::Store& store, const Layout::FlatNode& node, const Layout::TAmount offset)
+        {
+            TInterval bytes;
+            Analysis::GetByteRange(bytes.first, bytes.second, store, node, offset);
+            return bytes;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TAmount GetFirstLine(const TInterval& bytes, const Layout::TAmount lineSize) { return bytes.first / lineSize; }
+        Layout::TAmount GetLastLine(const TInterval& bytes, const Layout::TAmount lineSize)  { return bytes.second > bytes.first ? (bytes.second - 1) / lineSize : bytes.first / lineSize; }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsStraddling(const TInterval& bytes, const Layout::TAmount lineSize)
+        {
+            //touching more lines than the size requires
+            const Layout::TAmount size   = bytes.second - bytes.first;
+            const Layout::TAmount needed = std::max<Layout::TAmount>(1, (size + lineSize - 1) / lineSize);
+            return size > 0 && GetLastLine(bytes, lineSize) - GetFirstLine(bytes, lineSize) + 1 > needed;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void CollectLeaves(TIntervals& coldLeaves, unsigned int& numStraddling, const Layout::Store& store, const Heat::Map* heat, const Layout::TIndex root, const Layout::FlatNode& node, const Layout::TAmount offset, const Layout::TAmount lineSize)
+        {
+            for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+            {
+                const Layout::FlatNode& childNode = store.nodes[*child];
+                const Layout::TAmount childOffset = offset + childNode.offset;
+
+                if (Analysis::IsLeaf(childNode))
+                {
+                    const TInterval bytes = GetBytes(store, childNode, childOffset);
+                    numStraddling += IsStraddling(bytes, lineSize) ? 1u : 0u;
+
+                    if (heat && Heat::Classify(*heat, root, bytes.first, bytes.second) == Heat::Temperature::Cold)
+                    {
+                        coldLeaves.push_back(bytes);
+                    }
+                }
+                else
+                {
+                    CollectLeaves(coldLeaves, numStraddling, store, heat, root, childNode, childOffset, lineSize);
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintNode(FILE* output, const Layout::Store& store, const Heat::Map* heat, const Layout::TIndex root, const Layout::FlatNode& node, const Layout::TAmount offset, const Layout::TAmount lineSize, const unsigned int depth)
+        {
+            for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+            {
+                const Layout::FlatNode& childNode = store.nodes[*child];
+                const Layout::TAmount childOffset = offset + childNode.offset;
+                const TInterval bytes = GetBytes(store, childNode, childOffset);
+
+                const Layout::TAmount firstLine = GetFirstLine(bytes, lineSize);
+                const Layout::TAmount lastLine  = GetLastLine(bytes, lineSize);
+
+                char lines[32];
+                if (firstLine == lastLine) snprintf(lines, sizeof(lines), "%lld", firstLine);
+                else                       snprintf(lines, sizeof(lines), "%lld-%lld", firstLine, lastLine);
+
+                const char* temperature = heat ? Heat::ToString(Heat::Classify(*heat, root, bytes.first, bytes.second)) : "";
+                fprintf(output, "  %8lld %6lld %7s %5s  %*s%s%s\n", childOffset, childNode.size, lines, temperature, depth * 2, "", Analysis::GetMemberLabel(store, childNode).c_str(), IsStraddling(bytes, lineSize) ? "  [straddles]" : "");
+
+                if (!Analysis::IsLeaf(childNode))
+                {
+                    PrintNode(output, store, heat, root, childNode, childOffset, lineSize, depth + 1);
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsFirstLineWasted(const Occupancy& occupancy)
+        {
+            //padding and never accessed members take most of the line
+            if (occupancy.lines.empty()) return false;
+            const LineUsage& first = occupancy.lines.front();
+            return (first.padding + first.cold) * 2 > first.used + first.padding;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        TIntervals Merge(TIntervals& intervals)
+        {
+            //overlapping members ( bitfields sharing bytes, unions ) only count once
+            std::sort(intervals.begin(), intervals.end());
+            TIntervals merged;
+            for (const TInterval& interval : intervals)
+            {
+                if (!merged.empty() && interval.first <= merged.back().second) merged.back().second = std::max(merged.back().second, interval.second);
+                else                                                           merged.push_back(interval);
+            }
+            return merged;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void AddToLines(Occupancy& occupancy, Layout::TAmount LineUsage::* field, const TIntervals& intervals, const Layout::TAmount size)
+        {
+            for (const TInterval& interval : intervals)
+            {
+                const Layout::TAmount end = std::min(interval.second, size);
+                for (Layout::TAmount start = interval.first; start < end; )
+                {
+                    const Layout::TAmount line    = start / occupancy.lineSize;
+                    const Layout::TAmount lineEnd = std::min(end, (line + 1) * occupancy.lineSize);
+                    occupancy.lines[static_cast<size_t>(line)].*field += lineEnd - start;
+                    start = lineEnd;
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintOccupancy(FILE* output, const Layout::Store& store, const Layout::TIndex record, const Occupancy& occupancy)
+        {
+            const Layout::FlatNode& node = store.nodes[record];
+            fprintf(output, "%s: %lld bytes, %u cache lines of %lld bytes, %u straddling members\n", Analysis::GetTypeName(store, node).c_str(), node.size, static_cast<unsigned int>(occupancy.lines.size()), occupancy.lineSize, occupancy.numStraddling);
+
+            fprintf(output, "  %8s %6s %8s %6s %12s\n", "Line", "Used", "Padding", "Cold", "Utilization");
+            for (size_t i = 0u; i < occupancy.lines.size(); ++i)
+            {
+                const LineUsage& line = occupancy.lines[i];
+                const Layout::TAmount inRecord = line.used + line.padding;
+                fprintf(output, "  %8u %6lld %8lld %6lld %11.1f%%\n", static_cast<unsigned int>(i), line.used, line.padding, line.cold, inRecord ? (100.0 * line.used) / inRecord : 0.0);
+            }
+            fprintf(output, "\n");
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void Compute(Occupancy& occupancy, const Layout::Store& store, const Layout::TIndex record, const Layout::TAmount lineSize, const Heat::Map* heat)
+    {
+        const Layout::FlatNode& node = store.nodes[record];
+
+        occupancy.lineSize      = lineSize;
+        occupancy.numStraddling = 0u;
+        occupancy.lines.assign(static_cast<size_t>((node.size + lineSize - 1) / lineSize), LineUsage{ 0, 0, 0 });
+
+        //records without samples have no temperature, not only cold members
+        const Heat::Map* recordHeat = heat && Heat::GetTotal(*heat, record) > 0u ? heat : nullptr;
+
+        TIntervals coldLeaves;
+        Helpers::CollectLeaves(coldLeaves, occupancy.numStraddling, store, recordHeat, record, node, 0, lineSize);
+
+        //the used bytes are the ones counted in the real size, the line paddings add up to the record padding
+        Layout::TRanges used;
+        Layout::CollectUsedRanges(used, store, record);
+
+        Helpers::AddToLines(occupancy, &LineUsage::used, Helpers::Merge(used), node.size);
+        Helpers::AddToLines(occupancy, &LineUsage::cold, Helpers::Merge(coldLeaves), node.size);
+
+        for (size_t i = 0u; i < occupancy.lines.size(); ++i)
+        {
+            const Layout::TAmount inRecord = std::min<Layout::TAmount>(lineSize, node.size - static_cast<Layout::TAmount>(i) * lineSize);
+            occupancy.lines[i].padding = inRecord - occupancy.lines[i].used;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Report(FILE* output, const Layout::Store& store, const Heat::Map* heat, const char* typeName, const Layout::TAmount lineSize, const unsigned int top)
+    {
+        if (lineSize <= 0)
+        {
+            LOG_ERROR("Invalid cache line size.");
+            return false;
+        }
+
+        //a single record: full annotated tree
+        if (typeName || store.roots.size() == 1u)
+        {
+            Layout::TIndex root = 0u;
+            if (!Analysis::FindRoot(root, store, typeName))
+            {
+                LOG_ERROR("Type %s not found.", typeName);
+                return false;
+            }
+
+            Occupancy occupancy;
+            Compute(occupancy, store, root, lineSize, heat);
+            Helpers::PrintOccupancy(output, store, root, occupancy);
+
+            fprintf(output, "  %8s %6s %7s %5s  %s\n", "Offset", "Size", "Lines", heat ? "Temp" : "", "Member");
+            Helpers::PrintNode(output, store, heat, root, store.nodes[root], 0, lineSize, 0u);
+            return true;
+        }
+
+        //batch: flag the records whose first line is mostly padding or cold members
+        std::vector<FlaggedEntry> flagged;
+        std::unordered_set<Layout::TIndex> visitedTypes;
+        for (const Layout::TIndex root : store.roots)
+        {
+            if (visitedTypes.insert(store.nodes[root].type).second)
+            {
+                FlaggedEntry entry;
+                entry.record = root;
+                Compute(entry.occupancy, store, root, lineSize, heat);
+                if (Helpers::IsFirstLineWasted(entry.occupancy))
+                {
+                    flagged.push_back(std::move(entry));
+                }
+            }
+        }
+
+        std::stable_sort(flagged.begin(), flagged.end(), [](const FlaggedEntry& a, const FlaggedEntry& b){ return a.occupancy.lines.front().padding + a.occupancy.lines.front().cold > b.occupancy.lines.front().padding + b.occupancy.lines.front().cold; });
+        if (top > 0u && flagged.size() > top)
+        {
+            flagged.resize(top);
+        }
+
+        LOG_PROGRESS("%u records analyzed, %u have a first cache line mostly padding or cold.", static_cast<unsigned int>(visitedTypes.size()), static_cast<unsigned int>(flagged.size()));
+
+        fprintf(output, "%8s %8s %8s %6s %10s  %s\n", "Padding", "Cold", "Used", "Lines", "Straddling", "Type");
+        for (const FlaggedEntry& entry : flagged)
+        {
+            const LineUsage& first = entry.occupancy.lines.front();
+            fprintf(output, "%8lld %8lld %8lld %6u %10u  %s\n", first.padding, first.cold, first.used, static_cast<unsigned int>(entry.occupancy.lines.size()), entry.occupancy.numStraddling, Analysis::GetTypeName(store, store.nodes[entry.record]).c_str());
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
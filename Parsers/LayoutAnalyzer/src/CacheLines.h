@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "LayoutDefinitions.h"
+
+namespace Heat { struct Map; }
+
+namespace CacheLines
+{
+    struct LineUsage
+    {
+        Layout::TAmount used;    // bytes counted in the real size of the record
+        Layout::TAmount padding; // bytes of the line inside the record not counted in its real size
+        Layout::TAmount cold;    // bytes of members without access samples, only when the record was sampled
+    };
+
+    struct Occupancy
+    {
+        Occupancy()
+            : lineSize(64u)
+            , numStraddling(0u)
+        {}
+
+        Layout::TAmount        lineSize;
+        std::vector<LineUsage> lines;          // every line the record touches when it starts at a line boundary
+        unsigned int           numStraddling;  // members touching more lines than their size requires
+    };
+
+    void Compute(Occupancy& occupancy, const Layout::Store& store, const Layout::TIndex record, const Layout::TAmount lineSize, const Heat::Map* heat);
+    bool Report(FILE* output, const Layout::Store& store, const Heat::Map* heat, const char* typeName, const Layout::TAmount lineSize, const unsigned int top);
+}
\ No newline at end of file
@@ -0,0 +1,256 @@
+#include "CommandLine.h"
+
+#include "IO.h"
+
+AnalyzerParams::AnalyzerParams()
+    : command(Command::Invalid)
+    , input(nullptr)
+    , secondInput(nullptr)
+    , output(nullptr)
+    , typeName(nullptr)
+    , samples(nullptr)
+    , query(nullptr)
+    , top(0u)
+    , lineSize(64u)
+    , hotPercent(5u)
+    , maxGrowth(-1)
+    , maxPaddingGrowth(-1)
+    , json(false)
+{}
+
+namespace CommandLine
+{ 
+    constexpr int FAILURE = -1;
+    constexpr int SUCCESS = 0;
+
+    namespace Utils
+    { 
+        // -----------------------------------------------------------------------------------------------------------
+        int StringCompare(const char* s1, const char* s2)
+        {
+            for(;*s1 && (*s1 == *s2);++s1,++s2){}
+            return *(const unsigned char*)s1 - *(const unsigned char*)s2;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool StringToUInt(unsigned int& output, const char* str)
+        { 
+            unsigned int ret = 0; 
+            while (char c = *str)
+            { 
+                if (c < '0' || c > '9') 
+                { 
+                    return false;
+                }
+
+                ret=ret*10+(c-'0'); 
+                ++str;
+            }
+
+            output = ret;
+            return true;
+        } 
+
+        // -----------------------------------------------------------------------------------------------------------
+        Command ParseCommand(const char* str)
+        { 
+            if (StringCompare(str,"optimize") == 0)   return Command::Optimize;
+            if (StringCompare(str,"cachelines") == 0) return Command::CacheLines;
+            if (StringCompare(str,"heatmap") == 0)    return Command::HeatMap;
+            if (StringCompare(str,"diff") == 0)       return Command::Diff;
+            if (StringCompare(str,"freeze") == 0)     return Command::Freeze;
+            if (StringCompare(str,"query") == 0)      return Command::Query;
+            return Command::Invalid;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // -----------------------------------------------------------------------------------------------------------
+    void DisplayHelp()
+    {
+        AnalyzerParams defaultParams;
+        LOG_ALWAYS("Struct Layout Analyzer"); 
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Runs offline analysis over the .slbin results exported by the layout parsers."); 
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Usage: LayoutAnalyzer <command> <input.slbin> [options]"); 
+        LOG_ALWAYS("       LayoutAnalyzer diff <before.slbin> <after.slbin> [options]"); 
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Commands:"); 
+        LOG_ALWAYS("optimize              : Proposes the member order with the least padding for each record, ranked by total savings"); 
+        LOG_ALWAYS("cachelines            : Maps the members to cache lines, or flags the records whose first line is mostly padding or cold"); 
+        LOG_ALWAYS("heatmap               : Annotates the members with the access samples given with -samples"); 
+        LOG_ALWAYS("diff                  : Reports the added, removed and moved members and the size and padding changes between two exports"); 
+        LOG_ALWAYS("freeze                : Generates a header of static_asserts pinning the size, alignment, offsets and bitfield widths of the records"); 
+        LOG_ALWAYS("query                 : Filters and ranks the exported types through indexes, reads one query per line from stdin without -query"); 
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Command Legend:"); 
+        LOG_ALWAYS("-input          (-i)  : The path to the .slbin file"); 
+        LOG_ALWAYS("-output         (-o)  : The output file path for the report (stdout by default)"); 
+        LOG_ALWAYS("-type           (-t)  : Only analyze the record with the given qualified name"); 
+        LOG_ALWAYS("-top            (-n)  : Only report the first N entries of the ranking - example: '-n 20'"); 
+        LOG_ALWAYS("-lineSize       (-l)  : Cache line size in bytes ('%u' by default)", defaultParams.lineSize); 
+        LOG_ALWAYS("-samples        (-s)  : Memory access samples file, one 'type,offset,count' per line, used by every command"); 
+        LOG_ALWAYS("-hot                  : Share of the record samples in percent making a member hot ('%u' by default)", defaultParams.hotPercent); 
+        LOG_ALWAYS("-maxGrowth            : diff fails when a record grows by more than N bytes - example: '-maxGrowth 0'"); 
+        LOG_ALWAYS("-maxPaddingGrowth     : diff fails when the padding of a record grows by more than N bytes"); 
+        LOG_ALWAYS("-query          (-q)  : query terms - example: '-q \"has:vptr size>128 sort:padding\"'"); 
+        LOG_ALWAYS("                        size|padding|ratio|align followed by > >= < <= = and a value, ratio being the padding percent"); 
+        LOG_ALWAYS("                        has:vptr|vbptr|vtordisp|base|vbase|bitfield|union, contains:<type> ( trailing * for a prefix ),"); 
+        LOG_ALWAYS("                        file:<text>, name:<text>, sort:size|padding|ratio|align|name, top:N"); 
+        LOG_ALWAYS("-json                 : query prints the results as JSON instead of a table"); 
+        LOG_ALWAYS("-verbosity      (-v)  : Sets the verbosity level - example: '-v 1'"); 
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    int Parse(AnalyzerParams& params, int argc, char* argv[])
+    { 
+        //No args
+        if (argc <= 1) 
+        {
+            LOG_ERROR("No arguments found. Type '?' for help.");
+            return FAILURE;
+        }
+
+        //Check for Help
+        for (int i=1;i<argc;++i)
+        { 
+            if (Utils::StringCompare(argv[i],"?") == 0)
+            { 
+                DisplayHelp();
+                return FAILURE;
+            }
+        }
+
+        //The command always goes first
+        params.command = Utils::ParseCommand(argv[1]);
+        if (params.command == Command::Invalid)
+        { 
+            LOG_ERROR("Unknown command '%s'. Type '?' for help.", argv[1]);
+            return FAILURE;
+        }
+
+        //Parse arguments
+        for(int i=2;i < argc;++i)
+        { 
+            char* argValue = argv[i];
+            if (argValue[0] == '-')
+            { 
+                if ((Utils::StringCompare(argValue,"-i")==0 || Utils::StringCompare(argValue,"-input")==0) && (i+1) < argc)
+                { 
+                    ++i;
+                    params.input = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-o")==0 || Utils::StringCompare(argValue,"-output")==0) && (i+1) < argc)
+                { 
+                    ++i;
+                    params.output = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-t")==0 || Utils::StringCompare(argValue,"-type")==0) && (i+1) < argc)
+                { 
+                    ++i;
+                    params.typeName = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-n")==0 || Utils::StringCompare(argValue,"-top")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]))
+                    {
+                        params.top = value;
+                    }
+                }
+                else if ((Utils::StringCompare(argValue,"-l")==0 || Utils::StringCompare(argValue,"-lineSize")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]) && value > 0u)
+                    {
+                        params.lineSize = value;
+                    }
+                }
+                else if ((Utils::StringCompare(argValue,"-s")==0 || Utils::StringCompare(argValue,"-samples")==0) && (i+1) < argc)
+                { 
+                    ++i;
+                    params.samples = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-q")==0 || Utils::StringCompare(argValue,"-query")==0) && (i+1) < argc)
+                { 
+                    ++i;
+                    params.query = argv[i];
+                }
+                else if (Utils::StringCompare(argValue,"-json")==0)
+                { 
+                    params.json = true;
+                }
+                else if (Utils::StringCompare(argValue,"-hot")==0 && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]) && value <= 100u)
+                    {
+                        params.hotPercent = value;
+                    }
+                }
+                else if (Utils::StringCompare(argValue,"-maxGrowth")==0 && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]))
+                    {
+                        params.maxGrowth = value;
+                    }
+                }
+                else if (Utils::StringCompare(argValue,"-maxPaddingGrowth")==0 && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]))
+                    {
+                        params.maxPaddingGrowth = value;
+                    }
+                }
+                else if ((Utils::StringCompare(argValue,"-v")==0 || Utils::StringCompare(argValue,"-verbosity")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value,argv[i]) && value < static_cast<unsigned int>(IO::Verbosity::Invalid))
+                    { 
+                        IO::SetVerbosityLevel(IO::Verbosity(value));
+                    }
+                } 
+            }
+            else if (params.input == nullptr)
+            { 
+                //We assume that the first free argument is the actual input file
+                params.input = argValue;
+            }
+            else if (params.secondInput == nullptr)
+            { 
+                //The diff command compares against a second file
+                params.secondInput = argValue;
+            }
+        }
+
+        if (params.input == nullptr)
+        { 
+            LOG_ERROR("No input file provided.");
+            return FAILURE;
+        }
+
+        if (params.command == Command::Diff && params.secondInput == nullptr)
+        { 
+            LOG_ERROR("The diff command requires two input files.");
+            return FAILURE;
+        }
+
+        if (params.command == Command::HeatMap && params.samples == nullptr)
+        { 
+            LOG_ERROR("The heatmap command requires a samples file.");
+            return FAILURE;
+        }
+
+        return SUCCESS;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+enum class Command
+{ 
+    Optimize,
+    CacheLines,
+    HeatMap,
+    Diff,
+    Freeze,
+    Query,
+
+    Invalid
+};
+
+struct AnalyzerParams 
+{ 
+    AnalyzerParams();
+
+    Command         command;
+    const char*     input; 
+    const char*     secondInput;
+    const char*     output;
+    const char*     typeName;
+    const char*     samples;
+    const char*     query;
+    unsigned int    top;
+    unsigned int    lineSize;
+    unsigned int    hotPercent;
+    long long       maxGrowth;
+    long long       maxPaddingGrowth;
+    bool            json;
+};
+
+namespace CommandLine
+{ 
+    int Parse(AnalyzerParams& args, int argc, char* argv[]);
+}
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "Diff.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Analysis.h"
+#include "IO.h"
+
+namespace Diff
+{
+    // Records are matched by qualified type name and their direct members by name ( bases and table pointers by label ),
+    // every lookup goes through a hash map so the diff stays linear on the size of both exports.
+
+    using TNameMap = std::unordered_map<std::string,Layout::TIndex>;
+
+    struct RecordDelta
+    {
+        Layout::TIndex  before;
+        Layout::TIndex  after;
+        Layout::TAmount sizeDelta;
+        Layout::TAmount paddingDelta;
+        bool            exceeded;
+    };
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        void BuildTypeMap(TNameMap& output, std::vector<Layout::TIndex>& order, const Layout::Store& store)
+        {
+            //the same record can be exported several times, the first occurrence wins
+            for (const Layout::TIndex root : store.roots)
+            {
+                if (output.emplace(Analysis::GetTypeName(store, store.nodes[root]), root).second)
+                {
+                    order.push_back(root);
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string GetMemberKey(const Layout::Store& store, const Layout::FlatNode& node)
+        {
+            const bool isField = node.nature == Layout::Category::SimpleField || node.nature == Layout::Category::Bitfield || node.nature == Layout::Category::ComplexField || node.nature == Layout::Category::Union;
+            return isField ? std::string(store.strings.Get(node.name)) : Analysis::GetMemberLabel(store, node);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string GetOccurrenceKey(std::unordered_map<std::string,unsigned int>& occurrences, const Layout::Store& store, const Layout::FlatNode& node)
+        {
+            //unnamed members ( anonymous unions, repeated table pointers ) are told apart by their occurrence
+            std::string key = GetMemberKey(store, node);
+            const unsigned int occurrence = occurrences[key]++;
+            return occurrence > 0u ? key + '#' + std::to_string(occurrence) : key;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void BuildMemberMap(TNameMap& output, const Layout::Store& store, const Layout::FlatNode& node)
+        {
+            std::unordered_map<std::string,unsigned int> occurrences;
+            for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+            {
+                output.emplace(GetOccurrenceKey(occurrences, store, store.nodes[*child]), *child);
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsSameMember(const Layout::Store& before, const Layout::FlatNode& beforeNode, const Layout::Store& after, const Layout::FlatNode& afterNode)
+        {
+            return beforeNode.size == afterNode.size && beforeNode.nature == afterNode.nature && before.strings.Get(beforeNode.type) == after.strings.Get(afterNode.type);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool HasMemberChanges(const Layout::Store& before, const Layout::FlatNode& beforeNode, const Layout::Store& after, const Layout::FlatNode& afterNode)
+        {
+            if (beforeNode.numChildren != afterNode.numChildren)
+            {
+                return true;
+            }
+
+            //same member count: it is enough for every member in order to still match
+            const Layout::TIndex* afterChild = after.ChildrenBegin(afterNode);
+            for (const Layout::TIndex* child = before.ChildrenBegin(beforeNode), *end = before.ChildrenEnd(beforeNode); child != end; ++child, ++afterChild)
+            {
+                const Layout::FlatNode& a = before.nodes[*child];
+                const Layout::FlatNode& b = after.nodes[*afterChild];
+                if (a.offset != b.offset || !IsSameMember(before, a, after, b) || GetMemberKey(before, a) != GetMemberKey(after, b))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintMembers(FILE* output, const Layout::Store& before, const Layout::FlatNode& beforeNode, const Layout::Store& after, const Layout::FlatNode& afterNode)
+        {
+            TNameMap afterMembers;
+            BuildMemberMap(afterMembers, after, afterNode);
+
+            TNameMap beforeMembers;
+            BuildMemberMap(beforeMembers, before, beforeNode);
+
+            //removed, moved and changed members in the old order
+            std::unordered_map<std::string,unsigned int> occurrences;
+            for (const Layout::TIndex* child = before.ChildrenBegin(beforeNode), *end = before.ChildrenEnd(beforeNode); child != end; ++child)
+            {
+                const Layout::FlatNode& a = before.nodes[*child];
+                const std::string key = GetOccurrenceKey(occurrences, before, a);
+
+                TNameMap::const_iterator found = afterMembers.find(key);
+                if (found == afterMembers.end())
+                {
+                    fprintf(output, "  - %8lld %6lld  %s\n", a.offset, a.size, Analysis::GetMemberLabel(before, a).c_str());
+                    continue;
+                }
+
+                const Layout::FlatNode& b = after.nodes[found->second];
+                if (!IsSameMember(before, a, after, b))
+                {
+                    fprintf(output, "  * %8lld %6lld  %s -> offset %lld, size %lld, %s\n", a.offset, a.size, Analysis::GetMemberLabel(before, a).c_str(), b.offset, b.size, Analysis::GetMemberLabel(after, b).c_str());
+                }
+                else if (a.offset != b.offset)
+                {
+                    fprintf(output, "  > %8lld %6lld  %s -> offset %lld\n", a.offset, a.size, Analysis::GetMemberLabel(before, a).c_str(), b.offset);
+                }
+            }
+
+            //added members in the new order
+            occurrences.clear();
+            for (const Layout::TIndex* child = after.ChildrenBegin(afterNode), *end = after.ChildrenEnd(afterNode); child != end; ++child)
+            {
+                const Layout::FlatNode& b = after.nodes[*child];
+                const std::string key = GetOccurrenceKey(occurrences, after, b);
+
+                if (beforeMembers.find(key) == beforeMembers.end())
+                {
+                    fprintf(output, "  + %8lld %6lld  %s\n", b.offset, b.size, Analysis::GetMemberLabel(after, b).c_str());
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintRecord(FILE* output, const Layout::Store& before, const Layout::Store& after, const RecordDelta& delta)
+        {
+            const Layout::FlatNode& beforeNode = before.nodes[delta.before];
+            const Layout::FlatNode& afterNode  = after.nodes[delta.after];
+            const Layout::TAmount beforePadding = Analysis::GetPadding(beforeNode);
+
+            fprintf(output, "%s%s\n", Analysis::GetTypeName(before, beforeNode).c_str(), delta.exceeded ? "  [threshold exceeded]" : "");
+            fprintf(output, "  size %lld -> %lld (%+lld), align %lld -> %lld, padding %lld -> %lld (%+lld)\n",
+                beforeNode.size, afterNode.size, delta.sizeDelta, beforeNode.align, afterNode.align, beforePadding, beforePadding + delta.paddingDelta, delta.paddingDelta);
+            PrintMembers(output, before, beforeNode, after, afterNode);
+            fprintf(output, "\n");
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Report(FILE* output, const Layout::Store& before, const Layout::Store& after, const char* typeName, const Thresholds& thresholds, bool& exceeded)
+    {
+        exceeded = false;
+
+        TNameMap beforeTypes;
+        std::vector<Layout::TIndex> beforeOrder;
+        Helpers::BuildTypeMap(beforeTypes, beforeOrder, before);
+
+        TNameMap afterTypes;
+        std::vector<Layout::TIndex> afterOrder;
+        Helpers::BuildTypeMap(afterTypes, afterOrder, after);
+
+        if (typeName && beforeTypes.find(typeName) == beforeTypes.end() && afterTypes.find(typeName) == afterTypes.end())
+        {
+            LOG_ERROR("Type %s not found.", typeName);
+            return false;
+        }
+
+        std::vector<RecordDelta> changed;
+        std::vector<Layout::TIndex> removed;
+        Layout::TAmount totalGrowth = 0;
+        unsigned int numCompared = 0u;
+        unsigned int numExceeded = 0u;
+
+        for (const Layout::TIndex root : beforeOrder)
+        {
+            const Layout::FlatNode& beforeNode = before.nodes[root];
+            const std::string name = Analysis::GetTypeName(before, beforeNode);
+            if (typeName && name != typeName)
+            {
+                continue;
+            }
+
+            TNameMap::const_iterator found = afterTypes.find(name);
+            if (found == afterTypes.end())
+            {
+                removed.push_back(root);
+                continue;
+            }
+
+            ++numCompared;
+            const Layout::FlatNode& afterNode = after.nodes[found->second];
+            if (beforeNode.size == afterNode.size && beforeNode.align == afterNode.align && !Helpers::HasMemberChanges(before, beforeNode, after, afterNode))
+            {
+                continue;
+            }
+
+            RecordDelta delta;
+            delta.before       = root;
+            delta.after        = found->second;
+            delta.sizeDelta    = afterNode.size - beforeNode.size;
+            delta.paddingDelta = Analysis::GetPadding(afterNode) - Analysis::GetPadding(beforeNode);
+            delta.exceeded     = (thresholds.maxGrowth >= 0 && delta.sizeDelta > thresholds.maxGrowth) || (thresholds.maxPaddingGrowth >= 0 && delta.paddingDelta > thresholds.maxPaddingGrowth);
+
+            totalGrowth += delta.sizeDelta;
+            numExceeded += delta.exceeded ? 1u : 0u;
+            changed.push_back(delta);
+        }
+
+        std::vector<Layout::TIndex> added;
+        for (const Layout::TIndex root : afterOrder)
+        {
+            const std::string name = Analysis::GetTypeName(after, after.nodes[root]);
+            if ((typeName == nullptr || name == typeName) && beforeTypes.find(name) == beforeTypes.end())
+            {
+                added.push_back(root);
+            }
+        }
+
+        for (const RecordDelta& delta : changed)
+        {
+            Helpers::PrintRecord(output, before, after, delta);
+        }
+
+        for (const Layout::TIndex root : removed)
+        {
+            fprintf(output, "- type %s (%lld bytes)\n", Analysis::GetTypeName(before, before.nodes[root]).c_str(), before.nodes[root].size);
+        }
+
+        for (const Layout::TIndex root : added)
+        {
+            fprintf(output, "+ type %s (%lld bytes)\n", Analysis::GetTypeName(after, after.nodes[root]).c_str(), after.nodes[root].size);
+        }
+
+        if (!removed.empty() || !added.empty())
+        {
+            fprintf(output, "\n");
+        }
+
+        fprintf(output, "%u types compared, %u changed, %u removed, %u added, total size growth %+lld bytes\n", numCompared, static_cast<unsigned int>(changed.size()), static_cast<unsigned int>(removed.size()), static_cast<unsigned int>(added.size()), totalGrowth);
+
+        if (numExceeded > 0u)
+        {
+            exceeded = true;
+            LOG_ERROR("%u types exceed the growth thresholds.", numExceeded);
+        }
+
+        return true;
+    }
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdio>
+
+#include "LayoutDefinitions.h"
+
+namespace Diff
+{
+    struct Thresholds
+    {
+        Thresholds()
+            : maxGrowth(-1)
+            , maxPaddingGrowth(-1)
+        {}
+
+        Layout::TAmount maxGrowth;        // allowed size growth in bytes per record, negative disables the check
+        Layout::TAmount maxPaddingGrowth; // allowed padding growth in bytes per record, negative disables the check
+    };
+
+    bool Report(FILE* output, const Layout::Store& before, const Layout::Store& after, const char* typeName, const Thresholds& thresholds, bool& exceeded);
+}
\ No newline at end of file
@@ -0,0 +1,237 @@
+#include "Freeze.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "Analysis.h"
+#include "IO.h"
+
+namespace Freeze
+{
+    // Emits a header with static_asserts pinning the size, alignment, field offsets and bitfield widths of the
+    // exported records, grouped by the header defining them. Offsets are only checked for the direct named fields.
+
+    struct Group
+    {
+        std::string                 file;
+        std::vector<Layout::TIndex> records;
+    };
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        bool CanSpell(const std::string& typeName)
+        {
+            //unnamed scopes and lambdas can't be named from another header
+            return !typeName.empty() && typeName.find('(') == std::string::npos && typeName.find('$') == std::string::npos;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsNamedField(const Layout::Store& store, const Layout::FlatNode& node)
+        {
+            const bool isField = node.nature == Layout::Category::SimpleField || node.nature == Layout::Category::ComplexField || node.nature == Layout::Category::Bitfield || node.nature == Layout::Category::Union;
+            return isField && !store.strings.Get(node.name).empty();
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string GetIncludePath(std::string file)
+        {
+            std::replace(file.begin(), file.end(), '\\', '/');
+            return file;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsSourceFile(const std::string& file)
+        {
+            //not the compiler pseudo files like <built-in> or <command line>, the parser may have prefixed them with a directory
+            const size_t nameStart = file.find_last_of("/\\") + 1u;
+            return !file.empty() && !(file[nameStart] == '<' && file.back() == '>');
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintPreamble(FILE* output, const char* inputName)
+        {
+            fprintf(output, "// Layout freeze generated by LayoutAnalyzer from %s, regenerate it instead of editing.\n", inputName);
+            fprintf(output, "#pragma once\n\n");
+            fprintf(output, "#include <cstddef>\n");
+            fprintf(output, "#include <type_traits>\n\n");
+            fprintf(output, "#if defined(__clang__) || defined(__GNUC__)\n");
+            fprintf(output, "#pragma GCC diagnostic push\n");
+            fprintf(output, "#pragma GCC diagnostic ignored \"-Winvalid-offsetof\"\n");
+            fprintf(output, "#endif\n\n");
+            fprintf(output, "namespace LayoutFreeze\n");
+            fprintf(output, "{\n");
+            fprintf(output, "    // Bitfield widths can only be measured on records usable in constant expressions, the rest always pass\n");
+            fprintf(output, "    template<typename T, typename TMeasure>\n");
+            fprintf(output, "    constexpr bool CheckBitWidth(TMeasure measure, const unsigned int width)\n");
+            fprintf(output, "    {\n");
+            fprintf(output, "        if constexpr (std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>) return measure(static_cast<T*>(nullptr)) == width;\n");
+            fprintf(output, "        else return true;\n");
+            fprintf(output, "    }\n");
+            fprintf(output, "}\n\n");
+            fprintf(output, "// Stores every single bit in the field and counts the ones read back\n");
+            fprintf(output, "#define LAYOUT_FREEZE_BIT_WIDTH(FIELD, WIDTH, ...) LayoutFreeze::CheckBitWidth<__VA_ARGS__>([](auto* tag) \\\n");
+            fprintf(output, "    { \\\n");
+            fprintf(output, "        std::remove_pointer_t<decltype(tag)> value{}; \\\n");
+            fprintf(output, "        using TField = decltype(value.FIELD); \\\n");
+            fprintf(output, "        if constexpr (!std::is_integral_v<TField>) return static_cast<unsigned int>(WIDTH); \\\n");
+            fprintf(output, "        else \\\n");
+            fprintf(output, "        { \\\n");
+            fprintf(output, "            unsigned int bits = 0u; \\\n");
+            fprintf(output, "            for (unsigned int i = 0u; i < 64u; ++i) { value.FIELD = static_cast<TField>(1ull << i); bits += (static_cast<unsigned long long>(value.FIELD) >> i) & 1ull; } \\\n");
+            fprintf(output, "            return bits; \\\n");
+            fprintf(output, "        } \\\n");
+            fprintf(output, "    }, WIDTH)\n\n");
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintMembers(FILE* output, const Layout::Store& store, const Layout::FlatNode& node, const Layout::TAmount offset, const std::string& spelling, const std::string& typeName)
+        {
+            for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+            {
+                const Layout::FlatNode& childNode = store.nodes[*child];
+                if (childNode.nature == Layout::Category::Shared)
+                {
+                    //members at the same offset are grouped, their offsets are relative to the group
+                    PrintMembers(output, store, childNode, offset + childNode.offset, spelling, typeName);
+                    continue;
+                }
+
+                if (childNode.nature == Layout::Category::Bitfield)
+                {
+                    //one bit range per field sharing the storage, it holds the field name and its width
+                    for (const Layout::TIndex* bits = store.ChildrenBegin(childNode), *last = store.ChildrenEnd(childNode); bits != last; ++bits)
+                    {
+                        const Layout::FlatNode& bitsNode = store.nodes[*bits];
+                        if (IsNamedField(store, bitsNode))
+                        {
+                            const std::string fieldName(store.strings.Get(bitsNode.name));
+                            fprintf(output, "static_assert(LAYOUT_FREEZE_BIT_WIDTH(%s, %lld, %s), \"%s::%s width changed\");\n", fieldName.c_str(), bitsNode.size, spelling.c_str(), typeName.c_str(), fieldName.c_str());
+                        }
+                    }
+                    continue;
+                }
+
+                if (IsNamedField(store, childNode))
+                {
+                    const std::string fieldName(store.strings.Get(childNode.name));
+                    fprintf(output, "static_assert(offsetof(%s, %s) == %lld, \"%s::%s moved\");\n", spelling.c_str(), fieldName.c_str(), offset + childNode.offset, typeName.c_str(), fieldName.c_str());
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintRecord(FILE* output, const Layout::Store& store, const Layout::TIndex record, const unsigned int aliasIndex)
+        {
+            const Layout::FlatNode& node = store.nodes[record];
+            const std::string typeName = Analysis::GetTypeName(store, node);
+
+            //offsetof is a macro, template arguments holding commas need an alias
+            std::string spelling = typeName;
+            if (typeName.find(',') != std::string::npos)
+            {
+                spelling = "LayoutFreeze::Type" + std::to_string(aliasIndex);
+                fprintf(output, "namespace LayoutFreeze { using Type%u = %s; }\n", aliasIndex, typeName.c_str());
+            }
+
+            fprintf(output, "static_assert(sizeof(%s) == %lld, \"%s size changed\");\n", spelling.c_str(), node.size, typeName.c_str());
+            fprintf(output, "static_assert(alignof(%s) == %lld, \"%s alignment changed\");\n", spelling.c_str(), node.align, typeName.c_str());
+
+            PrintMembers(output, store, node, 0, spelling, typeName);
+
+            fprintf(output, "\n");
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Report(FILE* output, const Layout::Store& store, const char* typeName, const char* inputName)
+    {
+        std::vector<Layout::TIndex> records;
+        if (typeName)
+        {
+            Layout::TIndex root = 0u;
+            if (!Analysis::FindRoot(root, store, typeName))
+            {
+                LOG_ERROR("Type %s not found.", typeName);
+                return false;
+            }
+            records.push_back(root);
+        }
+        else
+        {
+            //the same record can be exported several times, the first occurrence wins
+            std::unordered_set<Layout::TIndex> visitedTypes;
+            for (const Layout::TIndex root : store.roots)
+            {
+                if (visitedTypes.insert(store.nodes[root].type).second)
+                {
+                    records.push_back(root);
+                }
+            }
+        }
+
+        //group by defining file, records without a location go last without an include
+        std::vector<Group> groups(store.files.size() + 1u);
+        unsigned int numSkipped = 0u;
+        for (const Layout::TIndex record : records)
+        {
+            const Layout::FlatNode& node = store.nodes[record];
+            const int fileIndex = node.typeLocation.fileIndex;
+            const bool isBuiltIn = fileIndex != Layout::INVALID_FILE_INDEX && !Helpers::IsSourceFile(store.files[fileIndex]);
+            if (!node.isValid || isBuiltIn || !Helpers::CanSpell(Analysis::GetTypeName(store, node)))
+            {
+                ++numSkipped;
+                continue;
+            }
+
+            groups[fileIndex == Layout::INVALID_FILE_INDEX ? store.files.size() : static_cast<size_t>(fileIndex)].records.push_back(record);
+        }
+
+        for (size_t i = 0u; i < store.files.size(); ++i)
+        {
+            groups[i].file = store.files[i];
+        }
+
+        std::stable_sort(groups.begin(), groups.end() - 1, [](const Group& a, const Group& b){ return a.file < b.file; });
+
+        Helpers::PrintPreamble(output, inputName);
+
+        unsigned int aliasIndex = 0u;
+        for (Group& group : groups)
+        {
+            if (group.records.empty())
+            {
+                continue;
+            }
+
+            //declaration order inside each file
+            std::stable_sort(group.records.begin(), group.records.end(), [&](const Layout::TIndex a, const Layout::TIndex b){ return store.nodes[a].typeLocation.line < store.nodes[b].typeLocation.line; });
+
+            if (group.file.empty())
+            {
+                fprintf(output, "// ---- Records without location\n\n");
+            }
+            else
+            {
+                const std::string path = Helpers::GetIncludePath(group.file);
+                fprintf(output, "// ---- %s\n", path.c_str());
+                fprintf(output, "#include \"%s\"\n\n", path.c_str());
+            }
+
+            for (const Layout::TIndex record : group.records)
+            {
+                Helpers::PrintRecord(output, store, record, aliasIndex++);
+            }
+        }
+
+        fprintf(output, "#undef LAYOUT_FREEZE_BIT_WIDTH\n\n");
+        fprintf(output, "#if defined(__clang__) || defined(__GNUC__)\n");
+        fprintf(output, "#pragma GCC diagnostic pop\n");
+        fprintf(output, "#endif\n");
+
+        LOG_PROGRESS("%u records frozen, %u skipped as invalid, unnamed or compiler defined.", static_cast<unsigned int>(records.size()) - numSkipped, numSkipped);
+        return true;
+    }
+}
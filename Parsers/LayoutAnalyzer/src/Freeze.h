@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdio>
+
+#include "LayoutDefinitions.h"
+
+namespace Freeze
+{
+    bool Report(FILE* output, const Layout::Store& store, const char* typeName, const char* inputName);
+}
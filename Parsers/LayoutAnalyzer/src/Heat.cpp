@@ -0,0 +1,290 @@
+#include "Heat.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Analysis.h"
+#include "IO.h"
+#include "Platform.h"
+
+namespace Heat
+{
+    struct HotEntry
+    {
+        Layout::TIndex  record;
+        TCount          samples;
+        unsigned int    numHot;
+        Layout::TAmount coldBytes;
+    };
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        std::string Trim(const std::string& str)
+        {
+            const size_t first = str.find_first_not_of(" \t\r\n");
+            const size_t last  = str.find_last_not_of(" \t\r\n");
+            return first == std::string::npos ? std::string() : str.substr(first, last - first + 1);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ParseLine(std::string& type, Layout::TAmount& offset, TCount& count, const std::string& line)
+        {
+            //split from the right, template arguments in the type name can hold commas too
+            const size_t countSeparator = line.rfind(',');
+            const size_t offsetSeparator = countSeparator == std::string::npos || countSeparator == 0u ? std::string::npos : line.rfind(',', countSeparator - 1);
+            if (offsetSeparator == std::string::npos)
+            {
+                return false;
+            }
+
+            type = Trim(line.substr(0, offsetSeparator));
+
+            const std::string offsetStr = Trim(line.substr(offsetSeparator + 1, countSeparator - offsetSeparator - 1));
+            const std::string countStr  = Trim(line.substr(countSeparator + 1));
+
+            //out of range values saturate, they are as malformed as the non numeric ones
+            char* end = nullptr;
+            errno = 0;
+            offset = strtoll(offsetStr.c_str(), &end, 0);
+            if (offsetStr.empty() || *end != '\0' || errno == ERANGE) return false;
+
+            //strtoull silently negates a leading minus
+            count = strtoull(countStr.c_str(), &end, 10);
+            if (countStr.empty() || countStr[0] == '-' || *end != '\0' || errno == ERANGE) return false;
+
+            return !type.empty();
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintNode(FILE* output, const Layout::Store& store, const Map& map, const Layout::TIndex root, const Layout::FlatNode& node, const Layout::TAmount offset, const unsigned int depth)
+        {
+            const TCount total = GetTotal(map, root);
+            for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+            {
+                const Layout::FlatNode& childNode = store.nodes[*child];
+                const Layout::TAmount childOffset = offset + childNode.offset;
+
+                Layout::TAmount start, finish;
+                Analysis::GetByteRange(start, finish, store, childNode, childOffset);
+                const TCount count = GetCount(map, root, start, finish);
+
+                fprintf(output, "  %8lld %6lld %10llu %6.1f%% %5s  %*s%s\n", childOffset, childNode.size, count, total ? (100.0 * count) / total : 0.0, ToString(Classify(map, root, start, finish)), depth * 2, "", Analysis::GetMemberLabel(store, childNode).c_str());
+
+                if (!Analysis::IsLeaf(childNode))
+                {
+                    PrintNode(output, store, map, root, childNode, childOffset, depth + 1);
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void CountLeaves(HotEntry& entry, const Layout::Store& store, const Map& map, const Layout::FlatNode& node, const Layout::TAmount offset)
+        {
+            for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+            {
+                const Layout::FlatNode& childNode = store.nodes[*child];
+                const Layout::TAmount childOffset = offset + childNode.offset;
+
+                if (Analysis::IsLeaf(childNode))
+                {
+                    Layout::TAmount start, finish;
+                    Analysis::GetByteRange(start, finish, store, childNode, childOffset);
+                    const Temperature temperature = Classify(map, entry.record, start, finish);
+                    entry.numHot    += temperature == Temperature::Hot ? 1u : 0u;
+                    entry.coldBytes += temperature == Temperature::Cold ? finish - start : 0;
+                }
+                else
+                {
+                    CountLeaves(entry, store, map, childNode, childOffset);
+                }
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Load(Map& map, const Layout::Store& store, const char* filename, const unsigned int hotPercent)
+    {
+        FILE* stream;
+        if (fopen_s(&stream, filename, "r"))
+        {
+            LOG_ERROR("Unable to open the samples file %s.", filename);
+            return false;
+        }
+
+        map.hotPercent = hotPercent;
+        map.records.clear();
+
+        std::unordered_map<std::string,Layout::TIndex> rootsByName;
+        for (const Layout::TIndex root : store.roots)
+        {
+            rootsByName.emplace(Analysis::GetTypeName(store, store.nodes[root]), root);
+        }
+
+        unsigned int numInvalid = 0u;
+        TCount unknownType = 0u;
+        TCount outOfRange = 0u;
+
+        std::string line;
+        char buffer[1024];
+        while (fgets(buffer, sizeof(buffer), stream))
+        {
+            //long lines come in several chunks
+            line += buffer;
+            if (line.back() != '\n' && !feof(stream))
+            {
+                continue;
+            }
+
+            std::string type;
+            Layout::TAmount offset = 0;
+            TCount count = 0u;
+            const std::string entry = Helpers::Trim(line);
+            line.clear();
+
+            if (entry.empty() || entry[0] == '#')
+            {
+                continue;
+            }
+
+            if (!Helpers::ParseLine(type, offset, count, entry))
+            {
+                ++numInvalid;
+                continue;
+            }
+
+            std::unordered_map<std::string,Layout::TIndex>::const_iterator found = rootsByName.find(type);
+            if (found == rootsByName.end())
+            {
+                unknownType += count;
+                continue;
+            }
+
+            if (offset < 0 || offset >= store.nodes[found->second].size)
+            {
+                outOfRange += count;
+                continue;
+            }
+
+            RecordSamples& samples = map.records[found->second];
+            samples.accumulated.emplace_back(offset, count);
+            samples.total += count;
+        }
+
+        fclose(stream);
+
+        //sort and turn the counts into running sums, ranges are then answered with two binary searches
+        for (std::pair<const Layout::TIndex,RecordSamples>& entry : map.records)
+        {
+            std::vector<std::pair<Layout::TAmount,TCount>>& accumulated = entry.second.accumulated;
+            std::stable_sort(accumulated.begin(), accumulated.end(), [](const std::pair<Layout::TAmount,TCount>& a, const std::pair<Layout::TAmount,TCount>& b){ return a.first < b.first; });
+
+            TCount running = 0u;
+            for (std::pair<Layout::TAmount,TCount>& sample : accumulated)
+            {
+                running += sample.second;
+                sample.second = running;
+            }
+        }
+
+        if (numInvalid)  LOG_WARNING("%u malformed lines ignored in %s.", numInvalid, filename);
+        if (unknownType) LOG_PROGRESS("%llu samples ignored for types not found in the export.", unknownType);
+        if (outOfRange)  LOG_PROGRESS("%llu samples ignored for offsets outside of their record.", outOfRange);
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    TCount GetCount(const Map& map, const Layout::TIndex root, const Layout::TAmount start, const Layout::TAmount end)
+    {
+        std::unordered_map<Layout::TIndex,RecordSamples>::const_iterator found = map.records.find(root);
+        if (found == map.records.end() || end <= start)
+        {
+            return 0u;
+        }
+
+        const std::vector<std::pair<Layout::TAmount,TCount>>& accumulated = found->second.accumulated;
+        auto before = [&](const Layout::TAmount offset) -> TCount
+        {
+            //running count of all the samples with a smaller offset
+            std::vector<std::pair<Layout::TAmount,TCount>>::const_iterator it = std::lower_bound(accumulated.begin(), accumulated.end(), offset, [](const std::pair<Layout::TAmount,TCount>& sample, const Layout::TAmount value){ return sample.first < value; });
+            return it == accumulated.begin() ? 0u : (it - 1)->second;
+        };
+
+        return before(end) - before(start);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    TCount GetTotal(const Map& map, const Layout::TIndex root)
+    {
+        std::unordered_map<Layout::TIndex,RecordSamples>::const_iterator found = map.records.find(root);
+        return found == map.records.end() ? 0u : found->second.total;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Temperature Classify(const Map& map, const Layout::TIndex root, const Layout::TAmount start, const Layout::TAmount end)
+    {
+        const TCount count = GetCount(map, root, start, end);
+        const TCount total = GetTotal(map, root);
+        return count == 0u ? Temperature::Cold : (count * 100u >= total * map.hotPercent ? Temperature::Hot : Temperature::Warm);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    const char* ToString(const Temperature temperature)
+    {
+        switch (temperature)
+        {
+        case Temperature::Hot:  return "hot";
+        case Temperature::Warm: return "warm";
+        default:                return "cold";
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Report(FILE* output, const Layout::Store& store, const Map& map, const char* typeName, const unsigned int top)
+    {
+        //a single record: full annotated tree
+        if (typeName || store.roots.size() == 1u)
+        {
+            Layout::TIndex root = 0u;
+            if (!Analysis::FindRoot(root, store, typeName))
+            {
+                LOG_ERROR("Type %s not found.", typeName);
+                return false;
+            }
+
+            const Layout::FlatNode& node = store.nodes[root];
+            fprintf(output, "%s: %lld bytes, %llu samples\n", Analysis::GetTypeName(store, node).c_str(), node.size, GetTotal(map, root));
+            fprintf(output, "  %8s %6s %10s %7s %5s  %s\n", "Offset", "Size", "Samples", "Share", "Temp", "Member");
+            Helpers::PrintNode(output, store, map, root, node, 0, 0u);
+            return true;
+        }
+
+        //batch: sampled records, most accessed first
+        std::vector<HotEntry> ranking;
+        for (const std::pair<const Layout::TIndex,RecordSamples>& entry : map.records)
+        {
+            HotEntry hotEntry{ entry.first, entry.second.total, 0u, 0 };
+            Helpers::CountLeaves(hotEntry, store, map, store.nodes[entry.first], 0);
+            ranking.push_back(hotEntry);
+        }
+
+        std::sort(ranking.begin(), ranking.end(), [](const HotEntry& a, const HotEntry& b){ return a.samples > b.samples || (a.samples == b.samples && a.record < b.record); });
+        if (top > 0u && ranking.size() > top)
+        {
+            ranking.resize(top);
+        }
+
+        fprintf(output, "%12s %6s %10s %8s  %s\n", "Samples", "Hot", "ColdBytes", "Size", "Type");
+        for (const HotEntry& entry : ranking)
+        {
+            const Layout::FlatNode& node = store.nodes[entry.record];
+            fprintf(output, "%12llu %6u %10lld %8lld  %s\n", entry.samples, entry.numHot, entry.coldBytes, node.size, Analysis::GetTypeName(store, node).c_str());
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
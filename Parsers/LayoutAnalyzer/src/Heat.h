@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdio>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "LayoutDefinitions.h"
+
+namespace Heat
+{
+    // Memory access samples joined with the exported records. The samples file holds one 'type,offset,count'
+    // entry per line ( offsets relative to the record start, decimal or 0x hex, '#' starts a comment ),
+    // as produced from perf mem / perf c2c data addresses resolved against the debug type information.
+
+    using TCount = unsigned long long;
+
+    enum class Temperature
+    {
+        Cold,
+        Warm,
+        Hot,
+    };
+
+    struct RecordSamples
+    {
+        RecordSamples()
+            : total(0u)
+        {}
+
+        std::vector<std::pair<Layout::TAmount,TCount>> accumulated; // sorted by offset, running count up to and including it
+        TCount                                         total;
+    };
+
+    struct Map
+    {
+        Map()
+            : hotPercent(5u)
+        {}
+
+        std::unordered_map<Layout::TIndex,RecordSamples> records; // by root node
+        unsigned int                                     hotPercent;
+    };
+
+    bool Load(Map& map, const Layout::Store& store, const char* filename, const unsigned int hotPercent);
+
+    TCount      GetCount(const Map& map, const Layout::TIndex root, const Layout::TAmount start, const Layout::TAmount end);
+    TCount      GetTotal(const Map& map, const Layout::TIndex root);
+    Temperature Classify(const Map& map, const Layout::TIndex root, const Layout::TAmount start, const Layout::TAmount end);
+    const char* ToString(const Temperature temperature);
+
+    bool Report(FILE* output, const Layout::Store& store, const Map& map, const char* typeName, const unsigned int top);
+}
\ No newline at end of file
@@ -0,0 +1,552 @@
+#include "Optimizer.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Analysis.h"
+#include "Heat.h"
+#include "IO.h"
+
+namespace Optimizer
+{
+    // Only fields move: table pointers and non virtual bases keep their place at the front and virtual bases
+    // stay at the end, shifted by the bytes saved. Consecutive bitfields move together as a single unit, but each
+    // bitfield is placed at bit granularity so runs ending up next to each other share storage like the compiler does.
+
+    enum { MAX_SEARCH_STEPS = 250000 };
+
+    enum class BitfieldRules
+    {
+        Itanium, // any bit where the field does not cross a boundary of its type alignment
+        MSVC,    // adjacent bitfields share a storage unit only when their types have the same size
+    };
+
+    struct BitField
+    {
+        Layout::TIndex  node;    // bit range of the field
+        Layout::TAmount start;   // original offset in bits within the record
+        Layout::TAmount width;
+        Layout::TAmount storage; // type size in bits
+        Layout::TAmount align;   // type alignment in bits
+    };
+
+    struct Unit
+    {
+        Layout::TIndex        first;   // position of the first child in the record children range
+        Layout::TIndex        count;   // bitfield runs span several children
+        Layout::TAmount       offset;  // original offset
+        Layout::TAmount       size;
+        Layout::TAmount       align;
+        Layout::TAmount       minBits; // bits the unit takes at least, used to bound the search
+        std::vector<BitField> bits;    // only for bitfield runs
+    };
+
+    struct Cursor
+    {
+        Layout::TAmount bit;         // first free bit
+        Layout::TAmount storageEnd;  // end of the bitfield storage unit still open (MSVC)
+        Layout::TAmount storageBits; // type size of the open storage unit, 0 when none
+    };
+
+    struct UnitClass
+    {
+        Layout::TAmount size;
+        Layout::TAmount align;
+        std::vector<unsigned int> units;
+        unsigned int    used;
+    };
+
+    struct RankEntry
+    {
+        Proposal        proposal;
+        unsigned int    uses;
+        Layout::TAmount total;
+        Heat::TCount    samples;
+    };
+
+    using TUnits   = std::vector<Unit>;
+    using TClasses = std::vector<UnitClass>;
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TAmount AlignUp(const Layout::TAmount value, const Layout::TAmount align)
+        {
+            return align > 1 ? ((value + align - 1) / align) * align : value;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TAmount ToBytes(const Layout::TAmount bits)
+        {
+            return (bits + 7) / 8;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsFixedPrefix(const Layout::Category nature)
+        {
+            return nature == Layout::Category::VTablePtr || nature == Layout::Category::VFTablePtr || nature == Layout::Category::VBTablePtr ||
+                   nature == Layout::Category::NVPrimaryBase || nature == Layout::Category::NVBase;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsFixedSuffix(const Layout::Category nature)
+        {
+            return nature == Layout::Category::VPrimaryBase || nature == Layout::Category::VBase || nature == Layout::Category::VtorDisp;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TAmount GetEnd(const Cursor& cursor)
+        {
+            return std::max(cursor.bit, cursor.storageEnd);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Cursor PlaceUnit(const Unit& unit, Cursor cursor, const BitfieldRules rules, std::vector<Layout::TAmount>* positions)
+        {
+            if (unit.bits.empty())
+            {
+                const Layout::TAmount offset = AlignUp(ToBytes(GetEnd(cursor)), unit.align);
+                if (positions) positions->push_back(offset * 8);
+                return Cursor{ (offset + unit.size) * 8, 0, 0 };
+            }
+
+            for (const BitField& field : unit.bits)
+            {
+                Layout::TAmount position = cursor.bit;
+                if (rules == BitfieldRules::Itanium)
+                {
+                    //zero widths only align the next bitfield
+                    if (field.width == 0 || (position % field.align) + field.width > field.storage)
+                    {
+                        position = AlignUp(position, field.align);
+                    }
+                }
+                else if (field.width == 0 || cursor.storageBits != field.storage || position + field.width > cursor.storageEnd)
+                {
+                    //open a new storage unit, zero widths just close the current one
+                    position = AlignUp(GetEnd(cursor), field.align);
+                    cursor.storageEnd  = field.width == 0 ? position : position + field.storage;
+                    cursor.storageBits = field.width == 0 ? 0 : field.storage;
+                }
+
+                if (positions) positions->push_back(position);
+                cursor.bit = position + field.width;
+            }
+
+            return cursor;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TAmount Place(const TUnits& units, const std::vector<unsigned int>& order, const BitfieldRules rules, const Layout::TAmount offset, std::vector<Layout::TAmount>* positions)
+        {
+            Cursor cursor{ offset * 8, 0, 0 };
+            for (const unsigned int index : order)
+            {
+                cursor = PlaceUnit(units[index], cursor, rules, positions);
+            }
+            return GetEnd(cursor);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void CollectUnits(TUnits& units, Layout::TAmount& prefixEnd, const Layout::Store& store, const Layout::FlatNode& record)
+        {
+            prefixEnd = 0;
+
+            const Layout::TIndex* children = store.ChildrenBegin(record);
+            for (Layout::TIndex i = 0u; i < record.numChildren; ++i)
+            {
+                const Layout::FlatNode& child = store.nodes[children[i]];
+                if (IsFixedPrefix(child.nature))
+                {
+                    prefixEnd = std::max(prefixEnd, child.offset + child.size);
+                }
+                else if (child.nature == Layout::Category::Bitfield)
+                {
+                    const bool extendsRun = !units.empty() && !units.back().bits.empty() && units.back().first + units.back().count == i;
+                    if (!extendsRun)
+                    {
+                        const Layout::TAmount firstBit = child.numChildren > 0u ? store.nodes[*store.ChildrenBegin(child)].offset : 0;
+                        units.push_back(Unit{ i, 0u, (child.offset * 8 + firstBit) / 8, 0, 1, 0, {} });
+                    }
+
+                    Unit& run = units.back();
+                    run.count += 1u;
+                    run.align  = std::max(run.align, child.align);
+
+                    //the bitfield holds one bit range per field sharing its storage, each keeping the alignment of its declared type
+                    for (const Layout::TIndex* bits = store.ChildrenBegin(child), *last = store.ChildrenEnd(child); bits != last; ++bits)
+                    {
+                        const Layout::FlatNode& field = store.nodes[*bits];
+                        const Layout::TAmount start = child.offset * 8 + field.offset;
+                        const Layout::TAmount align = std::max<Layout::TAmount>(field.align, 1) * 8;
+
+                        run.size     = std::max(run.size, ToBytes(start + field.size) - run.offset);
+                        run.minBits += field.size;
+                        run.bits.push_back(BitField{ *bits, start, field.size, align, align });
+                    }
+                }
+                else if (!IsFixedSuffix(child.nature))
+                {
+                    units.push_back(Unit{ i, 1u, child.offset, child.size, child.align, child.size * 8, {} });
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool Reproduce(Layout::TAmount& end, const TUnits& units, const BitfieldRules rules, const Layout::TAmount start)
+        {
+            //the model must give back the current layout in declaration order, otherwise packing or explicit alignment is involved
+            std::vector<unsigned int> order(units.size());
+            for (unsigned int i = 0u; i < units.size(); ++i)
+            {
+                order[i] = i;
+            }
+
+            std::vector<Layout::TAmount> positions;
+            end = Place(units, order, rules, start, &positions);
+
+            size_t index = 0u;
+            for (const Unit& unit : units)
+            {
+                if (unit.bits.empty())
+                {
+                    if (positions[index++] != unit.offset * 8) return false;
+                }
+                else for (const BitField& field : unit.bits)
+                {
+                    if (positions[index++] != field.start) return false;
+                }
+            }
+
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        struct Search
+        {
+            Search(const TUnits& _units, TClasses& _classes, const BitfieldRules _rules, const Layout::TAmount _align)
+                : units(_units)
+                , classes(_classes)
+                , rules(_rules)
+                , align(_align)
+                , bestEnd(-1)
+                , steps(0u)
+            {}
+
+            const TUnits&             units;
+            TClasses&                 classes;
+            BitfieldRules             rules;
+            Layout::TAmount           align;
+            Layout::TAmount           bestEnd; // in bits
+            std::vector<unsigned int> current;
+            std::vector<unsigned int> best;
+            unsigned int              steps;
+        };
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsBetter(const Search& search, const Layout::TAmount end)
+        {
+            //smallest record size first, then the most tail space left for the derived classes
+            if (search.bestEnd < 0) return true;
+            const Layout::TAmount size = AlignUp(ToBytes(end), search.align);
+            const Layout::TAmount bestSize = AlignUp(ToBytes(search.bestEnd), search.align);
+            return size < bestSize || (size == bestSize && end < search.bestEnd);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void SearchOrder(Search& search, const Cursor& cursor, const Layout::TAmount remaining)
+        {
+            //the bits left are a lower bound, bitfields can share the storage of the ones placed before them
+            if (++search.steps > MAX_SEARCH_STEPS || !IsBetter(search, cursor.bit + remaining))
+            {
+                return;
+            }
+
+            if (search.current.size() == search.units.size())
+            {
+                if (IsBetter(search, GetEnd(cursor)))
+                {
+                    search.bestEnd = GetEnd(cursor);
+                    search.best    = search.current;
+                }
+                return;
+            }
+
+            //units with the same size and alignment are interchangeable, branch per class instead of per unit
+            for (size_t i = 0u; i < search.classes.size(); ++i)
+            {
+                UnitClass& unitClass = search.classes[i];
+                if (unitClass.used < unitClass.units.size())
+                {
+                    search.current.push_back(static_cast<unsigned int>(i));
+                    ++unitClass.used;
+                    const Unit& unit = search.units[unitClass.units.front()];
+                    SearchOrder(search, PlaceUnit(unit, cursor, search.rules, nullptr), remaining - unit.minBits);
+                    --unitClass.used;
+                    search.current.pop_back();
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintProposal(FILE* output, const Layout::Store& store, const Proposal& proposal)
+        {
+            const Layout::FlatNode& record = store.nodes[proposal.record];
+            if (proposal.saved > 0)
+            {
+                fprintf(output, "%s: %lld -> %lld bytes (align %lld), %lld bytes saved\n", Analysis::GetTypeName(store, record).c_str(), record.size, proposal.size, proposal.align, proposal.saved);
+            }
+            else
+            {
+                fprintf(output, "%s: %lld bytes (align %lld), already optimal, 0 bytes saved\n", Analysis::GetTypeName(store, record).c_str(), record.size, proposal.align);
+            }
+
+            for (const Member& member : proposal.members)
+            {
+                const Layout::FlatNode& node = store.nodes[member.node];
+                if (member.bit >= 0)
+                {
+                    //bitfields show the byte and the bit within it, the storage of their type and their width
+                    const std::string offset = std::to_string(member.offset) + "." + std::to_string(member.bit);
+                    fprintf(output, "  %8s %6lld  %s : %lld\n", offset.c_str(), node.align, Analysis::GetMemberLabel(store, node).c_str(), node.size);
+                }
+                else
+                {
+                    fprintf(output, "  %8lld %6lld  %s\n", member.offset, node.size, Analysis::GetMemberLabel(store, node).c_str());
+                }
+            }
+
+            fprintf(output, "\n");
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        unsigned long long GetChildrenKey(const Layout::FlatNode& node)
+        {
+            return (static_cast<unsigned long long>(node.firstChild) << 32) | node.numChildren;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void CountUses(std::unordered_map<unsigned long long, unsigned int>& uses, const Layout::Store& store)
+        {
+            //every copy of a record shares its children range, count the copies found anywhere in the export in one pass
+            for (const Layout::FlatNode& node : store.nodes)
+            {
+                if (node.numChildren > 0u)
+                {
+                    ++uses[GetChildrenKey(node)];
+                }
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Optimize(Proposal& proposal, const Layout::Store& store, const Layout::TIndex record, const Heat::Map* heat)
+    {
+        const Layout::FlatNode& recordNode = store.nodes[record];
+        const Layout::TIndex* children = store.ChildrenBegin(recordNode);
+
+        if (!recordNode.isValid)
+        {
+            return false;
+        }
+
+        TUnits units;
+        Layout::TAmount prefixEnd = 0;
+        Helpers::CollectUnits(units, prefixEnd, store, recordNode);
+
+        //fields can start inside the tail padding of a base
+        const Layout::TAmount start = units.empty() ? prefixEnd : std::min(prefixEnd, units.front().offset);
+
+        //the compiler is not part of the export, the bitfield rules are the ones reproducing the current layout
+        BitfieldRules rules = BitfieldRules::Itanium;
+        Layout::TAmount originalEnd = 0;
+        if (!Helpers::Reproduce(originalEnd, units, rules, start) && !Helpers::Reproduce(originalEnd, units, rules = BitfieldRules::MSVC, start))
+        {
+            LOG_INFO("Skipping %s: the layout does not follow the natural alignment rules.", Analysis::GetTypeName(store, recordNode).c_str());
+            return false;
+        }
+        originalEnd = std::max(prefixEnd, Helpers::ToBytes(originalEnd));
+
+        //group the units by size and alignment, biggest alignment first as the search explores them in order
+        TClasses classes;
+        Layout::TAmount totalBits = 0;
+        for (unsigned int i = 0u; i < units.size(); ++i)
+        {
+            totalBits += units[i].minBits;
+
+            //bitfield runs depend on their bit positions, they are never interchangeable
+            TClasses::iterator found = !units[i].bits.empty() ? classes.end() : std::find_if(classes.begin(), classes.end(), [&](const UnitClass& entry){ return entry.size == units[i].size && entry.align == units[i].align && units[entry.units.front()].bits.empty(); });
+            if (found == classes.end())
+            {
+                classes.push_back(UnitClass{ units[i].size, units[i].align, {}, 0u });
+                found = classes.end() - 1;
+            }
+            found->units.push_back(i);
+        }
+
+        std::stable_sort(classes.begin(), classes.end(), [](const UnitClass& a, const UnitClass& b){ return a.align > b.align || (a.align == b.align && a.size > b.size); });
+
+        if (heat)
+        {
+            //interchangeable units are handed out most accessed first, so the hot ones get the lower offsets
+            for (UnitClass& unitClass : classes)
+            {
+                std::stable_sort(unitClass.units.begin(), unitClass.units.end(), [&](const unsigned int a, const unsigned int b)
+                {
+                    return Heat::GetCount(*heat, record, units[a].offset, units[a].offset + units[a].size) > Heat::GetCount(*heat, record, units[b].offset, units[b].offset + units[b].size);
+                });
+            }
+        }
+
+        Helpers::Search search(units, classes, rules, recordNode.align);
+        Helpers::SearchOrder(search, Cursor{ start * 8, 0, 0 }, totalBits);
+
+        std::vector<unsigned int> order;
+        for (UnitClass& unitClass : classes) unitClass.used = 0u;
+        for (const unsigned int classIndex : search.best)
+        {
+            UnitClass& unitClass = classes[classIndex];
+            order.push_back(unitClass.units[unitClass.used++]);
+        }
+
+        std::vector<Layout::TAmount> positions;
+        const Layout::TAmount newEnd = std::max(prefixEnd, Helpers::ToBytes(Helpers::Place(units, order, rules, start, &positions)));
+
+        proposal.record = record;
+        proposal.align  = recordNode.align;
+        proposal.saved  = Helpers::AlignUp(originalEnd, recordNode.align) - Helpers::AlignUp(newEnd, recordNode.align);
+        proposal.members.clear();
+
+        if (order.size() != units.size() || proposal.saved <= 0)
+        {
+            //nothing better found (or the search ran out of steps), keep the declaration order
+            order.resize(units.size());
+            for (unsigned int i = 0u; i < units.size(); ++i)
+            {
+                order[i] = i;
+            }
+
+            positions.clear();
+            Helpers::Place(units, order, rules, start, &positions);
+            proposal.saved = 0;
+        }
+
+        proposal.size = recordNode.size - proposal.saved;
+
+        for (Layout::TIndex i = 0u; i < recordNode.numChildren; ++i)
+        {
+            const Layout::FlatNode& child = store.nodes[children[i]];
+            if (Helpers::IsFixedPrefix(child.nature))
+            {
+                proposal.members.push_back(Member{ children[i], child.offset, -1 });
+            }
+        }
+
+        //the positions are in bits, one per field of each unit in the placement order
+        size_t position = 0u;
+        for (const unsigned int index : order)
+        {
+            const Unit& unit = units[index];
+            if (unit.bits.empty())
+            {
+                proposal.members.push_back(Member{ children[unit.first], positions[position++] / 8, -1 });
+            }
+            else for (const BitField& field : unit.bits)
+            {
+                const Layout::TAmount bit = positions[position++];
+                proposal.members.push_back(Member{ field.node, bit / 8, bit % 8 });
+            }
+        }
+
+        //virtual bases move as a block, the saved bytes are a multiple of the record alignment so they stay aligned
+        for (Layout::TIndex i = 0u; i < recordNode.numChildren; ++i)
+        {
+            const Layout::FlatNode& child = store.nodes[children[i]];
+            if (Helpers::IsFixedSuffix(child.nature))
+            {
+                proposal.members.push_back(Member{ children[i], child.offset - proposal.saved, -1 });
+            }
+        }
+
+        return true;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Report(FILE* output, const Layout::Store& store, const Heat::Map* heat, const char* typeName, const unsigned int top)
+    {
+        //a single record: show the proposal even when nothing is saved
+        if (typeName || store.roots.size() == 1u)
+        {
+            Layout::TIndex root = 0u;
+            if (!Analysis::FindRoot(root, store, typeName))
+            {
+                LOG_ERROR("Type %s not found.", typeName);
+                return false;
+            }
+
+            Proposal proposal;
+            if (!Optimize(proposal, store, root, heat))
+            {
+                LOG_ERROR("Unable to optimize %s.", Analysis::GetTypeName(store, store.nodes[root]).c_str());
+                return false;
+            }
+
+            Helpers::PrintProposal(output, store, proposal);
+            return true;
+        }
+
+        //batch: rank every record by bytes saved per instance times the instances found in the export, sampled records first
+        std::unordered_map<unsigned long long, unsigned int> uses;
+        Helpers::CountUses(uses, store);
+
+        std::vector<RankEntry> ranking;
+        std::unordered_set<Layout::TIndex> visitedTypes;
+        for (const Layout::TIndex root : store.roots)
+        {
+            const Layout::FlatNode& node = store.nodes[root];
+            if (!visitedTypes.insert(node.type).second)
+            {
+                continue;
+            }
+
+            RankEntry entry;
+            if (Optimize(entry.proposal, store, root, heat) && entry.proposal.saved > 0)
+            {
+                entry.uses    = uses[Helpers::GetChildrenKey(node)];
+                entry.total   = entry.proposal.saved * entry.uses;
+                entry.samples = heat ? Heat::GetTotal(*heat, root) : 0u;
+                ranking.push_back(std::move(entry));
+            }
+        }
+
+        std::stable_sort(ranking.begin(), ranking.end(), [](const RankEntry& a, const RankEntry& b)
+        {
+            if (a.samples != b.samples) return a.samples > b.samples;
+            return a.total > b.total || (a.total == b.total && a.proposal.saved > b.proposal.saved);
+        });
+        if (top > 0u && ranking.size() > top)
+        {
+            ranking.resize(top);
+        }
+
+        LOG_PROGRESS("%u records analyzed, %u can be reduced.", static_cast<unsigned int>(visitedTypes.size()), static_cast<unsigned int>(ranking.size()));
+
+        fprintf(output, "%6s %12s %8s %6s %8s %10s  %s\n", "Rank", "Samples", "Total", "Uses", "Saved", "Size", "Type");
+        for (size_t i = 0u; i < ranking.size(); ++i)
+        {
+            const RankEntry& entry = ranking[i];
+            const Layout::FlatNode& node = store.nodes[entry.proposal.record];
+            fprintf(output, "%6u %12llu %8lld %6u %8lld %4lld->%-4lld  %s\n", static_cast<unsigned int>(i + 1), entry.samples, entry.total, entry.uses, entry.proposal.saved, node.size, entry.proposal.size, Analysis::GetTypeName(store, node).c_str());
+        }
+        fprintf(output, "\n");
+
+        for (const RankEntry& entry : ranking)
+        {
+            Helpers::PrintProposal(output, store, entry.proposal);
+        }
+
+        return true;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdio>
+#include <vector>
+
+#include "LayoutDefinitions.h"
+
+namespace Heat { struct Map; }
+
+namespace Optimizer
+{
+    struct Member
+    { 
+        Layout::TIndex  node;
+        Layout::TAmount offset;
+        Layout::TAmount bit;    // bit within the byte for bitfields, -1 otherwise
+    };
+
+    struct Proposal
+    { 
+        Proposal()
+            : record(0u)
+            , size(0u)
+            , align(1u)
+            , saved(0u)
+        {}
+
+        Layout::TIndex      record;
+        std::vector<Member> members; // every child of the record in the proposed order with its new offset
+        Layout::TAmount     size;
+        Layout::TAmount     align;
+        Layout::TAmount     saved;
+    };
+
+    bool Optimize(Proposal& proposal, const Layout::Store& store, const Layout::TIndex record, const Heat::Map* heat);
+    bool Report(FILE* output, const Layout::Store& store, const Heat::Map* heat, const char* typeName, const unsigned int top);
+}
\ No newline at end of file
@@ -0,0 +1,741 @@
+#include "Query.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "IO.h"
+#include "LayoutReader.h"
+
+namespace Query
+{
+    // Terms are separated by spaces, double quotes keep spaces inside a term, and a record must match all of them:
+    //   size<op>N, padding<op>N, ratio<op>P, align<op>N  with <op> one of > >= < <= =, ratio is the padding share in percent
+    //   has:vptr|vbptr|vtordisp|base|vbase|bitfield|union the record or one of its bases holds such a member
+    //   contains:<type>                                  a member at any depth has this type, a trailing * matches a prefix
+    //   file:<text>                                      the record is defined in a file whose path contains the text
+    //   name:<text>                                      the record type name contains the text
+    //   sort:size|padding|ratio|align|name               ranking, numeric keys sort descending
+    //   top:N                                            only the first N results
+    // Records are the exported roots, once per type. The most selective indexed term picks the candidates and every
+    // other term is then checked per candidate in constant or logarithmic time.
+
+    using TRecordId  = unsigned int;
+    using TRecordIds = std::vector<TRecordId>;
+
+    enum { NUM_CATEGORIES = static_cast<unsigned int>(Layout::Category::Shared) + 1u };
+
+    namespace Metric
+    {
+        enum Type { Size, Padding, Ratio, Align, Count };
+    }
+
+    enum class TermType { Range, Category, Contains, File, Name };
+    enum class Order    { Export, Metric, Name };
+
+    struct Record
+    {
+        Layout::TIndex root;
+        Layout::TIndex type;                    // string index
+        unsigned int   categories;              // bit per category found in the record or its bases
+        double         metrics[Metric::Count];
+    };
+
+    struct Index
+    {
+        Layout::Reader                                      reader;
+        std::vector<Record>                                 records;
+        TRecordIds                                          sorted[Metric::Count];       // ascending metric
+        TRecordIds                                          byCategory[NUM_CATEGORIES];
+        std::unordered_map<Layout::TIndex,TRecordIds>       byContained;                 // by type string index
+        std::unordered_multimap<std::string_view,Layout::TIndex> containedTypes;         // type name and array element type to string index
+        std::vector<TRecordIds>                             byFile;
+    };
+
+    struct Term
+    {
+        Term()
+            : type(TermType::Name)
+            , metric(Metric::Size)
+            , min(-std::numeric_limits<double>::infinity())
+            , max(std::numeric_limits<double>::infinity())
+            , categories(0u)
+        {}
+
+        TermType     type;
+        Metric::Type metric;
+        double       min;        // inclusive
+        double       max;        // inclusive
+        unsigned int categories;
+        std::string  text;
+        TRecordIds   matches;    // sorted set for the category, contains and file terms
+    };
+
+    struct Request
+    {
+        Request()
+            : order(Order::Export)
+            , metric(Metric::Size)
+            , top(0u)
+        {}
+
+        std::vector<Term> terms;
+        Order             order;
+        Metric::Type      metric;
+        unsigned int      top;
+    };
+
+    using TTypeIds = std::vector<Layout::TIndex>;
+
+    // Types contained at any depth by the children ranges referenced by more than one node, the records embedded in
+    // many others share their range and are only walked once
+    struct ContainedMemo
+    {
+        std::vector<unsigned char>                      uses;  // by first child position, saturates at 2
+        std::unordered_map<unsigned long long,TTypeIds> types; // sorted and unique, by range
+    };
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        long GetElapsedMiliseconds(const std::chrono::steady_clock::time_point& start)
+        {
+            return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        unsigned int GetMask(const Layout::Category category) { return 1u << static_cast<unsigned int>(category); }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsBase(const Layout::Category category)
+        {
+            return category == Layout::Category::NVPrimaryBase || category == Layout::Category::NVBase || category == Layout::Category::VPrimaryBase || category == Layout::Category::VBase;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsLeaf(const Layout::NodeView& node)
+        {
+            //the bitfield children only hold the bit ranges of its fields
+            return node.GetNumChildren() == 0u || node.GetNature() == Layout::Category::Bitfield;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        unsigned int CollectCategories(const Layout::NodeView& node)
+        {
+            //the record's own layout includes everything inherited through its bases and the members sharing memory
+            unsigned int categories = 0u;
+            for (Layout::TIndex i = 0u, numChildren = node.GetNumChildren(); i < numChildren; ++i)
+            {
+                const Layout::NodeView child = node.GetChild(i);
+                if (!child)
+                {
+                    continue;
+                }
+
+                const Layout::Category nature = child.GetNature();
+                categories |= GetMask(nature);
+                if ((IsBase(nature) || nature == Layout::Category::Shared) && !IsLeaf(child))
+                {
+                    categories |= CollectCategories(child);
+                }
+            }
+            return categories;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void CountRangeUses(ContainedMemo& memo, const Layout::Reader& reader)
+        {
+            //a range referenced once is walked once anyway, memoizing it would only cost memory
+            for (Layout::TIndex i = 0u, numNodes = reader.GetNumNodes(); i < numNodes; ++i)
+            {
+                const Layout::NodeView node = reader.GetNode(i);
+                if (IsLeaf(node))
+                {
+                    continue;
+                }
+
+                const Layout::TIndex first = node.GetFirstChild();
+                if (first >= memo.uses.size())
+                {
+                    memo.uses.resize(static_cast<size_t>(first) + 1u, 0u);
+                }
+                memo.uses[first] += memo.uses[first] < 2u ? 1u : 0u;
+            }
+        }
+
+        const TTypeIds& GetContained(ContainedMemo& memo, const Layout::NodeView& node);
+
+        // -----------------------------------------------------------------------------------------------------------
+        void CollectContained(TTypeIds& types, ContainedMemo& memo, const Layout::NodeView& node)
+        {
+            for (Layout::TIndex i = 0u, numChildren = node.GetNumChildren(); i < numChildren; ++i)
+            {
+                const Layout::NodeView child = node.GetChild(i);
+                if (!child)
+                {
+                    continue;
+                }
+
+                if (!child.GetType().empty())
+                {
+                    types.push_back(child.GetTypeIndex());
+                }
+
+                if (IsLeaf(child))
+                {
+                    //bitfields sharing storage keep the type of every field in their bit ranges
+                    for (Layout::TIndex j = 0u, numBits = child.GetNature() == Layout::Category::Bitfield ? child.GetNumChildren() : 0u; j < numBits; ++j)
+                    {
+                        const Layout::NodeView bits = child.GetChild(j);
+                        if (bits && !bits.GetType().empty())
+                        {
+                            types.push_back(bits.GetTypeIndex());
+                        }
+                    }
+                    continue;
+                }
+
+                if (memo.uses[child.GetFirstChild()] > 1u)
+                {
+                    const TTypeIds& childTypes = GetContained(memo, child);
+                    types.insert(types.end(), childTypes.begin(), childTypes.end());
+                }
+                else
+                {
+                    CollectContained(types, memo, child);
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        const TTypeIds& GetContained(ContainedMemo& memo, const Layout::NodeView& node)
+        {
+            const unsigned long long key = (static_cast<unsigned long long>(node.GetFirstChild()) << 32) | node.GetNumChildren();
+            std::unordered_map<unsigned long long,TTypeIds>::const_iterator found = memo.types.find(key);
+            if (found != memo.types.end())
+            {
+                return found->second;
+            }
+
+            TTypeIds types;
+            CollectContained(types, memo, node);
+            std::sort(types.begin(), types.end());
+            types.erase(std::unique(types.begin(), types.end()), types.end());
+            return memo.types.emplace(key, std::move(types)).first->second;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string_view GetElementType(std::string_view type)
+        {
+            //'Padded[2]', 'char [4][8]' -> 'Padded', 'char'
+            std::string_view element = type;
+            while (!element.empty() && element.back() == ']')
+            {
+                const size_t open = element.rfind('[');
+                if (open == std::string_view::npos)
+                {
+                    return type;
+                }
+
+                element = element.substr(0, open);
+                while (!element.empty() && element.back() == ' ') element.remove_suffix(1);
+            }
+
+            //pointers and references to arrays ('int (*)[4]') don't embed their element
+            return element.empty() || element.back() == ')' ? type : element;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void Build(Index& index)
+        {
+            const Layout::Reader& reader = index.reader;
+            std::vector<bool> visitedTypes(reader.GetNumStrings(), false);
+            index.byFile.resize(reader.GetNumFiles());
+
+            ContainedMemo containedMemo;
+            CountRangeUses(containedMemo, reader);
+
+            TTypeIds contained;
+            for (Layout::TIndex i = 0u, numRoots = reader.GetNumRoots(); i < numRoots; ++i)
+            {
+                const Layout::NodeView root = reader.GetRoot(i);
+                if (!root || visitedTypes[root.GetTypeIndex()])
+                {
+                    continue;
+                }
+                visitedTypes[root.GetTypeIndex()] = true;
+
+                const TRecordId id = static_cast<TRecordId>(index.records.size());
+                contained.clear();
+                CollectContained(contained, containedMemo, root);
+                std::sort(contained.begin(), contained.end());
+                contained.erase(std::unique(contained.begin(), contained.end()), contained.end());
+                for (const Layout::TIndex type : contained)
+                {
+                    index.byContained[type].push_back(id);
+                }
+
+                //padding as computed by the parsers post-processing
+                const Layout::TAmount size    = root.GetSize();
+                const Layout::TAmount padding = size - root.GetRealSize();
+
+                Record record;
+                record.root                     = root.GetIndex();
+                record.type                     = root.GetTypeIndex();
+                record.categories               = CollectCategories(root);
+                record.metrics[Metric::Size]    = static_cast<double>(size);
+                record.metrics[Metric::Padding] = static_cast<double>(padding);
+                record.metrics[Metric::Ratio]   = size > 0 ? (100.0 * padding) / size : 0.0;
+                record.metrics[Metric::Align]   = static_cast<double>(root.GetAlign());
+                index.records.push_back(record);
+
+                for (unsigned int category = 0u; category < NUM_CATEGORIES; ++category)
+                {
+                    if (record.categories & (1u << category)) index.byCategory[category].push_back(id);
+                }
+
+                const int file = root.GetTypeLocation().fileIndex;
+                if (file >= 0 && static_cast<size_t>(file) < index.byFile.size())
+                {
+                    index.byFile[file].push_back(id);
+                }
+            }
+
+            for (unsigned int metric = 0u; metric < Metric::Count; ++metric)
+            {
+                TRecordIds& sorted = index.sorted[metric];
+                sorted.resize(index.records.size());
+                for (TRecordId id = 0u; id < sorted.size(); ++id)
+                {
+                    sorted[id] = id;
+                }
+                std::stable_sort(sorted.begin(), sorted.end(), [&](const TRecordId a, const TRecordId b){ return index.records[a].metrics[metric] < index.records[b].metrics[metric]; });
+            }
+
+            for (const std::pair<const Layout::TIndex,TRecordIds>& entry : index.byContained)
+            {
+                //array members are also found through their element type
+                const std::string_view type    = reader.GetString(entry.first);
+                const std::string_view element = GetElementType(type);
+                index.containedTypes.emplace(type, entry.first);
+                if (element.size() != type.size())
+                {
+                    index.containedTypes.emplace(element, entry.first);
+                }
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::vector<std::string> Tokenize(const char* query)
+        {
+            std::vector<std::string> tokens;
+            std::string token;
+            bool quoted = false;
+            for (const char* c = query; *c; ++c)
+            {
+                if (*c == '"')
+                {
+                    quoted = !quoted;
+                }
+                else if (!quoted && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n'))
+                {
+                    if (!token.empty()) tokens.push_back(std::move(token));
+                    token.clear();
+                }
+                else
+                {
+                    token += *c;
+                }
+            }
+
+            if (!token.empty()) tokens.push_back(std::move(token));
+            return tokens;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ParseNumber(double& output, const std::string& str)
+        {
+            char* end = nullptr;
+            output = strtod(str.c_str(), &end);
+            return !str.empty() && *end == '\0' && std::isfinite(output);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ParseMetric(Metric::Type& output, const std::string& str)
+        {
+            if (str == "size")    { output = Metric::Size;    return true; }
+            if (str == "padding") { output = Metric::Padding; return true; }
+            if (str == "ratio")   { output = Metric::Ratio;   return true; }
+            if (str == "align")   { output = Metric::Align;   return true; }
+            return false;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        unsigned int ParseCategories(const std::string& str)
+        {
+            if (str == "vptr")     return GetMask(Layout::Category::VTablePtr) | GetMask(Layout::Category::VFTablePtr);
+            if (str == "vbptr")    return GetMask(Layout::Category::VBTablePtr);
+            if (str == "vtordisp") return GetMask(Layout::Category::VtorDisp);
+            if (str == "base")     return GetMask(Layout::Category::NVPrimaryBase) | GetMask(Layout::Category::NVBase) | GetMask(Layout::Category::VPrimaryBase) | GetMask(Layout::Category::VBase);
+            if (str == "vbase")    return GetMask(Layout::Category::VPrimaryBase) | GetMask(Layout::Category::VBase);
+            if (str == "bitfield") return GetMask(Layout::Category::Bitfield);
+            if (str == "union")    return GetMask(Layout::Category::Union);
+            return 0u;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ParseComparison(Term& term, const std::string& token)
+        {
+            const size_t opStart = token.find_first_of("<>=");
+            if (opStart == std::string::npos || !ParseMetric(term.metric, token.substr(0, opStart)))
+            {
+                return false;
+            }
+
+            const size_t opEnd = token.find_first_not_of("<>=", opStart);
+            const std::string op = token.substr(opStart, opEnd == std::string::npos ? std::string::npos : opEnd - opStart);
+
+            double value = 0.0;
+            if (opEnd == std::string::npos || !ParseNumber(value, token.substr(opEnd)))
+            {
+                return false;
+            }
+
+            const double infinity = std::numeric_limits<double>::infinity();
+            term.type = TermType::Range;
+            if      (op == ">")  term.min = std::nextafter(value, infinity);
+            else if (op == ">=") term.min = value;
+            else if (op == "<")  term.max = std::nextafter(value, -infinity);
+            else if (op == "<=") term.max = value;
+            else if (op == "=")  term.min = term.max = value;
+            else return false;
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool Parse(Request& request, const char* query)
+        {
+            for (const std::string& token : Tokenize(query))
+            {
+                const size_t colon = token.find(':');
+                const std::string key   = colon == std::string::npos ? std::string() : token.substr(0, colon);
+                const std::string value = colon == std::string::npos ? std::string() : token.substr(colon + 1);
+
+                Term term;
+                if (key == "sort")
+                {
+                    if      (value == "name")                       request.order = Order::Name;
+                    else if (ParseMetric(request.metric, value))    request.order = Order::Metric;
+                    else { LOG_ERROR("Unknown sort key '%s'.", value.c_str()); return false; }
+                    continue;
+                }
+                else if (key == "top")
+                {
+                    double top = 0.0;
+                    if (!ParseNumber(top, value) || top < 0.0) { LOG_ERROR("Invalid top value '%s'.", value.c_str()); return false; }
+                    request.top = static_cast<unsigned int>(top);
+                    continue;
+                }
+                else if (key == "has")
+                {
+                    term.type       = TermType::Category;
+                    term.categories = ParseCategories(value);
+                    if (term.categories == 0u) { LOG_ERROR("Unknown member category '%s'.", value.c_str()); return false; }
+                }
+                else if (key == "contains" || key == "file" || key == "name")
+                {
+                    term.type = key == "contains" ? TermType::Contains : (key == "file" ? TermType::File : TermType::Name);
+                    term.text = value;
+                    if (value.empty()) { LOG_ERROR("Missing value for '%s'.", key.c_str()); return false; }
+                }
+                else if (!ParseComparison(term, token))
+                {
+                    LOG_ERROR("Unknown query term '%s'.", token.c_str());
+                    return false;
+                }
+
+                request.terms.push_back(std::move(term));
+            }
+
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void AddMatches(TRecordIds& output, const TRecordIds& input)
+        {
+            output.insert(output.end(), input.begin(), input.end());
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void Resolve(Term& term, const Index& index)
+        {
+            //set terms are turned into the sorted list of matching records once per query
+            switch (term.type)
+            {
+            case TermType::Category:
+                for (unsigned int category = 0u; category < NUM_CATEGORIES; ++category)
+                {
+                    if (term.categories & (1u << category)) AddMatches(term.matches, index.byCategory[category]);
+                }
+                break;
+
+            case TermType::Contains:
+                if (term.text.back() == '*')
+                {
+                    const std::string_view prefix = std::string_view(term.text).substr(0, term.text.size() - 1);
+                    for (const std::pair<const std::string_view,Layout::TIndex>& entry : index.containedTypes)
+                    {
+                        if (entry.first.substr(0, prefix.size()) == prefix) AddMatches(term.matches, index.byContained.at(entry.second));
+                    }
+                }
+                else
+                {
+                    using TIterator = std::unordered_multimap<std::string_view,Layout::TIndex>::const_iterator;
+                    const std::pair<TIterator,TIterator> found = index.containedTypes.equal_range(term.text);
+                    for (TIterator it = found.first; it != found.second; ++it) AddMatches(term.matches, index.byContained.at(it->second));
+                }
+                break;
+
+            case TermType::File:
+                for (Layout::TIndex file = 0u; file < index.byFile.size(); ++file)
+                {
+                    if (index.reader.GetFile(static_cast<int>(file)).find(term.text) != std::string_view::npos) AddMatches(term.matches, index.byFile[file]);
+                }
+                break;
+
+            default: return;
+            }
+
+            std::sort(term.matches.begin(), term.matches.end());
+            term.matches.erase(std::unique(term.matches.begin(), term.matches.end()), term.matches.end());
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::pair<TRecordIds::const_iterator,TRecordIds::const_iterator> GetRange(const Index& index, const Term& term)
+        {
+            const TRecordIds& sorted = index.sorted[term.metric];
+            const std::vector<Record>& records = index.records;
+            TRecordIds::const_iterator first = std::lower_bound(sorted.begin(), sorted.end(), term.min, [&](const TRecordId id, const double value){ return records[id].metrics[term.metric] < value; });
+            TRecordIds::const_iterator last  = std::upper_bound(first, sorted.end(), term.max, [&](const double value, const TRecordId id){ return value < records[id].metrics[term.metric]; });
+            return std::make_pair(first, last);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        size_t Estimate(const Index& index, const Term& term)
+        {
+            switch (term.type)
+            {
+            case TermType::Range: { const std::pair<TRecordIds::const_iterator,TRecordIds::const_iterator> range = GetRange(index, term); return static_cast<size_t>(range.second - range.first); }
+            case TermType::Name:  return index.records.size();
+            default:              return term.matches.size();
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool Matches(const Index& index, const Term& term, const TRecordId id)
+        {
+            const Record& record = index.records[id];
+            switch (term.type)
+            {
+            case TermType::Range: return record.metrics[term.metric] >= term.min && record.metrics[term.metric] <= term.max;
+            case TermType::Name:  return index.reader.GetString(record.type).find(term.text) != std::string_view::npos;
+            default:              return std::binary_search(term.matches.begin(), term.matches.end(), id);
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        TRecordIds Execute(Request& request, const Index& index)
+        {
+            for (Term& term : request.terms)
+            {
+                Resolve(term, index);
+            }
+
+            //the most selective term provides the candidates
+            const Term* driver = nullptr;
+            size_t numCandidates = index.records.size();
+            for (const Term& term : request.terms)
+            {
+                const size_t estimate = Estimate(index, term);
+                if (driver == nullptr || estimate < numCandidates)
+                {
+                    driver = &term;
+                    numCandidates = estimate;
+                }
+            }
+
+            TRecordIds candidates;
+            if (driver == nullptr || driver->type == TermType::Name)
+            {
+                candidates.resize(index.records.size());
+                for (TRecordId id = 0u; id < candidates.size(); ++id) candidates[id] = id;
+            }
+            else if (driver->type == TermType::Range)
+            {
+                const std::pair<TRecordIds::const_iterator,TRecordIds::const_iterator> range = GetRange(index, *driver);
+                candidates.assign(range.first, range.second);
+                std::sort(candidates.begin(), candidates.end());
+            }
+            else
+            {
+                candidates = driver->matches;
+            }
+
+            TRecordIds results;
+            for (const TRecordId id : candidates)
+            {
+                if (std::all_of(request.terms.begin(), request.terms.end(), [&](const Term& term){ return &term == driver || Matches(index, term, id); }))
+                {
+                    results.push_back(id);
+                }
+            }
+
+            //record ids follow the export order, which also breaks the ranking ties
+            const size_t numResults = request.top > 0u ? std::min<size_t>(request.top, results.size()) : results.size();
+            if (request.order == Order::Metric)
+            {
+                const Metric::Type metric = request.metric;
+                std::partial_sort(results.begin(), results.begin() + numResults, results.end(), [&](const TRecordId a, const TRecordId b){ return index.records[a].metrics[metric] > index.records[b].metrics[metric] || (index.records[a].metrics[metric] == index.records[b].metrics[metric] && a < b); });
+            }
+            else if (request.order == Order::Name)
+            {
+                std::partial_sort(results.begin(), results.begin() + numResults, results.end(), [&](const TRecordId a, const TRecordId b){ const std::string_view nameA = index.reader.GetString(index.records[a].type), nameB = index.reader.GetString(index.records[b].type); return nameA < nameB || (nameA == nameB && a < b); });
+            }
+
+            results.resize(numResults);
+            return results;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintJsonString(FILE* output, std::string_view str)
+        {
+            fputc('"', output);
+            for (const char c : str)
+            {
+                if (c == '"' || c == '\\')                        fprintf(output, "\\%c", c);
+                else if (static_cast<unsigned char>(c) < 0x20u) fprintf(output, "\\u%04x", static_cast<unsigned int>(c));
+                else                                              fputc(c, output);
+            }
+            fputc('"', output);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintTable(FILE* output, const Index& index, const TRecordIds& results)
+        {
+            fprintf(output, "%10s %6s %8s %7s  %s\n", "Size", "Align", "Padding", "Ratio", "Type");
+            for (const TRecordId id : results)
+            {
+                const Record& record = index.records[id];
+                const std::string type(index.reader.GetString(record.type));
+                fprintf(output, "%10.0f %6.0f %8.0f %6.1f%%  %s\n", record.metrics[Metric::Size], record.metrics[Metric::Align], record.metrics[Metric::Padding], record.metrics[Metric::Ratio], type.c_str());
+            }
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintJson(FILE* output, const Index& index, const TRecordIds& results)
+        {
+            fprintf(output, "[");
+            for (size_t i = 0u; i < results.size(); ++i)
+            {
+                const Record& record = index.records[results[i]];
+                const Layout::Location location = index.reader.GetNode(record.root).GetTypeLocation();
+
+                fprintf(output, "%s\n  {\"type\": ", i ? "," : "");
+                PrintJsonString(output, index.reader.GetString(record.type));
+                fprintf(output, ", \"size\": %.0f, \"align\": %.0f, \"padding\": %.0f, \"paddingRatio\": %.2f", record.metrics[Metric::Size], record.metrics[Metric::Align], record.metrics[Metric::Padding], record.metrics[Metric::Ratio]);
+                if (location.fileIndex != Layout::INVALID_FILE_INDEX)
+                {
+                    fprintf(output, ", \"file\": ");
+                    PrintJsonString(output, index.reader.GetFile(location.fileIndex));
+                    fprintf(output, ", \"line\": %u", location.line);
+                }
+                fprintf(output, "}");
+            }
+            fprintf(output, "%s]\n", results.empty() ? "" : "\n");
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool Answer(FILE* output, const Index& index, const char* query, const unsigned int top, const bool json)
+        {
+            Request request;
+            request.top = top;
+            if (!Parse(request, query))
+            {
+                return false;
+            }
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const TRecordIds results = Execute(request, index);
+            const long miliseconds = GetElapsedMiliseconds(start);
+
+            if (json) PrintJson(output, index, results);
+            else      PrintTable(output, index, results);
+            fflush(output);
+
+            LOG_PROGRESS("%u of %u types listed.", static_cast<unsigned int>(results.size()), static_cast<unsigned int>(index.records.size()));
+            IO::LogTime(IO::Verbosity::Info, "Query answered in ", miliseconds);
+            IO::Log(IO::Verbosity::Info, "\n");
+            return true;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Run(FILE* output, const char* filename, const char* query, const unsigned int top, const bool json)
+    {
+        Index index;
+        if (!index.reader.Open(filename))
+        {
+            return false;
+        }
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Helpers::Build(index);
+        LOG_PROGRESS("%u types indexed from %u nodes.", static_cast<unsigned int>(index.records.size()), index.reader.GetNumNodes());
+        IO::LogTime(IO::Verbosity::Info, "Indexes built in ", Helpers::GetElapsedMiliseconds(start));
+        IO::Log(IO::Verbosity::Info, "\n");
+
+        if (query)
+        {
+            return Helpers::Answer(output, index, query, top, json);
+        }
+
+        //interactive: one query per line, invalid queries are reported and skipped
+        std::string line;
+        char buffer[1024];
+        while (fgets(buffer, sizeof(buffer), stdin))
+        {
+            //long lines come in several chunks
+            line += buffer;
+            if (line.back() != '\n' && !feof(stdin))
+            {
+                continue;
+            }
+
+            while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+            {
+                line.pop_back();
+            }
+            const std::string entry = std::move(line);
+            line.clear();
+
+            if (entry == "quit")
+            {
+                break;
+            }
+
+            if (!entry.empty())
+            {
+                Helpers::Answer(output, index, entry.c_str(), top, json);
+            }
+        }
+
+        return true;
+    }
+}
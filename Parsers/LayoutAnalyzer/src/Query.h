@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdio>
+
+namespace Query
+{
+    // Filter and rank queries over a whole export, answered from secondary indexes built once when the file is opened.
+    // Without a query the queries are read from stdin one per line until 'quit'.
+    bool Run(FILE* output, const char* filename, const char* query, const unsigned int top, const bool json);
+}
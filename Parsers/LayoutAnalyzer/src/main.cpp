@@ -0,0 +1,82 @@
+#include <cstdio>
+
+#include "IO.h"
+#include "LayoutDefinitions.h"
+#include "Platform.h"
+
+#include "CacheLines.h"
+#include "CommandLine.h"
+#include "Diff.h"
+#include "Freeze.h"
+#include "Heat.h"
+#include "Optimizer.h"
+#include "Query.h"
+
+constexpr int FAILURE = -1;
+constexpr int SUCCESS = 0;
+constexpr int THRESHOLD_EXCEEDED = 1;
+
+// -----------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    //Parse Command Line arguments
+    AnalyzerParams params;
+    if (CommandLine::Parse(params, argc, argv) != 0)
+    {
+        return FAILURE;
+    }
+
+    //query maps the file and builds its own indexes instead of loading it
+    Layout::Store store;
+    if (params.command != Command::Query && !IO::FromFile(store, params.input))
+    { 
+        LOG_ERROR("Unable to load %s.", params.input);
+        return FAILURE;
+    }
+
+    Layout::Store secondStore;
+    if (params.command == Command::Diff && !IO::FromFile(secondStore, params.secondInput))
+    { 
+        LOG_ERROR("Unable to load %s.", params.secondInput);
+        return FAILURE;
+    }
+
+    Diff::Thresholds thresholds;
+    thresholds.maxGrowth        = params.maxGrowth;
+    thresholds.maxPaddingGrowth = params.maxPaddingGrowth;
+
+    Heat::Map heat;
+    if (params.samples && !Heat::Load(heat, store, params.samples, params.hotPercent))
+    { 
+        return FAILURE;
+    }
+    const Heat::Map* heatPtr = params.samples ? &heat : nullptr;
+
+    FILE* output = stdout;
+    if (params.output && fopen_s(&output, params.output, "w"))
+    { 
+        LOG_ERROR("Unable to open %s for writing.", params.output);
+        return FAILURE;
+    }
+
+    //Execute command
+    bool result = false;
+    bool exceeded = false;
+    switch (params.command)
+    { 
+    case Command::Optimize:   result = Optimizer::Report(output, store, heatPtr, params.typeName, params.top); break;
+    case Command::CacheLines: result = CacheLines::Report(output, store, heatPtr, params.typeName, params.lineSize, params.top); break;
+    case Command::HeatMap:    result = Heat::Report(output, store, heat, params.typeName, params.top); break;
+    case Command::Diff:       result = Diff::Report(output, store, secondStore, params.typeName, thresholds, exceeded); break;
+    case Command::Freeze:     result = Freeze::Report(output, store, params.typeName, params.input); break;
+    case Command::Query:      result = Query::Run(output, params.input, params.query, params.top, params.json); break;
+    default: break;
+    }
+
+    if (output != stdout)
+    { 
+        fclose(output);
+    }
+
+    return result ? (exceeded ? THRESHOLD_EXCEEDED : SUCCESS) : FAILURE;
+}
\ No newline at end of file
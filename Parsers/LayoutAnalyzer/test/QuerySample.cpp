@@ -0,0 +1,17 @@
+// Types exported by DWARFLayout for the query tests, the records only hold their members through arrays
+
+struct Padded      { char a; double b; };
+struct Lock        { int state; };
+struct PaddedArray { Padded items[2]; };
+struct LockGrid    { char flag; Lock locks[2][3]; };
+struct Holder      { char tag; PaddedArray array; };
+struct LockPtr     { Lock (*grid)[3]; };
+
+int main()
+{
+    PaddedArray paddedArray{};
+    LockGrid    lockGrid{};
+    Holder      holder{};
+    LockPtr     lockPtr{};
+    return static_cast<int>(sizeof(paddedArray) + sizeof(lockGrid) + sizeof(holder) + sizeof(lockPtr));
+}
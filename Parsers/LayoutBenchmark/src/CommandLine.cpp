@@ -0,0 +1,208 @@
+#include "CommandLine.h"
+
+#include "IO.h"
+
+BenchmarkParams::BenchmarkParams()
+    : command(Command::Invalid)
+    , output(nullptr)
+{}
+
+namespace CommandLine
+{
+    constexpr int FAILURE = -1;
+    constexpr int SUCCESS = 0;
+
+    namespace Utils
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        int StringCompare(const char* s1, const char* s2)
+        {
+            for(;*s1 && (*s1 == *s2);++s1,++s2){}
+            return *(const unsigned char*)s1 - *(const unsigned char*)s2;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool StringToUInt(unsigned int& output, const char* str)
+        {
+            unsigned int ret = 0;
+            while (char c = *str)
+            {
+                if (c < '0' || c > '9')
+                {
+                    return false;
+                }
+
+                ret=ret*10+(c-'0');
+                ++str;
+            }
+
+            output = ret;
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Command ParseCommand(const char* str)
+        {
+            if (StringCompare(str,"generate") == 0) return Command::Generate;
+            if (StringCompare(str,"run") == 0)      return Command::Run;
+            return Command::Invalid;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ParseUInt(unsigned int& output, const char* argValue, const char* name, int& i, int argc, char* argv[])
+        {
+            if (StringCompare(argValue,name) != 0 || (i+1) >= argc)
+            {
+                return false;
+            }
+
+            ++i;
+            unsigned int value = 0;
+            if (StringToUInt(value, argv[i]))
+            {
+                output = value;
+            }
+            return true;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // -----------------------------------------------------------------------------------------------------------
+    void DisplayHelp()
+    {
+        BenchmarkParams defaultParams;
+        LOG_ALWAYS("Struct Layout Benchmark");
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Generates synthetic codebases and measures the time ClangLayout spends in each phase while parsing them.");
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Usage: LayoutBenchmark generate <corpusDir> [options]");
+        LOG_ALWAYS("       LayoutBenchmark run <corpusDir> -parser <ClangLayout> [options]");
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Commands:");
+        LOG_ALWAYS("generate              : Writes the headers, main.cpp, compile_commands.json and the probe locations of a synthetic corpus");
+        LOG_ALWAYS("run                   : Invokes the parser on every probe location and on the whole corpus, printing the phase timings as JSON");
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Generate Legend:");
+        LOG_ALWAYS("-records              : Number of records ('%u' by default)", defaultParams.generator.records);
+        LOG_ALWAYS("-headers              : Number of headers the records are spread over ('%u' by default)", defaultParams.generator.headers);
+        LOG_ALWAYS("-fanout               : Previous headers included by each header ('%u' by default)", defaultParams.generator.fanout);
+        LOG_ALWAYS("-depth                : Length of the inheritance chains ('%u' by default)", defaultParams.generator.depth);
+        LOG_ALWAYS("-vbases               : Percent of records also deriving from a virtual base ('%u' by default)", defaultParams.generator.vbasePercent);
+        LOG_ALWAYS("-templates            : Distinct class template instantiations used as members ('%u' by default)", defaultParams.generator.templates);
+        LOG_ALWAYS("-probes               : Records defined in main.cpp used as cursor locations ('%u' by default)", defaultParams.generator.probes);
+        LOG_ALWAYS("-seed                 : Seed of the member generation ('%u' by default)", defaultParams.generator.seed);
+        LOG_ALWAYS("");
+        LOG_ALWAYS("Run Legend:");
+        LOG_ALWAYS("-parser         (-p)  : The path to the ClangLayout executable");
+        LOG_ALWAYS("-runs           (-r)  : Measured invocations per location and scenario ('%u' by default)", defaultParams.harness.runs);
+        LOG_ALWAYS("-locations            : Only query the first N probe locations (all by default)");
+        LOG_ALWAYS("-noAll                : Skip the whole corpus export scenario");
+        LOG_ALWAYS("-args           (-a)  : Extra arguments for every parser invocation - example: '-a -fast'");
+        LOG_ALWAYS("-output         (-o)  : The output file path for the JSON report (stdout by default)");
+        LOG_ALWAYS("-verbosity      (-v)  : Sets the verbosity level - example: '-v 1'");
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    int Parse(BenchmarkParams& params, int argc, char* argv[])
+    {
+        //No args
+        if (argc <= 1)
+        {
+            LOG_ERROR("No arguments found. Type '?' for help.");
+            return FAILURE;
+        }
+
+        //Check for Help
+        for (int i=1;i<argc;++i)
+        {
+            if (Utils::StringCompare(argv[i],"?") == 0)
+            {
+                DisplayHelp();
+                return FAILURE;
+            }
+        }
+
+        //The command always goes first
+        params.command = Utils::ParseCommand(argv[1]);
+        if (params.command == Command::Invalid)
+        {
+            LOG_ERROR("Unknown command '%s'. Type '?' for help.", argv[1]);
+            return FAILURE;
+        }
+
+        //Parse arguments
+        for(int i=2;i < argc;++i)
+        {
+            char* argValue = argv[i];
+            if (argValue[0] == '-')
+            {
+                if (Utils::ParseUInt(params.generator.records, argValue, "-records", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.generator.headers, argValue, "-headers", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.generator.fanout, argValue, "-fanout", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.generator.depth, argValue, "-depth", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.generator.vbasePercent, argValue, "-vbases", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.generator.templates, argValue, "-templates", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.generator.probes, argValue, "-probes", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.generator.seed, argValue, "-seed", i, argc, argv)) {}
+                else if (Utils::ParseUInt(params.harness.locations, argValue, "-locations", i, argc, argv)) {}
+                else if ((Utils::StringCompare(argValue,"-r")==0 || Utils::StringCompare(argValue,"-runs")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value, argv[i]) && value > 0u)
+                    {
+                        params.harness.runs = value;
+                    }
+                }
+                else if ((Utils::StringCompare(argValue,"-p")==0 || Utils::StringCompare(argValue,"-parser")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    params.harness.parser = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-a")==0 || Utils::StringCompare(argValue,"-args")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    params.harness.extraArgs = argv[i];
+                }
+                else if ((Utils::StringCompare(argValue,"-o")==0 || Utils::StringCompare(argValue,"-output")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    params.output = argv[i];
+                }
+                else if (Utils::StringCompare(argValue,"-noAll")==0)
+                {
+                    params.harness.exportAll = false;
+                }
+                else if ((Utils::StringCompare(argValue,"-v")==0 || Utils::StringCompare(argValue,"-verbosity")==0) && (i+1) < argc)
+                {
+                    ++i;
+                    unsigned int value = 0;
+                    if (Utils::StringToUInt(value,argv[i]) && value < static_cast<unsigned int>(IO::Verbosity::Invalid))
+                    {
+                        IO::SetVerbosityLevel(IO::Verbosity(value));
+                    }
+                }
+            }
+            else if (params.harness.corpus == nullptr)
+            {
+                //We assume that the first free argument is the corpus directory
+                params.harness.corpus = argValue;
+            }
+        }
+
+        if (params.harness.corpus == nullptr)
+        {
+            LOG_ERROR("No corpus directory provided.");
+            return FAILURE;
+        }
+
+        if (params.command == Command::Run && params.harness.parser == nullptr)
+        {
+            LOG_ERROR("The run command requires the parser executable, use -parser.");
+            return FAILURE;
+        }
+
+        return SUCCESS;
+    }
+}
\ No newline at end of file
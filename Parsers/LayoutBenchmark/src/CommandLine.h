@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Generator.h"
+#include "Harness.h"
+
+enum class Command
+{ 
+    Generate,
+    Run,
+
+    Invalid
+};
+
+struct BenchmarkParams 
+{ 
+    BenchmarkParams();
+
+    Command             command;
+    const char*         output;
+    Generator::Settings generator;
+    Harness::Settings   harness;
+};
+
+namespace CommandLine
+{ 
+    int Parse(BenchmarkParams& args, int argc, char* argv[]);
+}
\ No newline at end of file
@@ -0,0 +1,270 @@
+#include "Generator.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+
+#include "IO.h"
+#include "Platform.h"
+
+Generator::Settings::Settings()
+    : records(1000u)
+    , headers(50u)
+    , fanout(4u)
+    , depth(4u)
+    , vbasePercent(10u)
+    , templates(100u)
+    , probes(16u)
+    , seed(1u)
+{}
+
+namespace Generator
+{
+    constexpr unsigned int NUM_VIRTUAL_ROOTS = 4u;
+    constexpr unsigned int PROBE_NAME_COLUMN = 12u; // "    struct " precedes the probe names
+
+    const char* const s_fieldTypes[]   = { "bool", "char", "short", "int", "long long", "float", "double", "void*" };
+    const char* const s_elementTypes[] = { "char", "short", "int", "double" };
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        // Deterministic so the same settings always produce the same corpus on every machine
+        class Random
+        {
+        public:
+            Random(const unsigned int seed)
+                : m_state(seed * 2654435761u + 1u)
+            {}
+
+            unsigned int Next(const unsigned int range)
+            {
+                m_state = m_state * 1664525u + 1013904223u;
+                return (m_state >> 8) % range;
+            }
+
+        private:
+            unsigned int m_state;
+        };
+
+        // -----------------------------------------------------------------------------------------------------------
+        unsigned int GetHeader(const Settings& settings, const unsigned int record)
+        {
+            //records are spread contiguously, a chain base is always in the same header or an earlier one
+            return static_cast<unsigned int>(static_cast<unsigned long long>(record) * settings.headers / settings.records);
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string GetHeaderName(const unsigned int header)
+        {
+            char buffer[32];
+            snprintf(buffer, sizeof(buffer), "BenchHeader_%04u.h", header);
+            return buffer;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string ToJsonString(const std::filesystem::path& path)
+        {
+            std::string ret;
+            for (const char c : path.generic_string())
+            {
+                if (c == '"' || c == '\\') ret += '\\';
+                ret += c;
+            }
+            return ret;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool WriteFile(const std::filesystem::path& path, const std::string& content)
+        {
+            FILE* stream = nullptr;
+            if (fopen_s(&stream, path.string().c_str(), "w") != 0 || stream == nullptr)
+            {
+                LOG_ERROR("Unable to open %s for writing.", path.string().c_str());
+                return false;
+            }
+
+            const bool ret = fwrite(content.data(), 1u, content.size(), stream) == content.size();
+            fclose(stream);
+            return ret;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string GenerateCommon()
+        {
+            std::string content = "// Generated by LayoutBenchmark\n#pragma once\n\nnamespace Bench\n{\n";
+            content += "    template<typename T, unsigned int N> struct Array\n    {\n        T             items[N];\n        unsigned char count;\n    };\n";
+
+            for (unsigned int i = 0u; i < NUM_VIRTUAL_ROOTS; ++i)
+            {
+                const std::string name = "VirtualRoot_" + std::to_string(i);
+                content += "\n    struct " + name + "\n    {\n        virtual ~" + name + "() {}\n        int rootId;\n    };\n";
+            }
+
+            content += "}\n";
+            return content;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void GenerateRecord(std::string& content, Random& random, const Settings& settings, const unsigned int record)
+        {
+            const std::string name = "Record_" + std::to_string(record);
+
+            std::string bases;
+            if (record % settings.depth != 0u)
+            {
+                bases = "public Record_" + std::to_string(record - 1u);
+            }
+            if (random.Next(100u) < settings.vbasePercent)
+            {
+                bases += bases.empty() ? "" : ", ";
+                bases += "public virtual VirtualRoot_" + std::to_string(random.Next(NUM_VIRTUAL_ROOTS));
+            }
+
+            content += "\n    struct " + name + (bases.empty() ? "" : " : " + bases) + "\n    {\n";
+
+            if (random.Next(8u) == 0u)
+            {
+                content += "        virtual void Update_" + std::to_string(record) + "() {}\n";
+            }
+
+            const unsigned int numFields = 2u + random.Next(7u);
+            for (unsigned int i = 0u; i < numFields; ++i)
+            {
+                const unsigned int kind = random.Next(10u);
+                if (kind < 8u)
+                {
+                    content += std::string("        ") + s_fieldTypes[random.Next(sizeof(s_fieldTypes) / sizeof(s_fieldTypes[0]))] + " m_" + std::to_string(i) + ";\n";
+                }
+                else
+                {
+                    content += "        unsigned int m_" + std::to_string(i) + " : " + std::to_string(1u + random.Next(7u)) + ";\n";
+                }
+            }
+
+            //every instantiation is unique: element type and count are derived from the instantiation number
+            for (unsigned int instance = record; instance < settings.templates; instance += settings.records)
+            {
+                const unsigned int numElementTypes = sizeof(s_elementTypes) / sizeof(s_elementTypes[0]);
+                content += std::string("        Array<") + s_elementTypes[instance % numElementTypes] + ", " + std::to_string(instance / numElementTypes + 1u) + "> m_array" + std::to_string(instance) + ";\n";
+            }
+
+            content += "    };\n";
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string GenerateHeader(Random& random, const Settings& settings, const unsigned int header, unsigned int& nextRecord)
+        {
+            std::string content = "// Generated by LayoutBenchmark\n#pragma once\n\n#include \"BenchCommon.h\"\n";
+            for (unsigned int i = 1u; i <= settings.fanout && i <= header; ++i)
+            {
+                content += "#include \"" + GetHeaderName(header - i) + "\"\n";
+            }
+
+            content += "\nnamespace Bench\n{";
+            for (; nextRecord < settings.records && GetHeader(settings, nextRecord) == header; ++nextRecord)
+            {
+                GenerateRecord(content, random, settings, nextRecord);
+            }
+            content += "}\n";
+
+            return content;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void GenerateMain(std::string& content, std::string& locations, const Settings& settings)
+        {
+            content = "// Generated by LayoutBenchmark\n";
+            for (unsigned int header = 0u; header < settings.headers; ++header)
+            {
+                content += "#include \"" + GetHeaderName(header) + "\"\n";
+            }
+
+            //the comment and include lines above plus the ones below until the first probe
+            unsigned int line = settings.headers + 2u;
+            content += "\nnamespace Probe\n{\n";
+            line += 3u;
+
+            for (unsigned int probe = 0u; probe < settings.probes; ++probe)
+            {
+                //probes derive from the chain ends spread over the corpus and embed records from the other end
+                const unsigned int base     = settings.records - 1u - static_cast<unsigned int>(static_cast<unsigned long long>(probe) * settings.records / settings.probes);
+                const unsigned int embedded = static_cast<unsigned int>(static_cast<unsigned long long>(probe) * settings.records / settings.probes);
+                const std::string  name     = "Probe_" + std::to_string(probe);
+
+                locations += std::to_string(line) + ' ' + std::to_string(PROBE_NAME_COLUMN) + " Probe::" + name + '\n';
+
+                content += "    struct " + name + " : public Bench::Record_" + std::to_string(base) + "\n";
+                content += "    {\n";
+                content += "        Bench::Record_" + std::to_string(embedded) + " embedded;\n";
+                content += "        int value;\n";
+                content += "    };\n";
+                content += "\n";
+                content += "    int Use_" + std::to_string(probe) + "(const " + name + "& probe) { return probe.value + static_cast<int>(sizeof(probe)); }\n";
+                content += "\n";
+                line += 8u;
+            }
+
+            content += "}\n\nint main() { return 0; }\n";
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Generate(const char* directory, const Settings& settings)
+    {
+        if (settings.records == 0u || settings.headers == 0u || settings.depth == 0u)
+        {
+            LOG_ERROR("The corpus needs at least one record, one header and an inheritance depth of one.");
+            return false;
+        }
+
+        std::error_code error;
+        const std::filesystem::path root = std::filesystem::absolute(directory, error);
+        const std::filesystem::path includeDir = root / "include";
+        if (error || (std::filesystem::create_directories(includeDir, error), error))
+        {
+            LOG_ERROR("Unable to create the directory %s.", includeDir.string().c_str());
+            return false;
+        }
+
+        Helpers::Random random(settings.seed);
+
+        if (!Helpers::WriteFile(includeDir / "BenchCommon.h", Helpers::GenerateCommon()))
+        {
+            return false;
+        }
+
+        unsigned int nextRecord = 0u;
+        for (unsigned int header = 0u; header < settings.headers; ++header)
+        {
+            if (!Helpers::WriteFile(includeDir / Helpers::GetHeaderName(header), Helpers::GenerateHeader(random, settings, header, nextRecord)))
+            {
+                return false;
+            }
+        }
+
+        std::string mainContent;
+        std::string locations = "# records=" + std::to_string(settings.records) + " headers=" + std::to_string(settings.headers) + " fanout=" + std::to_string(settings.fanout) +
+            " depth=" + std::to_string(settings.depth) + " vbases=" + std::to_string(settings.vbasePercent) + " templates=" + std::to_string(settings.templates) +
+            " probes=" + std::to_string(settings.probes) + " seed=" + std::to_string(settings.seed) + "\n";
+        Helpers::GenerateMain(mainContent, locations, settings);
+
+        const std::filesystem::path mainFile = root / "main.cpp";
+        const std::string database =
+            "[\n"
+            "    {\n"
+            "        \"directory\": \"" + Helpers::ToJsonString(root) + "\",\n"
+            "        \"command\": \"clang++ -x c++ -std=c++17 -w -I" + Helpers::ToJsonString(includeDir) + " " + Helpers::ToJsonString(mainFile) + "\",\n"
+            "        \"file\": \"" + Helpers::ToJsonString(mainFile) + "\"\n"
+            "    }\n"
+            "]\n";
+
+        if (!Helpers::WriteFile(mainFile, mainContent) || !Helpers::WriteFile(root / "locations.txt", locations) || !Helpers::WriteFile(root / "compile_commands.json", database))
+        {
+            return false;
+        }
+
+        LOG_PROGRESS("Generated %u records over %u headers and %u probes in %s.", settings.records, settings.headers, settings.probes, root.string().c_str());
+        return true;
+    }
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+namespace Generator
+{ 
+    struct Settings
+    { 
+        Settings();
+
+        unsigned int records;       // records spread over the headers
+        unsigned int headers;       // headers included by the translation unit
+        unsigned int fanout;        // previous headers included by each header
+        unsigned int depth;         // length of the inheritance chains
+        unsigned int vbasePercent;  // share of records also deriving from a virtual base
+        unsigned int templates;     // distinct class template instantiations used as members
+        unsigned int probes;        // records defined in the main file, the cursor lookup targets
+        unsigned int seed;
+    };
+
+    // Writes a synthetic codebase in the given directory: include/Bench*.h, main.cpp including every header,
+    // compile_commands.json and locations.txt listing the probe locations the harness queries.
+    bool Generate(const char* directory, const Settings& settings);
+}
@@ -0,0 +1,340 @@
+#include "Harness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "IO.h"
+#include "Platform.h"
+
+Harness::Settings::Settings()
+    : corpus(nullptr)
+    , parser(nullptr)
+    , extraArgs(nullptr)
+    , runs(5u)
+    , locations(0u)
+    , exportAll(true)
+{}
+
+namespace Harness
+{
+    // Every parser invocation appends its phase timings to a JSON lines file (ClangLayout -timings), the harness
+    // runs one warm up invocation per scenario to fill the file system cache and then aggregates the measured ones.
+
+    enum Metric
+    {
+        Parse,
+        Lookup,
+        Compute,
+        PostProcess,
+        Write,
+        Total,
+
+        Count
+    };
+
+    const char* const s_metricNames[Metric::Count] = { "parse", "lookup", "compute", "postprocess", "write", "total" };
+
+    struct Sample
+    {
+        long long metrics[Metric::Count];
+        long long roots;
+        long long nodes;
+    };
+
+    struct Location
+    {
+        unsigned int row;
+        unsigned int col;
+        std::string  name;
+    };
+
+    struct Corpus
+    {
+        std::filesystem::path directory;
+        std::filesystem::path mainFile;
+        std::string           description;
+        std::vector<Location> locations;
+    };
+
+    struct Scenario
+    {
+        Scenario(const char* _name)
+            : name(_name)
+            , failures(0u)
+        {}
+
+        const char*         name;
+        std::vector<Sample> samples;
+        unsigned int        failures;
+    };
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        std::string Quote(const std::string& str)
+        {
+            return '"' + str + '"';
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ReadValue(long long& output, const char* line, const char* key)
+        {
+            //the lines are written by ClangLayout, a key lookup is enough to read them
+            const std::string pattern = std::string("\"") + key + "\":";
+            const char* found = strstr(line, pattern.c_str());
+            if (found == nullptr)
+            {
+                return false;
+            }
+
+            char* end = nullptr;
+            output = strtoll(found + pattern.size(), &end, 10);
+            return end != found + pattern.size();
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool ReadTimings(Sample& sample, const std::filesystem::path& filename)
+        {
+            FILE* stream = nullptr;
+            if (fopen_s(&stream, filename.string().c_str(), "r") != 0 || stream == nullptr)
+            {
+                return false;
+            }
+
+            char line[4096];
+            const bool hasLine = fgets(line, sizeof(line), stream) != nullptr;
+            fclose(stream);
+
+            bool ret = hasLine && ReadValue(sample.roots, line, "roots") && ReadValue(sample.nodes, line, "nodes");
+            for (int metric = 0; metric < Metric::Total; ++metric)
+            {
+                ret = ret && ReadValue(sample.metrics[metric], line, s_metricNames[metric]);
+            }
+            return ret;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool LoadCorpus(Corpus& corpus, const char* directory)
+        {
+            std::error_code error;
+            corpus.directory = std::filesystem::absolute(directory, error);
+            corpus.mainFile  = corpus.directory / "main.cpp";
+
+            const std::filesystem::path locationsFile = corpus.directory / "locations.txt";
+            FILE* stream = nullptr;
+            if (error || fopen_s(&stream, locationsFile.string().c_str(), "r") != 0 || stream == nullptr)
+            {
+                LOG_ERROR("Unable to read %s, generate the corpus first.", locationsFile.string().c_str());
+                return false;
+            }
+
+            char line[1024];
+            while (fgets(line, sizeof(line), stream))
+            {
+                line[strcspn(line, "\r\n")] = '\0';
+
+                if (line[0] == '#')
+                {
+                    //the generator settings
+                    corpus.description = line[1] == ' ' ? line + 2 : line + 1;
+                    continue;
+                }
+
+                //'<row> <col> <name>', the name runs until the next blank
+                int nameStart = 0;
+                Location location;
+                if (sscanf_s(line, "%u %u %n", &location.row, &location.col, &nameStart) == 2 && line[nameStart] != '\0')
+                {
+                    location.name.assign(line + nameStart, strcspn(line + nameStart, " \t"));
+                    corpus.locations.push_back(location);
+                }
+            }
+
+            fclose(stream);
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool Invoke(Scenario& scenario, const Settings& settings, const Corpus& corpus, const std::string& arguments, const bool measure)
+        {
+            const std::filesystem::path timingsFile = corpus.directory / "timings.jsonl";
+            const std::filesystem::path outputFile  = corpus.directory / "benchmark.slbin";
+            const std::filesystem::path logFile     = corpus.directory / "benchmark.log";
+
+            std::string command = Quote(settings.parser) + ' ' + arguments;
+            command += " -o=" + Quote(outputFile.string());
+            command += " -timings=" + Quote(timingsFile.string());
+            command += " -p " + Quote(corpus.directory.string());
+            if (settings.extraArgs)
+            {
+                command += ' ';
+                command += settings.extraArgs;
+            }
+            command += ' ' + Quote(corpus.mainFile.string());
+            command += " >> " + Quote(logFile.string()) + " 2>&1";
+
+#ifdef _WIN32
+            //cmd strips the outer quotes when the command starts with one
+            command = Quote(command);
+#endif
+
+            std::error_code error;
+            std::filesystem::remove(timingsFile, error);
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const int exitCode = std::system(command.c_str());
+            const long long total = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+            Sample sample;
+            sample.metrics[Metric::Total] = total;
+            if (exitCode != 0 || !ReadTimings(sample, timingsFile))
+            {
+                LOG_WARNING("Parser invocation failed, see %s: %s", logFile.string().c_str(), command.c_str());
+                scenario.failures += measure ? 1u : 0u;
+                return false;
+            }
+
+            if (measure)
+            {
+                scenario.samples.push_back(sample);
+            }
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintStats(FILE* output, std::vector<long long>& values)
+        {
+            std::sort(values.begin(), values.end());
+
+            long long sum = 0;
+            for (const long long value : values)
+            {
+                sum += value;
+            }
+
+            const size_t count = values.size();
+            const long long median = count % 2u ? values[count / 2u] : (values[count / 2u - 1u] + values[count / 2u]) / 2;
+            fprintf(output, "{ \"min\": %lld, \"median\": %lld, \"mean\": %lld, \"max\": %lld }", values.front(), median, sum / static_cast<long long>(count), values.back());
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void PrintScenario(FILE* output, const Scenario& scenario, const bool isLast)
+        {
+            fprintf(output, "    {\n");
+            fprintf(output, "      \"name\": \"%s\",\n", scenario.name);
+            fprintf(output, "      \"samples\": %u,\n", static_cast<unsigned int>(scenario.samples.size()));
+            fprintf(output, "      \"failures\": %u", scenario.failures);
+
+            if (!scenario.samples.empty())
+            {
+                std::vector<long long> values;
+                for (int metric = 0; metric < Metric::Count; ++metric)
+                {
+                    values.clear();
+                    for (const Sample& sample : scenario.samples) values.push_back(sample.metrics[metric]);
+
+                    fprintf(output, ",\n      \"%s\": ", s_metricNames[metric]);
+                    PrintStats(output, values);
+                }
+
+                //deterministic for a given corpus, the last run is representative
+                fprintf(output, ",\n      \"roots\": %lld,\n      \"nodes\": %lld", scenario.samples.back().roots, scenario.samples.back().nodes);
+            }
+
+            fprintf(output, "\n    }%s\n", isLast ? "" : ",");
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string ToJsonString(const std::string& str)
+        {
+            std::string ret;
+            for (const char c : str)
+            {
+                if (c == '"' || c == '\\') ret += '\\';
+                ret += c;
+            }
+            return ret;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Run(FILE* output, const Settings& settings)
+    {
+        Corpus corpus;
+        if (!Helpers::LoadCorpus(corpus, settings.corpus))
+        {
+            return false;
+        }
+
+        std::vector<Scenario> scenarios;
+
+        //single location queries, the editor use case: parse plus lookup dominate
+        const size_t numLocations = settings.locations == 0u ? corpus.locations.size() : std::min<size_t>(settings.locations, corpus.locations.size());
+        if (numLocations > 0u)
+        {
+            scenarios.emplace_back("location");
+            Scenario& scenario = scenarios.back();
+
+            for (size_t i = 0u; i < numLocations; ++i)
+            {
+                const Location& location = corpus.locations[i];
+                const std::string arguments = "-r=" + std::to_string(location.row) + " -c=" + std::to_string(location.col);
+
+                LOG_PROGRESS("Measuring %s...", location.name.c_str());
+                if (i == 0u)
+                {
+                    Helpers::Invoke(scenario, settings, corpus, arguments, false);
+                }
+
+                for (unsigned int run = 0u; run < settings.runs; ++run)
+                {
+                    Helpers::Invoke(scenario, settings, corpus, arguments, true);
+                }
+            }
+        }
+
+        //whole corpus export: compute, post processing and serialization dominate
+        if (settings.exportAll)
+        {
+            scenarios.emplace_back("all");
+            Scenario& scenario = scenarios.back();
+            const std::string arguments = "-all -fileFilter=BenchHeader";
+
+            LOG_PROGRESS("Measuring the whole corpus export...");
+            Helpers::Invoke(scenario, settings, corpus, arguments, false);
+            for (unsigned int run = 0u; run < settings.runs; ++run)
+            {
+                Helpers::Invoke(scenario, settings, corpus, arguments, true);
+            }
+        }
+
+        fprintf(output, "{\n");
+        fprintf(output, "  \"corpus\": \"%s\",\n", Helpers::ToJsonString(corpus.directory.generic_string()).c_str());
+        fprintf(output, "  \"settings\": \"%s\",\n", Helpers::ToJsonString(corpus.description).c_str());
+        fprintf(output, "  \"arguments\": \"%s\",\n", Helpers::ToJsonString(settings.extraArgs ? settings.extraArgs : "").c_str());
+        fprintf(output, "  \"runs\": %u,\n", settings.runs);
+        fprintf(output, "  \"unit\": \"us\",\n");
+        fprintf(output, "  \"scenarios\": [\n");
+        for (size_t i = 0u; i < scenarios.size(); ++i)
+        {
+            Helpers::PrintScenario(output, scenarios[i], i + 1u == scenarios.size());
+        }
+        fprintf(output, "  ]\n");
+        fprintf(output, "}\n");
+
+        for (const Scenario& scenario : scenarios)
+        {
+            if (scenario.failures > 0u || scenario.samples.empty())
+            {
+                LOG_ERROR("Scenario '%s' had failing parser invocations.", scenario.name);
+                return false;
+            }
+        }
+        return true;
+    }
+}
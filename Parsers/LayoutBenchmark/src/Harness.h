@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+
+namespace Harness
+{ 
+    struct Settings
+    { 
+        Settings();
+
+        const char*  corpus;     // directory written by the generator
+        const char*  parser;     // ClangLayout executable
+        const char*  extraArgs;  // appended to every parser invocation, e.g. "-fast"
+        unsigned int runs;       // measured invocations per scenario and location
+        unsigned int locations;  // probes queried by the lookup scenario, 0 for all of them
+        bool         exportAll;  // also measure a -all export of the whole corpus
+    };
+
+    // Runs the parser over the generated corpus and prints, as JSON, the min, median, mean and max of the time
+    // spent in each phase (parse, lookup, compute, postprocess, write) and of the whole invocation, in microseconds.
+    bool Run(FILE* output, const Settings& settings);
+}
@@ -0,0 +1,43 @@
+#include <cstdio>
+
+#include "IO.h"
+#include "Platform.h"
+
+#include "CommandLine.h"
+#include "Generator.h"
+#include "Harness.h"
+
+constexpr int FAILURE = -1;
+constexpr int SUCCESS = 0;
+
+// -----------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    //Parse Command Line arguments
+    BenchmarkParams params;
+    if (CommandLine::Parse(params, argc, argv) != 0)
+    {
+        return FAILURE;
+    }
+
+    if (params.command == Command::Generate)
+    { 
+        return Generator::Generate(params.harness.corpus, params.generator) ? SUCCESS : FAILURE;
+    }
+
+    FILE* output = stdout;
+    if (params.output && fopen_s(&output, params.output, "w"))
+    { 
+        LOG_ERROR("Unable to open %s for writing.", params.output);
+        return FAILURE;
+    }
+
+    const bool result = Harness::Run(output, params.harness);
+
+    if (output != stdout)
+    { 
+        fclose(output);
+    }
+
+    return result ? SUCCESS : FAILURE;
+}
\ No newline at end of file
@@ -6,7 +6,15 @@ ExportParams::ExportParams()
     : input(nullptr)
     , output(L"tempResult.slbin")
     , locationFile(nullptr)
+    , trace(nullptr)
+    , typeName(nullptr)
     , locationLine(0)
+#ifdef _WIN32
+    , native(false)
+#else
+    , native(true)
+#endif
+    , server(false)
 {}
 
 namespace CommandLine
@@ -59,6 +67,10 @@ namespace CommandLine
         LOG_ALWAYS("-output         (-o)  : The output file path for the results ('%s' by default)",defaultParams.output); 
         LOG_ALWAYS("-locationFile   (-lf) : The source file path where the symbol is located.");
         LOG_ALWAYS("-locationRow    (-lr) : The source file line within the given 'locationFile' where the symbol is located.");
+        LOG_ALWAYS("-typeName       (-tn) : The qualified name of the type to extract, instead of a location.");
+        LOG_ALWAYS("-native         (-n)  : Reads the pdb streams directly instead of using DIA, available on every platform (always on outside Windows)");
+        LOG_ALWAYS("-server         (-s)  : Stays alive answering requests from stdin, one per line with the -i/-lf/-lr/-tn/-o arguments, the pdb stays loaded until it changes on disk");
+        LOG_ALWAYS("-trace          (-t)  : Writes a Chrome trace event file of the export phases and prints the time per phase and the counters");
         LOG_ALWAYS("-verbosity      (-v)  : Sets the verbosity level - example: '-v 1'"); 
     }
 
@@ -112,6 +124,24 @@ namespace CommandLine
                         params.locationLine = value;
                     }
                 }
+                else if ((Utils::StringCompare(argValue, L"-tn") == 0 || Utils::StringCompare(argValue, L"-typeName") == 0) && (i + 1) < argc)
+                {
+                    ++i;
+                    params.typeName = argv[i];
+                }
+                else if (Utils::StringCompare(argValue, L"-n") == 0 || Utils::StringCompare(argValue, L"-native") == 0)
+                {
+                    params.native = true;
+                }
+                else if (Utils::StringCompare(argValue, L"-s") == 0 || Utils::StringCompare(argValue, L"-server") == 0)
+                {
+                    params.server = true;
+                }
+                else if ((Utils::StringCompare(argValue, L"-t") == 0 || Utils::StringCompare(argValue, L"-trace") == 0) && (i + 1) < argc)
+                {
+                    ++i;
+                    params.trace = argv[i];
+                }
                 else if ((Utils::StringCompare(argValue,L"-v")==0 || Utils::StringCompare(argValue,L"-verbosity")==0) && (i+1) < argc)
                 {
                     ++i;
@@ -7,7 +7,11 @@ struct ExportParams
     const wchar_t*  input; 
     const wchar_t*  output;
     const wchar_t*  locationFile;
+    const wchar_t*  trace;
+    const wchar_t*  typeName;
     unsigned int    locationLine; 
+    bool            native;
+    bool            server;
 };
 
 namespace CommandLine
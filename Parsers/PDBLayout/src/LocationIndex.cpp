@@ -0,0 +1,389 @@
+#include "LocationIndex.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "IO.h"
+#include "Platform.h"
+
+namespace PDB
+{
+    namespace IndexFormat
+    {
+        // File layout, little endian:
+        //   Header  : IndexHeader
+        //   Files   : numFiles x (name offset, first entry, entry count), sorted by name
+        //   Entries : numEntries x (line, id), grouped by file and sorted by line keeping the pdb order on ties
+        //   Strings : the normalized filenames, each one followed by a null terminator
+        constexpr uint32_t MAGIC   = 0x58494c53u; // "SLIX"
+        constexpr uint32_t VERSION = 1u;
+
+        struct IndexHeader
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint8_t  guid[16];
+            uint32_t age;
+            uint32_t idKind;
+            uint32_t numFiles;
+            uint32_t numEntries;
+            uint32_t stringsSize;
+            uint32_t padding;
+        };
+        static_assert(sizeof(IndexHeader) == 48, "Location index header size mismatch");
+
+        constexpr uint32_t FILE_WORDS  = 3u;
+        constexpr uint32_t ENTRY_WORDS = 2u;
+    }
+
+    namespace Helpers
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        // Same equivalence as the location compares of the readers: both separators match each other
+        std::string NormalizeFilename(const char* filename)
+        {
+            std::string ret(filename ? filename : "");
+            std::replace(ret.begin(), ret.end(), '\\', '/');
+            return ret;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    std::string GetLocationIndexPath(const char* pdbFile)
+    {
+        return std::string(pdbFile) + ".slidx";
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // ----------------------------------------------------------------------------------------------------------
+    void LocationIndexBuilder::Add(const char* filename, const uint32_t line, const uint32_t id)
+    {
+        const auto inserted = m_fileIds.emplace(Helpers::NormalizeFilename(filename), static_cast<uint32_t>(m_files.size()));
+        if (inserted.second)
+        {
+            m_files.push_back(inserted.first->first);
+        }
+
+        m_entries.push_back({ inserted.first->second, line, id });
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool LocationIndexBuilder::Write(const char* filename, const IndexKey& key) const
+    {
+        std::vector<uint32_t> fileOrder(m_files.size());
+        for (uint32_t i = 0u; i < fileOrder.size(); ++i)
+        {
+            fileOrder[i] = i;
+        }
+        std::sort(fileOrder.begin(), fileOrder.end(), [&](const uint32_t a, const uint32_t b) { return m_files[a] < m_files[b]; });
+
+        std::vector<uint32_t> fileRank(m_files.size());
+        for (uint32_t i = 0u; i < fileOrder.size(); ++i)
+        {
+            fileRank[fileOrder[i]] = i;
+        }
+
+        //stable so the first type found at a location in the pdb stays the answer, like the sequential walks
+        std::vector<Entry> entries = m_entries;
+        std::stable_sort(entries.begin(), entries.end(), [&](const Entry& a, const Entry& b)
+        {
+            return fileRank[a.file] != fileRank[b.file] ? fileRank[a.file] < fileRank[b.file] : a.line < b.line;
+        });
+
+        std::vector<uint32_t> files;
+        std::vector<char> strings;
+        files.reserve(fileOrder.size() * IndexFormat::FILE_WORDS);
+        uint32_t firstEntry = 0u;
+        for (const uint32_t file : fileOrder)
+        {
+            uint32_t numEntries = 0u;
+            while (firstEntry + numEntries < entries.size() && entries[firstEntry + numEntries].file == file)
+            {
+                ++numEntries;
+            }
+
+            files.push_back(static_cast<uint32_t>(strings.size()));
+            files.push_back(firstEntry);
+            files.push_back(numEntries);
+            strings.insert(strings.end(), m_files[file].c_str(), m_files[file].c_str() + m_files[file].size() + 1u);
+            firstEntry += numEntries;
+        }
+
+        std::vector<uint32_t> entryData;
+        entryData.reserve(entries.size() * IndexFormat::ENTRY_WORDS);
+        for (const Entry& entry : entries)
+        {
+            entryData.push_back(entry.line);
+            entryData.push_back(entry.id);
+        }
+
+        IndexFormat::IndexHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic       = IndexFormat::MAGIC;
+        header.version     = IndexFormat::VERSION;
+        header.age         = key.age;
+        header.idKind      = key.idKind;
+        header.numFiles    = static_cast<uint32_t>(fileOrder.size());
+        header.numEntries  = static_cast<uint32_t>(entries.size());
+        header.stringsSize = static_cast<uint32_t>(strings.size());
+        memcpy(header.guid, key.guid, sizeof(header.guid));
+
+        //written aside and renamed, so a concurrent query never maps a half written index
+        const std::string tempFilename = std::string(filename) + ".tmp";
+        FILE* stream;
+        if (fopen_s(&stream, tempFilename.c_str(), "wb"))
+        {
+            return false;
+        }
+
+        bool written = fwrite(&header, sizeof(header), 1, stream) == 1;
+        written = written && (files.empty() || fwrite(files.data(), files.size() * sizeof(uint32_t), 1, stream) == 1);
+        written = written && (entryData.empty() || fwrite(entryData.data(), entryData.size() * sizeof(uint32_t), 1, stream) == 1);
+        written = written && (strings.empty() || fwrite(strings.data(), strings.size(), 1, stream) == 1);
+        written = fclose(stream) == 0 && written;
+
+        remove(filename);
+        if (!written || rename(tempFilename.c_str(), filename) != 0)
+        {
+            remove(tempFilename.c_str());
+            return false;
+        }
+
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // ----------------------------------------------------------------------------------------------------------
+    LocationIndex::LocationIndex()
+        : m_data(nullptr)
+        , m_size(0u)
+        , m_numFiles(0u)
+        , m_files(nullptr)
+        , m_entries(nullptr)
+        , m_strings(nullptr)
+        , m_stringsSize(0u)
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    LocationIndex::~LocationIndex()
+    {
+        Close();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool LocationIndex::Open(const char* filename, const IndexKey& key)
+    {
+        Close();
+
+        if (!Map(filename))
+        {
+            return false;
+        }
+
+        if (!ReadSections(key))
+        {
+            LOG_INFO("The location index %s is outdated, it will be rebuilt.", filename);
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void LocationIndex::Close()
+    {
+        Unmap();
+        m_numFiles = 0u;
+        m_files = nullptr;
+        m_entries = nullptr;
+        m_strings = nullptr;
+        m_stringsSize = 0u;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    uint32_t LocationIndex::Find(const char* filename, const uint32_t line) const
+    {
+        if (!IsOpen())
+        {
+            return 0u;
+        }
+
+        const std::string location = Helpers::NormalizeFilename(filename);
+
+        uint32_t low = 0u;
+        uint32_t high = m_numFiles;
+        while (low < high)
+        {
+            const uint32_t mid = low + (high - low) / 2u;
+            if (strcmp(m_strings + m_files[mid * IndexFormat::FILE_WORDS], location.c_str()) < 0)
+            {
+                low = mid + 1u;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+
+        if (low == m_numFiles || location != m_strings + m_files[low * IndexFormat::FILE_WORDS])
+        {
+            return 0u;
+        }
+
+        const uint32_t* file = m_files + low * IndexFormat::FILE_WORDS;
+        uint32_t first = file[1];
+        uint32_t count = file[2];
+        while (count > 0u)
+        {
+            const uint32_t step = count / 2u;
+            if (m_entries[(first + step) * IndexFormat::ENTRY_WORDS] < line)
+            {
+                first += step + 1u;
+                count -= step + 1u;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+
+        return first < file[1] + file[2] && m_entries[first * IndexFormat::ENTRY_WORDS] == line ? m_entries[first * IndexFormat::ENTRY_WORDS + 1u] : 0u;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool LocationIndex::ReadSections(const IndexKey& key)
+    {
+        if (m_size < sizeof(IndexFormat::IndexHeader))
+        {
+            return false;
+        }
+
+        IndexFormat::IndexHeader header;
+        memcpy(&header, m_data, sizeof(header));
+        if (header.magic != IndexFormat::MAGIC || header.version != IndexFormat::VERSION || header.age != key.age || header.idKind != key.idKind || memcmp(header.guid, key.guid, sizeof(header.guid)) != 0)
+        {
+            return false;
+        }
+
+        const uint64_t filesSize = static_cast<uint64_t>(header.numFiles) * IndexFormat::FILE_WORDS * sizeof(uint32_t);
+        const uint64_t entriesSize = static_cast<uint64_t>(header.numEntries) * IndexFormat::ENTRY_WORDS * sizeof(uint32_t);
+        if (sizeof(header) + filesSize + entriesSize + header.stringsSize != m_size)
+        {
+            return false;
+        }
+
+        m_numFiles    = header.numFiles;
+        m_files       = reinterpret_cast<const uint32_t*>(m_data + sizeof(header));
+        m_entries     = reinterpret_cast<const uint32_t*>(m_data + sizeof(header) + filesSize);
+        m_strings     = reinterpret_cast<const char*>(m_data + sizeof(header) + filesSize + entriesSize);
+        m_stringsSize = header.stringsSize;
+
+        //the lookups trust the tables from here on
+        if (m_stringsSize > 0u && m_strings[m_stringsSize - 1u] != '\0')
+        {
+            return false;
+        }
+
+        for (uint32_t i = 0u; i < m_numFiles; ++i)
+        {
+            const uint32_t* file = m_files + i * IndexFormat::FILE_WORDS;
+            if (file[0] >= m_stringsSize || file[1] > header.numEntries || file[2] > header.numEntries - file[1])
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+#ifdef _WIN32
+    // ----------------------------------------------------------------------------------------------------------
+    bool LocationIndex::Map(const char* filename)
+    {
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+        //the view keeps the mapping alive
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+
+        if (view == nullptr)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<size_t>(size.QuadPart);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void LocationIndex::Unmap()
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#else
+    // ----------------------------------------------------------------------------------------------------------
+    bool LocationIndex::Map(const char* filename)
+    {
+        const int file = open(filename, O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        void* view = fstat(file, &info) == 0 && info.st_size > 0 ? mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+
+        //the mapping keeps the file alive
+        close(file);
+
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<size_t>(info.st_size);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void LocationIndex::Unmap()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#endif
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PDB
+{
+    namespace IndexIdKind
+    {
+        enum : uint32_t
+        {
+            DIASymbol = 1u, // DIA symbol index ids
+            TypeIndex = 2u, // TPI type indices read natively
+        };
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Identity of the pdb an index was built from: a relink writes a new guid or bumps the age
+    struct IndexKey
+    {
+        uint8_t  guid[16];
+        uint32_t age;
+        uint32_t idKind;
+    };
+
+    std::string GetLocationIndexPath(const char* pdbFile); // sidecar file next to the pdb
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Gathers the definition location of every type of a pdb to write them as a location index
+    class LocationIndexBuilder
+    {
+    public:
+        void     Add(const char* filename, const uint32_t line, const uint32_t id);
+        bool     Write(const char* filename, const IndexKey& key) const;
+        uint32_t GetNumEntries() const { return static_cast<uint32_t>(m_entries.size()); }
+
+    private:
+        struct Entry
+        {
+            uint32_t file;
+            uint32_t line;
+            uint32_t id;
+        };
+
+        std::unordered_map<std::string, uint32_t> m_fileIds;
+        std::vector<std::string>                  m_files;
+        std::vector<Entry>                        m_entries;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Memory mapped (filename, line) -> type id sidecar. Files are sorted by normalized name and their entries by line,
+    // so a query costs two binary searches and touches a handful of pages no matter the size of the pdb.
+    class LocationIndex
+    {
+    public:
+        LocationIndex();
+        ~LocationIndex();
+
+        LocationIndex(const LocationIndex&) = delete;
+        LocationIndex& operator=(const LocationIndex&) = delete;
+
+        bool Open(const char* filename, const IndexKey& key); // false when missing, corrupt or built from another pdb
+        void Close();
+        bool IsOpen() const { return m_data != nullptr; }
+
+        uint32_t Find(const char* filename, const uint32_t line) const; // first type defined at the location, 0 when missing
+
+    private:
+        bool Map(const char* filename);
+        void Unmap();
+        bool ReadSections(const IndexKey& key);
+
+    private:
+        const uint8_t*  m_data;
+        size_t          m_size;
+        uint32_t        m_numFiles;
+        const uint32_t* m_files;   // name offset, first entry and entry count per file
+        const uint32_t* m_entries; // line and id per entry
+        const char*     m_strings;
+        uint32_t        m_stringsSize;
+    };
+}
@@ -0,0 +1,318 @@
+#include "MSFFile.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "IO.h"
+
+namespace PDB
+{
+    namespace MSF
+    {
+        constexpr char     MAGIC[]         = "Microsoft C/C++ MSF 7.00\r\n\x1a" "DS\0\0";
+        constexpr size_t   MAGIC_SIZE      = 32u;
+        constexpr size_t   SUPERBLOCK_SIZE = MAGIC_SIZE + 6u * sizeof(uint32_t);
+        constexpr uint32_t NIL_STREAM_SIZE = 0xffffffffu;
+
+        // ----------------------------------------------------------------------------------------------------------
+        uint32_t ReadU32(const uint8_t* data)
+        {
+            uint32_t ret;
+            memcpy(&ret, data, sizeof(ret));
+            return ret;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        uint32_t GetNumBlocks(const uint32_t size, const uint32_t blockSize)
+        {
+            return size == NIL_STREAM_SIZE ? 0u : static_cast<uint32_t>((static_cast<uint64_t>(size) + blockSize - 1u) / blockSize);
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    Stream::Stream(const MSFFile* file, const uint32_t* blocks, const uint32_t size)
+        : m_file(file)
+        , m_blocks(blocks)
+        , m_size(size)
+        , m_isContiguous(true)
+    {
+        //linkers usually write each stream in consecutive blocks, in that case the whole stream is a direct view
+        const uint32_t numBlocks = MSF::GetNumBlocks(size, file->m_blockSize);
+        for (uint32_t i = 1u; i < numBlocks && m_isContiguous; ++i)
+        {
+            m_isContiguous = blocks[i] == blocks[i - 1] + 1u;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Stream::Read(const uint32_t offset, const uint32_t size, void* output) const
+    {
+        if (m_file == nullptr || offset > m_size || size > m_size - offset)
+        {
+            return false;
+        }
+
+        const uint32_t blockSize = m_file->m_blockSize;
+        uint8_t* dst = static_cast<uint8_t*>(output);
+        uint32_t done = 0u;
+        while (done < size)
+        {
+            const uint32_t position = offset + done;
+            const uint32_t inBlock = position % blockSize;
+            const uint32_t chunk = blockSize - inBlock < size - done ? blockSize - inBlock : size - done;
+            memcpy(dst + done, m_file->m_data + static_cast<uint64_t>(m_blocks[position / blockSize]) * blockSize + inBlock, chunk);
+            done += chunk;
+        }
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const uint8_t* Stream::View(const uint32_t offset, const uint32_t size, std::vector<uint8_t>& scratch) const
+    {
+        if (m_file == nullptr || offset > m_size || size > m_size - offset)
+        {
+            return nullptr;
+        }
+
+        const uint32_t blockSize = m_file->m_blockSize;
+        const uint32_t first = offset / blockSize;
+        const uint8_t* start = m_file->m_data + static_cast<uint64_t>(m_blocks[first]) * blockSize + offset % blockSize;
+        if (m_isContiguous || size == 0u)
+        {
+            return start;
+        }
+
+        const uint32_t last = (offset + size - 1u) / blockSize;
+        bool isContiguous = true;
+        for (uint32_t i = first + 1u; i <= last && isContiguous; ++i)
+        {
+            isContiguous = m_blocks[i] == m_blocks[i - 1] + 1u;
+        }
+
+        if (isContiguous)
+        {
+            return start;
+        }
+
+        scratch.resize(size);
+        return Read(offset, size, scratch.data()) ? scratch.data() : nullptr;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // ----------------------------------------------------------------------------------------------------------
+    MSFFile::MSFFile()
+        : m_data(nullptr)
+        , m_size(0u)
+        , m_blockSize(0u)
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    MSFFile::~MSFFile()
+    {
+        Close();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool MSFFile::Open(const char* filename)
+    {
+        Close();
+
+        if (!Map(filename))
+        {
+            LOG_ERROR("Unable to open the file %s.", filename);
+            return false;
+        }
+
+        if (!ReadDirectory())
+        {
+            LOG_ERROR("The file %s is not a valid MSF 7.0 program database.", filename);
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void MSFFile::Close()
+    {
+        Unmap();
+        m_blockSize = 0u;
+        m_streamSizes.clear();
+        m_streamBlocks.clear();
+        m_blocks.clear();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    Stream MSFFile::GetStream(const uint32_t index) const
+    {
+        if (index >= m_streamSizes.size())
+        {
+            return Stream();
+        }
+
+        const uint32_t size = m_streamSizes[index];
+        return Stream(this, m_blocks.data() + m_streamBlocks[index], size == MSF::NIL_STREAM_SIZE ? 0u : size);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool MSFFile::ReadDirectory()
+    {
+        if (m_size < MSF::SUPERBLOCK_SIZE || memcmp(m_data, MSF::MAGIC, MSF::MAGIC_SIZE) != 0)
+        {
+            return false;
+        }
+
+        const uint8_t* superBlock = m_data + MSF::MAGIC_SIZE;
+        m_blockSize = MSF::ReadU32(superBlock);
+        const uint32_t numBlocks      = MSF::ReadU32(superBlock + 8);
+        const uint32_t directoryBytes = MSF::ReadU32(superBlock + 12);
+        const uint32_t blockMapAddr   = MSF::ReadU32(superBlock + 20);
+
+        if ((m_blockSize != 512u && m_blockSize != 1024u && m_blockSize != 2048u && m_blockSize != 4096u) || static_cast<uint64_t>(numBlocks) * m_blockSize > m_size)
+        {
+            return false;
+        }
+
+        //the block map lists the blocks holding the stream directory
+        const uint32_t directoryBlocks = MSF::GetNumBlocks(directoryBytes, m_blockSize);
+        if (blockMapAddr >= numBlocks || directoryBlocks == 0u || directoryBlocks > m_blockSize / sizeof(uint32_t))
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> directory(static_cast<size_t>(directoryBlocks) * m_blockSize);
+        const uint8_t* blockMap = m_data + static_cast<uint64_t>(blockMapAddr) * m_blockSize;
+        for (uint32_t i = 0u; i < directoryBlocks; ++i)
+        {
+            const uint32_t block = MSF::ReadU32(blockMap + i * sizeof(uint32_t));
+            if (block >= numBlocks)
+            {
+                return false;
+            }
+            memcpy(directory.data() + static_cast<size_t>(i) * m_blockSize, m_data + static_cast<uint64_t>(block) * m_blockSize, m_blockSize);
+        }
+
+        //directory: stream count, stream sizes and then the block list of every stream
+        const uint32_t numStreams = MSF::ReadU32(directory.data());
+        if ((static_cast<uint64_t>(numStreams) + 1u) * sizeof(uint32_t) > directoryBytes)
+        {
+            return false;
+        }
+
+        m_streamSizes.resize(numStreams);
+        m_streamBlocks.resize(numStreams);
+        uint32_t totalBlocks = 0u;
+        for (uint32_t i = 0u; i < numStreams; ++i)
+        {
+            m_streamSizes[i] = MSF::ReadU32(directory.data() + (i + 1u) * sizeof(uint32_t));
+            m_streamBlocks[i] = totalBlocks;
+            totalBlocks += MSF::GetNumBlocks(m_streamSizes[i], m_blockSize);
+        }
+
+        const uint64_t blocksOffset = (static_cast<uint64_t>(numStreams) + 1u) * sizeof(uint32_t);
+        if (blocksOffset + static_cast<uint64_t>(totalBlocks) * sizeof(uint32_t) > directoryBytes)
+        {
+            return false;
+        }
+
+        m_blocks.resize(totalBlocks);
+        memcpy(m_blocks.data(), directory.data() + blocksOffset, static_cast<size_t>(totalBlocks) * sizeof(uint32_t));
+        for (const uint32_t block : m_blocks)
+        {
+            if (block >= numBlocks)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+#ifdef _WIN32
+    // ----------------------------------------------------------------------------------------------------------
+    bool MSFFile::Map(const char* filename)
+    {
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+        //the view keeps the mapping alive
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+
+        if (view == nullptr)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<size_t>(size.QuadPart);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void MSFFile::Unmap()
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#else
+    // ----------------------------------------------------------------------------------------------------------
+    bool MSFFile::Map(const char* filename)
+    {
+        const int file = open(filename, O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        void* view = fstat(file, &info) == 0 && info.st_size > 0 ? mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+
+        //the mapping keeps the file alive
+        close(file);
+
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const uint8_t*>(view);
+        m_size = static_cast<size_t>(info.st_size);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void MSFFile::Unmap()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#endif
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PDB
+{
+    class MSFFile;
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Byte range of a stream scattered over the file blocks. Views of ranges lying in consecutive blocks point straight
+    // into the mapping, the others are gathered into the caller scratch buffer.
+    class Stream
+    {
+    public:
+        Stream()
+            : m_file(nullptr)
+            , m_blocks(nullptr)
+            , m_size(0u)
+            , m_isContiguous(false)
+        {}
+
+        Stream(const MSFFile* file, const uint32_t* blocks, const uint32_t size);
+
+        explicit operator bool() const { return m_file != nullptr; }
+
+        uint32_t       GetSize() const { return m_size; }
+        bool           Read(const uint32_t offset, const uint32_t size, void* output) const;
+        const uint8_t* View(const uint32_t offset, const uint32_t size, std::vector<uint8_t>& scratch) const; // null when out of bounds
+
+        template<typename T> bool Read(const uint32_t offset, T& output) const { return Read(offset, sizeof(T), &output); }
+
+    private:
+        const MSFFile*  m_file;
+        const uint32_t* m_blocks;
+        uint32_t        m_size;
+        bool            m_isContiguous;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Memory mapped Multi-Stream Format container, the file layout of the PDBs. Opening reads the superblock and the
+    // stream directory, the streams themselves are only touched when read.
+    class MSFFile
+    {
+        friend class Stream;
+
+    public:
+        MSFFile();
+        ~MSFFile();
+
+        MSFFile(const MSFFile&) = delete;
+        MSFFile& operator=(const MSFFile&) = delete;
+
+        bool Open(const char* filename);
+        void Close();
+        bool IsOpen() const { return m_data != nullptr; }
+
+        uint32_t GetNumStreams() const { return static_cast<uint32_t>(m_streamSizes.size()); }
+        Stream   GetStream(const uint32_t index) const; // empty stream when missing
+
+    private:
+        bool Map(const char* filename);
+        void Unmap();
+        bool ReadDirectory();
+
+    private:
+        const uint8_t*        m_data;
+        size_t                m_size;
+        uint32_t              m_blockSize;
+        std::vector<uint32_t> m_streamSizes;
+        std::vector<uint32_t> m_streamBlocks; // offset of each stream block list in m_blocks
+        std::vector<uint32_t> m_blocks;
+    };
+}
@@ -0,0 +1,1161 @@
+#include "NativeReader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "IO.h"
+#include "LayoutDefinitions.h"
+#include "LayoutPostProcess.h"
+#include "Trace.h"
+
+#include "LocationIndex.h"
+#include "PDBFile.h"
+
+// Same layout reconstruction as the DIA based PDBReader, reading the type records straight from the TPI stream.
+// Types are reached through their index and forward references through the TPI hash buckets, and the location
+// queries only walk the IPI source line records, so a query never enumerates every user defined type.
+
+namespace NativeReader
+{
+    // nested bases and members computed at once, deeper chains fail the export instead of overflowing the stack
+    constexpr unsigned int MAX_TYPE_DEPTH = 16384u;
+
+    // types without a layout, the exports skip them
+    constexpr Layout::TIndex NO_NODE = 0xFFFFFFFF;
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        template<typename T> T Min(T a, T b) { return a > b ? b : a; }
+        template<typename T> T Max(T a, T b) { return a > b ? a : b; }
+
+        // -----------------------------------------------------------------------------------------------------------
+        template<typename T>
+        unsigned GetTrailingZeroes(T x)
+        {
+            if (x == 0)
+            {
+                return sizeof(T) * 8;
+            }
+            unsigned bits = 0;
+            for (; (x & 1) == 0; ++bits, x >>= 1) {}
+            return bits;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool SameFilename(const char* a, const char* b)
+        {
+            if (a && b)
+            {
+                for (; *a != '\0' && (*a == *b || (*a == '/' && *b == '\\') || (*a == '\\' && *b == '/')); ++a, ++b) {}
+                return *a == '\0' && *b == '\0';
+            }
+            return false;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        std::string wchar2string(const wchar_t* str)
+        {
+            std::string ret;
+            if (str)
+            {
+                while (*str) { ret += (char)*str++; }
+            }
+            return  ret;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool IsLayoutFreeAt(const Layout::Store& store, const Layout::FlatNode& node, const Layout::TIndices& children, Layout::TAmount offset, Layout::TAmount offsetEnd)
+        {
+            if (node.size < offsetEnd)
+            {
+                return false;
+            }
+
+            for (const Layout::TIndex child : children)
+            {
+                const Layout::FlatNode& childNode = store.nodes[child];
+                Layout::TAmount childEnd = (childNode.offset + childNode.size);
+                if ((offset >= childNode.offset && offset < childEnd) ||
+                    (offsetEnd > childNode.offset && offsetEnd <= childEnd))
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        Layout::TAmount AlignOffsetTo(Layout::TAmount offset, Layout::TAmount alignment)
+        {
+            const unsigned int bits = GetTrailingZeroes(alignment);
+            return ((offset + (alignment - 1)) >> bits) << bits;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Type computed once per session, every use gets a copy sharing the prototype children
+    struct TypePrototype
+    {
+        Layout::TIndex   node;         // base class subobject, without its virtual bases
+        Layout::TIndices virtualBases; // all the virtual bases found below the type, in placement order
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    struct SessionContext
+    {
+        PDB::PDBFile    pdb;
+        Layout::TAmount pointerSize = 8;
+        std::string     indexPath;
+
+        mutable Layout::Store                               store;     // the prototypes, followed by the copies of the current export
+        mutable std::unordered_map<uint32_t, TypePrototype> typeMemo;  // by type index
+        mutable size_t                                      exportNodes = 0u;
+        mutable size_t                                      exportChildren = 0u;
+        mutable unsigned int                                typeDepth = 0u;
+        mutable bool                                        typeTooDeep = false;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool OpenPDBSession(SessionContext& context, const wchar_t* filename)
+    {
+        TRACE_SCOPE("OpenPDBSession");
+
+        if (!context.pdb.Open(Helpers::wchar2string(filename).c_str()))
+        {
+            LOG_ERROR("Failed to load the pdb file.");
+            return false;
+        }
+
+        context.pointerSize = context.pdb.GetPointerSize();
+        context.indexPath = PDB::GetLocationIndexPath(Helpers::wchar2string(filename).c_str());
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // -----------------------------------------------------------------------------------------------------------
+    // The DIA symbol tags relevant for the layout, modifiers are folded into the type they modify
+    enum class TypeTag
+    {
+        None,
+        BaseType,
+        PointerType,
+        ArrayType,
+        UDT,
+        Enum,
+        Bitfield,
+        VTableShape,
+    };
+
+    namespace Modifiers
+    {
+        enum : uint16_t
+        {
+            Const     = 0x1,
+            Volatile  = 0x2,
+            Unaligned = 0x4,
+        };
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    struct TypeInfo
+    {
+        TypeTag         tag         = TypeTag::None;
+        Layout::TAmount length      = 0;
+        uint32_t        inner       = 0;     // pointee, array element, enum or bitfield underlying type
+        uint32_t        simpleKind  = 0;     // base types
+        uint32_t        fieldList   = 0;     // user defined types
+        uint16_t        modifiers   = 0;
+        bool            isReference = false;
+        bool            isUnion     = false;
+        Layout::TAmount bitPosition = 0;
+        Layout::TAmount bitLength   = 0;
+        std::string     name;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Simple types encode their kind in the low byte and their pointer mode in the next nibble
+    Layout::TAmount GetSimpleTypeSize(const uint32_t kind)
+    {
+        switch (kind)
+        {
+        case 0x10: case 0x20: case 0x30: case 0x68: case 0x69: case 0x70: case 0x7c: return 1;
+        case 0x11: case 0x21: case 0x31: case 0x46: case 0x71: case 0x72: case 0x73: case 0x7a: return 2;
+        case 0x08: case 0x12: case 0x22: case 0x32: case 0x40: case 0x74: case 0x75: case 0x7b: return 4;
+        case 0x13: case 0x23: case 0x33: case 0x41: case 0x76: case 0x77: return 8;
+        case 0x42: return 10;
+        case 0x14: case 0x24: case 0x78: case 0x79: return 16;
+        default: return 0;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    const char* GetSimpleTypeName(const uint32_t kind)
+    {
+        switch (kind)
+        {
+        case 0x00: return "";
+        case 0x03: return "void";
+        case 0x08: return "HRESULT";
+        case 0x10: case 0x70: return "char";
+        case 0x71: return "wchar_t";
+        case 0x68: return "int8";
+        case 0x20: case 0x69: return "uint8";
+        case 0x11: case 0x72: return "int16";
+        case 0x21: case 0x73: return "uint16";
+        case 0x74: return "int32";
+        case 0x75: return "uint32";
+        case 0x13: case 0x76: return "int64";
+        case 0x23: case 0x77: return "uint64";
+        case 0x14: case 0x78: return "int128";
+        case 0x24: case 0x79: return "uint128";
+        case 0x12: return "long";
+        case 0x22: return "unsigned long";
+        case 0x46: return "half";
+        case 0x40: return "float";
+        case 0x41: return "double";
+        case 0x42: return "float???";
+        case 0x30: case 0x31: case 0x32: case 0x33: return "bool";
+        case 0x7a: return "char16_t";
+        case 0x7b: return "char32_t";
+        case 0x7c: return "char8_t";
+        default: return "???";
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TAmount GetSimplePointerSize(const uint32_t mode)
+    {
+        switch (mode)
+        {
+        case 1: return 2;  //near 16
+        case 2:
+        case 3:            //far and huge 16
+        case 4: return 4;  //near 32
+        case 5: return 6;  //far 32
+        case 6: return 8;  //near 64
+        case 7: return 16; //near 128
+        default: return 0;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool GetTypeInfo(const SessionContext& context, const uint32_t typeIndex, TypeInfo& info)
+    {
+        info = TypeInfo();
+
+        if (typeIndex < PDB::FIRST_TYPE_INDEX)
+        {
+            const uint32_t mode = (typeIndex >> 8) & 0xf;
+            info.simpleKind = typeIndex & 0xff;
+            if (mode != 0)
+            {
+                info.tag    = TypeTag::PointerType;
+                info.length = GetSimplePointerSize(mode);
+                info.inner  = typeIndex & 0xff;
+            }
+            else
+            {
+                info.tag    = TypeTag::BaseType;
+                info.length = GetSimpleTypeSize(info.simpleKind);
+            }
+            return typeIndex != 0;
+        }
+
+        PDB::TypeRecord record;
+        if (!context.pdb.GetTypes().GetRecord(typeIndex, record))
+        {
+            return false;
+        }
+
+        PDB::RecordCursor cursor = record.GetCursor();
+        switch (record.kind)
+        {
+        case PDB::Leaf::Modifier:
+        {
+            const uint32_t modified = cursor.Read<uint32_t>();
+            const uint16_t modifiers = cursor.Read<uint16_t>();
+            if (!GetTypeInfo(context, modified, info))
+            {
+                return false;
+            }
+            info.modifiers |= modifiers;
+            return true;
+        }
+        case PDB::Leaf::Pointer:
+        {
+            info.inner = cursor.Read<uint32_t>();
+            const uint32_t attributes = cursor.Read<uint32_t>();
+            const uint32_t mode = (attributes >> 5) & 0x7;
+            const uint32_t size = (attributes >> 13) & 0x3f;
+            info.tag         = TypeTag::PointerType;
+            info.length      = size ? size : context.pointerSize;
+            info.isReference = mode == 1 || mode == 4; //lvalue and rvalue references
+            info.modifiers   = ((attributes >> 10) & 1 ? Modifiers::Const : 0) | ((attributes >> 9) & 1 ? Modifiers::Volatile : 0) | ((attributes >> 11) & 1 ? Modifiers::Unaligned : 0);
+            break;
+        }
+        case PDB::Leaf::Array:
+        {
+            info.inner = cursor.Read<uint32_t>();
+            cursor.Read<uint32_t>(); //index type
+            info.tag    = TypeTag::ArrayType;
+            info.length = cursor.ReadNumeric();
+            break;
+        }
+        case PDB::Leaf::Bitfield:
+        {
+            info.inner = cursor.Read<uint32_t>();
+            info.bitLength   = cursor.Read<uint8_t>();
+            info.bitPosition = cursor.Read<uint8_t>();
+            TypeInfo underlying;
+            GetTypeInfo(context, info.inner, underlying);
+            info.tag    = TypeTag::Bitfield;
+            info.length = underlying.length;
+            break;
+        }
+        case PDB::Leaf::VTableShape:
+        {
+            info.tag = TypeTag::VTableShape;
+            break;
+        }
+        case PDB::Leaf::Class:
+        case PDB::Leaf::Structure:
+        case PDB::Leaf::Interface:
+        case PDB::Leaf::Union:
+        case PDB::Leaf::Enum:
+        {
+            //members usually point to forward references, the definition holds the size and fields
+            const uint32_t definition = context.pdb.ResolveDefinition(typeIndex);
+            if (definition != typeIndex && !context.pdb.GetTypes().GetRecord(definition, record))
+            {
+                return false;
+            }
+
+            PDB::TagRecord tag;
+            if (!PDB::ReadTagRecord(record, tag))
+            {
+                return false;
+            }
+
+            info.name = tag.name;
+            if (tag.kind == PDB::Leaf::Enum)
+            {
+                TypeInfo underlying;
+                GetTypeInfo(context, tag.underlyingType, underlying);
+                info.tag    = TypeTag::Enum;
+                info.inner  = tag.underlyingType;
+                info.length = underlying.length;
+            }
+            else
+            {
+                info.tag       = TypeTag::UDT;
+                info.isUnion   = tag.kind == PDB::Leaf::Union;
+                info.length    = tag.size;
+                info.fieldList = tag.IsForwardReference() ? 0u : tag.fieldList;
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        return !cursor.Failed();
+    }
+
+    std::string GetTypeName(const SessionContext& context, const uint32_t typeIndex);
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::string GetArrayTypeName(const SessionContext& context, const TypeInfo& type)
+    {
+        TypeInfo innerType;
+        GetTypeInfo(context, type.inner, innerType);
+
+        if (!innerType.length)
+        {
+            return "???[]";
+        }
+
+        return GetTypeName(context, type.inner) + '[' + std::to_string(type.length / innerType.length) + ']';
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    std::string GetTypeName(const SessionContext& context, const uint32_t typeIndex)
+    {
+        std::string ret = "";
+
+        TypeInfo type;
+        if (!GetTypeInfo(context, typeIndex, type))
+        {
+            return ret;
+        }
+
+        switch (type.tag)
+        {
+        case TypeTag::UDT:
+        {
+            ret = (type.isUnion ? "union " : "") + type.name;
+        }
+        break;
+        case TypeTag::PointerType:
+        {
+            //nest the inner type
+            ret = GetTypeName(context, type.inner) + (type.isReference ? "&" : "*");
+
+            //add decorations
+            if (type.modifiers & Modifiers::Unaligned)
+            {
+                ret = "__unaligned " + ret;
+            }
+
+            if (type.modifiers & Modifiers::Volatile)
+            {
+                ret = "volatile " + ret;
+            }
+
+            if (type.modifiers & Modifiers::Const)
+            {
+                ret = "const " + ret;
+            }
+        }
+        break;
+        case TypeTag::ArrayType:
+        {
+            ret = GetArrayTypeName(context, type);
+        }
+        break;
+        case TypeTag::Enum:
+        {
+            ret = "enum " + type.name;
+        }
+        break;
+        case TypeTag::BaseType:
+        {
+            ret = GetSimpleTypeName(type.simpleKind);
+        }
+        break;
+        case TypeTag::Bitfield:
+        {
+            ret = GetTypeName(context, type.inner);
+        }
+        break;
+        default:
+            break;
+        }
+
+        return ret;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TAmount GuessAlignment(const SessionContext& context, const Layout::FlatNode& node, const uint32_t typeIndex)
+    {
+        const Layout::TAmount maxOffsetAlign = node.offset == 0 ? 1024 : (1 << Helpers::GetTrailingZeroes(node.offset));
+
+        TypeInfo type;
+        GetTypeInfo(context, typeIndex, type);
+        switch (type.tag)
+        {
+        case TypeTag::UDT:
+        {
+            Layout::TAmount align = 1;
+            for (const Layout::TIndex* child = context.store.ChildrenBegin(node), *end = context.store.ChildrenEnd(node); child != end; ++child)
+            {
+                align = Helpers::Max(align, context.store.nodes[*child].align);
+            }
+            return Helpers::Min(maxOffsetAlign, Helpers::Max(Layout::TAmount(1u), Helpers::Min(align, type.length)));
+        }
+        case TypeTag::ArrayType:
+        case TypeTag::Bitfield:
+            return GuessAlignment(context, node, type.inner);
+
+        case TypeTag::Enum:
+        case TypeTag::BaseType:
+        case TypeTag::PointerType:
+        default:
+        {
+            return Helpers::Min(maxOffsetAlign, Helpers::Max(Layout::TAmount(1u), type.length));
+        }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // -----------------------------------------------------------------------------------------------------------
+    struct FieldInfo
+    {
+        uint16_t        leaf        = 0;
+        uint32_t        type        = 0;
+        Layout::TAmount offset      = 0;
+        Layout::TAmount vbptrOffset = 0;
+        const char*     name        = "";
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Walks the members of a field list and its continuations, only the members taking space are reported
+    template<typename TCallback>
+    void ForEachField(const SessionContext& context, uint32_t fieldList, TCallback callback)
+    {
+        PDB::TypeRecord record;
+        while (fieldList != 0u && context.pdb.GetTypes().GetRecord(fieldList, record) && record.kind == PDB::Leaf::FieldList)
+        {
+            fieldList = 0u;
+
+            PDB::RecordCursor cursor = record.GetCursor();
+            while (!cursor.IsEnd() && !cursor.Failed())
+            {
+                FieldInfo field;
+                field.leaf = cursor.Read<uint16_t>();
+                switch (field.leaf)
+                {
+                case PDB::Leaf::BaseClass:
+                    cursor.Read<uint16_t>(); //attributes
+                    field.type   = cursor.Read<uint32_t>();
+                    field.offset = cursor.ReadNumeric();
+                    callback(field);
+                    break;
+                case PDB::Leaf::VirtualBaseClass:
+                case PDB::Leaf::IndirectVirtualBaseClass:
+                    cursor.Read<uint16_t>(); //attributes
+                    field.type = cursor.Read<uint32_t>();
+                    cursor.Read<uint32_t>(); //virtual base pointer type
+                    field.vbptrOffset = cursor.ReadNumeric();
+                    cursor.ReadNumeric();    //virtual base table index
+                    callback(field);
+                    break;
+                case PDB::Leaf::Member:
+                    cursor.Read<uint16_t>(); //attributes
+                    field.type   = cursor.Read<uint32_t>();
+                    field.offset = cursor.ReadNumeric();
+                    field.name   = cursor.ReadString();
+                    callback(field);
+                    break;
+                case PDB::Leaf::VFunctionTable:
+                    cursor.Read<uint16_t>(); //padding
+                    field.type = cursor.Read<uint32_t>();
+                    callback(field);
+                    break;
+                case PDB::Leaf::StaticMember:
+                case PDB::Leaf::NestedTypeEx:
+                case PDB::Leaf::NestedType:
+                case PDB::Leaf::FriendFunction:
+                    cursor.Read<uint16_t>();
+                    cursor.Read<uint32_t>();
+                    cursor.ReadString();
+                    break;
+                case PDB::Leaf::Method:
+                    cursor.Read<uint16_t>(); //overload count
+                    cursor.Read<uint32_t>(); //method list
+                    cursor.ReadString();
+                    break;
+                case PDB::Leaf::OneMethod:
+                {
+                    const uint16_t attributes = cursor.Read<uint16_t>();
+                    cursor.Read<uint32_t>();
+                    const uint16_t property = (attributes >> 2) & 0x7;
+                    if (property == 4 || property == 6)
+                    {
+                        cursor.Read<uint32_t>(); //introducing virtual functions store their vtable offset
+                    }
+                    cursor.ReadString();
+                    break;
+                }
+                case PDB::Leaf::Enumerate:
+                    cursor.Read<uint16_t>();
+                    cursor.ReadNumeric();
+                    cursor.ReadString();
+                    break;
+                case PDB::Leaf::FriendClass:
+                    cursor.Read<uint16_t>();
+                    cursor.Read<uint32_t>();
+                    break;
+                case PDB::Leaf::VFunctionOffset:
+                    cursor.Read<uint16_t>();
+                    cursor.Read<uint32_t>();
+                    cursor.Read<uint32_t>();
+                    break;
+                case PDB::Leaf::Index:
+                    cursor.Read<uint16_t>();
+                    fieldList = cursor.Read<uint32_t>();
+                    break;
+                default:
+                    LOG_WARNING("Unknown field list member kind 0x%x, the remaining members of the type are skipped.", field.leaf);
+                    return;
+                }
+
+                cursor.SkipPadding();
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    struct TypeContext
+    {
+        Layout::TIndices                   virtualBases;
+        std::unordered_set<Layout::TIndex> virtualBaseTypes; // type string indices
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool HasVirtualBase(const SessionContext& sessionContext, const TypeContext& typeContext, const Layout::TIndex input)
+    {
+        return input != NO_NODE && sessionContext.store.nodes[input].type != 0u && typeContext.virtualBaseTypes.count(sessionContext.store.nodes[input].type) != 0u;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void AddVirtualBase(const SessionContext& sessionContext, TypeContext& typeContext, const Layout::TIndex input)
+    {
+        if (input != NO_NODE && !HasVirtualBase(sessionContext, typeContext, input))
+        {
+            typeContext.virtualBases.emplace_back(input);
+            typeContext.virtualBaseTypes.insert(sessionContext.store.nodes[input].type);
+        }
+        else if (input != NO_NODE && input + 1u == sessionContext.store.nodes.size())
+        {
+            //the context already holds this virtual base, the duplicate was just copied and is not referenced anywhere else
+            sessionContext.store.nodes.pop_back();
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void InjectVBTablePtr(const SessionContext& sessionContext, const Layout::FlatNode& node, Layout::TIndices& children, const Layout::TAmount vbptrOffset)
+    {
+        //the virtual base records give the exact offset, it is only free when this type introduces the pointer
+        if (Helpers::IsLayoutFreeAt(sessionContext.store, node, children, vbptrOffset, vbptrOffset + sessionContext.pointerSize))
+        {
+            //Add the virtual base offset pointer
+            Layout::FlatNode fieldNode;
+            fieldNode.nature = Layout::Category::VBTablePtr;
+            fieldNode.offset = vbptrOffset;
+            fieldNode.size = sessionContext.pointerSize;
+            fieldNode.align = fieldNode.size;
+            const Layout::TIndex fieldIndex = sessionContext.store.AddNode(fieldNode);
+
+            auto placement = children.begin();
+            for (; placement != children.end() && sessionContext.store.nodes[*placement].offset < vbptrOffset; ++placement) {}
+            children.insert(placement, fieldIndex);
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void RemoveVirtualBasesFromNode(const SessionContext& sessionContext, const TypeContext& typeContext, Layout::FlatNode& node, Layout::TIndices& children, const std::unordered_set<Layout::TIndex>& virtualBases, const Layout::TAmount vbptrOffset)
+    {
+        //try to injecet the vbTablePtr
+        if (!virtualBases.empty())
+        {
+            //remove the vbases size from the structure as it is counted as a type but we should only have in on the root node
+            Layout::TAmount vbasesSize = 0u;
+            for (const Layout::TIndex child : typeContext.virtualBases)
+            {
+                //follow the typecontext order, as this dictates the final order in the struct.
+                const Layout::FlatNode& childNode = sessionContext.store.nodes[child];
+                if (virtualBases.count(childNode.type) != 0u)
+                {
+                    vbasesSize = Helpers::AlignOffsetTo(vbasesSize, childNode.align) + childNode.size;
+                }
+            }
+            vbasesSize = Helpers::AlignOffsetTo(vbasesSize, sessionContext.pointerSize);
+            node.size -= vbasesSize;
+
+            //With the new size restriction try to inject the VBTablePtr
+            InjectVBTablePtr(sessionContext, node, children, vbptrOffset);
+        }
+    }
+
+    void FixVirtualBases(const SessionContext& sessionContext, const TypeContext& typeContext, const Layout::TIndex node, const uint32_t typeIndex);
+    Layout::TIndex ComputeTypeRecursive(const SessionContext& sessionContext, TypeContext& typeContext, const uint32_t typeIndex);
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TIndex ComputeTypePrototype(const SessionContext& sessionContext, TypeContext& typeContext, const uint32_t typeIndex)
+    {
+        TypeInfo type;
+        if (!GetTypeInfo(sessionContext, typeIndex, type))
+        {
+            return NO_NODE;
+        }
+
+        Layout::Store& store = sessionContext.store;
+        Layout::FlatNode node;
+        Layout::TIndices children;
+
+        node.type   = store.strings.Intern(GetTypeName(sessionContext, typeIndex));
+        node.size   = type.length;
+
+        std::unordered_set<Layout::TIndex> thisVirtualBases;
+        Layout::TAmount vbptrOffset = 0;
+
+        ForEachField(sessionContext, type.fieldList, [&](const FieldInfo& child)
+        {
+            if (child.leaf == PDB::Leaf::BaseClass || child.leaf == PDB::Leaf::VirtualBaseClass || child.leaf == PDB::Leaf::IndirectVirtualBaseClass)
+            {
+                const Layout::TIndex baseNode = ComputeTypeRecursive(sessionContext, typeContext, child.type);
+                if (baseNode == NO_NODE)
+                {
+                    return;
+                }
+
+                if (child.leaf != PDB::Leaf::BaseClass)
+                {
+                    //virtual base
+                    store.nodes[baseNode].nature = Layout::Category::VBase;
+                    thisVirtualBases.insert(store.nodes[baseNode].type);
+                    AddVirtualBase(sessionContext, typeContext, baseNode);
+                    vbptrOffset = child.vbptrOffset;
+                }
+                else
+                {
+                    //Non virtual base
+                    store.nodes[baseNode].offset = child.offset;
+                    store.nodes[baseNode].nature = Layout::Category::NVBase;
+                    children.emplace_back(baseNode);
+                }
+            }
+            else
+            {
+                TypeInfo childType;
+                GetTypeInfo(sessionContext, child.type, childType);
+
+                if (childType.tag == TypeTag::UDT)
+                {
+                    //complex field, a complete object holding its own virtual bases
+                    TypeContext fieldContext;
+                    const Layout::TIndex fieldIndex = ComputeTypeRecursive(sessionContext, fieldContext, child.type);
+                    if (fieldIndex == NO_NODE)
+                    {
+                        return;
+                    }
+
+                    FixVirtualBases(sessionContext, fieldContext, fieldIndex, child.type);
+                    const Layout::TIndex fieldName = store.strings.Intern(child.name);
+
+                    Layout::FlatNode& fieldNode = store.nodes[fieldIndex];
+                    fieldNode.name = fieldName;
+                    fieldNode.offset = child.offset;
+                    fieldNode.nature = Layout::Category::ComplexField;
+                    fieldNode.align  = GuessAlignment(sessionContext, fieldNode, child.type);
+
+                    children.emplace_back(fieldIndex);
+                }
+                else
+                {
+                    Layout::FlatNode fieldNode;
+
+                    fieldNode.name   = store.strings.Intern(child.name);
+
+                    fieldNode.type   = store.strings.Intern(GetTypeName(sessionContext, child.type));
+                    fieldNode.nature = Layout::Category::SimpleField;
+
+                    fieldNode.offset = child.offset;
+                    fieldNode.size   = childType.length;
+                    fieldNode.align  = GuessAlignment(sessionContext, fieldNode, child.type);
+
+                    if (childType.tag == TypeTag::PointerType)
+                    {
+                        //Check for vtablePtr
+                        TypeInfo ptrType;
+                        GetTypeInfo(sessionContext, childType.inner, ptrType);
+                        if (child.leaf == PDB::Leaf::VFunctionTable || ptrType.tag == TypeTag::VTableShape)
+                        {
+                            fieldNode.type   = store.strings.Intern("");
+                            fieldNode.nature = Layout::Category::VTablePtr;
+                        }
+
+                        fieldNode.align = fieldNode.size;
+                    }
+
+                    if (childType.tag == TypeTag::Bitfield)
+                    {
+                        fieldNode.nature = Layout::Category::Bitfield;
+
+                        Layout::FlatNode extraData;
+                        extraData.offset = childType.bitPosition;
+                        extraData.size = childType.bitLength;
+
+                        const Layout::TIndex extraIndex = store.AddNode(extraData);
+                        const Layout::TIndex fieldIndex = store.AddNode(fieldNode);
+                        store.SetChildren(fieldIndex, &extraIndex, 1u);
+                        children.emplace_back(fieldIndex);
+                    }
+                    else
+                    {
+                        children.emplace_back(store.AddNode(fieldNode));
+                    }
+                }
+            }
+        });
+
+        std::stable_sort(children.begin(), children.end(), [&store](const Layout::TIndex a, const Layout::TIndex b) { return store.nodes[a].offset < store.nodes[b].offset; });
+
+        RemoveVirtualBasesFromNode(sessionContext, typeContext, node, children, thisVirtualBases, vbptrOffset);
+
+        const Layout::TIndex index = store.AddNode(node);
+        store.SetChildren(index, children.data(), static_cast<Layout::TIndex>(children.size()));
+        store.nodes[index].align = GuessAlignment(sessionContext, store.nodes[index], typeIndex);
+        return index;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Bases and members repeat a lot in deep hierarchies: each type is computed once per session in its own context and
+    // every use copies the prototype, replaying the virtual bases it found into the caller context
+    const TypePrototype* AcquirePrototype(const SessionContext& sessionContext, const uint32_t typeIndex)
+    {
+        auto found = sessionContext.typeMemo.find(typeIndex);
+        if (found == sessionContext.typeMemo.end())
+        {
+            if (sessionContext.typeTooDeep || sessionContext.typeDepth >= MAX_TYPE_DEPTH)
+            {
+                if (!sessionContext.typeTooDeep)
+                {
+                    LOG_ERROR("The type nesting goes deeper than %u levels at %s.", MAX_TYPE_DEPTH, GetTypeName(sessionContext, typeIndex).c_str());
+                }
+                sessionContext.typeTooDeep = true;
+                return nullptr;
+            }
+
+            TypeContext prototypeContext;
+            ++sessionContext.typeDepth;
+            const Layout::TIndex prototype = ComputeTypePrototype(sessionContext, prototypeContext, typeIndex);
+            --sessionContext.typeDepth;
+            found = sessionContext.typeMemo.emplace(typeIndex, TypePrototype{ prototype, std::move(prototypeContext.virtualBases) }).first;
+        }
+        else
+        {
+            Trace::AddCounter("typesReused", 1);
+        }
+
+        return &found->second;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TIndex CopyPrototype(const SessionContext& sessionContext, TypeContext& typeContext, const TypePrototype& prototype)
+    {
+        Layout::Store& store = sessionContext.store;
+        for (const Layout::TIndex virtualBase : prototype.virtualBases)
+        {
+            if (!HasVirtualBase(sessionContext, typeContext, virtualBase))
+            {
+                //the root places the virtual bases, each context needs its own copy
+                const Layout::FlatNode copy = store.nodes[virtualBase];
+                AddVirtualBase(sessionContext, typeContext, store.AddNode(copy));
+            }
+        }
+
+        if (prototype.node == NO_NODE)
+        {
+            return NO_NODE;
+        }
+
+        const Layout::FlatNode copy = store.nodes[prototype.node];
+        return store.AddNode(copy);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TIndex ComputeTypeRecursive(const SessionContext& sessionContext, TypeContext& typeContext, const uint32_t typeIndex)
+    {
+        const TypePrototype* prototype = AcquirePrototype(sessionContext, typeIndex);
+        return prototype ? CopyPrototype(sessionContext, typeContext, *prototype) : NO_NODE;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void FixVirtualBases(const SessionContext& sessionContext, const TypeContext& typeContext, const Layout::TIndex node, const uint32_t typeIndex)
+    {
+        if (node != NO_NODE && !typeContext.virtualBases.empty())
+        {
+            Layout::Store& store = sessionContext.store;
+
+            //Add all the found virtual bases at the end of the structure, in a children range of its own as the copy shares the prototype one
+            Layout::TIndices children(store.ChildrenBegin(store.nodes[node]), store.ChildrenEnd(store.nodes[node]));
+            Layout::TAmount size = store.nodes[node].size;
+            for (const Layout::TIndex vb : typeContext.virtualBases)
+            {
+                Layout::FlatNode& vbNode = store.nodes[vb];
+                vbNode.offset = Helpers::AlignOffsetTo(size, vbNode.align);
+                size = vbNode.offset + vbNode.size;
+                children.emplace_back(vb);
+            }
+            size = Helpers::AlignOffsetTo(size, sessionContext.pointerSize);
+            store.SetChildren(node, children.data(), static_cast<Layout::TIndex>(children.size()));
+
+            //restore the OG node size
+            TypeInfo type;
+            GetTypeInfo(sessionContext, typeIndex, type);
+            const Layout::TAmount correctSize = type.length;
+            if (correctSize != size)
+            {
+                LOG_WARNING("Found different struct sizes constructing the virutal bases: got %d and expected %d from the queried type. The layout might have mistakes!", size, correctSize);
+            }
+
+            Layout::FlatNode& fixedNode = store.nodes[node];
+            fixedNode.size = correctSize;
+            fixedNode.align = GuessAlignment(sessionContext, fixedNode, typeIndex); //re-guess alignment as the virtual bases might have changed the overall alignment
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TIndex ComputeType(const SessionContext& context, const uint32_t typeIndex)
+    {
+        TRACE_SCOPE("ComputeType");
+
+        context.typeTooDeep = false;
+        if (typeIndex == 0u)
+        {
+            return NO_NODE;
+        }
+
+        const TypePrototype* prototype = AcquirePrototype(context, typeIndex);
+        if (context.typeTooDeep)
+        {
+            //the prototypes computed on the way miss their deepest members, none can be reused
+            context.store.Clear();
+            context.typeMemo.clear();
+            context.exportNodes = context.exportChildren = 0u;
+            return NO_NODE;
+        }
+
+        //the prototypes stay in the store for the next exports, the copies made from here on are released with the result
+        context.exportNodes = context.store.nodes.size();
+        context.exportChildren = context.store.children.size();
+
+        TypeContext typeContext;
+        const Layout::TIndex node = CopyPrototype(context, typeContext, *prototype);
+        FixVirtualBases(context, typeContext, node, typeIndex);
+        return node;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    PDB::IndexKey GetIndexKey(const SessionContext& context)
+    {
+        PDB::IndexKey key;
+        memcpy(key.guid, context.pdb.GetGuid(), sizeof(key.guid));
+        key.age = context.pdb.GetAge();
+        key.idKind = PDB::IndexIdKind::TypeIndex;
+        return key;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Walks every source line record of the IPI stream once, answering the query and writing the location index
+    uint32_t BuildLocationIndex(const SessionContext& context, const std::string& location, const uint32_t line)
+    {
+        TRACE_SCOPE("BuildLocationIndex");
+
+        //linked pdbs reference the files through the string table, object files through string id records
+        std::unordered_map<uint32_t, std::string> stringIds;
+        PDB::LocationIndexBuilder builder;
+        uint32_t ret = 0u;
+        context.pdb.GetIds().ForEachRecord([&](const uint32_t index, const PDB::TypeRecord& record)
+        {
+            PDB::RecordCursor cursor = record.GetCursor();
+            if (record.kind == PDB::Leaf::StringId)
+            {
+                cursor.Read<uint32_t>(); //substrings
+                stringIds.emplace(index, cursor.ReadString());
+            }
+            else if (record.kind == PDB::Leaf::UdtSourceLine || record.kind == PDB::Leaf::UdtModSourceLine)
+            {
+                const uint32_t udt = cursor.Read<uint32_t>();
+                const uint32_t file = cursor.Read<uint32_t>();
+                const uint32_t lineNumber = cursor.Read<uint32_t>();
+
+                const char* udtFilename = "";
+                if (record.kind == PDB::Leaf::UdtModSourceLine)
+                {
+                    udtFilename = context.pdb.GetString(file);
+                }
+                else
+                {
+                    const auto found = stringIds.find(file);
+                    udtFilename = found != stringIds.end() ? found->second.c_str() : "";
+                }
+
+                builder.Add(udtFilename, lineNumber, udt);
+                if (ret == 0u && lineNumber == line && Helpers::SameFilename(udtFilename, location.c_str()))
+                {
+                    ret = udt;
+                }
+            }
+            return true;
+        });
+
+        Trace::AddCounter("recordsVisited", builder.GetNumEntries());
+
+        if (builder.GetNumEntries() == 0u)
+        {
+            LOG_WARNING("There were no User Defined Type locations found in the input symbol database.");
+        }
+
+        if (!builder.Write(context.indexPath.c_str(), GetIndexKey(context)))
+        {
+            LOG_WARNING("Unable to write the location index %s, the next queries will walk the whole pdb again.", context.indexPath.c_str());
+        }
+
+        return ret;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    uint32_t FindSymbolAtLocation(const SessionContext& context, const wchar_t* filename, const uint32_t line)
+    {
+        TRACE_SCOPE("FindSymbolAtLocation");
+
+        const std::string location = Helpers::wchar2string(filename);
+
+        //type indices are stable for a given guid and age, so an index built from this pdb answers directly
+        PDB::LocationIndex index;
+        if (index.Open(context.indexPath.c_str(), GetIndexKey(context)))
+        {
+            return index.Find(location.c_str(), line);
+        }
+
+        return BuildLocationIndex(context, location, line);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    uint32_t FindSymbolByName(const SessionContext& context, const wchar_t* typeName)
+    {
+        TRACE_SCOPE("FindSymbolByName");
+
+        const uint32_t ret = context.pdb.FindDefinition(Helpers::wchar2string(typeName).c_str());
+        if (ret == 0u)
+        {
+            LOG_WARNING("No type definition named %s found in the input symbol database.", Helpers::wchar2string(typeName).c_str());
+        }
+        return ret;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportResult(const SessionContext& context, const Layout::TIndex node, const size_t numNodes, const wchar_t* outputPath)
+    {
+        Layout::Store& store = context.store;
+        if (node != NO_NODE)
+        {
+            store.roots.push_back(node);
+        }
+
+        if (Trace::IsEnabled())
+        {
+            Trace::AddCounter("nodesCreated", static_cast<long long>(store.nodes.size() - numNodes));
+            Trace::AddCounter("lookupTableFiles", static_cast<long long>(store.files.size()));
+        }
+
+        const std::string outputStr = Helpers::wchar2string(outputPath);
+        const char* outputFileName = outputStr.size() == 0 ? "output.slbin" : outputStr.c_str();
+        Layout::PostProcess(store);
+        return IO::ToFile(store, outputFileName);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // The prototypes stay in the store for the next exports of the session, only the copies made for this result go
+    void ReleaseResult(const SessionContext& context)
+    {
+        context.store.nodes.resize(context.exportNodes);
+        context.store.children.resize(context.exportChildren);
+        context.store.roots.clear();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    SessionContext* OpenSession(const wchar_t* pdbFile)
+    {
+        if (!pdbFile)
+        {
+            LOG_ERROR("No pdb file path provided.");
+            return nullptr;
+        }
+
+        SessionContext* context = new SessionContext();
+        if (!OpenPDBSession(*context, pdbFile))
+        {
+            delete context;
+            return nullptr;
+        }
+        return context;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void CloseSession(SessionContext* context)
+    {
+        delete context;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportAtLocation(SessionContext& context, const wchar_t* filename, const int line, const wchar_t* outputPath, bool& found)
+    {
+        if (!outputPath)
+        {
+            LOG_ERROR("No output file path provided.");
+            return false;
+        }
+
+        if (!filename)
+        {
+            LOG_ERROR("No location file path provided.");
+            return false;
+        }
+
+        TRACE_SCOPE("NativeReader::ExportAtLocation");
+
+        const size_t numNodes = context.store.nodes.size();
+        const Layout::TIndex node = ComputeType(context, FindSymbolAtLocation(context, filename, line));
+        if (context.typeTooDeep)
+        {
+            found = false;
+            return false;
+        }
+
+        found = node != NO_NODE;
+        const bool written = ExportResult(context, node, numNodes, outputPath);
+        ReleaseResult(context);
+        return written;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportType(SessionContext& context, const wchar_t* typeName, const wchar_t* outputPath, bool& found)
+    {
+        if (!outputPath)
+        {
+            LOG_ERROR("No output file path provided.");
+            return false;
+        }
+
+        if (!typeName)
+        {
+            LOG_ERROR("No type name provided.");
+            return false;
+        }
+
+        TRACE_SCOPE("NativeReader::ExportType");
+
+        const size_t numNodes = context.store.nodes.size();
+        const Layout::TIndex node = ComputeType(context, FindSymbolByName(context, typeName));
+        if (context.typeTooDeep)
+        {
+            found = false;
+            return false;
+        }
+
+        found = node != NO_NODE;
+        const bool written = ExportResult(context, node, numNodes, outputPath);
+        ReleaseResult(context);
+        return written;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportAtLocation(const wchar_t* pdbFile, const wchar_t* filename, const int line, const wchar_t* outputPath)
+    {
+        SessionContext* context = OpenSession(pdbFile);
+        bool found = false;
+        const bool ret = context && ExportAtLocation(*context, filename, line, outputPath, found);
+        CloseSession(context);
+        return ret;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportType(const wchar_t* pdbFile, const wchar_t* typeName, const wchar_t* outputPath)
+    {
+        SessionContext* context = OpenSession(pdbFile);
+        bool found = false;
+        const bool ret = context && ExportType(*context, typeName, outputPath, found);
+        CloseSession(context);
+        return ret;
+    }
+}
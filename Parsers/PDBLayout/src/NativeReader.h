@@ -0,0 +1,15 @@
+#pragma once
+
+namespace NativeReader
+{
+	struct SessionContext;
+
+	bool ExportAtLocation(const wchar_t* pdbFile, const wchar_t* filename, const int line, const wchar_t* output);
+	bool ExportType(const wchar_t* pdbFile, const wchar_t* typeName, const wchar_t* output);
+
+	// sessions keep the pdb and the computed types loaded between exports
+	SessionContext* OpenSession(const wchar_t* pdbFile);
+	void            CloseSession(SessionContext* session);
+	bool            ExportAtLocation(SessionContext& session, const wchar_t* filename, const int line, const wchar_t* output, bool& found);
+	bool            ExportType(SessionContext& session, const wchar_t* typeName, const wchar_t* output, bool& found);
+}
@@ -0,0 +1,627 @@
+#include "PDBFile.h"
+
+#include <algorithm>
+
+#include "IO.h"
+
+namespace PDB
+{
+    namespace Streams
+    {
+        constexpr uint32_t PDB_INFO = 1u;
+        constexpr uint32_t TPI      = 2u;
+        constexpr uint32_t DBI      = 3u;
+        constexpr uint32_t IPI      = 4u;
+
+        constexpr uint16_t NONE     = 0xffffu;
+    }
+
+    namespace Layouts
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        // TPI and IPI stream header
+        struct TypeStreamHeader
+        {
+            uint32_t version;
+            uint32_t headerSize;
+            uint32_t typeIndexBegin;
+            uint32_t typeIndexEnd;
+            uint32_t typeRecordBytes;
+            uint16_t hashStreamIndex;
+            uint16_t hashAuxStreamIndex;
+            uint32_t hashKeySize;
+            uint32_t numHashBuckets;
+            int32_t  hashValueBufferOffset;
+            uint32_t hashValueBufferLength;
+            int32_t  indexOffsetBufferOffset;
+            uint32_t indexOffsetBufferLength;
+            int32_t  hashAdjBufferOffset;
+            uint32_t hashAdjBufferLength;
+        };
+        static_assert(sizeof(TypeStreamHeader) == 56, "TPI stream header size mismatch");
+
+        constexpr uint32_t DBI_MACHINE_OFFSET = 58u;
+        constexpr uint32_t NAMES_SIGNATURE    = 0xeffeeffeu;
+    }
+
+    namespace Helpers
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        uint8_t GetMachinePointerSize(const uint16_t machine)
+        {
+            switch (machine)
+            {
+            case 0x014c: //x86
+            case 0x01c0: //ARM
+            case 0x01c2: //Thumb
+            case 0x01c4: //ARMNT
+                return 4u;
+            case 0x8664: //x64
+            case 0xaa64: //ARM64
+            case 0xa641: //ARM64EC
+            case 0xa64e: //ARM64X
+            case 0x0200: //IA64
+                return 8u;
+            default:
+                LOG_WARNING("Could not find the machine pointer bit size for machine image number %u ( assumed 64bit - this only affects virtual base table pointer size )", machine);
+                return 8u;
+            }
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Serialized hash table of the named stream map: size, capacity, present and deleted bit vectors and then the
+        // key value pairs of the present buckets
+        bool ReadHashTable(const Stream& stream, uint32_t& offset, std::vector<std::pair<uint32_t, uint32_t>>& output)
+        {
+            uint32_t size = 0u;
+            uint32_t capacity = 0u;
+            if (!stream.Read(offset, size) || !stream.Read(offset + 4u, capacity))
+            {
+                return false;
+            }
+            offset += 8u;
+
+            std::vector<uint32_t> present;
+            for (int vector = 0; vector < 2; ++vector)
+            {
+                uint32_t numWords = 0u;
+                if (!stream.Read(offset, numWords) || numWords > capacity / 32u + 1u)
+                {
+                    return false;
+                }
+                offset += 4u;
+
+                if (vector == 0)
+                {
+                    present.resize(numWords);
+                    if (numWords > 0u && !stream.Read(offset, numWords * 4u, present.data()))
+                    {
+                        return false;
+                    }
+                }
+                offset += numWords * 4u;
+            }
+
+            for (uint32_t bucket = 0u; bucket < present.size() * 32u; ++bucket)
+            {
+                if (present[bucket / 32u] & (1u << (bucket % 32u)))
+                {
+                    std::pair<uint32_t, uint32_t> entry;
+                    if (!stream.Read(offset, entry.first) || !stream.Read(offset + 4u, entry.second))
+                    {
+                        return false;
+                    }
+                    offset += 8u;
+                    output.push_back(entry);
+                }
+            }
+
+            return output.size() == size;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        bool IsAnonymous(const char* name)
+        {
+            return strcmp(name, "<unnamed-tag>") == 0 || strcmp(name, "__unnamed") == 0 || strcmp(name, "<anonymous-tag>") == 0;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Hash used by the linkers to place a type definition in the TPI buckets, unnamed types are hashed on their
+        // whole record and can't be found by name
+        bool GetDefinitionHash(const TagRecord& tag, uint32_t& hash)
+        {
+            const bool hasUniqueName = (tag.options & ClassOptions::HasUniqueName) != 0u;
+            if (tag.IsForwardReference() || (hasUniqueName && IsAnonymous(tag.name)))
+            {
+                return false;
+            }
+
+            if ((tag.options & ClassOptions::Scoped) == 0u)
+            {
+                hash = HashStringV1(tag.name, strlen(tag.name));
+                return true;
+            }
+
+            if (hasUniqueName)
+            {
+                hash = HashStringV1(tag.uniqueName, strlen(tag.uniqueName));
+                return true;
+            }
+
+            return false;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    uint32_t HashStringV1(const char* str, const size_t length)
+    {
+        //xor of the little endian 4 byte words, then the remaining 2 and 1 byte parts, lower cased and folded
+        uint32_t result = 0u;
+        const uint8_t* data = reinterpret_cast<const uint8_t*>(str);
+        size_t i = 0u;
+        for (; i + 4u <= length; i += 4u)
+        {
+            result ^= static_cast<uint32_t>(data[i]) | (static_cast<uint32_t>(data[i + 1]) << 8) | (static_cast<uint32_t>(data[i + 2]) << 16) | (static_cast<uint32_t>(data[i + 3]) << 24);
+        }
+
+        if (length - i >= 2u)
+        {
+            result ^= static_cast<uint32_t>(data[i]) | (static_cast<uint32_t>(data[i + 1]) << 8);
+            i += 2u;
+        }
+
+        if (length - i == 1u)
+        {
+            result ^= data[i];
+        }
+
+        result |= 0x20202020u;
+        result ^= result >> 11;
+        return result ^ (result >> 16);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // ----------------------------------------------------------------------------------------------------------
+    uint64_t RecordCursor::ReadNumeric()
+    {
+        const uint16_t leaf = Read<uint16_t>();
+        if (leaf < 0x8000u)
+        {
+            return leaf;
+        }
+
+        switch (leaf)
+        {
+        case 0x8000: return static_cast<uint64_t>(static_cast<int64_t>(Read<int8_t>()));  //LF_CHAR
+        case 0x8001: return static_cast<uint64_t>(static_cast<int64_t>(Read<int16_t>())); //LF_SHORT
+        case 0x8002: return Read<uint16_t>();                                             //LF_USHORT
+        case 0x8003: return static_cast<uint64_t>(static_cast<int64_t>(Read<int32_t>())); //LF_LONG
+        case 0x8004: return Read<uint32_t>();                                             //LF_ULONG
+        case 0x8009: return static_cast<uint64_t>(Read<int64_t>());                        //LF_QUADWORD
+        case 0x800a: return Read<uint64_t>();                                             //LF_UQUADWORD
+        default:
+            m_failed = true;
+            return 0u;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const char* RecordCursor::ReadString()
+    {
+        const char* str = reinterpret_cast<const char*>(m_data);
+        const void* terminator = m_data < m_end ? memchr(m_data, '\0', static_cast<size_t>(m_end - m_data)) : nullptr;
+        if (terminator == nullptr)
+        {
+            m_failed = true;
+            return "";
+        }
+
+        m_data = static_cast<const uint8_t*>(terminator) + 1;
+        return str;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void RecordCursor::SkipPadding()
+    {
+        //LF_PAD0 to LF_PAD15, the low nibble tells how many bytes to skip including itself
+        if (m_data < m_end && *m_data > 0xf0u)
+        {
+            Skip(*m_data & 0x0fu);
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool IsTagRecord(const uint16_t kind)
+    {
+        return kind == Leaf::Class || kind == Leaf::Structure || kind == Leaf::Interface || kind == Leaf::Union || kind == Leaf::Enum;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool ReadTagRecord(const TypeRecord& record, TagRecord& output)
+    {
+        if (!IsTagRecord(record.kind))
+        {
+            return false;
+        }
+
+        RecordCursor cursor = record.GetCursor();
+        output.kind = record.kind;
+        cursor.Read<uint16_t>(); //member count
+        output.options = cursor.Read<uint16_t>();
+
+        if (record.kind == Leaf::Enum)
+        {
+            output.underlyingType = cursor.Read<uint32_t>();
+            output.fieldList = cursor.Read<uint32_t>();
+            output.size = 0u;
+        }
+        else if (record.kind == Leaf::Union)
+        {
+            output.fieldList = cursor.Read<uint32_t>();
+            output.size = cursor.ReadNumeric();
+        }
+        else
+        {
+            output.fieldList = cursor.Read<uint32_t>();
+            cursor.Read<uint32_t>(); //derivation list
+            cursor.Read<uint32_t>(); //vtable shape
+            output.size = cursor.ReadNumeric();
+        }
+
+        output.name = cursor.ReadString();
+        output.uniqueName = (output.options & ClassOptions::HasUniqueName) ? cursor.ReadString() : "";
+        return !cursor.Failed();
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // ----------------------------------------------------------------------------------------------------------
+    TypeStream::TypeStream()
+        : m_recordsOffset(0u)
+        , m_recordsSize(0u)
+        , m_begin(FIRST_TYPE_INDEX)
+        , m_end(FIRST_TYPE_INDEX)
+        , m_numBuckets(0u)
+        , m_hashValuesOffset(0u)
+        , m_hashValuesSize(0u)
+        , m_hasBuckets(false)
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool TypeStream::Read(const MSFFile& file, const uint32_t streamIndex)
+    {
+        m_records = file.GetStream(streamIndex);
+
+        Layouts::TypeStreamHeader header;
+        if (!m_records.Read(0u, header) || header.headerSize < sizeof(header) || header.typeIndexEnd < header.typeIndexBegin ||
+            static_cast<uint64_t>(header.headerSize) + header.typeRecordBytes > m_records.GetSize())
+        {
+            return false;
+        }
+
+        m_recordsOffset = header.headerSize;
+        m_recordsSize   = header.typeRecordBytes;
+        m_begin         = header.typeIndexBegin;
+        m_end           = header.typeIndexEnd;
+
+        if (header.hashStreamIndex != Streams::NONE)
+        {
+            m_hashStream = file.GetStream(header.hashStreamIndex);
+        }
+
+        //the hash values are the bucket of every record, in type index order
+        if (m_hashStream && header.hashKeySize == 4u && header.numHashBuckets > 0u && header.hashValueBufferLength == (m_end - m_begin) * 4u &&
+            header.hashValueBufferOffset >= 0 && static_cast<uint64_t>(header.hashValueBufferOffset) + header.hashValueBufferLength <= m_hashStream.GetSize())
+        {
+            m_numBuckets       = header.numHashBuckets;
+            m_hashValuesOffset = static_cast<uint32_t>(header.hashValueBufferOffset);
+            m_hashValuesSize   = header.hashValueBufferLength;
+        }
+        else
+        {
+            m_numBuckets = header.numHashBuckets > 0u ? header.numHashBuckets : 0x3ffffu;
+        }
+
+        //sparse type index to record offset pairs, about one every 8KB of records
+        if (m_hashStream && header.indexOffsetBufferOffset >= 0 && static_cast<uint64_t>(header.indexOffsetBufferOffset) + header.indexOffsetBufferLength <= m_hashStream.GetSize())
+        {
+            m_indexOffsets.resize(header.indexOffsetBufferLength / 8u);
+            for (size_t i = 0u; i < m_indexOffsets.size(); ++i)
+            {
+                const uint32_t offset = static_cast<uint32_t>(header.indexOffsetBufferOffset) + static_cast<uint32_t>(i) * 8u;
+                m_hashStream.Read(offset, m_indexOffsets[i].first);
+                m_hashStream.Read(offset + 4u, m_indexOffsets[i].second);
+            }
+        }
+
+        if (m_indexOffsets.empty() || m_indexOffsets.front().first != m_begin)
+        {
+            m_indexOffsets.insert(m_indexOffsets.begin(), std::pair<uint32_t, uint32_t>(m_begin, 0u));
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool TypeStream::ReadHeaderAt(const uint32_t offset, uint16_t& length, uint16_t& kind) const
+    {
+        return m_records.Read(offset, length) && m_records.Read(offset + 2u, kind);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool TypeStream::GetRecord(const uint32_t index, TypeRecord& record) const
+    {
+        if (index < m_begin || index >= m_end)
+        {
+            return false;
+        }
+
+        //closest known offset before the index, then walk the record lengths
+        std::vector<std::pair<uint32_t, uint32_t>>::const_iterator found = std::upper_bound(m_indexOffsets.begin(), m_indexOffsets.end(), index,
+            [](const uint32_t value, const std::pair<uint32_t, uint32_t>& entry) { return value < entry.first; });
+        --found;
+
+        uint32_t offset = m_recordsOffset + found->second;
+        const uint32_t end = m_recordsOffset + m_recordsSize;
+        uint16_t length = 0u;
+        for (uint32_t current = found->first; current < index; ++current)
+        {
+            if (!m_records.Read(offset, length))
+            {
+                return false;
+            }
+            offset += 2u + length;
+        }
+
+        if (offset + 4u > end || !ReadHeaderAt(offset, length, record.kind) || length < 2u || offset + 2u + length > end)
+        {
+            return false;
+        }
+
+        record.size = length - 2u;
+        record.data = m_records.View(offset + 4u, record.size, record.scratch);
+        return record.data != nullptr;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void TypeStream::GetBucket(const uint32_t hash, std::vector<uint32_t>& output) const
+    {
+        output.clear();
+        if (!m_hasBuckets)
+        {
+            BuildBuckets();
+        }
+
+        const uint32_t bucket = hash % m_numBuckets;
+        output.insert(output.end(), m_bucketEntries.begin() + m_bucketStarts[bucket], m_bucketEntries.begin() + m_bucketStarts[bucket + 1]);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void TypeStream::BuildBuckets() const
+    {
+        m_hasBuckets = true;
+
+        std::vector<uint32_t> values(m_end - m_begin, ~0u);
+        if (m_hashValuesSize > 0u)
+        {
+            //one pass over the 4 byte hash values, the records themselves are not read
+            m_hashStream.Read(m_hashValuesOffset, m_hashValuesSize, values.data());
+        }
+        else
+        {
+            //linkers always write the hash values, only hand made or truncated files need the records to be hashed here
+            LOG_INFO("The type stream has no hash values, hashing the type names.");
+            ForEachRecord([&](const uint32_t index, const TypeRecord& record)
+            {
+                TagRecord tag;
+                uint32_t hash = 0u;
+                if (ReadTagRecord(record, tag) && Helpers::GetDefinitionHash(tag, hash))
+                {
+                    values[index - m_begin] = hash % m_numBuckets;
+                }
+                return true;
+            });
+        }
+
+        m_bucketStarts.assign(m_numBuckets + 1u, 0u);
+        for (const uint32_t value : values)
+        {
+            if (value < m_numBuckets)
+            {
+                ++m_bucketStarts[value + 1u];
+            }
+        }
+
+        for (uint32_t i = 0u; i < m_numBuckets; ++i)
+        {
+            m_bucketStarts[i + 1u] += m_bucketStarts[i];
+        }
+
+        m_bucketEntries.resize(m_bucketStarts[m_numBuckets]);
+        std::vector<uint32_t> cursors(m_bucketStarts.begin(), m_bucketStarts.end() - 1);
+        for (uint32_t i = 0u; i < values.size(); ++i)
+        {
+            if (values[i] < m_numBuckets)
+            {
+                m_bucketEntries[cursors[values[i]]++] = m_begin + i;
+            }
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // ----------------------------------------------------------------------------------------------------------
+    PDBFile::PDBFile()
+        : m_age(0u)
+        , m_pointerSize(8u)
+        , m_names("")
+        , m_namesSize(0u)
+    {
+        memset(m_guid, 0, sizeof(m_guid));
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool PDBFile::Open(const char* filename)
+    {
+        if (!m_file.Open(filename))
+        {
+            return false;
+        }
+
+        uint32_t namesStream = Streams::NONE;
+        if (!ReadInfoStream(namesStream))
+        {
+            LOG_ERROR("Failed to read the pdb info stream.");
+            return false;
+        }
+
+        if (!m_types.Read(m_file, Streams::TPI))
+        {
+            LOG_ERROR("Failed to read the pdb type stream.");
+            return false;
+        }
+
+        //older pdbs have no id stream, the source locations are then unavailable
+        if (!m_ids.Read(m_file, Streams::IPI))
+        {
+            LOG_WARNING("The pdb has no id stream, type locations can't be resolved.");
+        }
+
+        if (namesStream != Streams::NONE && !ReadNames(namesStream))
+        {
+            LOG_WARNING("The pdb string table is invalid.");
+        }
+
+        ReadMachine();
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool PDBFile::ReadInfoStream(uint32_t& namesStream)
+    {
+        //version, signature, age and guid followed by the named stream map
+        const Stream stream = m_file.GetStream(Streams::PDB_INFO);
+        if (!stream.Read(8u, m_age) || !stream.Read(12u, sizeof(m_guid), m_guid))
+        {
+            return false;
+        }
+
+        uint32_t stringsSize = 0u;
+        if (!stream.Read(28u, stringsSize))
+        {
+            return false;
+        }
+
+        std::vector<char> strings(stringsSize + 1u, '\0');
+        if (!stream.Read(32u, stringsSize, strings.data()))
+        {
+            return false;
+        }
+
+        uint32_t offset = 32u + stringsSize;
+        std::vector<std::pair<uint32_t, uint32_t>> namedStreams;
+        if (!Helpers::ReadHashTable(stream, offset, namedStreams))
+        {
+            return false;
+        }
+
+        for (const std::pair<uint32_t, uint32_t>& entry : namedStreams)
+        {
+            if (entry.first < stringsSize && strcmp(strings.data() + entry.first, "/names") == 0)
+            {
+                namesStream = entry.second;
+            }
+        }
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool PDBFile::ReadNames(const uint32_t namesStream)
+    {
+        //signature, hash version and the string buffer, the hash buckets after it are not needed
+        const Stream stream = m_file.GetStream(namesStream);
+        uint32_t signature = 0u;
+        uint32_t size = 0u;
+        if (!stream.Read(0u, signature) || signature != Layouts::NAMES_SIGNATURE || !stream.Read(8u, size))
+        {
+            return false;
+        }
+
+        const uint8_t* data = stream.View(12u, size, m_namesScratch);
+        if (data == nullptr)
+        {
+            return false;
+        }
+
+        m_names = reinterpret_cast<const char*>(data);
+        m_namesSize = size;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void PDBFile::ReadMachine()
+    {
+        uint16_t machine = 0u;
+        if (m_file.GetStream(Streams::DBI).Read(Layouts::DBI_MACHINE_OFFSET, machine))
+        {
+            m_pointerSize = Helpers::GetMachinePointerSize(machine);
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    const char* PDBFile::GetString(const uint32_t offset) const
+    {
+        return offset < m_namesSize && memchr(m_names + offset, '\0', m_namesSize - offset) ? m_names + offset : "";
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    uint32_t PDBFile::FindTag(const uint32_t hash, const uint16_t kind, const char* name, const bool byUniqueName) const
+    {
+        std::vector<uint32_t> candidates;
+        m_types.GetBucket(hash, candidates);
+
+        TypeRecord record;
+        for (const uint32_t index : candidates)
+        {
+            TagRecord tag;
+            if (m_types.GetRecord(index, record) && ReadTagRecord(record, tag) && !tag.IsForwardReference() &&
+                (kind == 0u || tag.kind == kind) && strcmp(byUniqueName ? tag.uniqueName : tag.name, name) == 0)
+            {
+                return index;
+            }
+        }
+        return 0u;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    uint32_t PDBFile::FindDefinition(const char* name) const
+    {
+        return name ? FindTag(HashStringV1(name, strlen(name)), 0u, name, false) : 0u;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    uint32_t PDBFile::ResolveDefinition(const uint32_t typeIndex) const
+    {
+        std::unordered_map<uint32_t, uint32_t>::const_iterator found = m_definitions.find(typeIndex);
+        if (found != m_definitions.end())
+        {
+            return found->second;
+        }
+
+        uint32_t ret = typeIndex;
+        TypeRecord record;
+        TagRecord tag;
+        if (m_types.GetRecord(typeIndex, record) && ReadTagRecord(record, tag) && tag.IsForwardReference())
+        {
+            //the definition lives in the bucket of its name, or of its decorated name for the local types
+            const bool byUniqueName = (tag.options & ClassOptions::HasUniqueName) != 0u;
+            const char* key = (tag.options & ClassOptions::Scoped) ? tag.uniqueName : tag.name;
+            const uint32_t definition = FindTag(HashStringV1(key, strlen(key)), tag.kind, byUniqueName ? tag.uniqueName : tag.name, byUniqueName);
+            ret = definition ? definition : typeIndex;
+        }
+
+        m_definitions.emplace(typeIndex, ret);
+        return ret;
+    }
+}
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "MSFFile.h"
+
+namespace PDB
+{
+    // ----------------------------------------------------------------------------------------------------------
+    // The subset of the CodeView leaf kinds needed to find records and compute their layout
+
+    namespace Leaf
+    {
+        enum : uint16_t
+        {
+            VTableShape              = 0x000a,
+            Modifier                 = 0x1001,
+            Pointer                  = 0x1002,
+            Procedure                = 0x1008,
+            MemberFunction           = 0x1009,
+            FieldList                = 0x1203,
+            Bitfield                 = 0x1205,
+            BaseClass                = 0x1400,
+            VirtualBaseClass         = 0x1401,
+            IndirectVirtualBaseClass = 0x1402,
+            Index                    = 0x1404,
+            VFunctionTable           = 0x1409,
+            FriendClass              = 0x140b,
+            VFunctionOffset          = 0x140c,
+            Enumerate                = 0x1502,
+            Array                    = 0x1503,
+            Class                    = 0x1504,
+            Structure                = 0x1505,
+            Union                    = 0x1506,
+            Enum                     = 0x1507,
+            FriendFunction           = 0x150c,
+            Member                   = 0x150d,
+            StaticMember             = 0x150e,
+            Method                   = 0x150f,
+            NestedType               = 0x1510,
+            OneMethod                = 0x1511,
+            NestedTypeEx             = 0x1512,
+            Interface                = 0x1519,
+            StringId                 = 0x1605,
+            UdtSourceLine            = 0x1606,
+            UdtModSourceLine         = 0x1607,
+        };
+    }
+
+    namespace ClassOptions
+    {
+        enum : uint16_t
+        {
+            ForwardReference = 0x0080,
+            Scoped           = 0x0100,
+            HasUniqueName    = 0x0200,
+        };
+    }
+
+    constexpr uint32_t FIRST_TYPE_INDEX = 0x1000; // lower indices are the simple types encoded in the index itself
+
+    uint32_t HashStringV1(const char* str, const size_t length);
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Bounds checked reader over a record, reading past the end fails once and returns zeroes from then on
+    class RecordCursor
+    {
+    public:
+        RecordCursor(const uint8_t* data, const uint32_t size)
+            : m_data(data)
+            , m_end(data + size)
+            , m_failed(false)
+        {}
+
+        template<typename T> T Read()
+        {
+            T ret = T();
+            if (Has(sizeof(T)))
+            {
+                memcpy(&ret, m_data, sizeof(T));
+                m_data += sizeof(T);
+            }
+            return ret;
+        }
+
+        uint64_t    ReadNumeric(); // numeric leaf, a literal below 0x8000 or a value leaf
+        const char* ReadString();
+        void        Skip(const uint32_t size) { if (Has(size)) m_data += size; }
+        void        SkipPadding();  // LF_PAD bytes aligning the field list members
+
+        const uint8_t* GetData() const { return m_data; }
+        bool           IsEnd() const   { return m_data >= m_end; }
+        bool           Failed() const  { return m_failed; }
+
+    private:
+        bool Has(const size_t size) { m_failed = m_failed || static_cast<size_t>(m_end - m_data) < size; return !m_failed; }
+
+        const uint8_t* m_data;
+        const uint8_t* m_end;
+        bool           m_failed;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct TypeRecord
+    {
+        TypeRecord()
+            : kind(0u)
+            , size(0u)
+            , data(nullptr)
+        {}
+
+        RecordCursor GetCursor() const { return RecordCursor(data, size); }
+
+        uint16_t             kind;
+        uint32_t             size;    // bytes after the kind
+        const uint8_t*       data;
+        std::vector<uint8_t> scratch; // holds the record when it spans non consecutive blocks
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Header shared by the class, structure, interface, union and enum records
+    struct TagRecord
+    {
+        TagRecord()
+            : kind(0u)
+            , options(0u)
+            , fieldList(0u)
+            , underlyingType(0u)
+            , size(0u)
+            , name("")
+            , uniqueName("")
+        {}
+
+        bool IsForwardReference() const { return (options & ClassOptions::ForwardReference) != 0u; }
+
+        uint16_t    kind;
+        uint16_t    options;
+        uint32_t    fieldList;
+        uint32_t    underlyingType; // enums only
+        uint64_t    size;           // enums take it from the underlying type
+        const char* name;
+        const char* uniqueName;     // decorated name, empty when missing
+    };
+
+    bool IsTagRecord(const uint16_t kind);
+    bool ReadTagRecord(const TypeRecord& record, TagRecord& output);
+
+    // ----------------------------------------------------------------------------------------------------------
+    // TPI or IPI stream. Records are located through the index offsets of the hash stream, a binary search plus a
+    // short walk, and named types are found through the hash buckets without touching the other records.
+    class TypeStream
+    {
+    public:
+        TypeStream();
+
+        bool Read(const MSFFile& file, const uint32_t streamIndex);
+
+        uint32_t GetBegin() const { return m_begin; }
+        uint32_t GetEnd() const   { return m_end; }
+
+        bool GetRecord(const uint32_t index, TypeRecord& record) const;
+        void GetBucket(const uint32_t hash, std::vector<uint32_t>& output) const; // indices sharing the bucket of a name hash
+
+        // sequential walk over every record, the callback returns false to stop
+        template<typename TCallback> void ForEachRecord(TCallback callback) const;
+
+    private:
+        void BuildBuckets() const;
+        bool ReadHeaderAt(const uint32_t offset, uint16_t& length, uint16_t& kind) const;
+
+    private:
+        Stream                                     m_records;
+        Stream                                     m_hashStream;
+        uint32_t                                   m_recordsOffset;
+        uint32_t                                   m_recordsSize;
+        uint32_t                                   m_begin;
+        uint32_t                                   m_end;
+        uint32_t                                   m_numBuckets;
+        uint32_t                                   m_hashValuesOffset;
+        uint32_t                                   m_hashValuesSize;
+        std::vector<std::pair<uint32_t, uint32_t>> m_indexOffsets; // type index and record offset, sorted
+
+        //bucket -> type indices, built on the first lookup
+        mutable bool                               m_hasBuckets;
+        mutable std::vector<uint32_t>              m_bucketStarts;
+        mutable std::vector<uint32_t>              m_bucketEntries;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Program database read natively from its streams, without DIA, so it works on any host
+    class PDBFile
+    {
+    public:
+        PDBFile();
+
+        PDBFile(const PDBFile&) = delete;
+        PDBFile& operator=(const PDBFile&) = delete;
+
+        bool Open(const char* filename);
+
+        const uint8_t*    GetGuid() const        { return m_guid; }
+        uint32_t          GetAge() const         { return m_age; }
+        uint8_t           GetPointerSize() const { return m_pointerSize; }
+        const TypeStream& GetTypes() const       { return m_types; }
+        const TypeStream& GetIds() const         { return m_ids; }
+
+        const char* GetString(const uint32_t offset) const; // /names string table, empty when out of bounds
+        template<typename TCallback> void ForEachString(TCallback callback) const;
+
+        uint32_t FindDefinition(const char* name) const;           // 0 when missing
+        uint32_t ResolveDefinition(const uint32_t typeIndex) const; // definition of a forward reference, the same index otherwise
+
+    private:
+        bool ReadInfoStream(uint32_t& namesStream);
+        bool ReadNames(const uint32_t namesStream);
+        void ReadMachine();
+        uint32_t FindTag(const uint32_t hash, const uint16_t kind, const char* name, const bool byUniqueName) const;
+
+    private:
+        MSFFile                                        m_file;
+        uint8_t                                        m_guid[16];
+        uint32_t                                       m_age;
+        uint8_t                                        m_pointerSize;
+        TypeStream                                     m_types;
+        TypeStream                                     m_ids;
+        const char*                                    m_names;
+        uint32_t                                       m_namesSize;
+        std::vector<uint8_t>                           m_namesScratch;
+        mutable std::unordered_map<uint32_t, uint32_t> m_definitions; // resolved forward references
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    template<typename TCallback>
+    void TypeStream::ForEachRecord(TCallback callback) const
+    {
+        TypeRecord record;
+        uint32_t offset = m_recordsOffset;
+        const uint32_t end = m_recordsOffset + m_recordsSize;
+        for (uint32_t index = m_begin; index < m_end && offset + 4u <= end; ++index)
+        {
+            uint16_t length = 0u;
+            if (!ReadHeaderAt(offset, length, record.kind) || length < 2u)
+            {
+                return;
+            }
+
+            record.size = length - 2u;
+            record.data = m_records.View(offset + 4u, record.size, record.scratch);
+            if (record.data == nullptr || !callback(index, record))
+            {
+                return;
+            }
+            offset += 2u + length;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    template<typename TCallback>
+    void PDBFile::ForEachString(TCallback callback) const
+    {
+        //the buffer starts with an empty string, each string is null terminated
+        for (uint32_t offset = 0u; offset < m_namesSize;)
+        {
+            const char* str = m_names + offset;
+            const size_t length = strnlen(str, m_namesSize - offset);
+            if (length > 0u)
+            {
+                callback(offset, str);
+            }
+            offset += static_cast<uint32_t>(length) + 1u;
+        }
+    }
+}
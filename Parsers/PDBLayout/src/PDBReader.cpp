@@ -1,13 +1,31 @@
+#include "PDBReader.h"
+
+//DIA is Windows only, the other platforms use the native reader
+#ifdef _WIN32
+
 #include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "IO.h"
 #include "LayoutDefinitions.h"
+#include "LayoutPostProcess.h"
+#include "Trace.h"
+
+#include "LocationIndex.h"
 
 #include "dia2.h" 
 #include "diacreate.h"
 
 namespace PDBReader
 {
+    // nested bases and members computed at once, deeper chains fail the export instead of overflowing the stack
+    constexpr unsigned int MAX_TYPE_DEPTH = 16384u;
+
+    // types without a layout, the exports skip them
+    constexpr Layout::TIndex NO_NODE = 0xFFFFFFFF;
+
     namespace Helpers
     {
         // -----------------------------------------------------------------------------------------------------------
@@ -126,18 +144,19 @@ namespace PDBReader
         }
 
         // -----------------------------------------------------------------------------------------------------------
-        bool IsLayoutFreeAt(Layout::Node* node, Layout::TAmount offset, Layout::TAmount offsetEnd)
+        bool IsLayoutFreeAt(const Layout::Store& store, const Layout::FlatNode& node, const Layout::TIndices& children, Layout::TAmount offset, Layout::TAmount offsetEnd)
         {
-            if (node->size < offsetEnd)
+            if (node.size < offsetEnd)
             {
                 return false;
             }
 
-            for (Layout::Node* child : node->children)
+            for (const Layout::TIndex child : children)
             {
-                Layout::TAmount childEnd = (child->offset + child->size);
-                if ((offset >= child->offset && offset < childEnd) ||
-                    (offsetEnd > child->offset && offsetEnd <= childEnd))
+                const Layout::FlatNode& childNode = store.nodes[child];
+                Layout::TAmount childEnd = (childNode.offset + childNode.size);
+                if ((offset >= childNode.offset && offset < childEnd) ||
+                    (offsetEnd > childNode.offset && offsetEnd <= childEnd))
                 {
                     return false;
                 }
@@ -154,17 +173,36 @@ namespace PDBReader
         }
     }
 
+    // -----------------------------------------------------------------------------------------------------------
+    // Type computed once per session, every use gets a copy sharing the prototype children
+    struct TypePrototype
+    {
+        Layout::TIndex   node;         // base class subobject, without its virtual bases
+        Layout::TIndices virtualBases; // all the virtual bases found below the type, in placement order
+    };
+
     // -----------------------------------------------------------------------------------------------------------
     struct SessionContext
     {
+        IDiaDataSource* source = nullptr;
         IDiaSession* session = nullptr;
         IDiaSymbol* globalScope = nullptr;
         Layout::TAmount pointerSize = 8;
+        std::string indexPath;
+
+        mutable Layout::Store                            store;     // the prototypes, followed by the copies of the current export
+        mutable std::unordered_map<DWORD, TypePrototype> typeMemo;  // by DIA symbol index id
+        mutable size_t                                   exportNodes = 0u;
+        mutable size_t                                   exportChildren = 0u;
+        mutable unsigned int                             typeDepth = 0u;
+        mutable bool                                     typeTooDeep = false;
     };
 
     // -----------------------------------------------------------------------------------------------------------
     SessionContext OpenPDBSession(const wchar_t* filename)
     {
+        TRACE_SCOPE("OpenPDBSession");
+
         SessionContext ret;
         IDiaDataSource* source = nullptr;
 
@@ -177,6 +215,7 @@ namespace PDBReader
                 return ret;
             }
         }
+        ret.source = source;
 
         if (source->loadDataFromPdb(filename) < 0)
         {
@@ -192,6 +231,7 @@ namespace PDBReader
 
         ret.globalScope = Helpers::QueryDIAFunction(ret.session, &IDiaSession::get_globalScope);
         ret.pointerSize = Helpers::GetArchitecturePointerSize(Helpers::QueryDIAFunction(ret.globalScope, &IDiaSymbol::get_machineType));
+        ret.indexPath = PDB::GetLocationIndexPath(Helpers::wchar2string(filename).c_str());
 
         return ret;
     }
@@ -330,9 +370,9 @@ namespace PDBReader
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    Layout::TAmount GuessAlignment(Layout::Node* node, IDiaSymbol* type)
+    Layout::TAmount GuessAlignment(const SessionContext& context, const Layout::FlatNode& node, IDiaSymbol* type)
     {
-        const Layout::TAmount maxOffsetAlign = node->offset == 0 ? 1024 : (1 << Helpers::GetTrailingZeroes(node->offset));
+        const Layout::TAmount maxOffsetAlign = node.offset == 0 ? 1024 : (1 << Helpers::GetTrailingZeroes(node.offset));
 
         const enum SymTagEnum tag = static_cast<enum SymTagEnum>(Helpers::QueryDIAFunction(type, &IDiaSymbol::get_symTag));
         switch (tag)
@@ -340,15 +380,15 @@ namespace PDBReader
         case SymTagUDT:
         {
             Layout::TAmount align = 1;
-            for (Layout::Node* childNode : node->children)
+            for (const Layout::TIndex* child = context.store.ChildrenBegin(node), *end = context.store.ChildrenEnd(node); child != end; ++child)
             {
-                align = Helpers::Max(align, childNode->align);
+                align = Helpers::Max(align, context.store.nodes[*child].align);
             }
             const Layout::TAmount typeSize = Helpers::QueryDIAFunction(type, &IDiaSymbol::get_length);
             return Helpers::Min(maxOffsetAlign, Helpers::Max(Layout::TAmount(1u), Helpers::Min(align, typeSize)));
         }
         case SymTagArrayType:
-            return GuessAlignment(node, Helpers::QueryDIAFunction(type, &IDiaSymbol::get_type));
+            return GuessAlignment(context, node, Helpers::QueryDIAFunction(type, &IDiaSymbol::get_type));
 
         case SymTagEnum:
         case SymTagBaseType:
@@ -364,101 +404,105 @@ namespace PDBReader
     // -----------------------------------------------------------------------------------------------------------
     struct TypeContext
     {
-        std::vector<Layout::Node*> virtualBases;
+        Layout::TIndices                   virtualBases;
+        std::unordered_set<Layout::TIndex> virtualBaseTypes; // type string indices
     };
 
     // -----------------------------------------------------------------------------------------------------------
-    bool ContainerHasNode(const std::vector<Layout::Node*>& container, Layout::Node* input)
+    bool HasVirtualBase(const SessionContext& sessionContext, const TypeContext& typeContext, const Layout::TIndex input)
     {
-        if (input && !input->type.empty())
-        {
-            for (Layout::Node* node : container)
-            {
-                if (node->type == input->type)
-                {
-                    return true;
-                }
-            }
-        }
-        return false;
+        return input != NO_NODE && sessionContext.store.nodes[input].type != 0u && typeContext.virtualBaseTypes.count(sessionContext.store.nodes[input].type) != 0u;
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    void ContainerAddNode(std::vector<Layout::Node*>& container, Layout::Node* input)
+    void AddVirtualBase(const SessionContext& sessionContext, TypeContext& typeContext, const Layout::TIndex input)
     {
-        if (input && !ContainerHasNode(container, input))
+        if (input != NO_NODE && !HasVirtualBase(sessionContext, typeContext, input))
+        {
+            typeContext.virtualBases.emplace_back(input);
+            typeContext.virtualBaseTypes.insert(sessionContext.store.nodes[input].type);
+        }
+        else if (input != NO_NODE && input + 1u == sessionContext.store.nodes.size())
         {
-            container.emplace_back(input);
+            //the context already holds this virtual base, the duplicate was just copied and is not referenced anywhere else
+            sessionContext.store.nodes.pop_back();
         }
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    void InjectVBTablePtr(const SessionContext& sessionContext, Layout::Node* node)
+    void InjectVBTablePtr(const SessionContext& sessionContext, const Layout::FlatNode& node, Layout::TIndices& children)
     {
         Layout::TAmount tentativeOffset = 0;
 
         //find the memory position just after the non virtual bases
-        auto placement = node->children.begin();
-        for (; placement != node->children.end(); ++placement)
+        auto placement = children.begin();
+        for (; placement != children.end(); ++placement)
         {
-            if ((*placement)->nature != Layout::Category::NVBase)
+            const Layout::FlatNode& child = sessionContext.store.nodes[*placement];
+            if (child.nature != Layout::Category::NVBase)
             {
                 break;
             }
-            tentativeOffset = (*placement)->offset + (*placement)->size;
+            tentativeOffset = child.offset + child.size;
         }
 
         tentativeOffset = Helpers::AlignOffsetTo(tentativeOffset, sessionContext.pointerSize);
-        if (Helpers::IsLayoutFreeAt(node, tentativeOffset, tentativeOffset + sessionContext.pointerSize))
+        if (Helpers::IsLayoutFreeAt(sessionContext.store, node, children, tentativeOffset, tentativeOffset + sessionContext.pointerSize))
         {
             //Add the virtual base offset pointer
-            Layout::Node* fieldNode = new Layout::Node();
-            fieldNode->nature = Layout::Category::VBTablePtr;
-            fieldNode->offset = tentativeOffset;
-            fieldNode->size = sessionContext.pointerSize;
-            fieldNode->align = fieldNode->size;
-            node->children.emplace(placement, fieldNode);
+            Layout::FlatNode fieldNode;
+            fieldNode.nature = Layout::Category::VBTablePtr;
+            fieldNode.offset = tentativeOffset;
+            fieldNode.size = sessionContext.pointerSize;
+            fieldNode.align = fieldNode.size;
+            children.insert(placement, sessionContext.store.AddNode(fieldNode));
         }
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    void RemoveVirtualBasesFromNode(const SessionContext& sessionContext, TypeContext& typeContext, Layout::Node* node, std::vector<Layout::Node*>& virtualBases)
+    void RemoveVirtualBasesFromNode(const SessionContext& sessionContext, const TypeContext& typeContext, Layout::FlatNode& node, Layout::TIndices& children, const std::unordered_set<Layout::TIndex>& virtualBases)
     {
         //try to injecet the vbTablePtr
         if (!virtualBases.empty())
         {
             //remove the vbases size from the structure as it is counted as a type but we should only have in on the root node
             Layout::TAmount vbasesSize = 0u;
-            for (Layout::Node* child : typeContext.virtualBases)
+            for (const Layout::TIndex child : typeContext.virtualBases)
             {
                 //follow the typecontext order, as this dictates the final order in the struct. 
-                if (ContainerHasNode(virtualBases, child))
+                const Layout::FlatNode& childNode = sessionContext.store.nodes[child];
+                if (virtualBases.count(childNode.type) != 0u)
                 {
-                    vbasesSize = Helpers::AlignOffsetTo(vbasesSize, child->align) + child->size;
+                    vbasesSize = Helpers::AlignOffsetTo(vbasesSize, childNode.align) + childNode.size;
                 }
             }
             vbasesSize = Helpers::AlignOffsetTo(vbasesSize, sessionContext.pointerSize);
-            node->size -= vbasesSize;
+            node.size -= vbasesSize;
 
             //With the new size restriction try to inject the VBTablePtr
-            InjectVBTablePtr(sessionContext, node);
+            InjectVBTablePtr(sessionContext, node, children);
         }
     }
 
+    void FixVirtualBases(const SessionContext& sessionContext, const TypeContext& typeContext, const Layout::TIndex node, IDiaSymbol* type);
+    Layout::TIndex ComputeTypeRecursive(const SessionContext& sessionContext, TypeContext& typeContext, IDiaSymbol* type);
+
     // -----------------------------------------------------------------------------------------------------------
-    Layout::Node* ComputeTypeRecursive(const SessionContext& sessionContext, TypeContext& typeContext, IDiaSymbol* type)
+    Layout::TIndex ComputeTypePrototype(const SessionContext& sessionContext, TypeContext& typeContext, IDiaSymbol* type)
     {
         if (type == nullptr)
         {
-            return nullptr;
+            return NO_NODE;
         }
 
-        Layout::Node* node = new Layout::Node();
+        Layout::Store& store = sessionContext.store;
+        Layout::FlatNode node;
+        Layout::TIndices childNodes;
 
-        node->type   = GetTypeName(type);
-        node->size   = Helpers::QueryDIAFunction(type, &IDiaSymbol::get_length);
+        node.type   = store.strings.Intern(GetTypeName(type));
+        node.size   = Helpers::QueryDIAFunction(type, &IDiaSymbol::get_length);
 
-        std::vector<Layout::Node*> thisVirtualBases;
+        std::unordered_set<Layout::TIndex> thisVirtualBases;
 
         IDiaEnumSymbols* children = Helpers::FindChildren(type, SymTagNull);
         while (IDiaSymbol* child = Helpers::Next(children, &IDiaEnumSymbols::Next))
@@ -479,21 +523,25 @@ namespace PDBReader
             if (tag == SymTagBaseClass)
             {
                 IDiaSymbol* baseType = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_type);
-                Layout::Node* baseNode = ComputeTypeRecursive(sessionContext, typeContext, baseType);
+                const Layout::TIndex baseNode = ComputeTypeRecursive(sessionContext, typeContext, baseType);
+                if (baseNode == NO_NODE)
+                {
+                    continue;
+                }
 
                 if (Helpers::QueryDIAFunction(child, &IDiaSymbol::get_virtualBaseClass))
                 {
                     //virtual base
-                    baseNode->nature = Layout::Category::VBase;
-                    ContainerAddNode(typeContext.virtualBases, baseNode);
-                    thisVirtualBases.emplace_back(baseNode);
+                    store.nodes[baseNode].nature = Layout::Category::VBase;
+                    thisVirtualBases.insert(store.nodes[baseNode].type);
+                    AddVirtualBase(sessionContext, typeContext, baseNode);
                 }
                 else
                 {
                     //Non virtual base
-                    baseNode->offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_offset);
-                    baseNode->nature = Layout::Category::NVBase; 
-                    node->children.emplace_back(baseNode);
+                    store.nodes[baseNode].offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_offset);
+                    store.nodes[baseNode].nature = Layout::Category::NVBase; 
+                    childNodes.emplace_back(baseNode);
                 }
                 
             }
@@ -509,29 +557,39 @@ namespace PDBReader
                         
                     if (childTag == SymTagUDT)
                     {
-                        //complex field
-                        Layout::Node* fieldNode = ComputeTypeRecursive(sessionContext, typeContext, childType);
-                        fieldNode->name = Helpers::wchar2string(Helpers::QueryDIAFunction(child, &IDiaSymbol::get_name));
-                        fieldNode->offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_offset);
-                        fieldNode->nature = Layout::Category::ComplexField;
-                        fieldNode->align  = GuessAlignment(fieldNode, childType);
-
-                        node->children.emplace_back(fieldNode);
+                        //complex field, a complete object holding its own virtual bases
+                        TypeContext fieldContext;
+                        const Layout::TIndex fieldIndex = ComputeTypeRecursive(sessionContext, fieldContext, childType);
+                        if (fieldIndex == NO_NODE)
+                        {
+                            continue;
+                        }
+
+                        FixVirtualBases(sessionContext, fieldContext, fieldIndex, childType);
+                        const Layout::TIndex fieldName = store.strings.Intern(Helpers::wchar2string(Helpers::QueryDIAFunction(child, &IDiaSymbol::get_name)));
+
+                        Layout::FlatNode& fieldNode = store.nodes[fieldIndex];
+                        fieldNode.name = fieldName;
+                        fieldNode.offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_offset);
+                        fieldNode.nature = Layout::Category::ComplexField;
+                        fieldNode.align  = GuessAlignment(sessionContext, fieldNode, childType);
+
+                        childNodes.emplace_back(fieldIndex);
                     }
                     else
                     {
-                        Layout::Node* fieldNode = new Layout::Node();
+                        Layout::FlatNode fieldNode;
 
                         IDiaSymbol* childType = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_type);
 
-                        fieldNode->name   = Helpers::wchar2string(Helpers::QueryDIAFunction(child, &IDiaSymbol::get_name));
+                        fieldNode.name   = store.strings.Intern(Helpers::wchar2string(Helpers::QueryDIAFunction(child, &IDiaSymbol::get_name)));
                         
-                        fieldNode->type   = GetTypeName(childType);
-                        fieldNode->nature = Layout::Category::SimpleField;
+                        fieldNode.type   = store.strings.Intern(GetTypeName(childType));
+                        fieldNode.nature = Layout::Category::SimpleField;
                         
-                        fieldNode->offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_offset);
-                        fieldNode->size   = Helpers::QueryDIAFunction(childType, &IDiaSymbol::get_length);
-                        fieldNode->align  = GuessAlignment(fieldNode, childType);
+                        fieldNode.offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_offset);
+                        fieldNode.size   = Helpers::QueryDIAFunction(childType, &IDiaSymbol::get_length);
+                        fieldNode.align  = GuessAlignment(sessionContext, fieldNode, childType);
 
                         if (childTag == SymTagPointerType)
                         {
@@ -540,120 +598,358 @@ namespace PDBReader
                             const enum SymTagEnum ptrTag = static_cast<enum SymTagEnum>(Helpers::QueryDIAFunction(ptrType, &IDiaSymbol::get_symTag));
                             if (ptrTag == SymTagVTable || ptrTag == SymTagVTableShape)
                             {
-                                fieldNode->type   = "";
-                                fieldNode->nature = Layout::Category::VTablePtr;
+                                fieldNode.type   = store.strings.Intern("");
+                                fieldNode.nature = Layout::Category::VTablePtr;
                             }
                                 
-                            fieldNode->align = fieldNode->size;
+                            fieldNode.align = fieldNode.size;
                         }
 
                         if (locationType == LocIsBitField)
                         {
-                            fieldNode->nature = Layout::Category::Bitfield;
+                            fieldNode.nature = Layout::Category::Bitfield;
 
-                            Layout::Node* extraData = new Layout::Node();
-                            extraData->offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_bitPosition);
-                            extraData->size = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_length);
+                            Layout::FlatNode extraData;
+                            extraData.offset = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_bitPosition);
+                            extraData.size = Helpers::QueryDIAFunction(child, &IDiaSymbol::get_length);
 
-                            fieldNode->children.emplace_back(extraData);
+                            const Layout::TIndex extraIndex = store.AddNode(extraData);
+                            const Layout::TIndex fieldIndex = store.AddNode(fieldNode);
+                            store.SetChildren(fieldIndex, &extraIndex, 1u);
+                            childNodes.emplace_back(fieldIndex);
+                        }
+                        else
+                        {
+                            childNodes.emplace_back(store.AddNode(fieldNode));
                         }
-
-                        node->children.emplace_back(fieldNode);
 
                     }
                 }
             }
         }
 
-        std::stable_sort(node->children.begin(), node->children.begin(), [](Layout::Node* a, Layout::Node* b) { return a->offset < b->offset; });
+        std::stable_sort(childNodes.begin(), childNodes.begin(), [&store](const Layout::TIndex a, const Layout::TIndex b) { return store.nodes[a].offset < store.nodes[b].offset; });
 
-        RemoveVirtualBasesFromNode(sessionContext, typeContext, node, thisVirtualBases);
+        RemoveVirtualBasesFromNode(sessionContext, typeContext, node, childNodes, thisVirtualBases);
         
-        node->align = GuessAlignment(node, type);
-        return node;
+        const Layout::TIndex index = store.AddNode(node);
+        store.SetChildren(index, childNodes.data(), static_cast<Layout::TIndex>(childNodes.size()));
+        store.nodes[index].align = GuessAlignment(sessionContext, store.nodes[index], type);
+        return index;
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    void FixVirtualBases(const SessionContext& sessionContext, const TypeContext typeContext, Layout::Node* node, IDiaSymbol* type)
+    // Bases and members repeat a lot in deep hierarchies: each type is computed once per session in its own context and
+    // every use copies the prototype, replaying the virtual bases it found into the caller context
+    const TypePrototype* AcquirePrototype(const SessionContext& sessionContext, IDiaSymbol* type)
     {
-        if (node && !typeContext.virtualBases.empty())
+        if (type == nullptr)
         {
-            //Add all the found virtual bases at the end of the structure
-            for (Layout::Node* vb : typeContext.virtualBases)
+            return nullptr;
+        }
+
+        const DWORD id = Helpers::QueryDIAFunction(type, &IDiaSymbol::get_symIndexId);
+        auto found = sessionContext.typeMemo.find(id);
+        if (found == sessionContext.typeMemo.end())
+        {
+            if (sessionContext.typeTooDeep || sessionContext.typeDepth >= MAX_TYPE_DEPTH)
             {
-                vb->offset = Helpers::AlignOffsetTo(node->size, vb->align);
-                node->size = vb->offset + vb->size;
-                node->children.emplace_back(vb);
+                if (!sessionContext.typeTooDeep)
+                {
+                    LOG_ERROR("The type nesting goes deeper than %u levels at %s.", MAX_TYPE_DEPTH, GetTypeName(type).c_str());
+                }
+                sessionContext.typeTooDeep = true;
+                return nullptr;
             }
-            node->size = Helpers::AlignOffsetTo(node->size, sessionContext.pointerSize);
+
+            TypeContext prototypeContext;
+            ++sessionContext.typeDepth;
+            const Layout::TIndex prototype = ComputeTypePrototype(sessionContext, prototypeContext, type);
+            --sessionContext.typeDepth;
+            found = sessionContext.typeMemo.emplace(id, TypePrototype{ prototype, std::move(prototypeContext.virtualBases) }).first;
+        }
+        else
+        {
+            Trace::AddCounter("typesReused", 1);
+        }
+
+        return &found->second;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TIndex CopyPrototype(const SessionContext& sessionContext, TypeContext& typeContext, const TypePrototype& prototype)
+    {
+        Layout::Store& store = sessionContext.store;
+        for (const Layout::TIndex virtualBase : prototype.virtualBases)
+        {
+            if (!HasVirtualBase(sessionContext, typeContext, virtualBase))
+            {
+                //the root places the virtual bases, each context needs its own copy
+                const Layout::FlatNode copy = store.nodes[virtualBase];
+                AddVirtualBase(sessionContext, typeContext, store.AddNode(copy));
+            }
+        }
+
+        if (prototype.node == NO_NODE)
+        {
+            return NO_NODE;
+        }
+
+        const Layout::FlatNode copy = store.nodes[prototype.node];
+        return store.AddNode(copy);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    Layout::TIndex ComputeTypeRecursive(const SessionContext& sessionContext, TypeContext& typeContext, IDiaSymbol* type)
+    {
+        const TypePrototype* prototype = AcquirePrototype(sessionContext, type);
+        return prototype ? CopyPrototype(sessionContext, typeContext, *prototype) : NO_NODE;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void FixVirtualBases(const SessionContext& sessionContext, const TypeContext& typeContext, const Layout::TIndex node, IDiaSymbol* type)
+    {
+        if (node != NO_NODE && !typeContext.virtualBases.empty())
+        {
+            Layout::Store& store = sessionContext.store;
+
+            //Add all the found virtual bases at the end of the structure, in a children range of its own as the copy shares the prototype one
+            Layout::TIndices children(store.ChildrenBegin(store.nodes[node]), store.ChildrenEnd(store.nodes[node]));
+            Layout::TAmount size = store.nodes[node].size;
+            for (const Layout::TIndex vb : typeContext.virtualBases)
+            {
+                Layout::FlatNode& vbNode = store.nodes[vb];
+                vbNode.offset = Helpers::AlignOffsetTo(size, vbNode.align);
+                size = vbNode.offset + vbNode.size;
+                children.emplace_back(vb);
+            }
+            size = Helpers::AlignOffsetTo(size, sessionContext.pointerSize);
+            store.SetChildren(node, children.data(), static_cast<Layout::TIndex>(children.size()));
 
             //restore the OG node size 
             const Layout::TAmount correctSize = Helpers::QueryDIAFunction(type, &IDiaSymbol::get_length);
-            if (correctSize != node->size)
+            if (correctSize != size)
             {
-                LOG_WARNING("Found different struct sizes constructing the virutal bases: got %d and expected %d from the queried type. The layout might have mistakes!", node->size, correctSize);
+                LOG_WARNING("Found different struct sizes constructing the virutal bases: got %d and expected %d from the queried type. The layout might have mistakes!", size, correctSize);
             }
-            node->size = correctSize;
-            node->align = GuessAlignment(node, type); //re-guess alignment as the virtual bases might have changed the overall alignment
+
+            Layout::FlatNode& fixedNode = store.nodes[node];
+            fixedNode.size = correctSize;
+            fixedNode.align = GuessAlignment(sessionContext, fixedNode, type); //re-guess alignment as the virtual bases might have changed the overall alignment
         }
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    Layout::Node* ComputeType(const SessionContext& context, IDiaSymbol* type)
+    Layout::TIndex ComputeType(const SessionContext& context, IDiaSymbol* type)
     {
+        TRACE_SCOPE("ComputeType");
+
+        context.typeTooDeep = false;
+
+        const TypePrototype* prototype = AcquirePrototype(context, type);
+        if (context.typeTooDeep)
+        {
+            //the prototypes computed on the way miss their deepest members, none can be reused
+            context.store.Clear();
+            context.typeMemo.clear();
+            context.exportNodes = context.exportChildren = 0u;
+            return NO_NODE;
+        }
+
+        if (prototype == nullptr)
+        {
+            return NO_NODE;
+        }
+
+        //the prototypes stay in the store for the next exports, the copies made from here on are released with the result
+        context.exportNodes = context.store.nodes.size();
+        context.exportChildren = context.store.children.size();
+
         TypeContext typeContext;
-        Layout::Node* node = ComputeTypeRecursive(context, typeContext, type);
+        const Layout::TIndex node = CopyPrototype(context, typeContext, *prototype);
         FixVirtualBases(context, typeContext, node, type);
         return node;
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    IDiaSymbol* FindSymbolAtLocation(const SessionContext& context, const wchar_t* filename, const DWORD line)
+    const wchar_t* GetDefinitionLocation(IDiaSymbol* type, DWORD& line)
     {
+        IDiaLineNumber* location = Helpers::QueryDIAFunction(type, &IDiaSymbol::getSrcLineOnTypeDefn);
+        IDiaSourceFile* file = Helpers::QueryDIAFunction(location, &IDiaLineNumber::get_sourceFile);
+        line = Helpers::QueryDIAFunction(location, &IDiaLineNumber::get_lineNumber);
+        return location ? Helpers::QueryDIAFunction(file, &IDiaSourceFile::get_fileName) : nullptr;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    PDB::IndexKey GetIndexKey(const SessionContext& context)
+    {
+        const GUID guid = Helpers::QueryDIAFunction(context.globalScope, &IDiaSymbol::get_guid);
+
+        PDB::IndexKey key;
+        memcpy(key.guid, &guid, sizeof(key.guid));
+        key.age = Helpers::QueryDIAFunction(context.globalScope, &IDiaSymbol::get_age);
+        key.idKind = PDB::IndexIdKind::DIASymbol;
+        return key;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Walks every UDT once, answering the query and writing the location index for the next ones
+    IDiaSymbol* BuildLocationIndex(const SessionContext& context, const wchar_t* filename, const DWORD line)
+    {
+        TRACE_SCOPE("BuildLocationIndex");
+
         unsigned int totalUdtCount = 0u;
+        IDiaSymbol* ret = nullptr;
+        PDB::LocationIndexBuilder builder;
 
         IDiaEnumSymbols* children = Helpers::FindChildren(context.globalScope, SymTagUDT);
         while (IDiaSymbol* child = Helpers::Next(children, &IDiaEnumSymbols::Next))
         {
             ++totalUdtCount;
 
-            IDiaLineNumber* location = Helpers::QueryDIAFunction(child, &IDiaSymbol::getSrcLineOnTypeDefn);
-            const DWORD     lineNumber = Helpers::QueryDIAFunction(location, &IDiaLineNumber::get_lineNumber);
-            IDiaSourceFile* childFile = Helpers::QueryDIAFunction(location, &IDiaLineNumber::get_sourceFile);
-            const DWORD     childFileId = Helpers::QueryDIAFunction(childFile, &IDiaSourceFile::get_uniqueId);
-            const wchar_t* childFilename = Helpers::QueryDIAFunction(childFile, &IDiaSourceFile::get_fileName);
-
-            if (location && childFilename && lineNumber == line && Helpers::SameFilename(childFilename, filename))
+            DWORD lineNumber = 0;
+            const wchar_t* childFilename = GetDefinitionLocation(child, lineNumber);
+            if (childFilename)
             {
-                return child;
+                builder.Add(Helpers::wchar2string(childFilename).c_str(), lineNumber, Helpers::QueryDIAFunction(child, &IDiaSymbol::get_symIndexId));
+
+                if (!ret && lineNumber == line && Helpers::SameFilename(childFilename, filename))
+                {
+                    ret = child;
+                }
             }
         }
 
+        Trace::AddCounter("recordsVisited", totalUdtCount);
+
         if (totalUdtCount == 0)
         {
             LOG_WARNING("There were no User Defined Types found in the input symbol database.");
         }
 
+        if (!builder.Write(context.indexPath.c_str(), GetIndexKey(context)))
+        {
+            LOG_WARNING("Unable to write the location index %s, the next queries will walk the whole pdb again.", context.indexPath.c_str());
+        }
+
+        return ret;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    IDiaSymbol* FindSymbolAtLocation(const SessionContext& context, const wchar_t* filename, const DWORD line)
+    {
+        TRACE_SCOPE("FindSymbolAtLocation");
+
+        PDB::LocationIndex index;
+        if (index.Open(context.indexPath.c_str(), GetIndexKey(context)))
+        {
+            const DWORD id = index.Find(Helpers::wchar2string(filename).c_str(), line);
+            if (id == 0u)
+            {
+                return nullptr;
+            }
+
+            //the symbol ids are assigned by DIA, only trust them while they still point at the same definition
+            IDiaSymbol* symbol = nullptr;
+            DWORD lineNumber = 0;
+            if (context.session->symbolById(id, &symbol) == S_OK && Helpers::SameFilename(GetDefinitionLocation(symbol, lineNumber), filename) && lineNumber == line)
+            {
+                return symbol;
+            }
+
+            LOG_INFO("The location index %s does not match the DIA symbol ids, it will be rebuilt.", context.indexPath.c_str());
+            index.Close();
+        }
+
+        return BuildLocationIndex(context, filename, line);
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    IDiaSymbol* FindSymbolByName(const SessionContext& context, const wchar_t* typeName)
+    {
+        TRACE_SCOPE("FindSymbolByName");
+
+        //DIA answers name queries from its hashed symbol tables, the first definition with a size wins over the forward declarations
+        IDiaEnumSymbols* children = nullptr;
+        if (context.globalScope->findChildrenEx(SymTagUDT, typeName, nsfCaseSensitive, &children) == S_OK)
+        {
+            while (IDiaSymbol* child = Helpers::Next(children, &IDiaEnumSymbols::Next))
+            {
+                if (Helpers::QueryDIAFunction(child, &IDiaSymbol::get_length) > 0)
+                {
+                    return child;
+                }
+            }
+        }
+
+        LOG_WARNING("No type definition named %s found in the input symbol database.", Helpers::wchar2string(typeName).c_str());
         return nullptr;
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    bool ExportResult(Layout::Result& result, const wchar_t* outputPath)
+    bool ExportResult(const SessionContext& context, const Layout::TIndex node, const size_t numNodes, const wchar_t* outputPath)
     {
+        Layout::Store& store = context.store;
+        if (node != NO_NODE)
+        {
+            store.roots.push_back(node);
+        }
+
+        if (Trace::IsEnabled())
+        {
+            Trace::AddCounter("nodesCreated", static_cast<long long>(store.nodes.size() - numNodes));
+            Trace::AddCounter("lookupTableFiles", static_cast<long long>(store.files.size()));
+        }
+
         const std::string outputStr = Helpers::wchar2string(outputPath);
         const char* outputFileName = outputStr.size() == 0 ? "output.slbin" : outputStr.c_str();
-        return IO::ToFile(result, outputFileName);
+        Layout::PostProcess(store);
+        return IO::ToFile(store, outputFileName);
     }
 
     // -----------------------------------------------------------------------------------------------------------
-    bool ExportAtLocation(const wchar_t* pdbFile, const wchar_t* filename, const int line, const wchar_t* outputPath)
-	{
+    // The prototypes stay in the store for the next exports of the session, only the copies made for this result go
+    void ReleaseResult(const SessionContext& context)
+    {
+        context.store.nodes.resize(context.exportNodes);
+        context.store.children.resize(context.exportChildren);
+        context.store.roots.clear();
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    SessionContext* OpenSession(const wchar_t* pdbFile)
+    {
         if (!pdbFile)
         {
             LOG_ERROR("No pdb file path provided.");
-            return false;
+            return nullptr;
         }
 
+        SessionContext* context = new SessionContext(OpenPDBSession(pdbFile));
+        if (!context->session || !context->globalScope)
+        {
+            CloseSession(context);
+            return nullptr;
+        }
+        return context;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    void CloseSession(SessionContext* context)
+    {
+        if (context)
+        {
+            //releasing the source closes the pdb file
+            if (context->globalScope) context->globalScope->Release();
+            if (context->session) context->session->Release();
+            if (context->source) context->source->Release();
+            delete context;
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportAtLocation(SessionContext& context, const wchar_t* filename, const int line, const wchar_t* outputPath, bool& found)
+    {
         if (!outputPath)
         {
             LOG_ERROR("No output file path provided.");
@@ -666,17 +962,74 @@ namespace PDBReader
             return false;
         }
 
-        SessionContext context = OpenPDBSession(pdbFile);
+        TRACE_SCOPE("PDBReader::ExportAtLocation");
 
-        if (!context.session || !context.globalScope)
+        const size_t numNodes = context.store.nodes.size();
+        IDiaSymbol* symbol = FindSymbolAtLocation(context, filename, line);
+        const Layout::TIndex node = ComputeType(context, symbol);
+        if (context.typeTooDeep)
         {
+            found = false;
             return false;
         }
 
-        Layout::Result result;
-        IDiaSymbol* symbol = FindSymbolAtLocation(context, filename, line);
-        result.node = ComputeType(context, symbol);
+        found = node != NO_NODE;
+        const bool written = ExportResult(context, node, numNodes, outputPath);
+        ReleaseResult(context);
+        return written;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportType(SessionContext& context, const wchar_t* typeName, const wchar_t* outputPath, bool& found)
+    {
+        if (!outputPath)
+        {
+            LOG_ERROR("No output file path provided.");
+            return false;
+        }
+
+        if (!typeName)
+        {
+            LOG_ERROR("No type name provided.");
+            return false;
+        }
+
+        TRACE_SCOPE("PDBReader::ExportType");
+
+        const size_t numNodes = context.store.nodes.size();
+        IDiaSymbol* symbol = FindSymbolByName(context, typeName);
+        const Layout::TIndex node = ComputeType(context, symbol);
+        if (context.typeTooDeep)
+        {
+            found = false;
+            return false;
+        }
+
+        found = node != NO_NODE;
+        const bool written = ExportResult(context, node, numNodes, outputPath);
+        ReleaseResult(context);
+        return written;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportAtLocation(const wchar_t* pdbFile, const wchar_t* filename, const int line, const wchar_t* outputPath)
+    {
+        SessionContext* context = OpenSession(pdbFile);
+        bool found = false;
+        const bool ret = context && ExportAtLocation(*context, filename, line, outputPath, found);
+        CloseSession(context);
+        return ret;
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool ExportType(const wchar_t* pdbFile, const wchar_t* typeName, const wchar_t* outputPath)
+    {
+        SessionContext* context = OpenSession(pdbFile);
+        bool found = false;
+        const bool ret = context && ExportType(*context, typeName, outputPath, found);
+        CloseSession(context);
+        return ret;
+    }
+}
 
-        return ExportResult(result, outputPath);
-	}
-}
\ No newline at end of file
+#endif //_WIN32
@@ -0,0 +1,309 @@
+#include "Server.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include "IO.h"
+#include "Trace.h"
+
+#include "CommandLine.h"
+#include "NativeReader.h"
+#include "PDBReader.h"
+
+namespace Server
+{
+    // Each request is a single stdin line with the same arguments as a one-shot invocation:
+    //   [-i <pdb>] -lf <file> -lr <line> [-o <output>]
+    //   [-i <pdb>] -tn <type name> [-o <output>]
+    // The pdb given at startup is used when the request has none, arguments holding spaces go between double quotes.
+    // Each answer is a single stdout line: 'OK <ms>', 'NOTFOUND <ms>' or 'ERROR <ms>'.
+    // The session and its computed types stay loaded between requests. The pdb file is checked before each request and
+    // the session reopened when it changed on disk, as a relink rewrites it with a new guid or age.
+
+    namespace Helpers
+    {
+        // -----------------------------------------------------------------------------------------------------------
+        std::string wchar2string(const wchar_t* str)
+        {
+            std::string ret;
+            if (str)
+            {
+                while (*str) { ret += (char)*str++; }
+            }
+            return  ret;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        long GetElapsedMiliseconds(const std::chrono::steady_clock::time_point& start)
+        {
+            return static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        // Splits a request in arguments, double quotes group the spaces
+        void Tokenize(std::vector<std::wstring>& output, const std::string& line)
+        {
+            std::wstring token;
+            bool inToken = false;
+            bool inQuotes = false;
+            for (const char c : line)
+            {
+                if (c == '"')
+                {
+                    inQuotes = !inQuotes;
+                    inToken = true;
+                }
+                else if (!inQuotes && (c == ' ' || c == '\t' || c == '\r'))
+                {
+                    if (inToken)
+                    {
+                        output.push_back(token);
+                        token.clear();
+                        inToken = false;
+                    }
+                }
+                else
+                {
+                    token += static_cast<wchar_t>(static_cast<unsigned char>(c));
+                    inToken = true;
+                }
+            }
+
+            if (inToken)
+            {
+                output.push_back(token);
+            }
+        }
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    // Last write time and size of the pdb, a relink always changes the first one
+    struct FileStamp
+    {
+        bool operator==(const FileStamp& other) const { return time == other.time && size == other.size && id == other.id; }
+        bool operator!=(const FileStamp& other) const { return !(*this == other); }
+
+        unsigned long long time = 0u;
+        unsigned long long size = 0u;
+        unsigned long long id   = 0u; // inode, catches a file replaced within the timestamp resolution
+    };
+
+#ifdef _WIN32
+    // -----------------------------------------------------------------------------------------------------------
+    bool GetFileStamp(FileStamp& output, const wchar_t* filename)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA data;
+        if (!GetFileAttributesExW(filename, GetFileExInfoStandard, &data))
+        {
+            return false;
+        }
+
+        output.time = (static_cast<unsigned long long>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+        output.size = (static_cast<unsigned long long>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        output.id = 0u;
+        return true;
+    }
+#else
+    // -----------------------------------------------------------------------------------------------------------
+    bool GetFileStamp(FileStamp& output, const wchar_t* filename)
+    {
+        struct stat info;
+        if (stat(Helpers::wchar2string(filename).c_str(), &info) != 0)
+        {
+            return false;
+        }
+
+        output.time = static_cast<unsigned long long>(info.st_mtime);
+        output.size = static_cast<unsigned long long>(info.st_size);
+        output.id = static_cast<unsigned long long>(info.st_ino);
+        return true;
+    }
+#endif
+
+    // -----------------------------------------------------------------------------------------------------------
+    // The loaded pdb with the backend chosen at startup
+    class Session
+    {
+    public:
+        explicit Session(const bool native)
+            : m_native(native)
+            , m_diaSession(nullptr)
+            , m_nativeSession(nullptr)
+            , m_numLoads(0u)
+        {}
+
+        ~Session() { Close(); }
+
+        bool IsOpen() const { return m_diaSession != nullptr || m_nativeSession != nullptr; }
+        unsigned int GetNumLoads() const { return m_numLoads; }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool Acquire(const wchar_t* pdbFile)
+        {
+            if (!pdbFile)
+            {
+                LOG_ERROR("No pdb file path provided.");
+                return false;
+            }
+
+            FileStamp stamp;
+            if (!GetFileStamp(stamp, pdbFile))
+            {
+                LOG_ERROR("Unable to find the pdb file %s.", Helpers::wchar2string(pdbFile).c_str());
+                return false;
+            }
+
+            const bool samePdb = m_pdbFile == pdbFile;
+            if (IsOpen() && samePdb && stamp == m_stamp)
+            {
+                return true;
+            }
+
+            if (IsOpen() && samePdb)
+            {
+                LOG_PROGRESS("The pdb %s changed on disk, reloading it.", Helpers::wchar2string(pdbFile).c_str());
+            }
+
+            TRACE_SCOPE("Server::Load");
+
+            //a failed load, like a pdb still being written by the linker, is retried on the next request
+            Close();
+#ifdef _WIN32
+            if (!m_native)
+            {
+                m_diaSession = PDBReader::OpenSession(pdbFile);
+            }
+            else
+#endif
+            {
+                m_nativeSession = NativeReader::OpenSession(pdbFile);
+            }
+
+            m_pdbFile = pdbFile;
+            m_stamp = stamp;
+            ++m_numLoads;
+            return IsOpen();
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        void Close()
+        {
+#ifdef _WIN32
+            PDBReader::CloseSession(m_diaSession);
+#endif
+            NativeReader::CloseSession(m_nativeSession);
+            m_diaSession = nullptr;
+            m_nativeSession = nullptr;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------
+        bool Export(const ExportParams& params, bool& found)
+        {
+#ifdef _WIN32
+            if (m_diaSession)
+            {
+                return params.typeName ? PDBReader::ExportType(*m_diaSession, params.typeName, params.output, found) : PDBReader::ExportAtLocation(*m_diaSession, params.locationFile, params.locationLine, params.output, found);
+            }
+#endif
+            return params.typeName ? NativeReader::ExportType(*m_nativeSession, params.typeName, params.output, found) : NativeReader::ExportAtLocation(*m_nativeSession, params.locationFile, params.locationLine, params.output, found);
+        }
+
+    private:
+        bool                          m_native;
+        PDBReader::SessionContext*    m_diaSession;
+        NativeReader::SessionContext* m_nativeSession;
+        std::wstring                  m_pdbFile;
+        FileStamp                     m_stamp;
+        unsigned int                  m_numLoads;
+    };
+
+    // -----------------------------------------------------------------------------------------------------------
+    const char* ProcessRequest(Session& session, const ExportParams& defaultParams, const std::string& line)
+    {
+        TRACE_SCOPE("Server::Request");
+
+        std::vector<std::wstring> tokens;
+        tokens.emplace_back(L"PDBLayout");
+        Helpers::Tokenize(tokens, line);
+
+        std::vector<wchar_t*> argv;
+        for (std::wstring& token : tokens)
+        {
+            argv.push_back(&token[0]);
+        }
+
+        //the startup input and output apply unless the request overrides them
+        ExportParams params = defaultParams;
+        params.locationFile = nullptr;
+        params.locationLine = 0u;
+        params.typeName = nullptr;
+        if (CommandLine::Parse(params, static_cast<int>(argv.size()), argv.data()) != 0 || (!params.typeName && !params.locationFile))
+        {
+            LOG_ERROR("Invalid request: %s", line.c_str());
+            return "ERROR";
+        }
+
+        if (!session.Acquire(params.input))
+        {
+            return "ERROR";
+        }
+
+        bool found = false;
+        const bool written = session.Export(params, found);
+        return !written ? "ERROR" : found ? "OK" : "NOTFOUND";
+    }
+
+    // -----------------------------------------------------------------------------------------------------------
+    bool Run(const ExportParams& params)
+    {
+        Session session(params.native);
+
+        //preload the startup pdb so the first request is already warm
+        if (params.input)
+        {
+            session.Acquire(params.input);
+        }
+
+        LOG_PROGRESS("Layout server ready.");
+
+        unsigned int numRequests = 0u;
+        long slowestRequest = 0;
+
+        std::string line;
+        while (std::getline(std::cin, line))
+        {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (line == "quit") break;
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            const char* status = ProcessRequest(session, params, line);
+            const long miliseconds = Helpers::GetElapsedMiliseconds(start);
+
+            ++numRequests;
+            slowestRequest = miliseconds > slowestRequest ? miliseconds : slowestRequest;
+
+            IO::LogTime(IO::Verbosity::Info, "Request completed in ", miliseconds);
+            IO::Log(IO::Verbosity::Info, "\n");
+
+            fprintf(stdout, "%s %ld\n", status, miliseconds);
+            fflush(stdout);
+        }
+
+        LOG_PROGRESS("Served %u requests with %u pdb loads, the slowest took %ld ms.", numRequests, session.GetNumLoads(), slowestRequest);
+        Trace::AddCounter("serverRequests", numRequests);
+        Trace::AddCounter("serverLoads", session.GetNumLoads());
+        return true;
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+struct ExportParams;
+
+namespace Server
+{
+	bool Run(const ExportParams& params);
+}
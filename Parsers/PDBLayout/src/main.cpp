@@ -1,14 +1,25 @@
 #include "PDBReader.h"
+#include "NativeReader.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 #include "IO.h"
+#include "Trace.h"
 
 #include "CommandLine.h"
+#include "Server.h"
 
 constexpr int FAILURE = -1;
 constexpr int SUCCESS = 0;
 
 // -----------------------------------------------------------------------------------------------------------
-int wmain(int argc, wchar_t* argv[])
+int Run(int argc, wchar_t* argv[])
 {
     //Parse Command Line arguments
     ExportParams params;
@@ -17,6 +28,80 @@ int wmain(int argc, wchar_t* argv[])
         return FAILURE;
     }
 
+    //the trace filename is a plain char path like every other file written by the shared code
+    std::string traceFile;
+    for (const wchar_t* c = params.trace; c && *c; ++c) { traceFile += (char)*c; }
+    Trace::Session traceSession(params.trace ? traceFile.c_str() : nullptr);
+
+    if (params.server)
+    {
+        return Server::Run(params) ? SUCCESS : FAILURE;
+    }
+
     //Execute exporter
-    return PDBReader::ExportAtLocation(params.input, params.locationFile, params.locationLine, params.output) ? SUCCESS : FAILURE;
-}
\ No newline at end of file
+#ifdef _WIN32
+    if (!params.native)
+    {
+        return (params.typeName ? PDBReader::ExportType(params.input, params.typeName, params.output) : PDBReader::ExportAtLocation(params.input, params.locationFile, params.locationLine, params.output)) ? SUCCESS : FAILURE;
+    }
+#endif
+    return (params.typeName ? NativeReader::ExportType(params.input, params.typeName, params.output) : NativeReader::ExportAtLocation(params.input, params.locationFile, params.locationLine, params.output)) ? SUCCESS : FAILURE;
+}
+
+#ifdef _WIN32
+// -----------------------------------------------------------------------------------------------------------
+int wmain(int argc, wchar_t* argv[])
+{
+    return Run(argc, argv);
+}
+#else
+// the readers recurse once per nested type, this stack fits their depth limit (the Windows build reserves it at link time)
+constexpr size_t STACK_SIZE = 128u << 20;
+
+// -----------------------------------------------------------------------------------------------------------
+struct RunArgs
+{
+    int       argc;
+    wchar_t** argv;
+    int       ret;
+};
+
+// -----------------------------------------------------------------------------------------------------------
+void* RunThread(void* data)
+{
+    RunArgs& args = *static_cast<RunArgs*>(data);
+    args.ret = Run(args.argc, args.argv);
+    return nullptr;
+}
+
+// -----------------------------------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+    //the DIA backend is Windows only, elsewhere the native reader gets the arguments widened
+    std::vector<std::wstring> arguments(argc);
+    for (int i = 0; i < argc; ++i)
+    {
+        arguments[i].assign(argv[i], argv[i] + strlen(argv[i]));
+    }
+
+    std::vector<wchar_t*> wideArgv;
+    for (std::wstring& argument : arguments)
+    {
+        wideArgv.push_back(&argument[0]);
+    }
+
+    //the main thread stack size comes from the environment limits
+    RunArgs args = { argc, wideArgv.data(), FAILURE };
+    pthread_attr_t attributes;
+    pthread_t thread;
+    if (pthread_attr_init(&attributes) != 0 || pthread_attr_setstacksize(&attributes, STACK_SIZE) != 0 || pthread_create(&thread, &attributes, RunThread, &args) != 0)
+    {
+        LOG_ERROR("Unable to start the export thread.");
+        return FAILURE;
+    }
+
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attributes);
+    return args.ret;
+}
+#endif
\ No newline at end of file
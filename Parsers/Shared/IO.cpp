@@ -1,18 +1,29 @@
 #include "IO.h"
 
-#include <cstdio>
+#include <algorithm>
 #include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 #include "LayoutDefinitions.h"
+#include "LayoutFormat.h"
+#include "Platform.h"
+#include "Trace.h"
 
 namespace IO
 { 
-    enum { DATA_VERSION = 2 };
+    enum { DATA_VERSION = Layout::Format::DATA_VERSION };
 
-    using TBuffer = FILE*;
-    using U8 = char;
+    namespace Section = Layout::Format::Section;
+    using Layout::Format::FileHeader;
+    using Layout::Format::NodeRecord;
+
+    enum : uint32_t { INVALID_INDEX = 0xFFFFFFFF };
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////
     // Logging
@@ -69,96 +80,378 @@ namespace IO
 
 
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////
-    // Logging
+    // Export
     //////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     namespace Utils
     {
         // -----------------------------------------------------------------------------------------------------------------
-        template<typename T> void Binarize(FILE* stream, T input)
-        {
-            fwrite(&input, sizeof(T), 1, stream);
+        struct OutputBuffer
+        { 
+            template<typename T> void Write(const T& input) { WriteBytes(&input, sizeof(T)); }
+
+            void WriteBytes(const void* input, const size_t size)
+            { 
+                const char* bytes = static_cast<const char*>(input);
+                data.insert(data.end(), bytes, bytes + size);
+            }
+
+            uint64_t BeginSection()
+            { 
+                data.resize((data.size() + 7u) & ~static_cast<size_t>(7u), '\0');
+                return data.size();
+            }
+
+            std::vector<char> data;
+        };
+
+        // -----------------------------------------------------------------------------------------------------------------
+        struct Compaction
+        { 
+            // Only what the roots reach gets written, memoized prototypes and unused strings are dropped. 
+            // Nodes are numbered root by root so each type lands in a contiguous block of the node table.
+
+            std::vector<uint32_t>                         nodeRemap;    // by store node
+            std::vector<uint32_t>                         stringRemap;  // by store string
+            std::unordered_map<Layout::TIndex,uint32_t>   rangeRemap;   // by store first child
+            std::unordered_map<std::string_view,uint32_t> stringLookup; 
+
+            std::vector<Layout::TIndex>   nodes;    // store node per file node
+            std::vector<std::string_view> strings;
+            std::vector<uint32_t>         children;
+        };
+
+        // -----------------------------------------------------------------------------------------------------------------
+        uint32_t InternString(Compaction& compaction, std::string_view str)
+        { 
+            const std::pair<std::unordered_map<std::string_view,uint32_t>::iterator,bool> result = compaction.stringLookup.emplace(str, static_cast<uint32_t>(compaction.strings.size()));
+            if (result.second)
+            { 
+                compaction.strings.push_back(str);
+            }
+            return result.first->second;
         }
 
-        // -----------------------------------------------------------------------------------------------------------
-        void BinarizeString(FILE* stream, const std::string& str)
-        {
-            //Perform size encoding in 7bitSize format
-            size_t strSize = str.length();
-            do
-            {
-                const U8 val = strSize < 0x80 ? strSize & 0x7F : (strSize & 0x7F) | 0x80;
-                fwrite(&val, sizeof(U8), 1, stream);
-                strSize >>= 7;
+        // -----------------------------------------------------------------------------------------------------------------
+        uint32_t RemapString(Compaction& compaction, const Layout::Store& store, const Layout::TIndex str)
+        { 
+            if (compaction.stringRemap[str] == INVALID_INDEX)
+            { 
+                compaction.stringRemap[str] = InternString(compaction, store.strings.Get(str));
             }
-            while (strSize);
+            return compaction.stringRemap[str];
+        }
 
-            fwrite(str.c_str(), str.length(), 1, stream);
+        // -----------------------------------------------------------------------------------------------------------------
+        uint32_t RemapNode(Compaction& compaction, const Layout::TIndex node)
+        { 
+            if (compaction.nodeRemap[node] == INVALID_INDEX)
+            { 
+                compaction.nodeRemap[node] = static_cast<uint32_t>(compaction.nodes.size());
+                compaction.nodes.push_back(node);
+            }
+            return compaction.nodeRemap[node];
         }
 
         // -----------------------------------------------------------------------------------------------------------------
-        void BinarizeLocation(FILE* stream, const Layout::Location& location)
+        void Compact(Compaction& compaction, const Layout::Store& store)
         { 
-            Binarize(stream,location.fileIndex);
+            compaction.nodeRemap.assign(store.nodes.size(), INVALID_INDEX);
+            compaction.stringRemap.assign(store.strings.Size(), INVALID_INDEX);
 
-            if (location.fileIndex != Layout::INVALID_FILE_INDEX)
+            size_t next = 0u;
+            for (const Layout::TIndex root : store.roots)
             { 
-                //valid filename, serialize also line and column
-                Binarize(stream,location.line);
-                Binarize(stream,location.column);
+                RemapNode(compaction, root);
+
+                for (; next < compaction.nodes.size(); ++next)
+                { 
+                    const Layout::FlatNode& node = store.nodes[compaction.nodes[next]];
+                    RemapString(compaction, store, node.type);
+                    RemapString(compaction, store, node.name);
+
+                    //shared children ranges are only written once
+                    if (node.numChildren > 0u && compaction.rangeRemap.emplace(node.firstChild, static_cast<uint32_t>(compaction.children.size())).second)
+                    { 
+                        for (const Layout::TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+                        { 
+                            compaction.children.push_back(RemapNode(compaction, *child));
+                        }
+                    }
+                }
             }
         }
 
         // -----------------------------------------------------------------------------------------------------------------
-        void BinarizeNode(FILE* stream,const Layout::Node& node)
-        {       
-            BinarizeString(stream,node.type);
-            BinarizeString(stream,node.name);
-            Binarize(stream,node.offset);
-            Binarize(stream,node.size);
-            Binarize(stream,node.align);
-            Binarize(stream,node.nature);
-            Binarize(stream,node.isValid);
-
-            BinarizeLocation(stream,node.typeLocation);
-            BinarizeLocation(stream,node.fieldLocation);
-
-            Binarize(stream,static_cast<unsigned int>(node.children.size()));
-            for (const Layout::Node* child : node.children)
-            { 
-                BinarizeNode(stream,*child);
-            }  
+        void Serialize(OutputBuffer& buffer, const Layout::Store& store)
+        { 
+            Compaction compaction;
+            Compact(compaction, store);
+
+            std::vector<uint32_t> files;
+            files.reserve(store.files.size());
+            for (const std::string& file : store.files)
+            { 
+                files.push_back(InternString(compaction, file));
+            }
+
+            FileHeader header = {};
+            header.version     = DATA_VERSION;
+            header.numStrings  = static_cast<uint32_t>(compaction.strings.size());
+            header.numFiles    = static_cast<uint32_t>(files.size());
+            header.numNodes    = static_cast<uint32_t>(compaction.nodes.size());
+            header.numChildren = static_cast<uint32_t>(compaction.children.size());
+            header.numRoots    = static_cast<uint32_t>(store.roots.size());
+
+            //placeholder, patched once the section offsets are known
+            buffer.Write(header);
+
+            header.sections[Section::StringOffsets] = buffer.BeginSection();
+            uint32_t stringOffset = 0u;
+            for (const std::string_view str : compaction.strings)
+            { 
+                buffer.Write(stringOffset);
+                stringOffset += static_cast<uint32_t>(str.size()) + 1u;
+            }
+            buffer.Write(stringOffset);
+
+            header.sections[Section::StringData] = buffer.BeginSection();
+            for (const std::string_view str : compaction.strings)
+            { 
+                buffer.WriteBytes(str.data(), str.size());
+                buffer.Write('\0');
+            }
+
+            header.sections[Section::Files] = buffer.BeginSection();
+            buffer.WriteBytes(files.data(), files.size() * sizeof(uint32_t));
+
+            header.sections[Section::Nodes] = buffer.BeginSection();
+            for (const Layout::TIndex index : compaction.nodes)
+            { 
+                const Layout::FlatNode& node = store.nodes[index];
+
+                NodeRecord record = {};
+                record.type        = compaction.stringRemap[node.type];
+                record.name        = compaction.stringRemap[node.name];
+                record.firstChild  = node.numChildren > 0u ? compaction.rangeRemap[node.firstChild] : 0u;
+                record.numChildren = node.numChildren;
+                record.offset      = node.offset;
+                record.size        = node.size;
+                record.realSize    = node.realSize;
+                record.align       = static_cast<uint32_t>(node.align);
+                record.typeFile    = node.typeLocation.fileIndex;
+                record.typeLine    = node.typeLocation.line;
+                record.typeColumn  = node.typeLocation.column;
+                record.fieldFile   = node.fieldLocation.fileIndex;
+                record.fieldLine   = node.fieldLocation.line;
+                record.fieldColumn = node.fieldLocation.column;
+                record.nature      = static_cast<uint8_t>(node.nature);
+                record.isValid     = node.isValid ? 1u : 0u;
+                buffer.Write(record);
+            }
+
+            header.sections[Section::Children] = buffer.BeginSection();
+            buffer.WriteBytes(compaction.children.data(), compaction.children.size() * sizeof(uint32_t));
+
+            header.sections[Section::Roots] = buffer.BeginSection();
+            std::vector<uint32_t> roots;
+            roots.reserve(store.roots.size());
+            for (const Layout::TIndex root : store.roots)
+            { 
+                roots.push_back(compaction.nodeRemap[root]);
+            }
+            buffer.WriteBytes(roots.data(), roots.size() * sizeof(uint32_t));
+
+            header.sections[Section::Index] = buffer.BeginSection();
+            std::vector<uint32_t> index(roots.size());
+            for (uint32_t i = 0u; i < index.size(); ++i)
+            { 
+                index[i] = i;
+            }
+            std::stable_sort(index.begin(), index.end(), [&](const uint32_t a, const uint32_t b){ return store.strings.Get(store.nodes[store.roots[a]].type) < store.strings.Get(store.nodes[store.roots[b]].type); });
+            buffer.WriteBytes(index.data(), index.size() * sizeof(uint32_t));
+
+            memcpy(buffer.data.data(), &header, sizeof(header));
         }
 
         // -----------------------------------------------------------------------------------------------------------------
-        void BinarizeFiles(FILE* stream, const Layout::TFiles& files)
+        bool WriteFile(const OutputBuffer& buffer, const char* filename)
+        { 
+            FILE* stream;
+            const errno_t openResult = fopen_s(&stream, filename, "wb");
+            if (openResult)
+            {
+                return false;
+            }
+
+            //a single write, the whole file is serialized in memory first
+            const bool written = buffer.data.empty() || fwrite(buffer.data.data(), buffer.data.size(), 1, stream) == 1;
+            return fclose(stream) == 0 && written;
+        }
+    }
+
+    bool ToFile(const Layout::Store& store, const char* filename)
+    {
+        TRACE_SCOPE("IO::ToFile");
+
+        Utils::OutputBuffer buffer;
         {
-            Binarize(stream,static_cast<unsigned int>(files.size()));
-            for (const std::string& file : files)
+            TRACE_SCOPE("IO::Serialize");
+            if (store.roots.empty())
+            {
+                //an empty result only holds the version
+                buffer.Write(static_cast<int32_t>(DATA_VERSION));
+            }
+            else
+            {
+                Utils::Serialize(buffer, store);
+            }
+        }
+
+        Trace::AddCounter("bytesWritten", static_cast<long long>(buffer.data.size()));
+
+        TRACE_SCOPE("IO::WriteFile");
+        return Utils::WriteFile(buffer, filename);
+    }
+
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    // Import
+    //////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+    namespace Utils
+    {
+        // -----------------------------------------------------------------------------------------------------------------
+        bool ReadFile(std::vector<char>& output, const char* filename)
+        { 
+            FILE* stream;
+            const errno_t openResult = fopen_s(&stream, filename, "rb");
+            if (openResult)
+            {
+                return false;
+            }
+
+            char chunk[64*1024];
+            size_t read = 0u;
+            while ((read = fread(chunk, 1, sizeof(chunk), stream)) > 0u)
             { 
-                BinarizeString(stream,file);
-            }  
+                output.insert(output.end(), chunk, chunk + read);
+            }
+
+            const bool failed = ferror(stream) != 0;
+            fclose(stream);
+            return !failed;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------------
+        template<typename T> const T* GetSection(const std::vector<char>& data, const FileHeader& header, const Section::Type section, const uint64_t count)
+        { 
+            //null when the section doesn't fit in the file
+            const uint64_t offset = header.sections[section];
+            return offset % alignof(T) == 0u && offset <= data.size() && count <= (data.size() - offset) / sizeof(T) ? reinterpret_cast<const T*>(data.data() + offset) : nullptr;
+        }
+
+        // -----------------------------------------------------------------------------------------------------------------
+        bool Deserialize(Layout::Store& store, const std::vector<char>& data)
+        { 
+            FileHeader header;
+            memcpy(&header, data.data(), sizeof(header));
+
+            const uint32_t* stringOffsets = GetSection<uint32_t>(data, header, Section::StringOffsets, static_cast<uint64_t>(header.numStrings) + 1u);
+            const uint32_t* files         = GetSection<uint32_t>(data, header, Section::Files, header.numFiles);
+            const NodeRecord* nodes       = GetSection<NodeRecord>(data, header, Section::Nodes, header.numNodes);
+            const uint32_t* children      = GetSection<uint32_t>(data, header, Section::Children, header.numChildren);
+            const uint32_t* roots         = GetSection<uint32_t>(data, header, Section::Roots, header.numRoots);
+            const char* stringData        = stringOffsets ? GetSection<char>(data, header, Section::StringData, stringOffsets[header.numStrings]) : nullptr;
+
+            if (!stringOffsets || !stringData || !files || !nodes || !children || !roots)
+            { 
+                return false;
+            }
+
+            Layout::TIndices stringRemap(header.numStrings);
+            for (uint32_t i = 0u; i < header.numStrings; ++i)
+            { 
+                if (stringOffsets[i] >= stringOffsets[i+1]) return false;
+                stringRemap[i] = store.strings.Intern(std::string_view(stringData + stringOffsets[i], stringOffsets[i+1] - stringOffsets[i] - 1u));
+            }
+
+            for (uint32_t i = 0u; i < header.numFiles; ++i)
+            { 
+                if (files[i] >= header.numStrings) return false;
+                store.files.emplace_back(store.strings.Get(stringRemap[files[i]]));
+            }
+
+            const Layout::TIndex nodeOffset     = static_cast<Layout::TIndex>(store.nodes.size());
+            const Layout::TIndex childrenOffset = static_cast<Layout::TIndex>(store.children.size());
+
+            store.nodes.reserve(store.nodes.size() + header.numNodes);
+            for (uint32_t i = 0u; i < header.numNodes; ++i)
+            { 
+                const NodeRecord& record = nodes[i];
+                if (record.type >= header.numStrings || record.name >= header.numStrings || record.firstChild > header.numChildren || record.numChildren > header.numChildren - record.firstChild)
+                { 
+                    return false;
+                }
+
+                Layout::FlatNode node;
+                node.type                    = stringRemap[record.type];
+                node.name                    = stringRemap[record.name];
+                node.firstChild              = record.firstChild + childrenOffset;
+                node.numChildren             = record.numChildren;
+                node.offset                  = record.offset;
+                node.size                    = record.size;
+                node.realSize                = record.realSize;
+                node.align                   = record.align;
+                node.typeLocation.fileIndex  = record.typeFile;
+                node.typeLocation.line       = record.typeLine;
+                node.typeLocation.column     = record.typeColumn;
+                node.fieldLocation.fileIndex = record.fieldFile;
+                node.fieldLocation.line      = record.fieldLine;
+                node.fieldLocation.column    = record.fieldColumn;
+                node.nature                  = static_cast<Layout::Category>(record.nature);
+                node.isValid                 = record.isValid != 0u;
+                store.nodes.push_back(node);
+            }
+
+            store.children.reserve(store.children.size() + header.numChildren);
+            for (uint32_t i = 0u; i < header.numChildren; ++i)
+            { 
+                if (children[i] >= header.numNodes) return false;
+                store.children.push_back(children[i] + nodeOffset);
+            }
+
+            for (uint32_t i = 0u; i < header.numRoots; ++i)
+            { 
+                if (roots[i] >= header.numNodes) return false;
+                store.roots.push_back(roots[i] + nodeOffset);
+            }
+
+            return true;
         }
     }
 
-    bool ToFile(const Layout::Result& result, const char* filename)
+    bool FromFile(Layout::Store& store, const char* filename)
     {
-        FILE* stream;
-        const errno_t openResult = fopen_s(&stream, filename, "wb");
-        if (openResult)
+        std::vector<char> data;
+        if (!Utils::ReadFile(data, filename))
         {
             return false;
         }
 
-        Utils::Binarize(stream, DATA_VERSION);
-
-        if (result.node)
-        {
-            Utils::BinarizeFiles(stream, result.files);
-            Utils::BinarizeNode(stream, *(result.node));
+        int32_t version = 0;
+        if (data.size() < sizeof(version) || (memcpy(&version, data.data(), sizeof(version)), version != DATA_VERSION))
+        { 
+            LOG_ERROR("Unsupported file version found in %s.", filename);
+            return false;
         }
 
-        fclose(stream);
+        //an empty result only holds the version
+        if (data.size() > sizeof(version) && (data.size() < sizeof(FileHeader) || !Utils::Deserialize(store, data)))
+        { 
+            LOG_ERROR("Unable to read %s, the file is truncated or corrupt.", filename);
+            store.Clear();
+            return false;
+        }
 
         return true;
     }
@@ -1,14 +1,14 @@
 #pragma once
 
 #define LOG_ALWAYS(...)   { IO::Log(IO::Verbosity::Always,__VA_ARGS__);               IO::Log(IO::Verbosity::Always,"\n");}
-#define LOG_ERROR(...)    { IO::Log(IO::Verbosity::Always,"[ERROR] "##__VA_ARGS__);   IO::Log(IO::Verbosity::Always,"\n");}
-#define LOG_WARNING(...)  { IO::Log(IO::Verbosity::Always,"[WARNING] "##__VA_ARGS__); IO::Log(IO::Verbosity::Always,"\n");}
+#define LOG_ERROR(...)    { IO::Log(IO::Verbosity::Always,"[ERROR] " __VA_ARGS__);  IO::Log(IO::Verbosity::Always,"\n");}
+#define LOG_WARNING(...)  { IO::Log(IO::Verbosity::Always,"[WARNING] " __VA_ARGS__); IO::Log(IO::Verbosity::Always,"\n");}
 #define LOG_PROGRESS(...) { IO::Log(IO::Verbosity::Progress,__VA_ARGS__);             IO::Log(IO::Verbosity::Progress,"\n");}
 #define LOG_INFO(...)     { IO::Log(IO::Verbosity::Info,__VA_ARGS__);                 IO::Log(IO::Verbosity::Info,"\n");}
 
 namespace Layout
 { 
-	struct Result;
+	struct Store;
 }
 
 namespace IO
@@ -32,5 +32,10 @@ namespace IO
     //////////////////////////////////////////////////////////////////////////////////////////
     // Export
 
-	bool ToFile(const Layout::Result& result, const char* filename);
+	bool ToFile(const Layout::Store& store, const char* filename);
+
+    //////////////////////////////////////////////////////////////////////////////////////////
+    // Import
+
+	bool FromFile(Layout::Store& store, const char* filename);
 }
\ No newline at end of file
@@ -1,7 +1,11 @@
 #pragma once
 
-#include <vector>
+#include <algorithm>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace Layout 
 {
@@ -26,6 +30,8 @@ namespace Layout
         VFTablePtr,
         VBTablePtr,
         VtorDisp,
+        Union,
+        Shared,
     };
 
     // ----------------------------------------------------------------------------------------------------------
@@ -43,21 +49,36 @@ namespace Layout
     };
 
     // ----------------------------------------------------------------------------------------------------------
-    struct Node
+    // The parsers build the layouts straight into a flat store: all nodes live in one array and reference their children 
+    // through a range of the children index array, so several nodes can share the same children range. 
+    // Strings are interned in an arena and referenced by index.
+
+    using TIndex   = unsigned int;
+    using TIndices = std::vector<TIndex>;
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct FlatNode
     { 
-        Node() 
-            : nature(Category::Root)
+        FlatNode() 
+            : name(0u)
+            , type(0u)
+            , firstChild(0u)
+            , numChildren(0u)
             , offset(0u)
             , size(1u)
+            , realSize(0u)
             , align(1u)
+            , nature(Category::Root)
             , isValid(true)
         {}
 
-        std::string        name;
-        std::string        type;
-        std::vector<Node*> children;
+        TIndex             name;        // string index
+        TIndex             type;        // string index
+        TIndex             firstChild;  // first entry in Store::children
+        TIndex             numChildren;
         TAmount            offset;
         TAmount            size;
+        TAmount            realSize;    // size minus padding, filled by Layout::PostProcess
         TAmount            align;
         Location           typeLocation;
         Location           fieldLocation;
@@ -66,13 +87,103 @@ namespace Layout
     };
 
     // ----------------------------------------------------------------------------------------------------------
-    struct Result
+    class StringPool
     { 
-        Result()
-            : node(nullptr)
-        {}
+    public:
+        StringPool()
+            : m_chunkUsed(0u)
+            , m_chunkSize(0u)
+        { 
+            Intern(""); //index 0 is always the empty string
+        }
+
+        TIndex Intern(std::string_view str)
+        { 
+            std::unordered_map<std::string_view,TIndex>::const_iterator found = m_lookup.find(str);
+            if (found != m_lookup.end())
+            { 
+                return found->second;
+            }
+
+            const std::string_view stored = Allocate(str);
+            const TIndex index = static_cast<TIndex>(m_strings.size());
+            m_strings.push_back(stored);
+            m_lookup.emplace(stored,index);
+            return index;
+        }
+
+        std::string_view Get(const TIndex index) const { return m_strings[index]; }
+        TIndex           Size() const                  { return static_cast<TIndex>(m_strings.size()); }
+
+        void Clear()
+        { 
+            m_lookup.clear();
+            m_strings.clear();
+            m_chunks.clear();
+            m_chunkUsed = m_chunkSize = 0u;
+            Intern("");
+        }
+
+    private:
+        static constexpr size_t CHUNK_SIZE = 64u*1024u;
+
+        std::string_view Allocate(std::string_view str)
+        { 
+            //chunks never move, the views stay valid until the pool is cleared
+            if (m_chunkUsed + str.size() + 1 > m_chunkSize)
+            { 
+                m_chunkSize = std::max(str.size() + 1u, CHUNK_SIZE);
+                m_chunks.emplace_back(new char[m_chunkSize]);
+                m_chunkUsed = 0u;
+            }
+
+            char* memory = m_chunks.back().get() + m_chunkUsed;
+            str.copy(memory, str.size());
+            memory[str.size()] = '\0';
+            m_chunkUsed += str.size() + 1;
+            return std::string_view(memory, str.size());
+        }
+
+    private:
+        std::vector<std::unique_ptr<char[]>>        m_chunks;
+        size_t                                      m_chunkUsed;
+        size_t                                      m_chunkSize;
+        std::vector<std::string_view>               m_strings;
+        std::unordered_map<std::string_view,TIndex> m_lookup;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    struct Store
+    { 
+        TIndex AddNode(const FlatNode& node)
+        { 
+            nodes.push_back(node);
+            return static_cast<TIndex>(nodes.size() - 1);
+        }
+
+        void SetChildren(const TIndex node, const TIndex* indices, const TIndex count)
+        { 
+            nodes[node].firstChild  = static_cast<TIndex>(children.size());
+            nodes[node].numChildren = count;
+            children.insert(children.end(), indices, indices + count);
+        }
+
+        const TIndex* ChildrenBegin(const FlatNode& node) const { return children.data() + node.firstChild; }
+        const TIndex* ChildrenEnd(const FlatNode& node) const   { return children.data() + node.firstChild + node.numChildren; }
+
+        void Clear()
+        { 
+            nodes.clear();
+            children.clear();
+            roots.clear();
+            files.clear();
+            strings.Clear();
+        }
 
-        Node*  node;
-        TFiles files; 
+        std::vector<FlatNode> nodes;
+        TIndices              children;
+        TIndices              roots;
+        TFiles                files;
+        StringPool            strings;
     };
 }
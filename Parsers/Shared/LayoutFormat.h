@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+// On disk layout of the .slbin files, shared by the IO export/import and the memory mapped reader
+
+namespace Layout
+{ 
+    namespace Format
+    { 
+        enum { DATA_VERSION = 6 };
+
+        // File layout, little endian with every section starting 8 byte aligned:
+        //   Header        : FileHeader, element counts and the file offset of every section
+        //   StringOffsets : numStrings + 1 offsets into the string data, string i spans [offsets[i], offsets[i+1] - 1)
+        //   StringData    : the unique strings, each one followed by a null terminator
+        //   Files         : string index per file
+        //   Nodes         : one NodeRecord per node, children are a range of the children section
+        //   Children      : node index per child, nodes copied from the same record share their range
+        //   Roots         : node index per root in export order
+        //   Index         : positions in the roots section sorted by type name, to look a type up with a binary search
+        // A file holding only the version is a valid empty result.
+
+        namespace Section
+        { 
+            enum Type { StringOffsets, StringData, Files, Nodes, Children, Roots, Index, Count };
+        }
+
+        struct FileHeader
+        { 
+            int32_t  version;
+            uint32_t numStrings;
+            uint32_t numFiles;
+            uint32_t numNodes;
+            uint32_t numChildren;
+            uint32_t numRoots;
+            uint64_t sections[Section::Count];
+        };
+
+        struct NodeRecord
+        { 
+            uint32_t type;        // string index
+            uint32_t name;        // string index
+            uint32_t firstChild;  // first entry in the children section
+            uint32_t numChildren;
+            int64_t  offset;
+            int64_t  size;
+            int64_t  realSize;    // size minus padding
+            uint32_t align;
+            int32_t  typeFile;
+            uint32_t typeLine;
+            uint32_t typeColumn;
+            int32_t  fieldFile;
+            uint32_t fieldLine;
+            uint32_t fieldColumn;
+            uint8_t  nature;
+            uint8_t  isValid;
+            uint8_t  padding[2];
+        };
+
+        static_assert(sizeof(FileHeader) == 80u, "FileHeader is part of the file format");
+        static_assert(sizeof(NodeRecord) == 72u, "NodeRecord is part of the file format");
+    }
+}
@@ -0,0 +1,444 @@
+#include "LayoutPostProcess.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+#include "LayoutDefinitions.h"
+#include "Trace.h"
+
+namespace Layout
+{
+    constexpr TIndex NO_NODE = 0xFFFFFFFF;
+
+    namespace Helpers
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        bool IsUnion(std::string_view type)
+        {
+            return type.substr(0, 5) == "union";
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Accumulates the real size of a node from its children in order, without buffering them
+        class RealSizeAccumulator
+        {
+        public:
+            RealSizeAccumulator(const bool isUnion, TIndices* counted = nullptr)
+                : m_counted(counted)
+                , m_isUnion(isUnion)
+                , m_hasChildren(false)
+                , m_hasGroup(false)
+                , m_total(0)
+                , m_end(0)
+                , m_prevOffset(0)
+                , m_prevSize(0)
+                , m_prevBitfield(false)
+                , m_groupOffset(0)
+                , m_groupSize(0)
+                , m_groupRealSize(0)
+                , m_groupChild(0u)
+            {}
+
+            void Add(const TAmount offset, const TAmount size, const TAmount realSize, const bool isBitfield, const TIndex child = 0u)
+            {
+                if (m_isUnion)
+                {
+                    //every member overlaps at the union start
+                    if (!m_hasChildren || realSize > m_total)
+                    {
+                        m_groupChild = child;
+                    }
+                    m_hasChildren = true;
+                    m_total = std::max(m_total, realSize);
+                    return;
+                }
+
+                if (size == 0)
+                {
+                    //empty bases and unexpected empty members take no space
+                    return;
+                }
+
+                if (isBitfield && m_prevBitfield && (offset == m_prevOffset || offset < m_prevOffset + m_prevSize))
+                {
+                    //bitfields sharing the storage of the previous one
+                    return;
+                }
+
+                m_hasChildren  = true;
+                m_prevOffset   = offset;
+                m_prevSize     = size;
+                m_prevBitfield = isBitfield;
+
+                if (m_hasGroup && offset == m_groupOffset)
+                {
+                    //members at the same offset share their memory
+                    m_groupSize     = std::max(m_groupSize, size);
+                    m_groupChild    = realSize > m_groupRealSize ? child : m_groupChild;
+                    m_groupRealSize = std::max(m_groupRealSize, realSize);
+                    return;
+                }
+
+                Flush();
+                m_hasGroup      = true;
+                m_groupOffset   = offset;
+                m_groupSize     = size;
+                m_groupRealSize = realSize;
+                m_groupChild    = child;
+            }
+
+            TAmount Finish(const TAmount size)
+            {
+                Flush();
+                if (m_isUnion && m_hasChildren && m_counted)
+                {
+                    m_counted->push_back(m_groupChild);
+                }
+                return m_hasChildren ? m_total : size;
+            }
+
+        private:
+            void Flush()
+            {
+                if (m_hasGroup)
+                {
+                    //members starting inside a previous one are already counted
+                    if (m_end <= m_groupOffset)
+                    {
+                        m_total += m_groupRealSize;
+                        if (m_counted) m_counted->push_back(m_groupChild);
+                    }
+                    m_end    = std::max(m_end, m_groupOffset + m_groupSize);
+                    m_hasGroup = false;
+                }
+            }
+
+        private:
+            TIndices* m_counted; // children adding to the total, the biggest one for overlapping groups
+            bool    m_isUnion;
+            bool    m_hasChildren;
+            bool    m_hasGroup;
+            TAmount m_total;
+            TAmount m_end;
+            TAmount m_prevOffset;
+            TAmount m_prevSize;
+            bool    m_prevBitfield;
+            TAmount m_groupOffset;
+            TAmount m_groupSize;
+            TAmount m_groupRealSize;
+            TIndex  m_groupChild;
+        };
+
+        // ----------------------------------------------------------------------------------------------------------
+        void PostProcessNode(std::vector<bool>& visited, Store& store, const TIndex index)
+        {
+            if (visited[index])
+            {
+                return;
+            }
+            visited[index] = true;
+
+            FlatNode& node = store.nodes[index];
+            if (node.nature == Category::Bitfield)
+            {
+                node.realSize = node.size;
+                return;
+            }
+
+            RealSizeAccumulator accumulator(IsUnion(store.strings.Get(node.type)));
+            for (const TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+            {
+                PostProcessNode(visited, store, *child);
+
+                const FlatNode& childNode = store.nodes[*child];
+                accumulator.Add(childNode.offset, childNode.size, childNode.realSize, childNode.nature == Category::Bitfield);
+            }
+            node.realSize = accumulator.Finish(node.size);
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void CollectUsedRanges(TRanges& output, const Store& store, const FlatNode& node, const TAmount offset)
+        {
+            TIndices counted;
+            if (node.nature != Category::Bitfield)
+            {
+                RealSizeAccumulator accumulator(IsUnion(store.strings.Get(node.type)), &counted);
+                for (const TIndex* child = store.ChildrenBegin(node), *end = store.ChildrenEnd(node); child != end; ++child)
+                {
+                    const FlatNode& childNode = store.nodes[*child];
+                    accumulator.Add(childNode.offset, childNode.size, childNode.realSize, childNode.nature == Category::Bitfield, *child);
+                }
+                accumulator.Finish(node.size);
+            }
+
+            //nodes without counted children are used as a whole, like the real size does
+            if (counted.empty())
+            {
+                output.emplace_back(offset, offset + node.size);
+                return;
+            }
+
+            for (const TIndex child : counted)
+            {
+                const FlatNode& childNode = store.nodes[child];
+                CollectUsedRanges(output, store, childNode, offset + childNode.offset);
+            }
+        }
+        // ----------------------------------------------------------------------------------------------------------
+        // Rebuilds the layouts the way the viewer displays them. The changed nodes and ranges are appended, the original
+        // ones stay untouched as they can be shared with the prototypes a reader session keeps for its next exports.
+        class LayoutShaper
+        {
+        public:
+            LayoutShaper(Store& store)
+                : m_store(store)
+                , m_shaped(store.nodes.size(), NO_NODE)
+                , m_bitfieldName(store.strings.Intern("Bitfield"))
+                , m_sharedName(store.strings.Intern("Shared Memory"))
+            {}
+
+            TIndex Shape(const TIndex index)
+            {
+                if (m_shaped[index] != NO_NODE)
+                {
+                    return m_shaped[index];
+                }
+
+                FlatNode node = m_store.nodes[index];
+                if (node.nature == Category::Bitfield)
+                {
+                    //bitfields alone in a union or in shared memory
+                    m_shaped[index] = AddBitfield(&index, 1u);
+                    return m_shaped[index];
+                }
+
+                const bool isUnion = IsUnion(m_store.strings.Get(node.type));
+                const TIndex firstChild = node.firstChild;
+                node.nature = isUnion ? Category::Union : node.nature;
+                ShapeChildren(node, isUnion);
+
+                const bool changed = node.firstChild != firstChild || node.nature != m_store.nodes[index].nature;
+                m_shaped[index] = changed ? m_store.AddNode(node) : index;
+                return m_shaped[index];
+            }
+
+        private:
+            void ShapeChildren(FlatNode& node, const bool isUnion)
+            {
+                if (node.numChildren == 0u)
+                {
+                    return;
+                }
+
+                //ranges are only shared between copies of the same record
+                const unsigned long long key = (static_cast<unsigned long long>(node.firstChild) << 32) | node.numChildren;
+                std::unordered_map<unsigned long long,TRange>::const_iterator found = m_ranges.find(key);
+                if (found != m_ranges.end())
+                {
+                    node.firstChild  = found->second.first;
+                    node.numChildren = found->second.second;
+                    return;
+                }
+
+                TIndices shaped;
+                shaped.reserve(node.numChildren);
+                if (isUnion)
+                {
+                    //every member overlaps, there is nothing to merge
+                    for (TIndex i = 0u; i < node.numChildren; ++i)
+                    {
+                        shaped.push_back(Shape(m_store.children[node.firstChild + i]));
+                    }
+                }
+                else
+                {
+                    MergeBitfields(shaped, node.firstChild, node.numChildren);
+                    ShareMemory(shaped);
+                }
+
+                const TIndex* original = m_store.children.data() + node.firstChild;
+                TIndex firstChild = node.firstChild;
+                if (shaped.size() != node.numChildren || !std::equal(shaped.begin(), shaped.end(), original))
+                {
+                    firstChild = static_cast<TIndex>(m_store.children.size());
+                    m_store.children.insert(m_store.children.end(), shaped.begin(), shaped.end());
+                }
+
+                m_ranges.emplace(key, TRange(firstChild, static_cast<TIndex>(shaped.size())));
+                node.firstChild  = firstChild;
+                node.numChildren = static_cast<TIndex>(shaped.size());
+            }
+
+            void MergeBitfields(TIndices& output, const TIndex firstChild, const TIndex numChildren)
+            {
+                //bitfields starting inside the storage of the previous one share it, empty members don't break the run
+                TIndices run;
+                size_t   runSlot   = 0u;
+                TAmount  runOffset = 0;
+                TAmount  runSize   = 0;
+
+                for (TIndex i = 0u; i < numChildren; ++i)
+                {
+                    const TIndex   child  = m_store.children[firstChild + i];
+                    const TAmount offset = m_store.nodes[child].offset;
+                    const TAmount size   = m_store.nodes[child].size;
+
+                    if (size > 0 && m_store.nodes[child].nature == Category::Bitfield)
+                    {
+                        if (!run.empty() && (offset == runOffset || offset < runOffset + runSize))
+                        {
+                            run.push_back(child);
+                            continue;
+                        }
+
+                        FlushBitfields(output, run, runSlot);
+                        runSlot   = output.size();
+                        runOffset = offset;
+                        runSize   = size;
+                        run.push_back(child);
+                        output.push_back(NO_NODE);
+                    }
+                    else
+                    {
+                        if (size > 0)
+                        {
+                            FlushBitfields(output, run, runSlot);
+                        }
+                        output.push_back(Shape(child));
+                    }
+                }
+
+                FlushBitfields(output, run, runSlot);
+            }
+
+            void FlushBitfields(TIndices& output, TIndices& run, const size_t slot)
+            {
+                if (!run.empty())
+                {
+                    output[slot] = AddBitfield(run.data(), static_cast<TIndex>(run.size()));
+                    run.clear();
+                }
+            }
+
+            TIndex AddBitfield(const TIndex* fields, const TIndex numFields)
+            {
+                //the bit ranges take the field name and type, and keep their alignment as the storage unit of the declared type
+                FlatNode bitfield = m_store.nodes[fields[0]];
+                TIndices bits;
+                for (TIndex i = 0u; i < numFields; ++i)
+                {
+                    const FlatNode field = m_store.nodes[fields[i]];
+                    for (TIndex j = 0u; j < field.numChildren; ++j)
+                    {
+                        FlatNode bit = m_store.nodes[m_store.children[field.firstChild + j]];
+                        bit.name   = field.name;
+                        bit.type   = field.type;
+                        bit.nature = Category::Bitfield;
+                        bit.align  = field.align;
+                        bit.offset += (field.offset - bitfield.offset) * 8;
+                        bits.push_back(m_store.AddNode(bit));
+                    }
+                }
+
+                bitfield.name = bits.size() > 1u ? m_bitfieldName : bitfield.name;
+                const TIndex index = m_store.AddNode(bitfield);
+                m_store.SetChildren(index, bits.data(), static_cast<TIndex>(bits.size()));
+                return index;
+            }
+
+            void ShareMemory(TIndices& members)
+            {
+                //consecutive members at the same offset are grouped, empty members are left where they are
+                TIndices group;
+                size_t   groupSlot = 0u;
+                size_t   used      = 0u;
+
+                for (const TIndex member : members)
+                {
+                    const bool isEmpty = m_store.nodes[member].size == 0;
+                    if (!isEmpty && !group.empty() && m_store.nodes[member].offset == m_store.nodes[group.front()].offset)
+                    {
+                        group.push_back(member);
+                        continue;
+                    }
+
+                    if (!isEmpty)
+                    {
+                        FlushShared(members, group, groupSlot);
+                        groupSlot = used;
+                        group.push_back(member);
+                    }
+                    members[used++] = member;
+                }
+
+                FlushShared(members, group, groupSlot);
+                members.resize(used);
+            }
+
+            void FlushShared(TIndices& members, TIndices& group, const size_t slot)
+            {
+                if (group.size() > 1u)
+                {
+                    FlatNode shared;
+                    shared.name     = m_sharedName;
+                    shared.nature   = Category::Shared;
+                    shared.offset   = m_store.nodes[group.front()].offset;
+                    shared.size     = 0;
+                    shared.realSize = 0;
+
+                    TIndices sharedMembers;
+                    for (const TIndex member : group)
+                    {
+                        FlatNode memberNode = m_store.nodes[member];
+                        shared.size     = std::max(shared.size, memberNode.size);
+                        shared.realSize = std::max(shared.realSize, memberNode.realSize);
+                        shared.align    = std::max(shared.align, memberNode.align);
+                        shared.isValid  = shared.isValid && memberNode.isValid;
+
+                        memberNode.offset = 0;
+                        sharedMembers.push_back(m_store.AddNode(memberNode));
+                    }
+
+                    const TIndex index = m_store.AddNode(shared);
+                    m_store.SetChildren(index, sharedMembers.data(), static_cast<TIndex>(sharedMembers.size()));
+                    members[slot] = index;
+                }
+                group.clear();
+            }
+
+        private:
+            using TRange = std::pair<TIndex,TIndex>;
+
+            Store&                                        m_store;
+            TIndices                                      m_shaped; // by original node
+            std::unordered_map<unsigned long long,TRange> m_ranges; // shaped range by original range
+            TIndex                                        m_bitfieldName;
+            TIndex                                        m_sharedName;
+        };
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void CollectUsedRanges(TRanges& output, const Store& store, const TIndex node)
+    {
+        Helpers::CollectUsedRanges(output, store, store.nodes[node], 0);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void PostProcess(Store& store)
+    {
+        TRACE_SCOPE("PostProcess");
+
+        std::vector<bool> visited(store.nodes.size(), false);
+        for (const TIndex root : store.roots)
+        {
+            Helpers::PostProcessNode(visited, store, root);
+        }
+
+        Helpers::LayoutShaper shaper(store);
+        for (TIndex& root : store.roots)
+        {
+            root = shaper.Shape(root);
+        }
+    }
+}
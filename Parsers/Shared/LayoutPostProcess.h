@@ -0,0 +1,25 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "LayoutDefinitions.h"
+
+namespace Layout
+{
+    using TRanges = std::vector<std::pair<TAmount,TAmount>>;
+
+    // Computes the real size of every node, the bytes not lost to padding, with the same rules the viewer applies
+    // to display the layout: empty members are ignored, bitfields sharing storage count once, members at the same
+    // offset and union members overlap, and members starting inside a previous one don't add to the total.
+    // Nodes shared by several parents are computed once, so both passes are linear on the number of unique nodes.
+    // The roots are then replaced by the layouts as the viewer displays them: union types get the Union category,
+    // bitfields sharing storage become a single node holding the bit ranges of every field, named "Bitfield" when
+    // there is more than one, and other members at the same offset are grouped under a "Shared Memory" node.
+
+    void PostProcess(Store& store);
+
+    // Byte ranges counted in the real size of a processed node, relative to its start, following the same rules.
+    // They don't overlap and add up to the real size, so padding can be located without computing it differently.
+    void CollectUsedRanges(TRanges& output, const Store& store, const TIndex node);
+}
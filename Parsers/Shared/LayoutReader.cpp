@@ -0,0 +1,303 @@
+#include "LayoutReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "IO.h"
+#include "LayoutFormat.h"
+
+namespace Layout
+{
+    namespace Helpers
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        template<typename T> const T* GetSection(const char* data, const size_t size, const Format::FileHeader& header, const Format::Section::Type section, const uint64_t count)
+        {
+            //null when the section doesn't fit in the file
+            const uint64_t offset = header.sections[section];
+            return offset % alignof(T) == 0u && offset <= size && count <= (size - offset) / sizeof(T) ? reinterpret_cast<const T*>(data + offset) : nullptr;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        Location ToLocation(const int32_t fileIndex, const uint32_t line, const uint32_t column)
+        {
+            Location location;
+            location.fileIndex = fileIndex;
+            location.line      = line;
+            location.column    = column;
+            return location;
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    //empty views give back defaults, so a corrupt reference never reaches the mapping
+    TIndex           NodeView::GetIndex() const         { return m_record ? static_cast<TIndex>(m_record - m_reader->m_nodes) : 0u; }
+    std::string_view NodeView::GetType() const          { return m_record ? m_reader->GetString(m_record->type) : std::string_view(); }
+    TIndex           NodeView::GetTypeIndex() const     { return m_record ? m_record->type : 0u; }
+    std::string_view NodeView::GetName() const          { return m_record ? m_reader->GetString(m_record->name) : std::string_view(); }
+    TAmount          NodeView::GetOffset() const        { return m_record ? m_record->offset : 0; }
+    TAmount          NodeView::GetSize() const          { return m_record ? m_record->size : 0; }
+    TAmount          NodeView::GetRealSize() const      { return m_record ? m_record->realSize : 0; }
+    TAmount          NodeView::GetAlign() const         { return m_record ? m_record->align : 1; }
+    Category         NodeView::GetNature() const        { return m_record ? static_cast<Category>(m_record->nature) : Category::Root; }
+    bool             NodeView::IsValid() const          { return m_record && m_record->isValid != 0u; }
+    Location         NodeView::GetTypeLocation() const  { return m_record ? Helpers::ToLocation(m_record->typeFile, m_record->typeLine, m_record->typeColumn) : Location(); }
+    Location         NodeView::GetFieldLocation() const { return m_record ? Helpers::ToLocation(m_record->fieldFile, m_record->fieldLine, m_record->fieldColumn) : Location(); }
+    TIndex           NodeView::GetNumChildren() const   { return m_record ? m_record->numChildren : 0u; }
+    TIndex           NodeView::GetFirstChild() const    { return m_record ? m_record->firstChild : 0u; }
+
+    // ----------------------------------------------------------------------------------------------------------
+    NodeView NodeView::GetChild(const TIndex index) const
+    {
+        if (!m_record)
+        {
+            return NodeView();
+        }
+
+        const uint64_t child = static_cast<uint64_t>(m_record->firstChild) + index;
+        return index < m_record->numChildren && child < m_reader->m_header->numChildren ? m_reader->GetNode(m_reader->m_children[child]) : NodeView();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    Reader::Reader()
+        : m_data(nullptr)
+        , m_size(0u)
+        , m_header(nullptr)
+        , m_stringOffsets(nullptr)
+        , m_stringData(nullptr)
+        , m_files(nullptr)
+        , m_nodes(nullptr)
+        , m_children(nullptr)
+        , m_roots(nullptr)
+        , m_index(nullptr)
+    {}
+
+    // ----------------------------------------------------------------------------------------------------------
+    Reader::~Reader()
+    {
+        Close();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Reader::Open(const char* filename)
+    {
+        Close();
+
+        if (!Map(filename))
+        {
+            LOG_ERROR("Unable to map %s.", filename);
+            return false;
+        }
+
+        int32_t version = 0;
+        if (m_size < sizeof(version) || (memcpy(&version, m_data, sizeof(version)), version != Format::DATA_VERSION))
+        {
+            LOG_ERROR("Unsupported file version found in %s.", filename);
+            Close();
+            return false;
+        }
+
+        //an empty result only holds the version
+        if (m_size > sizeof(version) && !ReadSections())
+        {
+            LOG_ERROR("Unable to read %s, the file is truncated or corrupt.", filename);
+            Close();
+            return false;
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Reader::Close()
+    {
+        Unmap();
+        m_header        = nullptr;
+        m_stringOffsets = nullptr;
+        m_stringData    = nullptr;
+        m_files         = nullptr;
+        m_nodes         = nullptr;
+        m_children      = nullptr;
+        m_roots         = nullptr;
+        m_index         = nullptr;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool Reader::ReadSections()
+    {
+        //mappings are page aligned, the header can be read in place
+        if (m_size < sizeof(Format::FileHeader))
+        {
+            return false;
+        }
+
+        const Format::FileHeader& header = *reinterpret_cast<const Format::FileHeader*>(m_data);
+
+        m_stringOffsets = Helpers::GetSection<uint32_t>(m_data, m_size, header, Format::Section::StringOffsets, static_cast<uint64_t>(header.numStrings) + 1u);
+        m_files         = Helpers::GetSection<uint32_t>(m_data, m_size, header, Format::Section::Files, header.numFiles);
+        m_nodes         = Helpers::GetSection<Format::NodeRecord>(m_data, m_size, header, Format::Section::Nodes, header.numNodes);
+        m_children      = Helpers::GetSection<uint32_t>(m_data, m_size, header, Format::Section::Children, header.numChildren);
+        m_roots         = Helpers::GetSection<uint32_t>(m_data, m_size, header, Format::Section::Roots, header.numRoots);
+        m_index         = Helpers::GetSection<uint32_t>(m_data, m_size, header, Format::Section::Index, header.numRoots);
+        m_stringData    = m_stringOffsets ? Helpers::GetSection<char>(m_data, m_size, header, Format::Section::StringData, m_stringOffsets[header.numStrings]) : nullptr;
+
+        m_header = &header;
+        if (!m_stringOffsets || !m_stringData || !m_files || !m_nodes || !m_children || !m_roots || !m_index)
+        {
+            return false;
+        }
+
+        //the lookups binary search the index without further checks, every entry must point to an existing root
+        for (TIndex i = 0u; i < header.numRoots; ++i)
+        {
+            if (m_index[i] >= header.numRoots || m_roots[m_index[i]] >= header.numNodes)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    TIndex Reader::GetNumRoots() const   { return m_header ? m_header->numRoots : 0u; }
+    TIndex Reader::GetNumNodes() const   { return m_header ? m_header->numNodes : 0u; }
+    TIndex Reader::GetNumFiles() const   { return m_header ? m_header->numFiles : 0u; }
+    TIndex Reader::GetNumStrings() const { return m_header ? m_header->numStrings : 0u; }
+
+    // ----------------------------------------------------------------------------------------------------------
+    NodeView Reader::GetNode(const TIndex index) const
+    {
+        return index < GetNumNodes() ? NodeView(this, m_nodes + index) : NodeView();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    NodeView Reader::GetRoot(const TIndex index) const
+    {
+        return index < GetNumRoots() ? GetNode(m_roots[index]) : NodeView();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    NodeView Reader::FindRoot(std::string_view typeName) const
+    {
+        //the index holds root positions sorted by type name, ties keep the export order
+        const uint32_t* end = m_index + GetNumRoots();
+        const uint32_t* found = std::lower_bound(m_index, end, typeName, [this](const uint32_t position, std::string_view name){ return GetRoot(position).GetType() < name; });
+        if (found != end)
+        {
+            const NodeView root = GetRoot(*found);
+            if (root && root.GetType() == typeName)
+            {
+                return root;
+            }
+        }
+        return NodeView();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    std::string_view Reader::GetFile(const int index) const
+    {
+        return index >= 0 && static_cast<TIndex>(index) < GetNumFiles() ? GetString(m_files[index]) : std::string_view();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    std::string_view Reader::GetString(const TIndex index) const
+    {
+        if (index >= GetNumStrings())
+        {
+            return std::string_view();
+        }
+
+        //strings are null terminated, the terminator is not part of the view
+        const uint32_t start = m_stringOffsets[index];
+        const uint32_t end   = m_stringOffsets[index + 1];
+        return start < end && end <= m_stringOffsets[m_header->numStrings] ? std::string_view(m_stringData + start, end - start - 1u) : std::string_view();
+    }
+
+#ifdef _WIN32
+    // ----------------------------------------------------------------------------------------------------------
+    bool Reader::Map(const char* filename)
+    {
+        HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            return false;
+        }
+
+        LARGE_INTEGER size;
+        HANDLE mapping = GetFileSizeEx(file, &size) && size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+        //the view keeps the mapping alive
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+
+        if (view == nullptr)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const char*>(view);
+        m_size = static_cast<size_t>(size.QuadPart);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Reader::Unmap()
+    {
+        if (m_data)
+        {
+            UnmapViewOfFile(m_data);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#else
+    // ----------------------------------------------------------------------------------------------------------
+    bool Reader::Map(const char* filename)
+    {
+        const int file = open(filename, O_RDONLY);
+        if (file < 0)
+        {
+            return false;
+        }
+
+        struct stat info;
+        void* view = fstat(file, &info) == 0 && info.st_size > 0 ? mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+
+        //the mapping keeps the file alive
+        close(file);
+
+        if (view == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_data = static_cast<const char*>(view);
+        m_size = static_cast<size_t>(info.st_size);
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Reader::Unmap()
+    {
+        if (m_data)
+        {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+        m_data = nullptr;
+        m_size = 0u;
+    }
+#endif
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "LayoutDefinitions.h"
+
+namespace Layout
+{
+    namespace Format
+    {
+        struct FileHeader;
+        struct NodeRecord;
+    }
+
+    class Reader;
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Read only view of a node record inside a mapped file, valid while the reader stays open.
+    // Views are two pointers: walking a tree allocates nothing and only touches the pages of the visited nodes.
+    class NodeView
+    {
+    public:
+        NodeView()
+            : m_reader(nullptr)
+            , m_record(nullptr)
+        {}
+
+        NodeView(const Reader* reader, const Format::NodeRecord* record)
+            : m_reader(reader)
+            , m_record(record)
+        {}
+
+        explicit operator bool() const { return m_record != nullptr; }
+
+        TIndex           GetIndex() const;
+        std::string_view GetType() const;
+        TIndex           GetTypeIndex() const;                // string index, strings are unique so equal types share it
+        std::string_view GetName() const;
+        TAmount          GetOffset() const;
+        TAmount          GetSize() const;
+        TAmount          GetRealSize() const;
+        TAmount          GetAlign() const;
+        Category         GetNature() const;
+        bool             IsValid() const;
+        Location         GetTypeLocation() const;
+        Location         GetFieldLocation() const;
+        TIndex           GetNumChildren() const;
+        TIndex           GetFirstChild() const;               // children range start, copies of a record share their range
+        NodeView         GetChild(const TIndex index) const; // empty view when out of range or corrupt
+
+    private:
+        const Reader*             m_reader;
+        const Format::NodeRecord* m_record;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Memory mapped .slbin reader: opening only validates the header and the section bounds, so inspecting a single
+    // type of a multi GB export costs the index binary search plus the pages of that type.
+    class Reader
+    {
+        friend class NodeView;
+
+    public:
+        Reader();
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool Open(const char* filename);
+        void Close();
+        bool IsOpen() const { return m_data != nullptr; }
+
+        TIndex           GetNumRoots() const;
+        NodeView         GetRoot(const TIndex index) const;
+        NodeView         FindRoot(std::string_view typeName) const; // first exported root with this type, empty view when missing
+
+        TIndex           GetNumNodes() const;
+        NodeView         GetNode(const TIndex index) const;
+
+        TIndex           GetNumFiles() const;
+        std::string_view GetFile(const int index) const;
+
+        TIndex           GetNumStrings() const;
+        std::string_view GetString(const TIndex index) const;
+
+    private:
+        bool Map(const char* filename);
+        void Unmap();
+        bool ReadSections();
+
+        const char*               m_data;
+        size_t                    m_size;
+        const Format::FileHeader* m_header;        // null for empty results, only holding the version
+        const uint32_t*           m_stringOffsets;
+        const char*               m_stringData;
+        const uint32_t*           m_files;
+        const Format::NodeRecord* m_nodes;
+        const uint32_t*           m_children;
+        const uint32_t*           m_roots;
+        const uint32_t*           m_index;
+    };
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// The tools use the CRT secure functions, the other platforms get standard fallbacks with the same contract
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <cstdio>
+
+typedef int errno_t;
+
+inline errno_t fopen_s(FILE** stream, const char* filename, const char* mode)
+{
+    *stream = fopen(filename, mode);
+    return *stream ? 0 : errno;
+}
+
+// only for formats without %s, %c or %[ conversions, the secure version expects a buffer size after those
+#define sscanf_s(buffer, format, ...) sscanf(buffer, format, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,315 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "IO.h"
+#include "Platform.h"
+
+namespace Trace
+{
+    struct Event
+    {
+        const char*  name;
+        char         phase;    // 'X' complete scope, 'C' counter
+        unsigned int thread;
+        long long    start;    // microseconds since Start
+        long long    duration; // microseconds for scopes, current value for counters
+    };
+
+    struct Counter
+    {
+        const char* name;
+        long long   value;
+    };
+
+    struct Phase
+    {
+        const char*  name;
+        long long    first;
+        long long    total;
+        long long    longest;
+        unsigned int calls;
+    };
+
+    struct Globals
+    {
+        Globals()
+            : enabled(false)
+            , nextThread(1u)
+        {}
+
+        std::atomic<bool>                     enabled;
+        std::atomic<unsigned int>             nextThread;
+        std::mutex                            mutex;
+        std::string                           filename;
+        std::chrono::steady_clock::time_point start;
+        std::vector<Event>                    events;
+        std::vector<Counter>                  counters;
+    };
+
+    Globals g_globals;
+
+    thread_local unsigned int t_threadId = 0u;
+
+    namespace Helpers
+    {
+        // ----------------------------------------------------------------------------------------------------------
+        long long GetTimestamp(const std::chrono::steady_clock::time_point& time)
+        {
+            return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(time - g_globals.start).count());
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        unsigned int GetThreadId()
+        {
+            //small sequential ids keep the trace viewer rows in creation order
+            if (t_threadId == 0u)
+            {
+                t_threadId = g_globals.nextThread++;
+            }
+            return t_threadId;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        // Call with the mutex held
+        Counter& FindCounter(const char* name)
+        {
+            for (Counter& counter : g_globals.counters)
+            {
+                if (counter.name == name || strcmp(counter.name, name) == 0)
+                {
+                    return counter;
+                }
+            }
+
+            g_globals.counters.push_back(Counter{ name, 0 });
+            return g_globals.counters.back();
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void UpdateCounter(const char* name, const long long value, const bool accumulate)
+        {
+            if (!g_globals.enabled)
+            {
+                return;
+            }
+
+            const long long now = GetTimestamp(std::chrono::steady_clock::now());
+            const unsigned int thread = GetThreadId();
+
+            std::lock_guard<std::mutex> lock(g_globals.mutex);
+            Counter& counter = FindCounter(name);
+            counter.value = accumulate ? counter.value + value : std::max(counter.value, value);
+            g_globals.events.push_back(Event{ name, 'C', thread, now, counter.value });
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void CollectPhases(std::vector<Phase>& phases)
+        {
+            for (const Event& event : g_globals.events)
+            {
+                if (event.phase != 'X')
+                {
+                    continue;
+                }
+
+                Phase* found = nullptr;
+                for (Phase& phase : phases)
+                {
+                    if (phase.name == event.name || strcmp(phase.name, event.name) == 0)
+                    {
+                        found = &phase;
+                        break;
+                    }
+                }
+
+                if (found == nullptr)
+                {
+                    phases.push_back(Phase{ event.name, event.start, 0, 0, 0u });
+                    found = &phases.back();
+                }
+
+                found->first   = std::min(found->first, event.start);
+                found->total  += event.duration;
+                found->longest = std::max(found->longest, event.duration);
+                ++found->calls;
+            }
+
+            //scopes are recorded when they end, list the phases in the order they started instead, parents first
+            std::sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b){ return a.first < b.first || (a.first == b.first && a.longest > b.longest); });
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        bool WriteTrace(const char* filename)
+        {
+            FILE* stream = nullptr;
+            if (fopen_s(&stream, filename, "w") != 0 || stream == nullptr)
+            {
+                return false;
+            }
+
+            //Chrome trace event format, the counters are repeated as metadata for a quick look
+            fprintf(stream, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+            fprintf(stream, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"StructLayout parser\"}}");
+            for (const Event& event : g_globals.events)
+            {
+                if (event.phase == 'X')
+                {
+                    fprintf(stream, ",\n{\"name\":\"%s\",\"cat\":\"parser\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"dur\":%lld}", event.name, event.thread, event.start, event.duration);
+                }
+                else
+                {
+                    fprintf(stream, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"tid\":%u,\"ts\":%lld,\"args\":{\"value\":%lld}}", event.name, event.thread, event.start, event.duration);
+                }
+            }
+
+            fprintf(stream, "\n],\"otherData\":{");
+            for (size_t i = 0u; i < g_globals.counters.size(); ++i)
+            {
+                fprintf(stream, "%s\"%s\":%lld", i == 0u ? "" : ",", g_globals.counters[i].name, g_globals.counters[i].value);
+            }
+            fprintf(stream, "}}\n");
+
+            return fclose(stream) == 0;
+        }
+
+        // ----------------------------------------------------------------------------------------------------------
+        void LogSummary()
+        {
+            std::vector<Phase> phases;
+            CollectPhases(phases);
+
+            //phases running on several threads add up their time
+            LOG_ALWAYS("Trace summary:");
+            for (const Phase& phase : phases)
+            {
+                LOG_ALWAYS("  %-24s %12.3f ms  %6u calls  longest %10.3f ms", phase.name, phase.total / 1000.0, phase.calls, phase.longest / 1000.0);
+            }
+            for (const Counter& counter : g_globals.counters)
+            {
+                LOG_ALWAYS("  %-24s %12lld", counter.name, counter.value);
+            }
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Start(const char* filename)
+    {
+        std::lock_guard<std::mutex> lock(g_globals.mutex);
+        g_globals.filename = filename ? filename : "";
+        g_globals.start    = std::chrono::steady_clock::now();
+        g_globals.events.clear();
+        g_globals.counters.clear();
+        g_globals.enabled  = true;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void Stop()
+    {
+        if (!g_globals.enabled)
+        {
+            return;
+        }
+
+        MaxCounter("peakMemoryBytes", static_cast<long long>(GetPeakMemory()));
+
+        std::lock_guard<std::mutex> lock(g_globals.mutex);
+        g_globals.enabled = false;
+
+        Helpers::LogSummary();
+
+        if (!g_globals.filename.empty())
+        {
+            if (Helpers::WriteTrace(g_globals.filename.c_str()))
+            {
+                LOG_ALWAYS("Trace written to %s.", g_globals.filename.c_str());
+            }
+            else
+            {
+                LOG_ERROR("Unable to write the trace file %s.", g_globals.filename.c_str());
+            }
+        }
+
+        g_globals.events.clear();
+        g_globals.counters.clear();
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    bool IsEnabled()
+    {
+        return g_globals.enabled;
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void AddCounter(const char* name, const long long value)
+    {
+        Helpers::UpdateCounter(name, value, true);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    void MaxCounter(const char* name, const long long value)
+    {
+        Helpers::UpdateCounter(name, value, false);
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    size_t GetPeakMemory()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters;
+        return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? static_cast<size_t>(counters.PeakWorkingSetSize) : 0u;
+#else
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+        {
+            return 0u;
+        }
+#ifdef __APPLE__
+        return static_cast<size_t>(usage.ru_maxrss);
+#else
+        //kilobytes on Linux
+        return static_cast<size_t>(usage.ru_maxrss) * 1024u;
+#endif
+#endif
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    Scope::Scope(const char* name)
+        : m_name(g_globals.enabled ? name : nullptr)
+    {
+        if (m_name)
+        {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    // ----------------------------------------------------------------------------------------------------------
+    Scope::~Scope()
+    {
+        if (m_name == nullptr || !g_globals.enabled)
+        {
+            return;
+        }
+
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        const Event event{ m_name, 'X', Helpers::GetThreadId(), Helpers::GetTimestamp(m_start), Helpers::GetTimestamp(end) - Helpers::GetTimestamp(m_start) };
+
+        std::lock_guard<std::mutex> lock(g_globals.mutex);
+        g_globals.events.push_back(event);
+    }
+}
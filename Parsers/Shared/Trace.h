@@ -0,0 +1,51 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+#define TRACE_CONCAT_IMPL(a,b) a##b
+#define TRACE_CONCAT(a,b)      TRACE_CONCAT_IMPL(a,b)
+#define TRACE_SCOPE(name)      Trace::Scope TRACE_CONCAT(traceScope,__LINE__)(name)
+
+namespace Trace
+{
+    // Instrumentation of the parser phases: scopes become Chrome trace events (chrome://tracing, Perfetto) and a per
+    // phase wall time summary, counters become counter events and summary totals. Everything is a no-op until Start
+    // is called, a disabled scope costs one branch. Names must be string literals, only their pointer is stored.
+
+    void Start(const char* filename); // an empty filename only collects the summary
+    void Stop();                      // writes the trace file and logs the summary, no-op when not started
+    bool IsEnabled();
+
+    void AddCounter(const char* name, const long long value); // accumulated over the whole run
+    void MaxCounter(const char* name, const long long value); // keeps the highest value reported
+
+    size_t GetPeakMemory(); // peak resident set size of the process in bytes, 0 when unknown
+
+    // ----------------------------------------------------------------------------------------------------------
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char*                           m_name; // null when tracing is disabled
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    // ----------------------------------------------------------------------------------------------------------
+    // Traces its own lifetime when given a filename, so every early return of a parser entry point still reports
+    class Session
+    {
+    public:
+        explicit Session(const char* filename) { if (filename) Start(filename); }
+        ~Session() { Stop(); }
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+    };
+}
@@ -217,8 +217,19 @@ namespace StructLayout
         public bool PrintCommandLine { get; set; } = false;
         public string OutputDirectory { get; set; } = null;        
 
-        public const uint VERSION = 2;
-      
+        public const uint VERSION = 6;
+
+        private const long NodeRecordSize = 72;
+
+        private enum Section { StringOffsets, StringData, Files, Nodes, Children, Roots, Index, Count }
+
+        private class FileTables
+        {
+            public long[] Sections { get; } = new long[(int)Section.Count];
+            public List<string> Files { set; get; } = null;
+            public Dictionary<uint, string> Strings { get; } = new Dictionary<uint, string>();
+        }
+
         private string GetToolPath(string localPath)
         {
             string installDirectory = EditorUtils.GetExtensionInstallationDirectory();
@@ -236,241 +247,120 @@ namespace StructLayout
             return GetToolPath(@"External\PDBLayout.exe");
         }
 
-        private LayoutLocation ReadLocation(BinaryReader reader, List<string> files)
+        private string ReadString(BinaryReader reader, FileTables tables, uint index)
         {
-            int fileIndex = reader.ReadInt32();
-
-            if (fileIndex < 0 || fileIndex >= files.Count)
+            string ret;
+            if (!tables.Strings.TryGetValue(index, out ret))
             {
-                return null;
-            }
-
-            LayoutLocation ret = new LayoutLocation { Filename = files[fileIndex] };
+                reader.BaseStream.Seek(tables.Sections[(int)Section.StringOffsets] + index * 4L, SeekOrigin.Begin);
+                uint start = reader.ReadUInt32();
+                uint end = reader.ReadUInt32();
 
-            ret.Line   = reader.ReadUInt32(); 
-            ret.Column = reader.ReadUInt32();
+                //stored null terminated, the terminator is not part of the string
+                reader.BaseStream.Seek(tables.Sections[(int)Section.StringData] + start, SeekOrigin.Begin);
+                ret = Encoding.UTF8.GetString(reader.ReadBytes((int)(end - start - 1)));
+                tables.Strings.Add(index, ret);
+            }
 
             return ret;
         }
 
-        private LayoutNode ReadNode(BinaryReader reader, List<string> files)
+        private FileTables ReadTables(BinaryReader reader)
         {
-            LayoutNode node = new LayoutNode();
-            node.Type = reader.ReadString();
-            node.Name = reader.ReadString();
-
-            node.Offset = (uint)reader.ReadInt64();
-            node.Size = (uint)reader.ReadInt64();
-            node.Align = (uint)reader.ReadInt64();
-            node.Category = (LayoutNode.LayoutCategory)reader.ReadByte();
-            node.IsValid = reader.ReadBoolean();
-
-            node.TypeLocation = ReadLocation(reader, files);
-            node.FieldLocation = ReadLocation(reader, files);
-
-            uint numChildren = reader.ReadUInt32();
-            for (uint i = 0; i < numChildren; ++i)
-            {
-                node.AddChild(ReadNode(reader, files));
-            }
+            FileTables tables = new FileTables();
 
-            return node;
-        }
-
-        private List<string> ReadFiles(BinaryReader reader)
-        {
+            reader.ReadUInt32(); //numStrings
             uint numFiles = reader.ReadUInt32();
-            List<string> output = new List<string>((int)numFiles);
+            reader.ReadUInt32(); //numNodes
+            reader.ReadUInt32(); //numChildren
+            reader.ReadUInt32(); //numRoots
 
-            for (uint i = 0; i < numFiles; ++i)
+            for (int i = 0; i < (int)Section.Count; ++i)
             {
-                output.Add(reader.ReadString());
+                tables.Sections[i] = (long)reader.ReadUInt64();
             }
 
-            return output;
-        }
-
-        private void FinalizeNodeRecursive(LayoutNode node)
-        {
-            node.Offset += node.Parent != null ? node.Parent.Offset : 0;
-            node.RenderData.Background = node.IsValid? Colors.GetCategoryBackground(node.Category) : Colors.GetErrorBrush();
-
-            node.RealSize = node.Children.Count == 0? node.Size : 0;
-            uint realSizeOffset = node.Offset;
-            foreach (LayoutNode child in node.Children)
-            {
-                FinalizeNodeRecursive(child);
-
-                node.RealSize += realSizeOffset <= child.Offset ? child.RealSize : 0;
-                realSizeOffset = Math.Max(child.Offset+child.Size,realSizeOffset);
-            }
-
-            //For shared memory nodes, children will be overlaped 
-            if (node.Category == LayoutNode.LayoutCategory.Shared || node.Category == LayoutNode.LayoutCategory.Union)
+            tables.Files = new List<string>((int)numFiles);
+            for (uint i = 0; i < numFiles; ++i)
             {
-                foreach (LayoutNode child in node.Children)
-                {
-                    node.RealSize = Math.Max(child.RealSize, node.RealSize);
-                }
+                reader.BaseStream.Seek(tables.Sections[(int)Section.Files] + i * 4L, SeekOrigin.Begin);
+                tables.Files.Add(ReadString(reader, tables, reader.ReadUInt32()));
             }
-        }
 
-        private void FixUnions(LayoutNode node)
-        {
-            if (node.Type.Length > 0 && node.Type.StartsWith("union"))
-            {
-                node.Category = LayoutNode.LayoutCategory.Union;
-            }
+            return tables;
         }
 
-        private void AdjustBitfieldNode(LayoutNode node)
+        private LayoutLocation ReadLocation(BinaryReader reader, List<string> files)
         {
-            node.Extra = node.Children;
-            node.Children = new List<LayoutNode>();
-
-            foreach (LayoutNode child in node.Extra)
-            {
-                child.Name     = node.Name;
-                child.Type     = node.Type;
-                child.Category = node.Category;
-            }
-        }
+            int fileIndex = reader.ReadInt32();
+            uint line     = reader.ReadUInt32();
+            uint column   = reader.ReadUInt32();
 
-        private void MergeBitfieldNodes(LayoutNode source, LayoutNode target)
-        {
-            foreach (LayoutNode child in source.Extra)
+            if (fileIndex < 0 || fileIndex >= files.Count)
             {
-                target.Extra.Add(child);
+                return null;
             }
 
-            if (target.Extra.Count > 1)
-            {
-                target.Name = "Bitfield";
-            }
+            return new LayoutLocation { Filename = files[fileIndex], Line = line, Column = column };
         }
 
-        private void FixBitfields(LayoutNode node)
+        private LayoutNode ReadNode(BinaryReader reader, FileTables tables, uint nodeIndex)
         {
-            LayoutNode prevNode = null;
-            for (int i = 0; i < node.Children.Count;)
-            {
-                LayoutNode thisNode = node.Children[i];
-
-                if (thisNode.Category == LayoutNode.LayoutCategory.Bitfield)
-                {
-                    AdjustBitfieldNode(thisNode);
-
-                    if (prevNode != null && prevNode.Category == LayoutNode.LayoutCategory.Bitfield && (thisNode.Offset == prevNode.Offset || thisNode.Offset < prevNode.Offset + prevNode.Size))
-                    {
-                        MergeBitfieldNodes(thisNode, prevNode);
-                        node.Children.RemoveAt(i);
-                        continue;
-                    }
-                }
+            //Node records have a fixed size, only the nodes under the requested root are read
+            reader.BaseStream.Seek(tables.Sections[(int)Section.Nodes] + nodeIndex * NodeRecordSize, SeekOrigin.Begin);
 
-                prevNode = thisNode;
-                ++i;
-            }           
-        }
+            uint typeIndex   = reader.ReadUInt32();
+            uint nameIndex   = reader.ReadUInt32();
+            uint firstChild  = reader.ReadUInt32();
+            uint numChildren = reader.ReadUInt32();
 
-        private void ShareNodes(LayoutNode nodeA, LayoutNode nodeB)
-        {
-            LayoutNode parent = nodeA.Parent;
+            LayoutNode node = new LayoutNode();
+            node.Offset = (uint)reader.ReadInt64();
+            node.Size = (uint)reader.ReadInt64();
+            node.RealSize = (uint)reader.ReadInt64();
+            node.Align = reader.ReadUInt32();
+            node.TypeLocation = ReadLocation(reader, tables.Files);
+            node.FieldLocation = ReadLocation(reader, tables.Files);
+            node.Category = (LayoutNode.LayoutCategory)reader.ReadByte();
+            node.IsValid = reader.ReadBoolean();
 
-            LayoutNode share;
+            node.Type = ReadString(reader, tables, typeIndex);
+            node.Name = ReadString(reader, tables, nameIndex);
 
-            //Create or update the Shared node
-            if (nodeA.Category != LayoutNode.LayoutCategory.Shared)
-            {
-                //Create the new node
-                share = new LayoutNode();
-                share.Name = "Shared Memory";
-                share.Category = LayoutNode.LayoutCategory.Shared;
-                share.Offset = nodeA.Offset;
-                share.Size = nodeA.Size;
-                share.IsValid = nodeA.IsValid;
-                nodeA.Offset = 0;
-
-                //inject the new node
-                int index = parent.Children.IndexOf(nodeA);
-                share.Children.Add(nodeA);
-                parent.Children[index] = share;
-
-                share.Parent = parent;
-                nodeA.Parent = share;
-            }
-            else
+            //Shared children ranges are read once per node, nodes get modified later on so they need their own copy
+            for (uint i = 0; i < numChildren; ++i)
             {
-                share = nodeA;
-            }
-
-            //perform the merge
-            share.Size = Math.Max(share.Size, nodeB.Size);
-            nodeB.Offset = 0;
-            share.Children.Add(nodeB);
-            nodeB.Parent = share;
-            parent.Children.Remove(nodeB);
-            share.IsValid = nodeA.IsValid && nodeB.IsValid;
-        }
+                reader.BaseStream.Seek(tables.Sections[(int)Section.Children] + (firstChild + i) * 4L, SeekOrigin.Begin);
+                LayoutNode childNode = ReadNode(reader, tables, reader.ReadUInt32());
 
-        private void FixEmptyTypes(LayoutNode node)
-        {
-            for (int i = 0; i < node.Children.Count;)
-            {
-                var childNode = node.Children[i];
-                if (childNode.Size == 0)
+                //The parsers already merged the bitfields and shared memory, only the bit ranges and the empty members are hidden
+                if (node.Category == LayoutNode.LayoutCategory.Bitfield || (childNode.Size == 0 && !node.IsSharedMemory()))
                 {
-                    //We don't accept elements of 0 size ( can be Empty Base Optimization or something unexpected )
-                    node.Children.RemoveAt(i);
+                    childNode.Parent = node;
                     node.Extra.Add(childNode);
                 }
                 else
                 {
-                    ++i;
+                    node.AddChild(childNode);
                 }
             }
-        }
 
-        private void FixSharedMemory(LayoutNode node)
-        {
-            for (int i = 1; i < node.Children.Count;)
-            {
-                var thisNode = node.Children[i];
-                var prevNode = node.Children[i - 1];
-
-                if (thisNode.Offset == prevNode.Offset)
-                {
-                    ShareNodes(prevNode,thisNode);
-                }
-                else
-                {
-                    ++i;
-                }
-            }
+            return node;
         }
 
-        private void FixOverlaps(LayoutNode node)
+        private void FinalizeNodeRecursive(LayoutNode node)
         {
-            FixUnions(node);
-
-            if (!node.IsSharedMemory())
-            {
-                FixEmptyTypes(node);
-                FixBitfields(node);
-                FixSharedMemory(node);
-            }
+            node.Offset += node.Parent != null ? node.Parent.Offset : 0;
+            node.RenderData.Background = node.IsValid? Colors.GetCategoryBackground(node.Category) : Colors.GetErrorBrush();
 
-            //continue recursion
             foreach (LayoutNode child in node.Children)
             {
-                FixOverlaps(child);
+                FinalizeNodeRecursive(child);
             }
         }
 
         public void FinalizeNode(LayoutNode node)
         {
-            FixOverlaps(node);
-
             node.Expand();
 
             FinalizeNodeRecursive(node);
@@ -524,8 +414,9 @@ namespace StructLayout
                 }
                 else
                 {
-                    List<string> files = ReadFiles(reader);
-                    ret.Layout = ReadNode(reader, files);
+                    FileTables tables = ReadTables(reader);
+                    reader.BaseStream.Seek(tables.Sections[(int)Section.Roots], SeekOrigin.Begin);
+                    ret.Layout = ReadNode(reader, tables, reader.ReadUInt32());
                     FinalizeNode(ret.Layout);
 
                     OutputLog.Log("Found structure " + ret.Layout.Type + ".");